@@ -0,0 +1,326 @@
+#include "triangulation.h"
+#include "surfaces.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdlib.h>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+// Runs the refinement pipeline without a window and reports the time spent
+// in every phase as JSON, one record per face budget, or per number of
+// levels with --levels= to subdivide uniformly. With --kernels, times the
+// surface sampling kernels instead. With --halfedge, also times the
+// conversion of the refined surface to a GtsHMesh and back and reports the
+// memory taken by its arrays. With --jobs=, refines as many independent
+// surfaces at once on separate threads, reporting the times of the first
+// one and the wall time of them all.
+
+double elapsed(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - since).count();
+}
+
+// Peak resident set size of the process in kilobytes
+long peakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+std::vector<guint> parseCounts(const char * list)
+{
+    std::vector<guint> counts;
+    const char * p = list;
+    while (*p) {
+        char * end = nullptr;
+        const unsigned long n = strtoul(p, &end, 10);
+        if (end == p || n == 0) {
+            ERROR("Invalid count: %s", list);
+        }
+        counts.push_back(static_cast<guint>(n));
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            ERROR("Invalid count: %s", list);
+        }
+    }
+    return counts;
+}
+
+// Times the batch kernels of every surface model against evaluating the
+// points one at a time through the height field table, as the solvers did
+void benchmarkKernels()
+{
+    const size_t n = 1 << 20;
+    const int repeats = 10;
+    std::vector<double> x(n), y(n), z(n), fx(n), fy(n), reference(n);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < n; i ++) {
+        seed = seed * 1103515245 + 12345;
+        x[i] = 2.0 * (seed >> 8) / (1 << 24) - 1.0;
+        seed = seed * 1103515245 + 12345;
+        y[i] = 2.0 * (seed >> 8) / (1 << 24) - 1.0;
+    }
+
+    printf("{\n");
+    printf("  \"lanes\": %d,\n", SURFACE_LANES);
+    printf("  \"points\": %zu,\n", n);
+    printf("  \"kernels\": [");
+    for (size_t k = 0; k < heightFieldCount; k ++) {
+        const HeightField & field = heightFields[k];
+
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r ++)
+            for (size_t i = 0; i < n; i ++)
+                reference[i] = field.f(x[i], y[i]);
+        const double scalarTime = elapsed(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r ++)
+            field.evaluate(x.data(), y.data(), z.data(), n);
+        const double batchTime = elapsed(start);
+
+        double error = 0.0;
+        for (size_t i = 0; i < n; i ++)
+            error = std::max(error, fabs(z[i] - reference[i]));
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r ++)
+            for (size_t i = 0; i < n; i ++)
+                field.evaluateGradient(&x[i], &y[i], &z[i], &fx[i], &fy[i], 1);
+        const double scalarGradientTime = elapsed(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r ++)
+            field.evaluateGradient(x.data(), y.data(), z.data(),
+                fx.data(), fy.data(), n);
+        const double batchGradientTime = elapsed(start);
+
+        const double ns = 1e9 / (static_cast<double>(n) * repeats);
+        printf(k ? ",\n" : "\n");
+        printf("    {\n");
+        printf("      \"surface\": \"%s\",\n", field.name);
+        printf("      \"scalar_ns\": %.3f,\n", scalarTime * ns);
+        printf("      \"batch_ns\": %.3f,\n", batchTime * ns);
+        printf("      \"scalar_gradient_ns\": %.3f,\n",
+            scalarGradientTime * ns);
+        printf("      \"batch_gradient_ns\": %.3f,\n",
+            batchGradientTime * ns);
+        printf("      \"max_error\": %g\n", error);
+        printf("    }");
+    }
+    printf("\n  ]\n}\n");
+}
+
+// Times and sizes of one refinement, from building the surface to
+// destroying it
+struct RunResult
+{
+    guint vertices, edges, faces;
+    double deviation;
+    bool budgetExceeded;
+    double buildTime, refineTime, exportTime, destroyTime;
+    double toHalfEdgeTime, fromHalfEdgeTime;
+    size_t halfEdgeBytes;
+    size_t cacheHits, cacheMisses;
+};
+
+RunResult runOnce(guint levels, guint maxFaces, double tolerance,
+                  guint threads, bool halfEdge)
+{
+    RunResult r = {};
+    GtsRefineTolerance stop = {};
+    stop.tolerance = tolerance;
+    stop.max_faces = maxFaces;
+    ProjectionCache cache = {};
+
+    auto start = std::chrono::steady_clock::now();
+    GtsSurface * surface = buildSurface();
+    r.buildTime = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+    if (levels > 0)
+        gts_surface_subdivide_uniform(surface, levels,
+            refineEdge, &cache, threads);
+    else
+        refineSurface(surface, cache, stop, threads);
+    r.refineTime = elapsed(start);
+    r.deviation = stop.bound;
+    r.budgetExceeded = stop.budget_exceeded;
+
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<GtsSurfaceBuffers> buffers(
+        gts_surface_buffers_new(surface, TRUE),
+        [] (GtsSurfaceBuffers * b) { gts_surface_buffers_destroy(b); });
+    r.exportTime = elapsed(start);
+
+    if (halfEdge) {
+        start = std::chrono::steady_clock::now();
+        GtsHMesh * mesh = gts_hmesh_new_from_surface(surface);
+        r.toHalfEdgeTime = elapsed(start);
+        r.halfEdgeBytes =
+            mesh->vsize * (3 * sizeof(gdouble) + sizeof(guint32)) +
+            mesh->fsize * (sizeof(guint32) + 3 * 4 * sizeof(guint32));
+
+        start = std::chrono::steady_clock::now();
+        GtsSurface * copy = gts_surface_new(gts_surface_class(),
+            gts_face_class(), gts_edge_class(), gts_vertex_class());
+        gts_hmesh_to_surface(mesh, copy);
+        r.fromHalfEdgeTime = elapsed(start);
+
+        gts_object_destroy(GTS_OBJECT(copy));
+        gts_hmesh_destroy(mesh);
+    }
+
+    r.vertices = gts_surface_vertex_number(surface);
+    r.edges = gts_surface_edge_number(surface);
+    r.faces = gts_surface_face_number(surface);
+    start = std::chrono::steady_clock::now();
+    gts_object_destroy(GTS_OBJECT(surface));
+    r.destroyTime = elapsed(start);
+
+    r.cacheHits = cache.hits.load();
+    r.cacheMisses = cache.misses.load();
+    return r;
+}
+
+int main(int argc, char ** argv)
+{
+    std::vector<guint> faceBudgets = { 1000, 10000, 100000 };
+    std::vector<guint> levels;
+    double tolerance = 0.0;
+    guint threads = 0;
+    guint jobs = 1;
+    bool halfEdge = false;
+
+    for (int i = 1; i < argc; i ++) {
+        const std::string arg = argv[i];
+        if (arg == "--projection=simplex") {
+            projectionEngine = ProjectionEngine::Simplex;
+        } else if (arg == "--projection=newton") {
+            projectionEngine = ProjectionEngine::Newton;
+        } else if (arg == "--cost=exact") {
+            costModel = CostModel::Exact;
+        } else if (arg == "--cost=estimate") {
+            costModel = CostModel::Estimate;
+        } else if (arg == "--allocator=malloc") {
+            objectAllocator = ObjectAllocator::Malloc;
+        } else if (arg == "--allocator=slab") {
+            objectAllocator = ObjectAllocator::Slab;
+        } else if (arg == "--allocator=arena") {
+            objectAllocator = ObjectAllocator::Arena;
+        } else if (arg.compare(0, 10, "--surface=") == 0) {
+            heightField = findHeightField(arg.c_str() + 10);
+            if (heightField == nullptr) {
+                ERROR("Unknown surface: %s", arg.c_str() + 10);
+            }
+        } else if (arg.compare(0, 8, "--faces=") == 0) {
+            faceBudgets = parseCounts(arg.c_str() + 8);
+        } else if (arg.compare(0, 9, "--levels=") == 0) {
+            levels = parseCounts(arg.c_str() + 9);
+        } else if (arg.compare(0, 8, "--slack=") == 0) {
+            refineSlack = atof(arg.c_str() + 8);
+        } else if (arg.compare(0, 12, "--tolerance=") == 0) {
+            tolerance = atof(arg.c_str() + 12);
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            threads = static_cast<guint>(atoi(arg.c_str() + 10));
+        } else if (arg.compare(0, 7, "--jobs=") == 0) {
+            jobs = static_cast<guint>(atoi(arg.c_str() + 7));
+            if (jobs == 0) {
+                ERROR("Invalid number of jobs: %s", arg.c_str() + 7);
+            }
+        } else if (arg == "--halfedge") {
+            halfEdge = true;
+        } else if (arg == "--kernels") {
+            benchmarkKernels();
+            return 0;
+        } else {
+            ERROR("Unknown argument: %s", argv[i]);
+        }
+    }
+
+    printf("{\n");
+    printf("  \"surface\": \"%s\",\n", heightField->name);
+    printf("  \"projection\": \"%s\",\n",
+        projectionEngine == ProjectionEngine::Simplex ? "simplex" : "newton");
+    printf("  \"cost\": \"%s\",\n",
+        costModel == CostModel::Exact ? "exact" : "estimate");
+    printf("  \"allocator\": \"%s\",\n",
+        objectAllocator == ObjectAllocator::Malloc ? "malloc" :
+        objectAllocator == ObjectAllocator::Slab ? "slab" : "arena");
+    printf("  \"tolerance\": %g,\n", tolerance);
+    printf("  \"slack\": %g,\n", refineSlack);
+    printf("  \"threads\": %u,\n",
+        threads ? threads : g_get_num_processors());
+    printf("  \"jobs\": %u,\n", jobs);
+    printf("  \"runs\": [");
+
+    const bool uniform = !levels.empty();
+    const size_t runs = uniform ? levels.size() : faceBudgets.size();
+    for (size_t i = 0; i < runs; i ++) {
+        projectionStats.calls = 0;
+        projectionStats.iterations = 0;
+
+        std::vector<RunResult> results(jobs);
+        auto start = std::chrono::steady_clock::now();
+        if (jobs == 1) {
+            results[0] = runOnce(uniform ? levels[i] : 0,
+                uniform ? 0 : faceBudgets[i], tolerance, threads, halfEdge);
+        } else {
+            std::vector<std::thread> workers;
+            for (guint j = 0; j < jobs; j ++)
+                workers.emplace_back([&, j] {
+                    results[j] = runOnce(uniform ? levels[i] : 0,
+                        uniform ? 0 : faceBudgets[i], tolerance, threads,
+                        halfEdge);
+                });
+            for (std::thread & worker : workers)
+                worker.join();
+        }
+        const double wallTime = elapsed(start);
+        const RunResult & r = results[0];
+
+        printf(i ? ",\n" : "\n");
+        printf("    {\n");
+        if (uniform) {
+            printf("      \"levels\": %u,\n", levels[i]);
+        } else {
+            printf("      \"max_faces\": %u,\n", faceBudgets[i]);
+        }
+        printf("      \"vertices\": %u,\n", r.vertices);
+        printf("      \"edges\": %u,\n", r.edges);
+        printf("      \"faces\": %u,\n", r.faces);
+        if (!uniform) {
+            printf("      \"deviation\": %g,\n", r.deviation);
+            printf("      \"budget_exceeded\": %s,\n",
+                r.budgetExceeded ? "true" : "false");
+        }
+        printf("      \"build_seconds\": %.6f,\n", r.buildTime);
+        printf("      \"refine_seconds\": %.6f,\n", r.refineTime);
+        printf("      \"export_seconds\": %.6f,\n", r.exportTime);
+        printf("      \"destroy_seconds\": %.6f,\n", r.destroyTime);
+        if (halfEdge) {
+            printf("      \"to_halfedge_seconds\": %.6f,\n",
+                r.toHalfEdgeTime);
+            printf("      \"from_halfedge_seconds\": %.6f,\n",
+                r.fromHalfEdgeTime);
+            printf("      \"halfedge_kb\": %zu,\n", r.halfEdgeBytes / 1024);
+        }
+        printf("      \"wall_seconds\": %.6f,\n", wallTime);
+        printf("      \"projection_calls\": %zu,\n",
+            projectionStats.calls.load());
+        printf("      \"projection_iterations\": %zu,\n",
+            projectionStats.iterations.load());
+        printf("      \"cache_hits\": %zu,\n", r.cacheHits);
+        printf("      \"cache_misses\": %zu,\n", r.cacheMisses);
+        printf("      \"peak_rss_kb\": %ld\n", peakRss());
+        printf("    }");
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -222,46 +222,38 @@ static void mark_as_hole (GtsFace * f, GtsSurface * s)
   e3 = GTS_TRIANGLE (f)->e3;
 
   if (!GTS_IS_CONSTRAINT (e1)) {
-    GSList * i = e1->triangles;
-    while (i) {
-      GtsFace * f1 = i->data;
+    GtsFace * f1;
+    guint i;
+    GTS_ADJACENCY_FOREACH (&e1->triangles, i, f1)
       if (f1 != f && GTS_IS_FACE (f1) && gts_face_has_parent_surface (f1, s))
 	mark_as_hole (f1, s);
-      i = i->next;
-    }
   }
   if (!GTS_IS_CONSTRAINT (e2)) {
-    GSList * i = e2->triangles;
-    while (i) {
-      GtsFace * f1 = i->data;
+    GtsFace * f1;
+    guint i;
+    GTS_ADJACENCY_FOREACH (&e2->triangles, i, f1)
       if (f1 != f && GTS_IS_FACE (f1) && gts_face_has_parent_surface (f1, s))
 	mark_as_hole (f1, s);
-      i = i->next;
-    }
   }
   if (!GTS_IS_CONSTRAINT (e3)) {
-    GSList * i = e3->triangles;
-    while (i) {
-      GtsFace * f1 = i->data;
+    GtsFace * f1;
+    guint i;
+    GTS_ADJACENCY_FOREACH (&e3->triangles, i, f1)
       if (f1 != f && GTS_IS_FACE (f1) && gts_face_has_parent_surface (f1, s))
 	mark_as_hole (f1, s);
-      i = i->next;
-    }
   }
 }
 
 static void edge_mark_as_hole (GtsEdge * e, GtsSurface * s)
 {
-  GSList * i = e->triangles;
+  GtsFace * f;
+  guint i;
 
-  while (i) {
-    GtsFace * f = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, f)
     if (GTS_IS_FACE (f) && 
 	gts_face_has_parent_surface (f, s) &&
 	triangle_is_hole (GTS_TRIANGLE (f)))
       mark_as_hole (f, s);
-    i = i->next;
-  }
 }
 
 static gboolean face_is_marked (GtsObject * o)
@@ -119,8 +119,7 @@ static void triangle_cleanup (GtsSurface * s)
 
 static gboolean check_boundaries (GtsVertex * v1, GtsVertex * v2)
 {
-  return (g_slist_length (v1->segments) < 4 && 
-	  g_slist_length (v2->segments) < 4);
+  return (v1->segments.n < 4 && v2->segments.n < 4);
 }
 
 /* cleanup - using a given threshold merge vertices which are too close.
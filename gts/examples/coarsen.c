@@ -112,9 +112,9 @@ static gboolean stop_log_cost (gdouble cost, guint number)
 
 static gdouble cost_angle (GtsEdge * e)
 {
-  if (e->triangles && e->triangles->next)
-    return fabs (gts_triangles_angle (e->triangles->data,
-				      e->triangles->next->data));
+  if (e->triangles.n > 1)
+    return fabs (gts_triangles_angle (e->triangles.items[0],
+				      e->triangles.items[1]));
   return G_MAXDOUBLE;
 }
 
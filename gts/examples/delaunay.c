@@ -119,7 +119,8 @@ static void gts_constraint_split (GtsConstraint * c,
 				  GtsSurface * s,
 				  GtsFifo * fifo)
 {
-  GSList * i;
+  GtsFace * f;
+  guint i;
   GtsVertex * v1, * v2;
   GtsEdge * e;
 
@@ -130,17 +131,15 @@ static void gts_constraint_split (GtsConstraint * c,
   v2 = GTS_SEGMENT (c)->v2;
   e = GTS_EDGE (c);
 
-  i = e->triangles;
-  while (i) {
-    GtsFace * f = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, f)
     if (GTS_IS_FACE (f) && gts_face_has_parent_surface (f, s)) {
       GtsVertex * v = gts_triangle_vertex_opposite (GTS_TRIANGLE (f), e);
       if (gts_point_orientation (GTS_POINT (v1), 
 				 GTS_POINT (v2), 
 				 GTS_POINT (v)) == 0.) {
-	GSList * j = e->triangles;
 	GtsFace * f1 = NULL;
 	GtsEdge * e1, * e2;
+	guint j;
 
 	/* replaces edges with constraints */
 	gts_triangle_vertices_edges (GTS_TRIANGLE (f), e,
@@ -163,12 +162,10 @@ static void gts_constraint_split (GtsConstraint * c,
 	}
 
 	/* look for face opposite */
-	while (j && !f1) {
-	  if (GTS_IS_FACE (j->data) && 
-	      gts_face_has_parent_surface (j->data, s))
-	    f1 = j->data;
-	  j = j->next;
-	}
+	for (j = 0; j < e->triangles.n && !f1; j++)
+	  if (GTS_IS_FACE (e->triangles.items[j]) && 
+	      gts_face_has_parent_surface (e->triangles.items[j], s))
+	    f1 = e->triangles.items[j];
 	if (f1) { /* c is not a boundary of s */
 	  GtsEdge * e3, * e4, * e5;
 	  GtsVertex * v3;
@@ -183,8 +180,6 @@ static void gts_constraint_split (GtsConstraint * c,
 	return;
       }
     }
-    i = i->next;
-  }
 }
 
 static void add_constraint (GtsConstraint * c, GtsSurface * s)
@@ -247,19 +242,17 @@ static double slope (GtsVertex * v1, GtsVertex * v2, GtsVertex * v3)
 static gboolean edge_slope_swap (GtsEdge * e, GtsSurface * s)
 {
   if (!GTS_IS_CONSTRAINT (e)) {
-    GtsTriangle * t1 = NULL, * t2 = NULL;
-    GSList * i = e->triangles;
-    while (i) {
-      if (GTS_IS_FACE (i->data) && gts_face_has_parent_surface (i->data, s)) {
+    GtsTriangle * t, * t1 = NULL, * t2 = NULL;
+    guint i;
+    GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+      if (GTS_IS_FACE (t) && gts_face_has_parent_surface (GTS_FACE (t), s)) {
 	if (!t1)
-	  t1 = i->data;
+	  t1 = t;
 	else if (!t2)
-	  t2 = i->data;
+	  t2 = t;
 	else
 	  g_return_val_if_fail (gts_edge_face_number (e, s) == 2, FALSE);
       }
-      i = i->next;
-    }
     if (!t1 || !t2)
       return FALSE;
     GtsVertex * v1, * v2, * v3, * v4, * v5, * v6;
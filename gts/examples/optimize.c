@@ -77,21 +77,18 @@ static gdouble triangles_angle (GtsPoint * p1, GtsPoint * p2,
 
 static gdouble edge_swap_cost (GtsEdge * e)
 {
-  GSList * i;
-  GtsTriangle * t1 = NULL, * t2 = NULL;
+  guint i;
+  GtsTriangle * t, * t1 = NULL, * t2 = NULL;
   GtsVertex * v1, * v2, * v3, * v4;
   GtsEdge * e1, * e2, * e3, * e4;
   gdouble ab, aa;
 
-  i = e->triangles;
-  while (i) {
-    if (GTS_IS_FACE (i->data)) {
-      if (!t1) t1 = i->data;
-      else if (!t2) t2 = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t)) {
+      if (!t1) t1 = t;
+      else if (!t2) t2 = t;
       else return G_MAXDOUBLE;
     }
-    i = i->next;
-  }
   if (!t1 || !t2)
     return G_MAXDOUBLE;
 
@@ -107,20 +104,17 @@ static gdouble edge_swap_cost (GtsEdge * e)
 
 static void edge_swap (GtsEdge * e, GtsSurface * s, GtsEHeap * heap)
 {
-  GSList * i;
-  GtsTriangle * t1 = NULL, * t2 = NULL;
+  guint i;
+  GtsTriangle * t, * t1 = NULL, * t2 = NULL;
   GtsVertex * v1, * v2, * v3, * v4;
   GtsEdge * e1, * e2, * e3, * e4;
 
-  i = e->triangles;
-  while (i) {
-    if (GTS_IS_FACE (i->data)) {
-      if (!t1) t1 = i->data;
-      else if (!t2) t2 = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t)) {
+      if (!t1) t1 = t;
+      else if (!t2) t2 = t;
       else g_assert_not_reached ();
     }
-    i = i->next;
-  }
   g_assert (t1 && t2);
 
   gts_triangle_vertices_edges (t1, e, &v1, &v2, &v3, &e, &e3, &e4);
@@ -173,18 +167,15 @@ static void surface_optimize (GtsSurface * surface,
 
 static void angle_stats (GtsEdge * e, GtsRange * angle)
 {
-  GSList * i;
-  GtsTriangle * t1 = NULL, * t2 = NULL;
-
-  i = e->triangles;
-  while (i) {
-    if (GTS_IS_FACE (i->data)) {
-      if (!t1) t1 = i->data;
-      else if (!t2) t2 = i->data;
+  guint i;
+  GtsTriangle * t, * t1 = NULL, * t2 = NULL;
+
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t)) {
+      if (!t1) t1 = t;
+      else if (!t2) t2 = t;
       else return;
     }
-    i = i->next;
-  }
   if (!t1 || !t2)
     return;
 
@@ -63,21 +63,20 @@ static void smooth_vertex (GtsVertex * v, gpointer * data)
 static void smooth_fold (GtsVertex * v, gpointer * data)
 {
   gdouble * maxcosine2 = data[2];
-  GSList * i = v->segments;
   gboolean folded = FALSE;
   guint * nfold = data[3];
+  guint i;
 
-  while (i && !folded) {
-    if (GTS_IS_EDGE (i->data)) {
-      GtsEdge * e = i->data;
+  for (i = 0; i < v->segments.n && !folded; i++) {
+    if (GTS_IS_EDGE (v->segments.items[i])) {
+      GtsEdge * e = v->segments.items[i];
 
-      if (gts_triangles_are_folded (e->triangles, 
-				    GTS_SEGMENT (e)->v1,
-				    GTS_SEGMENT (e)->v2,
-				    *maxcosine2))
+      if (gts_edge_triangles_are_folded (e, 
+					 GTS_SEGMENT (e)->v1,
+					 GTS_SEGMENT (e)->v2,
+					 *maxcosine2))
 	folded = TRUE;
     }
-    i = i->next;
   }
   if (folded) {
     (*nfold)++;
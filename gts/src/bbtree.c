@@ -19,6 +19,7 @@
 
 #include <math.h>
 #include "gts.h"
+#include "gts-private.h"
 
 static void bbox_init (GtsBBox * bbox)
 {
@@ -33,8 +34,9 @@ static void bbox_init (GtsBBox * bbox)
 GtsBBoxClass * gts_bbox_class (void)
 {
   static GtsBBoxClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo bbox_info = {
       "GtsBBox",
       sizeof (GtsBBox),
@@ -45,6 +47,7 @@ GtsBBoxClass * gts_bbox_class (void)
       (GtsArgGetFunc) NULL
     };
     klass = gts_object_class_new (gts_object_class (), &bbox_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -525,83 +528,80 @@ gboolean gts_bbox_overlaps_segment (GtsBBox * bb, GtsSegment * s)
   return triBoxOverlap (bc, bh, tv);
 }
 
+static GNode * bb_tree_items (GtsBVH * bvh, guint start, guint end)
+{
+  GtsBBox * bbox;
+  GNode * node;
+  guint i, mid;
+
+  if (end - start == 1) /* leaf node */
+    return g_node_new (bvh->bboxes[start]);
+
+  bbox = gts_bbox_new (gts_bbox_class (), NULL,
+		       bvh->item.x1[start], bvh->item.y1[start],
+		       bvh->item.z1[start], bvh->item.x2[start],
+		       bvh->item.y2[start], bvh->item.z2[start]);
+  for (i = start + 1; i < end; i++) {
+    if (bvh->item.x1[i] < bbox->x1) bbox->x1 = bvh->item.x1[i];
+    if (bvh->item.y1[i] < bbox->y1) bbox->y1 = bvh->item.y1[i];
+    if (bvh->item.z1[i] < bbox->z1) bbox->z1 = bvh->item.z1[i];
+    if (bvh->item.x2[i] > bbox->x2) bbox->x2 = bvh->item.x2[i];
+    if (bvh->item.y2[i] > bbox->y2) bbox->y2 = bvh->item.y2[i];
+    if (bvh->item.z2[i] > bbox->z2) bbox->z2 = bvh->item.z2[i];
+  }
+  node = g_node_new (bbox);
+  mid = (start + end)/2;
+  g_node_append (node, bb_tree_items (bvh, start, mid));
+  g_node_append (node, bb_tree_items (bvh, mid, end));
+
+  return node;
+}
+
+static GNode * bb_tree_from_bvh (GtsBVH * bvh, guint32 i)
+{
+  GNode * node;
+
+  if (bvh->count[i] > 0)
+    return bb_tree_items (bvh, bvh->first[i], bvh->first[i] + bvh->count[i]);
+
+  node = g_node_new (gts_bbox_new (gts_bbox_class (), NULL,
+				   bvh->node.x1[i], bvh->node.y1[i],
+				   bvh->node.z1[i], bvh->node.x2[i],
+				   bvh->node.y2[i], bvh->node.z2[i]));
+  g_node_append (node, bb_tree_from_bvh (bvh, bvh->first[i]));
+  g_node_append (node, bb_tree_from_bvh (bvh, bvh->first[i] + 1));
+
+  return node;
+}
+
 /**
  * gts_bb_tree_new:
  * @bboxes: a list of #GtsBBox.
  *
  * Builds a new hierarchy of bounding boxes for @bboxes. At each
  * level, the GNode->data field contains a #GtsBBox bounding box of
- * all the children. The tree is binary and is built by repeatedly
- * cutting in two approximately equal halves the bounding boxes at
- * each level until a leaf node (i.e. a bounding box given in @bboxes)
- * is reached. In order to minimize the depth of the tree, the cutting
- * direction is always chosen as perpendicular to the longest
- * dimension of the bounding box.
+ * all the children. The tree is binary, its leaves are the bounding
+ * boxes given in @bboxes and it is split in the same way as the
+ * #GtsBVH returned by gts_bvh_new(), the few boxes of each leaf of
+ * the latter being split in halves.
+ *
+ * A #GtsBVH stores the same hierarchy in a few arrays rather than in
+ * a #GNode per box and is faster to build and to query.
  *
  * Returns: a new hierarchy of bounding boxes.  
  */
 GNode * gts_bb_tree_new (GSList * bboxes)
 {
-  GSList * i, * positive = NULL, * negative = NULL;
-  GNode * node;
-  GtsBBox * bbox;
-  guint dir, np = 0, nn = 0;
-  gdouble * p1, * p2;
-  gdouble cut;
+  GtsBVH * bvh;
+  GNode * tree;
   
   g_return_val_if_fail (bboxes != NULL, NULL);
 
-  if (bboxes->next == NULL) /* leaf node */
-    return g_node_new (bboxes->data);
-
-  bbox = gts_bbox_bboxes (gts_bbox_class (), bboxes);
-  node = g_node_new (bbox);
-
-  if (bbox->x2 - bbox->x1 > bbox->y2 - bbox->y1) {
-    if (bbox->z2 - bbox->z1 > bbox->x2 - bbox->x1)
-      dir = 2;
-    else
-      dir = 0;
-  }
-  else if (bbox->z2 - bbox->z1 > bbox->y2 - bbox->y1)
-    dir = 2;
-  else
-    dir = 1;
+  bvh = gts_bvh_new (bboxes, 1);
+  tree = bb_tree_from_bvh (bvh, 0);
+  gts_bvh_destroy (bvh, FALSE);
 
-  p1 = (gdouble *) &bbox->x1;
-  p2 = (gdouble *) &bbox->x2;
-  cut = (p1[dir] + p2[dir])/2.;
-  i = bboxes;
-  while (i) {
-    bbox = i->data; 
-    p1 = (gdouble *) &bbox->x1;
-    p2 = (gdouble *) &bbox->x2;
-    if ((p1[dir] + p2[dir])/2. > cut) {
-      positive = g_slist_prepend (positive, bbox);
-      np++;
-    }
-    else {
-      negative = g_slist_prepend (negative, bbox);
-      nn++;
-    }
-    i = i->next;
-  }
-  if (!positive) {
-    GSList * last = g_slist_nth (negative, (nn - 1)/2);
-    positive = last->next;
-    last->next = NULL;
-  }
-  else if (!negative) {
-    GSList * last = g_slist_nth (positive, (np - 1)/2);
-    negative = last->next;
-    last->next = NULL;
-  }
-  g_node_prepend (node, gts_bb_tree_new (positive));
-  g_slist_free (positive);
-  g_node_prepend (node, gts_bb_tree_new (negative));
-  g_slist_free (negative);
-  
-  return node;
+  return tree;
 }
 
 static void prepend_triangle_bbox (GtsTriangle * t, GSList ** bboxes)
@@ -838,7 +838,8 @@ static gdouble bb_tree_min_max (GNode * tree,
   gdouble min1, max1, min2, max2;
 
   if (tree->children == NULL) {
-    *list = g_slist_prepend (*list, tree->data);
+    if (list)
+      *list = g_slist_prepend (*list, tree->data);
     return min_max;
   }
   tree1 = tree->children;
@@ -911,6 +912,157 @@ GSList * gts_bb_tree_point_closest_bboxes (GNode * tree,
   return list;
 }
 
+/* Calls @func for each leaf of @tree whose box is not further from @p
+   than @min_max, i.e. for each element of the list returned by
+   gts_bb_tree_point_closest_bboxes() */
+static void bb_tree_closest_leaves (GNode * tree,
+				    GtsPoint * p,
+				    gdouble min_max,
+				    GFunc func,
+				    gpointer data)
+{
+  gdouble min, max;
+
+  gts_bbox_point_distance2 (tree->data, p, &min, &max);
+  if (min > min_max)
+    return;
+  if (tree->children == NULL)
+    (*func) (tree->data, data);
+  else {
+    bb_tree_closest_leaves (tree->children, p, min_max, func, data);
+    bb_tree_closest_leaves (tree->children->next, p, min_max, func, data);
+  }
+}
+
+/* Same as gts_bb_tree_point_closest_bboxes() but calls @func for each
+   bounding box rather than building a list */
+static void bb_tree_point_closest_bboxes (GNode * tree,
+					  GtsPoint * p,
+					  GFunc func,
+					  gpointer data)
+{
+  gdouble min, min_max;
+
+  gts_bbox_point_distance2 (tree->data, p, &min, &min_max);
+  min_max = bb_tree_min_max (tree, p, min_max, NULL);
+  bb_tree_closest_leaves (tree, p, min_max, func, data);
+}
+
+/* Inserts @hit into the @m first elements of @n, sorted by increasing
+   distance, keeping at most @k elements. Returns the new number of
+   elements of @n. */
+guint gts_bbox_nearest_insert (GtsBBoxNearest * n, guint k, guint m,
+			       const GtsBBoxNearest * hit)
+{
+  guint i;
+
+  if (m == k) {
+    if (hit->distance2 >= n[k - 1].distance2)
+      return m;
+    m--;
+  }
+  for (i = m; i > 0 && n[i - 1].distance2 > hit->distance2; i--)
+    n[i] = n[i - 1];
+  n[i] = *hit;
+  return m + 1;
+}
+
+typedef gdouble (* NearestEvalFunc) (GtsPoint * p, 
+				     GtsBBox * bb, 
+				     GtsVector closest,
+				     gpointer data);
+
+typedef struct {
+  GtsPoint * p;
+  NearestEvalFunc eval;
+  gpointer data;
+  GtsBBoxNearest * n;
+  guint k, m;
+} NearestQuery;
+
+#define NEAREST_BOUND(q) ((q)->m < (q)->k ? G_MAXDOUBLE :\
+			  (q)->n[(q)->k - 1].distance2)
+
+static gdouble bbox_point_min2 (GtsBBox * bb, GtsPoint * p)
+{
+  gdouble d = 0., t;
+
+  if (p->x < bb->x1)      { t = bb->x1 - p->x; d += t*t; }
+  else if (p->x > bb->x2) { t = p->x - bb->x2; d += t*t; }
+  if (p->y < bb->y1)      { t = bb->y1 - p->y; d += t*t; }
+  else if (p->y > bb->y2) { t = p->y - bb->y2; d += t*t; }
+  if (p->z < bb->z1)      { t = bb->z1 - p->z; d += t*t; }
+  else if (p->z > bb->z2) { t = p->z - bb->z2; d += t*t; }
+  return d;
+}
+
+/* Visits the children of @node closest first, skipping those which
+   cannot contain an object closer than the k-th closest found so far */
+static void bb_tree_nearest (GNode * node, NearestQuery * q)
+{
+  GNode * i = node->children;
+
+  if (i == NULL) {
+    GtsBBoxNearest hit;
+
+    hit.bbox = node->data;
+    hit.distance2 = (*q->eval) (q->p, hit.bbox, hit.closest, q->data);
+    q->m = gts_bbox_nearest_insert (q->n, q->k, q->m, &hit);
+  }
+  else if (i->next && i->next->next == NULL) {
+    GNode * near = i, * far = i->next;
+    gdouble dnear = bbox_point_min2 (near->data, q->p);
+    gdouble dfar = bbox_point_min2 (far->data, q->p);
+
+    if (dfar < dnear) {
+      GNode * tn = near; gdouble td = dnear;
+      near = far; far = tn; dnear = dfar; dfar = td;
+    }
+    if (dnear < NEAREST_BOUND (q))
+      bb_tree_nearest (near, q);
+    if (dfar < NEAREST_BOUND (q))
+      bb_tree_nearest (far, q);
+  }
+  else
+    for (; i; i = i->next)
+      if (bbox_point_min2 (i->data, q->p) < NEAREST_BOUND (q))
+	bb_tree_nearest (i, q);
+}
+
+static guint bb_tree_k_nearest (GNode * tree, GtsPoint * p,
+				NearestEvalFunc eval, gpointer data,
+				guint k, GtsBBoxNearest * n)
+{
+  NearestQuery q;
+
+  q.p = p;
+  q.eval = eval;
+  q.data = data;
+  q.n = n;
+  q.k = k;
+  q.m = 0;
+  if (k > 0)
+    bb_tree_nearest (tree, &q);
+  return q.m;
+}
+
+typedef struct {
+  GtsPoint * p;
+  GtsBBoxDistFunc distance;
+  gdouble dmin;
+  GtsBBox * bbox;
+} PointDistance;
+
+static void point_distance (GtsBBox * bb, PointDistance * d)
+{
+  gdouble dist = (*d->distance) (d->p, bb->bounded);
+
+  if (fabs (dist) < fabs (d->dmin)) {
+    d->dmin = dist;
+    d->bbox = bb;
+  }
+}
+
 /**
  * gts_bb_tree_point_distance:
  * @tree: a bounding box tree.
@@ -919,6 +1071,11 @@ GSList * gts_bb_tree_point_closest_bboxes (GNode * tree,
  * @bbox: if not %NULL is set to the bounding box containing the closest 
  * object.
  *
+ * @distance is called for each of the bounding boxes which would be
+ * returned by gts_bb_tree_point_closest_bboxes(), without building
+ * the list. Only the absolute values it returns are compared with one
+ * another: it does not need to return the Euclidean distance.
+ *
  * Returns: the distance as evaluated by @distance between @p and the closest
  * object in @tree.
  */
@@ -927,27 +1084,43 @@ gdouble gts_bb_tree_point_distance (GNode * tree,
 				    GtsBBoxDistFunc distance,
 				    GtsBBox ** bbox)
 {
-  GSList * list, * i;
-  gdouble dmin = G_MAXDOUBLE;
+  PointDistance d;
 
-  g_return_val_if_fail (tree != NULL, dmin);
-  g_return_val_if_fail (p != NULL, dmin);
-  g_return_val_if_fail (distance != NULL, dmin);
+  g_return_val_if_fail (tree != NULL, G_MAXDOUBLE);
+  g_return_val_if_fail (p != NULL, G_MAXDOUBLE);
+  g_return_val_if_fail (distance != NULL, G_MAXDOUBLE);
 
-  i = list = gts_bb_tree_point_closest_bboxes (tree, p);
-  while (i) {
-    gdouble d = (*distance) (p, GTS_BBOX (i->data)->bounded);
+  d.p = p;
+  d.distance = distance;
+  d.dmin = G_MAXDOUBLE;
+  d.bbox = NULL;
+  bb_tree_point_closest_bboxes (tree, p, (GFunc) point_distance, &d);
+  if (bbox && d.bbox)
+    *bbox = d.bbox;
 
-    if (fabs (d) < fabs (dmin)) {
-      dmin = d;
-      if (bbox)
-	*bbox = i->data;
-    }
-    i = i->next;
-  }
-  g_slist_free (list);
+  return d.dmin;
+}
+
+typedef struct {
+  GtsPoint * p;
+  GtsBBoxClosestFunc closest;
+  gdouble dmin;
+  GtsPoint * np;
+} PointClosest;
 
-  return dmin;
+static void point_closest (GtsBBox * bb, PointClosest * c)
+{
+  GtsPoint * tp = (*c->closest) (c->p, bb->bounded);
+  gdouble d = gts_point_distance2 (tp, c->p);
+
+  if (d < c->dmin) {
+    if (c->np)
+      gts_object_destroy (GTS_OBJECT (c->np));
+    c->np = tp;
+    c->dmin = d;
+  }
+  else
+    gts_object_destroy (GTS_OBJECT (tp));
 }
 
 /**
@@ -958,6 +1131,10 @@ gdouble gts_bb_tree_point_distance (GNode * tree,
  * @distance: if not %NULL is set to the distance between @p and the 
  * new #GtsPoint.
  *
+ * Note that @closest is called for each of the bounding boxes which
+ * would be returned by gts_bb_tree_point_closest_bboxes(). If you do
+ * not need a new #GtsPoint, use gts_bb_tree_point_nearest() instead.
+ *
  * Returns: a new #GtsPoint, closest point to @p and belonging to an object of
  * @tree.
  */
@@ -966,35 +1143,90 @@ GtsPoint * gts_bb_tree_point_closest (GNode * tree,
 				      GtsBBoxClosestFunc closest,
 				      gdouble * distance)
 {
-  GSList * list, * i;
-  gdouble dmin = G_MAXDOUBLE;
-  GtsPoint * np = NULL;
+  PointClosest c;
 
   g_return_val_if_fail (tree != NULL, NULL);
   g_return_val_if_fail (p != NULL, NULL);
   g_return_val_if_fail (closest != NULL, NULL);
 
-  i = list = gts_bb_tree_point_closest_bboxes (tree, p);
-  while (i) {
-    GtsPoint * tp = (*closest) (p, GTS_BBOX (i->data)->bounded);
-    gdouble d = gts_point_distance2 (tp, p);
-
-    if (d < dmin) {
-      if (np)
-	gts_object_destroy (GTS_OBJECT (np));
-      np = tp;
-      dmin = d;
-    }
-    else
-      gts_object_destroy (GTS_OBJECT (tp));
-    i = i->next;
-  }
-  g_slist_free (list);
-
+  c.p = p;
+  c.closest = closest;
+  c.dmin = G_MAXDOUBLE;
+  c.np = NULL;
+  bb_tree_point_closest_bboxes (tree, p, (GFunc) point_closest, &c);
   if (distance)
-    *distance = dmin;
+    *distance = c.dmin;
+
+  return c.np;
+}
+
+static gdouble point_nearest (GtsPoint * p, GtsBBox * bb, GtsVector closest,
+			      GtsBBoxNearestFunc * nearest)
+{
+  return (**nearest) (p, bb->bounded, closest);
+}
+
+/**
+ * gts_bb_tree_point_nearest:
+ * @tree: a bounding box tree.
+ * @p: a #GtsPoint.
+ * @nearest: a #GtsBBoxNearestFunc.
+ *
+ * Looks for the object of @tree closest to @p. The boxes are visited
+ * closest first and those further away than the closest object found
+ * so far are skipped. Nothing is allocated.
+ *
+ * Returns: the bounding box of the closest object, the square of its
+ * distance to @p and its point closest to @p, as set by @nearest. The
+ * bounding box is %NULL if @tree is empty.
+ */
+GtsBBoxNearest gts_bb_tree_point_nearest (GNode * tree,
+					  GtsPoint * p,
+					  GtsBBoxNearestFunc nearest)
+{
+  GtsBBoxNearest n;
+
+  n.bbox = NULL;
+  n.distance2 = G_MAXDOUBLE;
+  n.closest[0] = n.closest[1] = n.closest[2] = 0.;
+
+  g_return_val_if_fail (tree != NULL, n);
+  g_return_val_if_fail (p != NULL, n);
+  g_return_val_if_fail (nearest != NULL, n);
+
+  bb_tree_k_nearest (tree, p, (NearestEvalFunc) point_nearest, &nearest,
+		     1, &n);
+  return n;
+}
+
+/**
+ * gts_bb_tree_point_k_nearest:
+ * @tree: a bounding box tree.
+ * @p: a #GtsPoint.
+ * @nearest: a #GtsBBoxNearestFunc.
+ * @k: the number of objects to look for.
+ * @n: an array of at least @k #GtsBBoxNearest.
+ *
+ * Same as gts_bb_tree_point_nearest() for the @k objects of @tree
+ * closest to @p.
+ *
+ * Returns: the number of objects found (@k if @tree contains at least
+ * @k objects). The first elements of @n are set to these objects,
+ * sorted by increasing distance to @p.
+ */
+guint gts_bb_tree_point_k_nearest (GNode * tree,
+				   GtsPoint * p,
+				   GtsBBoxNearestFunc nearest,
+				   guint k,
+				   GtsBBoxNearest * n)
+{
+  g_return_val_if_fail (tree != NULL, 0);
+  g_return_val_if_fail (p != NULL, 0);
+  g_return_val_if_fail (nearest != NULL, 0);
+  g_return_val_if_fail (k == 0 || n != NULL, 0);
 
-  return np;  
+  return bb_tree_k_nearest (tree, p, (NearestEvalFunc) point_nearest, 
+			    &nearest, k, n);
 }
 
 /**
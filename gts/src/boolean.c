@@ -59,8 +59,9 @@ static void surface_inter_init (GtsSurfaceInter * si)
 GtsSurfaceInterClass * gts_surface_inter_class (void)
 {
   static GtsSurfaceInterClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo surface_inter_info = {
       "GtsSurfaceInter",
       sizeof (GtsSurfaceInter),
@@ -71,6 +72,7 @@ GtsSurfaceInterClass * gts_surface_inter_class (void)
       (GtsArgGetFunc) NULL
     };
     klass = gts_object_class_new (gts_object_class (), &surface_inter_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -101,8 +103,9 @@ static EdgeInter * edge_inter_new    (GtsVertex * v1, GtsVertex * v2,
 static GtsEdgeClass * edge_inter_class (void)
 {
   static GtsEdgeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo edge_inter_info = {
       "EdgeInter",
       sizeof (EdgeInter),
@@ -114,6 +117,7 @@ static GtsEdgeClass * edge_inter_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_constraint_class ()),
 				  &edge_inter_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -793,53 +797,45 @@ static void write_loops (GSList * i, FILE * fp)
 
 static GtsSegment * prev_flag (GtsSegment * s, CurveFlag flag)
 {
-  GSList * i = s->v1->segments;
+  GtsSegment * s1;
+  guint i;
 
-  while (i) {
-    if (i->data != s && IS_SET (i->data, flag))
-      return i->data;
-    i = i->next;
-  }
+  GTS_ADJACENCY_FOREACH (&s->v1->segments, i, s1)
+    if (s1 != s && IS_SET (s1, flag))
+      return s1;
   return NULL;
 }
 
 static GtsSegment * next_flag (GtsSegment * s, CurveFlag flag)
 {
-  GSList * i = s->v2->segments;
+  GtsSegment * s1;
+  guint i;
 
-  while (i) {
-    if (i->data != s && IS_SET (i->data, flag))
-      return i->data;
-    i = i->next;
-  }
+  GTS_ADJACENCY_FOREACH (&s->v2->segments, i, s1)
+    if (s1 != s && IS_SET (s1, flag))
+      return s1;
   return NULL;
 }
 
 static GtsSegment * next_interior (GtsVertex * v)
 {
-  GSList * i = v->segments;
-
-  while (i) {
-    GtsSegment * s = i->data;
+  GtsSegment * s;
+  guint i;
 
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s)
     if (s->v1 == v && IS_SET (s, INTERIOR))
       return s;
-    i = i->next;
-  }
   return NULL;
 }
 
 static GtsSegment * prev_interior (GtsVertex * v)
 {
-  GSList * i = v->segments;
-
-  while (i) {
-    GtsSegment * s = i->data;
+  GtsSegment * s;
+  guint i;
 
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s)
     if (s->v2 == v && IS_SET (s, INTERIOR))
       return s;
-    i = i->next;
-  }
   return NULL;
 }
 
@@ -1399,7 +1395,7 @@ static void triangulate_loop (GtsSegment * start,
 static void check_object (GtsObject * o)
 {
   g_assert (o->reserved == NULL);
-  g_assert (o->flags == 0);  
+  g_assert ((o->flags & ~GTS_ARENA) == 0);  
 }
 
 static void check_boundary (GtsEdge * e, GtsSurface * s)
@@ -1704,27 +1700,25 @@ static gint triangle_orientation (GtsTriangle * t, GtsEdge * e)
 
 static gboolean check_orientation (GtsEdge * e, GtsSurface * s)
 {
-  GtsTriangle * t1 = NULL, * t2 = NULL;
-  GSList * i = e->triangles;
+  GtsTriangle * t, * t1 = NULL, * t2 = NULL;
+  guint i;
   gint o1 = 0, o2 = 0;
 
-  while (i) {
-    if (GTS_IS_FACE (i->data) && 
-	gts_face_has_parent_surface (i->data, s)) {
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t) && 
+	gts_face_has_parent_surface (GTS_FACE (t), s)) {
       if (t1 == NULL) {
-	t1 = i->data;
+	t1 = t;
 	o1 = triangle_orientation (t1, e);
       }
       else if (t2 == NULL) {
-	t2 = i->data;
+	t2 = t;
 	o2 = triangle_orientation (t2, e);
 	g_return_val_if_fail (o1*o2 < 0, FALSE);
       }
       else
 	g_assert_not_reached ();
     }
-    i = i->next;
-  }
   g_return_val_if_fail (t1 && t2, FALSE);
   return TRUE;
 }
@@ -1734,30 +1728,25 @@ static void check_edge (GtsSegment * s, gpointer * data)
   gboolean * ok = data[0];
   GtsSurfaceInter * si = data[1];
   gboolean * closed = data[2];
-  GSList * j;
-  guint nn = 0;
+  guint j, nn = 0;
   
-  j = s->v1->segments;
-  while (j && *ok) {
-    GtsSegment * s1 = j->data;
+  for (j = 0; j < s->v1->segments.n && *ok; j++) {
+    GtsSegment * s1 = s->v1->segments.items[j];
     
     if (s1 != s && GTS_OBJECT (s1)->reserved == si) {
       if (s1->v2 != s->v1)
 	*ok = FALSE;
       nn++;
     }
-    j = j->next;
   }
-  j = s->v2->segments;
-  while (j && *ok) {
-    GtsSegment * s1 = j->data;
+  for (j = 0; j < s->v2->segments.n && *ok; j++) {
+    GtsSegment * s1 = s->v2->segments.items[j];
     
     if (s1 != s && GTS_OBJECT (s1)->reserved == si) {
       if (s1->v1 != s->v2)
 	*ok = FALSE;
       nn++;
     }
-    j = j->next;
   }
   if (nn != 2)
     *closed = FALSE;
@@ -1818,12 +1807,10 @@ static GtsFace * next_compatible_face (GtsEdge * e,
 				       GtsSurface * s1,
 				       GtsSurface * s2)
 {
-  GSList * i = e->triangles;
-  GtsFace * f2 = NULL, * f3 = NULL;
-
-  while (i) {
-    GtsFace * f1 = i->data;
+  GtsFace * f1, * f2 = NULL, * f3 = NULL;
+  guint i;
 
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, f1)
     if (f1 != f && GTS_IS_FACE (f1)) {
       if (gts_face_has_parent_surface (f1, s1))
 	return f1;
@@ -1833,8 +1820,6 @@ static GtsFace * next_compatible_face (GtsEdge * e,
 	else g_assert_not_reached (); /* s2 is a non-manifold surface */
       }
     }
-    i = i->next;
-  }
   if (f3 == NULL) {
     if (gts_edge_is_boundary (e, s2))
       return NULL;
@@ -1917,21 +1902,20 @@ void gts_surface_inter_boolean (GtsSurfaceInter * si,
   i = si->edges;
   while (i) {
     GtsEdge * e = i->data;
-    GSList * j = e->triangles;
+    GtsFace * f;
+    guint j;
     
-    while (j) {
-      if (gts_face_has_parent_surface (j->data, s) &&
-	  orient*triangle_orientation (j->data, e) > 0) {
+    GTS_ADJACENCY_FOREACH (&e->triangles, j, f)
+      if (gts_face_has_parent_surface (f, s) &&
+	  orient*triangle_orientation (GTS_TRIANGLE (f), e) > 0) {
 #ifdef DEBUG_BOOLEAN
 	GtsFace * boundary = gts_edge_is_boundary (e, surface);
 
-	g_assert (!boundary || boundary == j->data);
+	g_assert (!boundary || boundary == f);
 #endif /* DEBUG_BOOLEAN */
-	walk_faces (e, j->data, s, GTS_OBJECT (s)->reserved, surface);
+	walk_faces (e, f, s, GTS_OBJECT (s)->reserved, surface);
 	break;
       }
-      j = j->next;
-    }
     i = i->next;
   }
   g_slist_foreach (si->edges, (GFunc) gts_object_reset_reserved, NULL);
@@ -0,0 +1,1395 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "gts.h"
+#include "gts-private.h"
+
+/* maximum number of items of a leaf */
+#define LEAF_SIZE 4
+/* number of bins along each axis for the surface area heuristic */
+#define NBINS 16
+/* cost of traversing a node relative to the cost of testing an item */
+#define TRAVERSAL_COST 1.
+/* number of items from which the subtrees are built in parallel */
+#define PARALLEL_BUILD_MIN 4096
+/* traversals deeper than this allocate their stack */
+#define STACK_SIZE 64
+/* number of consecutive queries of a batch processed by a thread at once */
+#define QUERY_CHUNK 256
+
+typedef struct {
+  gdouble x1, y1, z1, x2, y2, z2;
+} Box;
+
+static void box_init (Box * b)
+{
+  b->x1 = b->y1 = b->z1 = G_MAXDOUBLE;
+  b->x2 = b->y2 = b->z2 = -G_MAXDOUBLE;
+}
+
+static void box_add (Box * b, const Box * b1)
+{
+  b->x1 = MIN (b->x1, b1->x1);
+  b->y1 = MIN (b->y1, b1->y1);
+  b->z1 = MIN (b->z1, b1->z1);
+  b->x2 = MAX (b->x2, b1->x2);
+  b->y2 = MAX (b->y2, b1->y2);
+  b->z2 = MAX (b->z2, b1->z2);
+}
+
+/* half the surface area of @b */
+static gdouble box_area (const Box * b)
+{
+  gdouble x = b->x2 - b->x1, y = b->y2 - b->y1, z = b->z2 - b->z1;
+
+  return x*y + y*z + z*x;
+}
+
+/* the items are sorted in place, their boxes and centers being kept
+   together for the sake of locality */
+typedef struct {
+  Box box;
+  gdouble c[3];
+  guint32 index;
+} BuildItem;
+
+typedef struct {
+  Box * bounds;
+  guint32 * first, * count;
+  guint n, depth;
+} BuildNodes;
+
+typedef struct {
+  guint32 node;
+  guint start, end, depth;
+  BuildNodes nodes;
+} BuildTask;
+
+static void build_nodes_init (BuildNodes * nodes, guint nitems)
+{
+  guint size = 2*nitems - 1;
+
+  nodes->bounds = g_malloc (size*sizeof (Box));
+  nodes->first = g_malloc (size*sizeof (guint32));
+  nodes->count = g_malloc (size*sizeof (guint32));
+  nodes->n = 1;
+  nodes->depth = 0;
+}
+
+static void build_nodes_free (BuildNodes * nodes)
+{
+  g_free (nodes->bounds);
+  g_free (nodes->first);
+  g_free (nodes->count);
+}
+
+#define BIN(c, min, scale) MIN ((guint) (((c) - (min))*(scale)), NBINS - 1)
+
+/* Looks for the best split of @items with the surface area heuristic,
+   returns %FALSE if they are better left in a leaf */
+static gboolean sah_split (BuildItem * items, guint m,
+			   const Box * bounds, const Box * cbounds,
+			   guint * axis, guint * bin)
+{
+  Box boxes[3][NBINS];
+  guint counts[3][NBINS];
+  gdouble best = G_MAXDOUBLE, area = box_area (bounds), scale[3];
+  const gdouble * cmin = &cbounds->x1, * cmax = &cbounds->x2;
+  guint a, i;
+
+  for (a = 0; a < 3; a++) {
+    scale[a] = cmax[a] > cmin[a] ? NBINS/(cmax[a] - cmin[a]) : 0.;
+    for (i = 0; i < NBINS; i++) {
+      box_init (&boxes[a][i]);
+      counts[a][i] = 0;
+    }
+  }
+  for (i = 0; i < m; i++)
+    for (a = 0; a < 3; a++) {
+      guint j = BIN (items[i].c[a], cmin[a], scale[a]);
+
+      box_add (&boxes[a][j], &items[i].box);
+      counts[a][j]++;
+    }
+
+  for (a = 0; a < 3; a++) {
+    gdouble right[NBINS];
+    guint n = 0;
+    Box b;
+
+    if (scale[a] == 0.)
+      continue;
+    /* right[i] is the cost of the items of the bins after i */
+    box_init (&b);
+    for (i = NBINS - 1; i > 0; i--) {
+      box_add (&b, &boxes[a][i]);
+      n += counts[a][i];
+      right[i - 1] = n > 0 ? n*box_area (&b) : 0.;
+    }
+    box_init (&b);
+    n = 0;
+    for (i = 0; i < NBINS - 1; i++) {
+      gdouble cost;
+
+      box_add (&b, &boxes[a][i]);
+      n += counts[a][i];
+      if (n == 0 || n == m)
+	continue;
+      cost = n*box_area (&b) + right[i];
+      if (cost < best) {
+	best = cost;
+	*axis = a;
+	*bin = i;
+      }
+    }
+  }
+
+  if (best == G_MAXDOUBLE) {
+    /* all the centers are the same: splits in the middle */
+    if (m <= LEAF_SIZE)
+      return FALSE;
+    *axis = 3;
+    return TRUE;
+  }
+  return m > LEAF_SIZE || TRAVERSAL_COST*area + best < m*area;
+}
+
+static void build_node (BuildItem * items, BuildNodes * nodes,
+			guint32 node, guint start, guint end, guint depth,
+			guint task_size, GArray * tasks)
+{
+  Box * bounds = &nodes->bounds[node], cbounds;
+  guint axis = 0, bin = 0, mid, i;
+  guint32 child;
+
+  box_init (bounds);
+  box_init (&cbounds);
+  for (i = start; i < end; i++) {
+    gdouble * c = items[i].c;
+    Box cb;
+
+    box_add (bounds, &items[i].box);
+    cb.x1 = cb.x2 = c[0]; cb.y1 = cb.y2 = c[1]; cb.z1 = cb.z2 = c[2];
+    box_add (&cbounds, &cb);
+  }
+  if (depth > nodes->depth)
+    nodes->depth = depth;
+
+  if (tasks && end - start <= task_size) {
+    BuildTask task;
+
+    task.node = node;
+    task.start = start;
+    task.end = end;
+    task.depth = depth;
+    g_array_append_val (tasks, task);
+    /* set once the subtree is built */
+    nodes->first[node] = nodes->count[node] = 0;
+    return;
+  }
+
+  if (!sah_split (items + start, end - start, bounds, &cbounds, &axis, &bin)) {
+    nodes->first[node] = start;
+    nodes->count[node] = end - start;
+    return;
+  }
+
+  if (axis == 3)
+    mid = (start + end)/2;
+  else {
+    gdouble cmin = (&cbounds.x1)[axis];
+    gdouble scale = NBINS/((&cbounds.x2)[axis] - cmin);
+    guint j = end;
+
+    /* partitions the items on each side of the split */
+    mid = start;
+    while (mid < j)
+      if (BIN (items[mid].c[axis], cmin, scale) <= bin)
+	mid++;
+      else {
+	BuildItem tmp = items[mid];
+
+	items[mid] = items[--j];
+	items[j] = tmp;
+      }
+  }
+
+  child = nodes->n;
+  nodes->n += 2;
+  nodes->first[node] = child;
+  nodes->count[node] = 0;
+  build_node (items, nodes, child, start, mid, depth + 1, task_size, tasks);
+  build_node (items, nodes, child + 1, mid, end, depth + 1, task_size, tasks);
+}
+
+static void build_task (BuildTask * task, BuildItem * items)
+{
+  build_nodes_init (&task->nodes, task->end - task->start);
+  build_node (items, &task->nodes, 0, task->start, task->end, 0, 0, NULL);
+}
+
+static void boxes_alloc (GtsBVHBoxes * b, guint n)
+{
+  b->x1 = g_malloc (6*n*sizeof (gdouble));
+  b->y1 = b->x1 + n;
+  b->z1 = b->y1 + n;
+  b->x2 = b->z1 + n;
+  b->y2 = b->x2 + n;
+  b->z2 = b->y2 + n;
+}
+
+static void boxes_set (GtsBVHBoxes * b, guint i, const Box * box)
+{
+  b->x1[i] = box->x1; b->y1[i] = box->y1; b->z1[i] = box->z1;
+  b->x2[i] = box->x2; b->y2[i] = box->y2; b->z2[i] = box->z2;
+}
+
+/* Copies the nodes of @nodes, node 0 going to @root and node k > 0 to
+   @base + k - 1 */
+static void bvh_copy_nodes (GtsBVH * bvh, BuildNodes * nodes,
+			    guint32 root, guint32 base)
+{
+  guint k;
+
+  for (k = 0; k < nodes->n; k++) {
+    guint32 i = k == 0 ? root : base + k - 1;
+
+    boxes_set (&bvh->node, i, &nodes->bounds[k]);
+    bvh->count[i] = nodes->count[k];
+    bvh->first[i] = nodes->count[k] > 0 ? nodes->first[k] :
+      base + nodes->first[k] - 1;
+  }
+}
+
+static gdouble node_area (GtsBVHBoxes * b, guint32 i)
+{
+  gdouble x = b->x2[i] - b->x1[i];
+  gdouble y = b->y2[i] - b->y1[i];
+  gdouble z = b->z2[i] - b->z1[i];
+
+  return x*y + y*z + z*x;
+}
+
+/* contribution of node @i to the cost of @bvh, times the area of the root */
+#define NODE_COST(bvh, i) (((bvh)->count[i] > 0 ? (bvh)->count[i] :\
+			    TRAVERSAL_COST)*node_area (&(bvh)->node, i))
+
+/* Returns the cost of @bvh for the surface area heuristic, that is the
+   expected cost of a ray query relative to testing a single item */
+static gdouble bvh_cost (GtsBVH * bvh)
+{
+  gdouble cost = 0., area = node_area (&bvh->node, 0);
+  guint i;
+
+  for (i = 0; i < bvh->nnodes; i++)
+    cost += NODE_COST (bvh, i);
+  return area > 0. ? cost/area : cost;
+}
+
+static GtsBVH * bvh_new (GtsBBox ** bboxes, guint n, guint nthreads)
+{
+  GtsBVH * bvh;
+  BuildItem * items;
+  BuildNodes nodes;
+  GArray * tasks = NULL;
+  guint i, task_size = 0;
+
+  items = g_malloc (n*sizeof (BuildItem));
+  for (i = 0; i < n; i++) {
+    GtsBBox * bb = bboxes[i];
+    Box * b = &items[i].box;
+
+    b->x1 = bb->x1; b->y1 = bb->y1; b->z1 = bb->z1;
+    b->x2 = bb->x2; b->y2 = bb->y2; b->z2 = bb->z2;
+    items[i].c[0] = (b->x1 + b->x2)/2.;
+    items[i].c[1] = (b->y1 + b->y2)/2.;
+    items[i].c[2] = (b->z1 + b->z2)/2.;
+    items[i].index = i;
+  }
+
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+  /* the calling thread splits the top of the tree into a few subtrees
+     per thread, which are then built in parallel */
+  if (nthreads > 1 && n >= PARALLEL_BUILD_MIN) {
+    tasks = g_array_new (FALSE, FALSE, sizeof (BuildTask));
+    task_size = MAX (n/(4*nthreads), LEAF_SIZE);
+  }
+  build_nodes_init (&nodes, n);
+  build_node (items, &nodes, 0, 0, n, 0, task_size, tasks);
+  if (tasks && tasks->len > 0) {
+    GThreadPool * pool = g_thread_pool_new ((GFunc) build_task, items,
+					    nthreads, TRUE, NULL);
+
+    for (i = 0; i < tasks->len; i++)
+      g_thread_pool_push (pool, &g_array_index (tasks, BuildTask, i), NULL);
+    g_thread_pool_free (pool, FALSE, TRUE);
+  }
+
+  bvh = g_malloc (sizeof (GtsBVH));
+  bvh->nitems = n;
+  bvh->nnodes = nodes.n;
+  bvh->depth = nodes.depth;
+  if (tasks)
+    for (i = 0; i < tasks->len; i++) {
+      BuildTask * task = &g_array_index (tasks, BuildTask, i);
+
+      bvh->nnodes += task->nodes.n - 1;
+      bvh->depth = MAX (bvh->depth, task->depth + task->nodes.depth);
+    }
+  boxes_alloc (&bvh->node, bvh->nnodes);
+  bvh->first = g_malloc (bvh->nnodes*sizeof (guint32));
+  bvh->count = g_malloc (bvh->nnodes*sizeof (guint32));
+  bvh_copy_nodes (bvh, &nodes, 0, 1);
+  build_nodes_free (&nodes);
+  if (tasks) {
+    guint32 base = nodes.n;
+
+    for (i = 0; i < tasks->len; i++) {
+      BuildTask * task = &g_array_index (tasks, BuildTask, i);
+
+      bvh_copy_nodes (bvh, &task->nodes, task->node, base);
+      base += task->nodes.n - 1;
+      build_nodes_free (&task->nodes);
+    }
+    g_array_free (tasks, TRUE);
+  }
+
+  boxes_alloc (&bvh->item, n);
+  bvh->bboxes = g_malloc (n*sizeof (GtsBBox *));
+  for (i = 0; i < n; i++) {
+    boxes_set (&bvh->item, i, &items[i].box);
+    bvh->bboxes[i] = bboxes[items[i].index];
+  }
+  g_free (items);
+
+  bvh->parent = g_malloc (bvh->nnodes*sizeof (guint32));
+  bvh->leaf = g_malloc (n*sizeof (guint32));
+  bvh->parent[0] = 0;
+  for (i = 0; i < bvh->nnodes; i++)
+    if (bvh->count[i] == 0)
+      bvh->parent[bvh->first[i]] = bvh->parent[bvh->first[i] + 1] = i;
+    else {
+      guint32 j;
+
+      for (j = bvh->first[i]; j < bvh->first[i] + bvh->count[i]; j++)
+	bvh->leaf[j] = i;
+    }
+  bvh->cost = bvh->build_cost = bvh_cost (bvh);
+  bvh->nthreads = nthreads;
+  bvh->index = NULL;
+
+  return bvh;
+}
+
+/**
+ * gts_bvh_new:
+ * @bboxes: a list of #GtsBBox.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Builds a new bounding volume hierarchy for @bboxes. Its nodes are
+ * split according to the surface area heuristic, evaluated for a few
+ * bins of the centers of the boxes along each axis, until a leaf
+ * holds only a few boxes and splitting it further would not make
+ * traversals cheaper.
+ *
+ * For a large number of boxes, the top of the hierarchy is built by
+ * the calling thread and its subtrees are built by @nthreads threads.
+ * The resulting hierarchy is the same whatever @nthreads.
+ *
+ * Returns: a new #GtsBVH.
+ */
+GtsBVH * gts_bvh_new (GSList * bboxes, guint nthreads)
+{
+  GPtrArray * array;
+  GtsBVH * bvh;
+
+  g_return_val_if_fail (bboxes != NULL, NULL);
+
+  array = g_ptr_array_new ();
+  while (bboxes) {
+    g_ptr_array_add (array, bboxes->data);
+    bboxes = bboxes->next;
+  }
+  bvh = bvh_new ((GtsBBox **) array->pdata, array->len, nthreads);
+  g_ptr_array_free (array, TRUE);
+
+  return bvh;
+}
+
+static void add_triangle_bbox (GtsTriangle * t, GPtrArray * bboxes)
+{
+  g_ptr_array_add (bboxes, gts_bbox_triangle (gts_bbox_class (), t));
+}
+
+/**
+ * gts_bvh_surface:
+ * @s: a #GtsSurface.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Returns: a new #GtsBVH bounding the faces of @s (see gts_bvh_new()) or
+ * %NULL if @s has no faces.
+ */
+GtsBVH * gts_bvh_surface (GtsSurface * s, guint nthreads)
+{
+  GPtrArray * bboxes;
+  GtsBVH * bvh = NULL;
+
+  g_return_val_if_fail (s != NULL, NULL);
+
+  bboxes = g_ptr_array_new ();
+  gts_surface_foreach_face (s, (GtsFunc) add_triangle_bbox, bboxes);
+  if (bboxes->len > 0)
+    bvh = bvh_new ((GtsBBox **) bboxes->pdata, bboxes->len, nthreads);
+  g_ptr_array_free (bboxes, TRUE);
+
+  return bvh;
+}
+
+static void bvh_free_arrays (GtsBVH * bvh)
+{
+  g_free (bvh->node.x1);
+  g_free (bvh->first);
+  g_free (bvh->count);
+  g_free (bvh->parent);
+  g_free (bvh->item.x1);
+  g_free (bvh->bboxes);
+  g_free (bvh->leaf);
+  if (bvh->index)
+    g_hash_table_destroy (bvh->index);
+}
+
+/**
+ * gts_bvh_destroy:
+ * @bvh: a #GtsBVH.
+ * @free_leaves: if %TRUE the bounding boxes given by the user are freed.
+ *
+ * Frees all the memory allocated for @bvh and, if @free_leaves is
+ * set to %TRUE, destroys the boxes given when creating it.
+ */
+void gts_bvh_destroy (GtsBVH * bvh, gboolean free_leaves)
+{
+  g_return_if_fail (bvh != NULL);
+
+  if (free_leaves) {
+    guint i;
+
+    for (i = 0; i < bvh->nitems; i++)
+      gts_object_destroy (GTS_OBJECT (bvh->bboxes[i]));
+  }
+  bvh_free_arrays (bvh);
+  g_free (bvh);
+}
+
+/* Sets the box of item @j of @bvh to the one of its #GtsBBox */
+static void item_update (GtsBVH * bvh, guint32 j)
+{
+  GtsBBox * bb = bvh->bboxes[j];
+
+  bvh->item.x1[j] = bb->x1; bvh->item.y1[j] = bb->y1;
+  bvh->item.z1[j] = bb->z1; bvh->item.x2[j] = bb->x2;
+  bvh->item.y2[j] = bb->y2; bvh->item.z2[j] = bb->z2;
+}
+
+/* Sets the box of node @i of @bvh to the union of the boxes of its
+   children or items */
+static void node_update (GtsBVH * bvh, guint32 i)
+{
+  GtsBVHBoxes * b = bvh->count[i] > 0 ? &bvh->item : &bvh->node;
+  guint32 j = bvh->first[i], end = j + (bvh->count[i] > 0 ? 
+					 bvh->count[i] : 2);
+  Box box;
+
+  box_init (&box);
+  for (; j < end; j++) {
+    box.x1 = MIN (box.x1, b->x1[j]); box.y1 = MIN (box.y1, b->y1[j]);
+    box.z1 = MIN (box.z1, b->z1[j]); box.x2 = MAX (box.x2, b->x2[j]);
+    box.y2 = MAX (box.y2, b->y2[j]); box.z2 = MAX (box.z2, b->z2[j]);
+  }
+  boxes_set (&bvh->node, i, &box);
+}
+
+static void bbox_update (GtsBBox * bb, GtsPoint ** p, guint n)
+{
+  gdouble x1 = p[0]->x, y1 = p[0]->y, z1 = p[0]->z;
+  gdouble x2 = x1, y2 = y1, z2 = z1;
+  guint i;
+
+  for (i = 1; i < n; i++) {
+    x1 = MIN (x1, p[i]->x); y1 = MIN (y1, p[i]->y); z1 = MIN (z1, p[i]->z);
+    x2 = MAX (x2, p[i]->x); y2 = MAX (y2, p[i]->y); z2 = MAX (z2, p[i]->z);
+  }
+  gts_bbox_set (bb, bb->bounded, x1, y1, z1, x2, y2, z2);
+}
+
+typedef struct {
+  GtsBVH * bvh;
+  guint8 * marked;   /* nodes then items */
+  GArray * nodes;    /* marked nodes */
+} Refit;
+
+/* If @o is bounded by an item of @r->bvh, updates its box and marks
+   the nodes containing it */
+static void refit_touch (Refit * r, gpointer o, GtsPoint ** p, guint n)
+{
+  GtsBVH * bvh = r->bvh;
+  guint32 j = GPOINTER_TO_UINT (g_hash_table_lookup (bvh->index, o)), i;
+
+  if (j-- == 0 || r->marked[bvh->nnodes + j])
+    return;
+  r->marked[bvh->nnodes + j] = TRUE;
+  bbox_update (bvh->bboxes[j], p, n);
+  item_update (bvh, j);
+  for (i = bvh->leaf[j]; !r->marked[i]; i = bvh->parent[i]) {
+    r->marked[i] = TRUE;
+    g_array_append_val (r->nodes, i);
+    if (i == 0)
+      break;
+  }
+}
+
+static int decreasing (const void * a, const void * b)
+{
+  guint32 i = *((guint32 *) a), j = *((guint32 *) b);
+
+  return i < j ? 1 : i > j ? -1 : 0;
+}
+
+static void bvh_rebuild (GtsBVH * bvh)
+{
+  GtsBVH * new = bvh_new (bvh->bboxes, bvh->nitems, bvh->nthreads);
+
+  bvh_free_arrays (bvh);
+  *bvh = *new;
+  g_free (new);
+}
+
+/**
+ * gts_bvh_refit:
+ * @bvh: a #GtsBVH.
+ * @vertices: a list of the #GtsVertex which have moved or %NULL.
+ * @max_cost: the maximum increase of the cost of @bvh.
+ *
+ * Updates @bvh after some of the objects it bounds have moved, without
+ * changing its structure.
+ *
+ * If @vertices is not %NULL, the bounding boxes of @bvh bounding one
+ * of @vertices, one of their segments or one of the triangles of these
+ * segments are updated to bound their new position. Only the nodes
+ * containing these boxes are updated, bottom-up.
+ *
+ * If @vertices is %NULL, the caller is assumed to have updated the
+ * bounding boxes of @bvh (using gts_bbox_set() for example) and all
+ * the nodes are updated.
+ *
+ * Refitting does not move items between nodes, so the boxes of the
+ * nodes may grow and overlap as objects move away from their initial
+ * positions. If this increases the cost of @bvh for the surface area
+ * heuristic by more than a factor @max_cost relative to its cost when
+ * it was built, @bvh is rebuilt from its (updated) bounding boxes,
+ * which are reused. Use %G_MAXDOUBLE to never rebuild.
+ *
+ * Returns: %TRUE if @bvh has been rebuilt, %FALSE otherwise.
+ */
+gboolean gts_bvh_refit (GtsBVH * bvh, GSList * vertices, gdouble max_cost)
+{
+  g_return_val_if_fail (bvh != NULL, FALSE);
+
+  if (vertices == NULL) {
+    guint i;
+
+    for (i = 0; i < bvh->nitems; i++)
+      item_update (bvh, i);
+    for (i = bvh->nnodes; i > 0; i--)
+      node_update (bvh, i - 1);
+    bvh->cost = bvh_cost (bvh);
+  }
+  else {
+    Refit r;
+    gdouble cost, area = node_area (&bvh->node, 0);
+    guint i;
+
+    if (bvh->index == NULL) {
+      bvh->index = g_hash_table_new (NULL, NULL);
+      for (i = 0; i < bvh->nitems; i++)
+	g_hash_table_insert (bvh->index, bvh->bboxes[i]->bounded, 
+			     GUINT_TO_POINTER (i + 1));
+    }
+    r.bvh = bvh;
+    r.marked = g_malloc0 (bvh->nnodes + bvh->nitems);
+    r.nodes = g_array_new (FALSE, FALSE, sizeof (guint32));
+    while (vertices) {
+      GtsVertex * v = vertices->data;
+      GtsSegment * s;
+      guint k, l;
+
+      refit_touch (&r, v, (GtsPoint **) &v, 1);
+      GTS_ADJACENCY_FOREACH (&v->segments, k, s) {
+	GtsTriangle * t;
+	GtsPoint * p[3];
+
+	p[0] = GTS_POINT (s->v1); p[1] = GTS_POINT (s->v2);
+	refit_touch (&r, s, p, 2);
+	if (GTS_IS_EDGE (s))
+	  GTS_ADJACENCY_FOREACH (&GTS_EDGE (s)->triangles, l, t) {
+	    gts_triangle_vertices (t, (GtsVertex **) &p[0], 
+				   (GtsVertex **) &p[1], 
+				   (GtsVertex **) &p[2]);
+	    refit_touch (&r, t, p, 3);
+	  }
+      }
+      vertices = vertices->next;
+    }
+
+    /* children have larger indices than their parent */
+    qsort (r.nodes->data, r.nodes->len, sizeof (guint32), decreasing);
+    cost = bvh->cost*(area > 0. ? area : 1.);
+    for (i = 0; i < r.nodes->len; i++) {
+      guint32 n = g_array_index (r.nodes, guint32, i);
+
+      cost -= NODE_COST (bvh, n);
+      node_update (bvh, n);
+      cost += NODE_COST (bvh, n);
+    }
+    area = node_area (&bvh->node, 0);
+    bvh->cost = area > 0. ? cost/area : cost;
+    g_array_free (r.nodes, TRUE);
+    g_free (r.marked);
+  }
+
+  if (bvh->cost > max_cost*bvh->build_cost) {
+    bvh_rebuild (bvh);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+#define STACK_NEW(local, n) ((n) <= STACK_SIZE ? (local) :\
+			     g_malloc ((n)*sizeof (*(local))))
+#define STACK_FREE(stack, local) if ((stack) != (local)) g_free (stack)
+
+#define BOXES_ARE_OVERLAPPING(b, i, bb) (!((bb)->x1 > (b)->x2[i] ||\
+					   (bb)->x2 < (b)->x1[i] ||\
+					   (bb)->y1 > (b)->y2[i] ||\
+					   (bb)->y2 < (b)->y1[i] ||\
+					   (bb)->z1 > (b)->z2[i] ||\
+					   (bb)->z2 < (b)->z1[i]))
+#define BOX_IS_STABBED(b, i, p) (!((p)->x > (b)->x2[i] ||\
+				   (p)->y < (b)->y1[i] ||\
+				   (p)->y > (b)->y2[i] ||\
+				   (p)->z < (b)->z1[i] ||\
+				   (p)->z > (b)->z2[i]))
+
+/**
+ * gts_bvh_stabbed:
+ * @bvh: a #GtsBVH.
+ * @p: a #GtsPoint.
+ *
+ * Returns: a list of the bounding boxes of @bvh which are stabbed by
+ * the ray defined by @p (see gts_bbox_is_stabbed()).
+ */
+GSList * gts_bvh_stabbed (GtsBVH * bvh, GtsPoint * p)
+{
+  guint32 local[STACK_SIZE], * stack;
+  GSList * list = NULL;
+  guint n = 0;
+
+  g_return_val_if_fail (bvh != NULL, NULL);
+  g_return_val_if_fail (p != NULL, NULL);
+
+  stack = STACK_NEW (local, bvh->depth + 1);
+  stack[n++] = 0;
+  while (n > 0) {
+    guint32 i = stack[--n], j;
+
+    if (!BOX_IS_STABBED (&bvh->node, i, p))
+      continue;
+    if (bvh->count[i] == 0) {
+      stack[n++] = bvh->first[i] + 1;
+      stack[n++] = bvh->first[i];
+    }
+    else
+      for (j = bvh->first[i]; j < bvh->first[i] + bvh->count[i]; j++)
+	if (BOX_IS_STABBED (&bvh->item, j, p))
+	  list = g_slist_prepend (list, bvh->bboxes[j]);
+  }
+  STACK_FREE (stack, local);
+
+  return list;
+}
+
+/**
+ * gts_bvh_overlap:
+ * @bvh: a #GtsBVH.
+ * @bbox: a #GtsBBox.
+ *
+ * Returns: a list of the bounding boxes of @bvh which overlap @bbox.
+ */
+GSList * gts_bvh_overlap (GtsBVH * bvh, GtsBBox * bbox)
+{
+  guint32 local[STACK_SIZE], * stack;
+  GSList * list = NULL;
+  guint n = 0;
+
+  g_return_val_if_fail (bvh != NULL, NULL);
+  g_return_val_if_fail (bbox != NULL, NULL);
+
+  stack = STACK_NEW (local, bvh->depth + 1);
+  stack[n++] = 0;
+  while (n > 0) {
+    guint32 i = stack[--n], j;
+
+    if (!BOXES_ARE_OVERLAPPING (&bvh->node, i, bbox))
+      continue;
+    if (bvh->count[i] == 0) {
+      stack[n++] = bvh->first[i] + 1;
+      stack[n++] = bvh->first[i];
+    }
+    else
+      for (j = bvh->first[i]; j < bvh->first[i] + bvh->count[i]; j++)
+	if (BOXES_ARE_OVERLAPPING (&bvh->item, j, bbox))
+	  list = g_slist_prepend (list, bvh->bboxes[j]);
+  }
+  STACK_FREE (stack, local);
+
+  return list;
+}
+
+/**
+ * gts_bvh_is_overlapping:
+ * @bvh: a #GtsBVH.
+ * @bbox: a #GtsBBox.
+ *
+ * Returns: %TRUE if any bounding box of @bvh overlaps @bbox, %FALSE
+ * otherwise.
+ */
+gboolean gts_bvh_is_overlapping (GtsBVH * bvh, GtsBBox * bbox)
+{
+  guint32 local[STACK_SIZE], * stack;
+  gboolean overlapping = FALSE;
+  guint n = 0;
+
+  g_return_val_if_fail (bvh != NULL, FALSE);
+  g_return_val_if_fail (bbox != NULL, FALSE);
+
+  stack = STACK_NEW (local, bvh->depth + 1);
+  stack[n++] = 0;
+  while (n > 0 && !overlapping) {
+    guint32 i = stack[--n], j;
+
+    if (!BOXES_ARE_OVERLAPPING (&bvh->node, i, bbox))
+      continue;
+    if (bvh->count[i] == 0) {
+      stack[n++] = bvh->first[i] + 1;
+      stack[n++] = bvh->first[i];
+    }
+    else
+      for (j = bvh->first[i]; j < bvh->first[i] + bvh->count[i]; j++)
+	if (BOXES_ARE_OVERLAPPING (&bvh->item, j, bbox)) {
+	  overlapping = TRUE;
+	  break;
+	}
+  }
+  STACK_FREE (stack, local);
+
+  return overlapping;
+}
+
+#define NODES_ARE_OVERLAPPING(b1, i, b2, j) (!((b1)->x1[i] > (b2)->x2[j] ||\
+					       (b1)->x2[i] < (b2)->x1[j] ||\
+					       (b1)->y1[i] > (b2)->y2[j] ||\
+					       (b1)->y2[i] < (b2)->y1[j] ||\
+					       (b1)->z1[i] > (b2)->z2[j] ||\
+					       (b1)->z2[i] < (b2)->z1[j]))
+#define NODE_VOLUME(b, i) (((b)->x2[i] - (b)->x1[i])*\
+			   ((b)->y2[i] - (b)->y1[i])*\
+			   ((b)->z2[i] - (b)->z1[i]))
+
+/**
+ * gts_bvh_traverse_overlapping:
+ * @bvh1: a #GtsBVH.
+ * @bvh2: a #GtsBVH.
+ * @func: a #GtsBBTreeTraverseFunc.
+ * @data: user data to be passed to @func.
+ *
+ * Calls @func for each overlapping pair of bounding boxes of @bvh1
+ * and @bvh2.
+ */
+void gts_bvh_traverse_overlapping (GtsBVH * bvh1, GtsBVH * bvh2,
+				   GtsBBTreeTraverseFunc func,
+				   gpointer data)
+{
+  guint32 local[STACK_SIZE], * stack;
+  guint n = 0;
+
+  g_return_if_fail (bvh1 != NULL && bvh2 != NULL);
+  g_return_if_fail (func != NULL);
+
+  /* pairs of nodes: descending one of them adds at most one pair */
+  stack = STACK_NEW (local, 2*(bvh1->depth + bvh2->depth + 1));
+  stack[n++] = 0; stack[n++] = 0;
+  while (n > 0) {
+    guint32 j = stack[--n], i = stack[--n];
+
+    if (!NODES_ARE_OVERLAPPING (&bvh1->node, i, &bvh2->node, j))
+      continue;
+    if (bvh1->count[i] > 0 && bvh2->count[j] > 0) {
+      guint32 k, l;
+
+      for (k = bvh1->first[i]; k < bvh1->first[i] + bvh1->count[i]; k++)
+	for (l = bvh2->first[j]; l < bvh2->first[j] + bvh2->count[j]; l++)
+	  if (NODES_ARE_OVERLAPPING (&bvh1->item, k, &bvh2->item, l))
+	    (*func) (bvh1->bboxes[k], bvh2->bboxes[l], data);
+    }
+    else if (bvh2->count[j] > 0 ||
+	     (bvh1->count[i] == 0 &&
+	      NODE_VOLUME (&bvh1->node, i) > NODE_VOLUME (&bvh2->node, j))) {
+      stack[n++] = bvh1->first[i] + 1; stack[n++] = j;
+      stack[n++] = bvh1->first[i]; stack[n++] = j;
+    }
+    else {
+      stack[n++] = i; stack[n++] = bvh2->first[j] + 1;
+      stack[n++] = i; stack[n++] = bvh2->first[j];
+    }
+  }
+  STACK_FREE (stack, local);
+}
+
+/* Square of the distance between @p and box @i of @b */
+static gdouble box_point_min2 (GtsBVHBoxes * b, guint32 i, GtsPoint * p)
+{
+  gdouble d = 0., t;
+
+  if (p->x < b->x1[i])      { t = b->x1[i] - p->x; d += t*t; }
+  else if (p->x > b->x2[i]) { t = p->x - b->x2[i]; d += t*t; }
+  if (p->y < b->y1[i])      { t = b->y1[i] - p->y; d += t*t; }
+  else if (p->y > b->y2[i]) { t = p->y - b->y2[i]; d += t*t; }
+  if (p->z < b->z1[i])      { t = b->z1[i] - p->z; d += t*t; }
+  else if (p->z > b->z2[i]) { t = p->z - b->z2[i]; d += t*t; }
+  return d;
+}
+
+typedef gdouble (* NearestEvalFunc) (GtsPoint * p, 
+				     GtsBBox * bb, 
+				     GtsVector closest,
+				     gpointer data);
+
+typedef struct {
+  guint32 node;
+  gdouble min;
+} NearestNode;
+
+/* Sets the first elements of @n to the (at most) @k items of @bvh
+   closest to @p, as evaluated by @eval, and returns their number. The
+   children of a node are visited closest first and the nodes and items
+   further away than the k-th closest item found so far are skipped. */
+static guint bvh_k_nearest (GtsBVH * bvh, GtsPoint * p,
+			    NearestEvalFunc eval, gpointer data,
+			    guint k, GtsBBoxNearest * n)
+{
+  NearestNode local[STACK_SIZE], * stack;
+  gdouble bound = G_MAXDOUBLE;
+  guint m = 0, ns = 0;
+
+  if (k == 0)
+    return 0;
+
+  stack = STACK_NEW (local, bvh->depth + 1);
+  stack[0].node = 0;
+  stack[0].min = box_point_min2 (&bvh->node, 0, p);
+  ns = 1;
+  while (ns > 0) {
+    guint32 i, j;
+
+    ns--;
+    if (stack[ns].min >= bound)
+      continue;
+    i = stack[ns].node;
+    if (bvh->count[i] == 0) {
+      guint32 c = bvh->first[i];
+      gdouble min1 = box_point_min2 (&bvh->node, c, p);
+      gdouble min2 = box_point_min2 (&bvh->node, c + 1, p);
+
+      /* the closest child is pushed last to be visited first */
+      if (min1 < min2) {
+	if (min2 < bound) { stack[ns].node = c + 1; stack[ns++].min = min2; }
+	if (min1 < bound) { stack[ns].node = c;     stack[ns++].min = min1; }
+      }
+      else {
+	if (min1 < bound) { stack[ns].node = c;     stack[ns++].min = min1; }
+	if (min2 < bound) { stack[ns].node = c + 1; stack[ns++].min = min2; }
+      }
+    }
+    else
+      for (j = bvh->first[i]; j < bvh->first[i] + bvh->count[i]; j++)
+	if (box_point_min2 (&bvh->item, j, p) < bound) {
+	  GtsBBoxNearest hit;
+
+	  hit.bbox = bvh->bboxes[j];
+	  hit.distance2 = (*eval) (p, hit.bbox, hit.closest, data);
+	  m = gts_bbox_nearest_insert (n, k, m, &hit);
+	  if (m == k)
+	    bound = n[k - 1].distance2;
+	}
+  }
+  STACK_FREE (stack, local);
+
+  return m;
+}
+
+/* Same as gts_bbox_point_distance2() for box @i of @b */
+static void box_point_distance2 (GtsBVHBoxes * b, guint32 i, GtsPoint * p,
+				 gdouble * min, gdouble * max)
+{
+  gdouble x = p->x, y = p->y, z = p->z;
+  gdouble xd1 = (b->x1[i] - x)*(b->x1[i] - x);
+  gdouble xd2 = (x - b->x2[i])*(x - b->x2[i]);
+  gdouble yd1 = (b->y1[i] - y)*(b->y1[i] - y);
+  gdouble yd2 = (y - b->y2[i])*(y - b->y2[i]);
+  gdouble zd1 = (b->z1[i] - z)*(b->z1[i] - z);
+  gdouble zd2 = (z - b->z2[i])*(z - b->z2[i]);
+  gdouble mx = MIN (xd1, xd2), Mx = MAX (xd1, xd2);
+  gdouble my = MIN (yd1, yd2), My = MAX (yd1, yd2);
+  gdouble mz = MIN (zd1, zd2), Mz = MAX (zd1, zd2);
+  gdouble dmax;
+
+  *min = (x < b->x1[i] ? xd1 : x > b->x2[i] ? xd2 : 0.) +
+    (y < b->y1[i] ? yd1 : y > b->y2[i] ? yd2 : 0.) +
+    (z < b->z1[i] ? zd1 : z > b->z2[i] ? zd2 : 0.);
+  dmax = mx + My + Mz;
+  dmax = MIN (dmax, Mx + my + Mz);
+  dmax = MIN (dmax, Mx + My + mz);
+  *max = dmax;
+}
+
+/* Returns the smallest upper bound, given by box_point_distance2(), of
+   the square of the distance between @p and the objects of @bvh */
+static gdouble bvh_min_max (GtsBVH * bvh, GtsPoint * p, guint32 * stack)
+{
+  gdouble min, min_max;
+  guint n = 0;
+
+  box_point_distance2 (&bvh->node, 0, p, &min, &min_max);
+  stack[n++] = 0;
+  while (n > 0) {
+    guint32 i = stack[--n], j;
+    gdouble max;
+
+    box_point_distance2 (&bvh->node, i, p, &min, &max);
+    if (min > min_max)
+      continue;
+    if (bvh->count[i] == 0) {
+      guint32 c = bvh->first[i];
+      gdouble min1, max1, min2, max2;
+
+      box_point_distance2 (&bvh->node, c, p, &min1, &max1);
+      box_point_distance2 (&bvh->node, c + 1, p, &min2, &max2);
+      min_max = MIN (min_max, MIN (max1, max2));
+      /* the closest child is visited first */
+      if (min1 < min2) {
+	if (min2 <= min_max) stack[n++] = c + 1;
+	if (min1 <= min_max) stack[n++] = c;
+      }
+      else {
+	if (min1 <= min_max) stack[n++] = c;
+	if (min2 <= min_max) stack[n++] = c + 1;
+      }
+    }
+    else
+      for (j = bvh->first[i]; j < bvh->first[i] + bvh->count[i]; j++) {
+	box_point_distance2 (&bvh->item, j, p, &min, &max);
+	if (max < min_max)
+	  min_max = max;
+      }
+  }
+
+  return min_max;
+}
+
+/* Calls @func for each item of @bvh which may be the closest to @p,
+   i.e. the same items as gts_bb_tree_point_closest_bboxes(): those
+   whose box is not further from @p than the maximum distance between
+   @p and the object bounded by any of the items */
+static void bvh_point_closest_items (GtsBVH * bvh, GtsPoint * p,
+				     void (* func) (GtsBBox *, gpointer),
+				     gpointer data)
+{
+  guint32 local[STACK_SIZE], * stack;
+  gdouble min_max;
+  guint n = 0;
+
+  stack = STACK_NEW (local, bvh->depth + 1);
+  min_max = bvh_min_max (bvh, p, stack);
+  stack[n++] = 0;
+  while (n > 0) {
+    guint32 i = stack[--n], j;
+    gdouble min, max;
+
+    box_point_distance2 (&bvh->node, i, p, &min, &max);
+    if (min > min_max)
+      continue;
+    if (bvh->count[i] == 0) {
+      stack[n++] = bvh->first[i] + 1;
+      stack[n++] = bvh->first[i];
+    }
+    else
+      for (j = bvh->first[i]; j < bvh->first[i] + bvh->count[i]; j++) {
+	box_point_distance2 (&bvh->item, j, p, &min, &max);
+	if (min <= min_max)
+	  (*func) (bvh->bboxes[j], data);
+      }
+  }
+  STACK_FREE (stack, local);
+}
+
+typedef struct {
+  GtsPoint * p;
+  GtsBBoxDistFunc distance;
+  gdouble dmin;
+  GtsBBox * bbox;
+} PointDistance;
+
+static void point_distance (GtsBBox * bb, PointDistance * d)
+{
+  gdouble dist = (*d->distance) (d->p, bb->bounded);
+
+  if (fabs (dist) < fabs (d->dmin)) {
+    d->dmin = dist;
+    d->bbox = bb;
+  }
+}
+
+/**
+ * gts_bvh_point_distance:
+ * @bvh: a #GtsBVH.
+ * @p: a #GtsPoint.
+ * @distance: a #GtsBBoxDistFunc.
+ * @bbox: if not %NULL is set to the bounding box containing the closest
+ * object.
+ *
+ * Same as gts_bb_tree_point_distance() for a #GtsBVH. This function
+ * only reads @bvh and can be called concurrently from several threads.
+ *
+ * Returns: the distance as evaluated by @distance between @p and the closest
+ * object in @bvh.
+ */
+gdouble gts_bvh_point_distance (GtsBVH * bvh,
+				GtsPoint * p,
+				GtsBBoxDistFunc distance,
+				GtsBBox ** bbox)
+{
+  PointDistance d;
+
+  g_return_val_if_fail (bvh != NULL, G_MAXDOUBLE);
+  g_return_val_if_fail (p != NULL, G_MAXDOUBLE);
+  g_return_val_if_fail (distance != NULL, G_MAXDOUBLE);
+
+  d.p = p;
+  d.distance = distance;
+  d.dmin = G_MAXDOUBLE;
+  d.bbox = NULL;
+  bvh_point_closest_items (bvh, p, (void (*) (GtsBBox *, gpointer))
+			   point_distance, &d);
+  if (bbox && d.bbox)
+    *bbox = d.bbox;
+
+  return d.dmin;
+}
+
+typedef struct {
+  GtsPoint * p;
+  GtsBBoxClosestFunc closest;
+  gdouble dmin;
+  GtsPoint * np;
+} PointClosest;
+
+static void point_closest (GtsBBox * bb, PointClosest * c)
+{
+  GtsPoint * tp = (*c->closest) (c->p, bb->bounded);
+  gdouble d = gts_point_distance2 (tp, c->p);
+
+  if (d < c->dmin) {
+    if (c->np)
+      gts_object_destroy (GTS_OBJECT (c->np));
+    c->np = tp;
+    c->dmin = d;
+  }
+  else
+    gts_object_destroy (GTS_OBJECT (tp));
+}
+
+/**
+ * gts_bvh_point_closest:
+ * @bvh: a #GtsBVH.
+ * @p: a #GtsPoint.
+ * @closest: a #GtsBBoxClosestFunc.
+ * @distance: if not %NULL is set to the distance between @p and the
+ * new #GtsPoint.
+ *
+ * Same as gts_bb_tree_point_closest() for a #GtsBVH.
+ *
+ * Returns: a new #GtsPoint, closest point to @p and belonging to an object of
+ * @bvh.
+ */
+GtsPoint * gts_bvh_point_closest (GtsBVH * bvh,
+				  GtsPoint * p,
+				  GtsBBoxClosestFunc closest,
+				  gdouble * distance)
+{
+  PointClosest c;
+
+  g_return_val_if_fail (bvh != NULL, NULL);
+  g_return_val_if_fail (p != NULL, NULL);
+  g_return_val_if_fail (closest != NULL, NULL);
+
+  c.p = p;
+  c.closest = closest;
+  c.dmin = G_MAXDOUBLE;
+  c.np = NULL;
+  bvh_point_closest_items (bvh, p, (void (*) (GtsBBox *, gpointer))
+			   point_closest, &c);
+  if (distance)
+    *distance = c.dmin;
+
+  return c.np;
+}
+
+static gdouble point_nearest (GtsPoint * p, GtsBBox * bb, GtsVector closest,
+			      GtsBBoxNearestFunc * nearest)
+{
+  return (**nearest) (p, bb->bounded, closest);
+}
+
+/**
+ * gts_bvh_point_nearest:
+ * @bvh: a #GtsBVH.
+ * @p: a #GtsPoint.
+ * @nearest: a #GtsBBoxNearestFunc.
+ *
+ * Same as gts_bb_tree_point_nearest() for a #GtsBVH. This function
+ * only reads @bvh and can be called concurrently from several threads.
+ *
+ * Returns: the bounding box of the object of @bvh closest to @p, the
+ * square of its distance to @p and its point closest to @p.
+ */
+GtsBBoxNearest gts_bvh_point_nearest (GtsBVH * bvh,
+				      GtsPoint * p,
+				      GtsBBoxNearestFunc nearest)
+{
+  GtsBBoxNearest n;
+
+  n.bbox = NULL;
+  n.distance2 = G_MAXDOUBLE;
+  n.closest[0] = n.closest[1] = n.closest[2] = 0.;
+
+  g_return_val_if_fail (bvh != NULL, n);
+  g_return_val_if_fail (p != NULL, n);
+  g_return_val_if_fail (nearest != NULL, n);
+
+  bvh_k_nearest (bvh, p, (NearestEvalFunc) point_nearest, &nearest, 1, &n);
+  return n;
+}
+
+/**
+ * gts_bvh_point_k_nearest:
+ * @bvh: a #GtsBVH.
+ * @p: a #GtsPoint.
+ * @nearest: a #GtsBBoxNearestFunc.
+ * @k: the number of objects to look for.
+ * @n: an array of at least @k #GtsBBoxNearest.
+ *
+ * Same as gts_bb_tree_point_k_nearest() for a #GtsBVH.
+ *
+ * Returns: the number of objects found, set in the first elements of @n
+ * by increasing distance to @p.
+ */
+guint gts_bvh_point_k_nearest (GtsBVH * bvh,
+			       GtsPoint * p,
+			       GtsBBoxNearestFunc nearest,
+			       guint k,
+			       GtsBBoxNearest * n)
+{
+  g_return_val_if_fail (bvh != NULL, 0);
+  g_return_val_if_fail (p != NULL, 0);
+  g_return_val_if_fail (nearest != NULL, 0);
+  g_return_val_if_fail (k == 0 || n != NULL, 0);
+
+  return bvh_k_nearest (bvh, p, (NearestEvalFunc) point_nearest, &nearest,
+			k, n);
+}
+
+/* Interleaves the 10 lowest bits of @x with zeros */
+static guint32 morton_spread (guint32 x)
+{
+  x &= 0x3ff;
+  x = (x | (x << 16)) & 0x030000ff;
+  x = (x | (x << 8))  & 0x0300f00f;
+  x = (x | (x << 4))  & 0x030c30c3;
+  x = (x | (x << 2))  & 0x09249249;
+  return x;
+}
+
+static int compare_keys (const void * a, const void * b)
+{
+  guint64 k1 = *((guint64 *) a), k2 = *((guint64 *) b);
+
+  return k1 < k2 ? -1 : k1 > k2;
+}
+
+/* Returns an array of @n keys: the Morton code of point i, relative to
+   the bounding box of @points, in the upper 32 bits and i in the lower
+   32 bits, sorted by increasing code */
+static guint64 * morton_order (GtsVector * points, guint n)
+{
+  guint64 * keys = g_malloc (n*sizeof (guint64));
+  Box b;
+  gdouble sx, sy, sz;
+  guint i;
+
+  box_init (&b);
+  for (i = 0; i < n; i++) {
+    Box p;
+
+    p.x1 = p.x2 = points[i][0];
+    p.y1 = p.y2 = points[i][1];
+    p.z1 = p.z2 = points[i][2];
+    box_add (&b, &p);
+  }
+  sx = b.x2 > b.x1 ? 1023.99/(b.x2 - b.x1) : 0.;
+  sy = b.y2 > b.y1 ? 1023.99/(b.y2 - b.y1) : 0.;
+  sz = b.z2 > b.z1 ? 1023.99/(b.z2 - b.z1) : 0.;
+  for (i = 0; i < n; i++) {
+    guint32 code =
+      morton_spread ((guint32) ((points[i][0] - b.x1)*sx)) |
+      morton_spread ((guint32) ((points[i][1] - b.y1)*sy)) << 1 |
+      morton_spread ((guint32) ((points[i][2] - b.z1)*sz)) << 2;
+
+    keys[i] = ((guint64) code) << 32 | i;
+  }
+  qsort (keys, n, sizeof (guint64), compare_keys);
+
+  return keys;
+}
+
+typedef struct {
+  GtsBVH * bvh;
+  GtsVector * points;
+  guint64 * order;
+  GtsBBoxNearestFunc nearest;
+  GtsBBoxNearest * results;
+} PointsNearest;
+
+typedef struct {
+  guint start, end;
+} PointsChunk;
+
+static void points_nearest_chunk (PointsChunk * c, PointsNearest * q)
+{
+  GtsPoint * p = gts_point_new (gts_point_class (), 0., 0., 0.);
+  guint i;
+
+  for (i = c->start; i < c->end; i++) {
+    guint32 j = q->order ? (guint32) q->order[i] : i;
+
+    p->x = q->points[j][0];
+    p->y = q->points[j][1];
+    p->z = q->points[j][2];
+    bvh_k_nearest (q->bvh, p, (NearestEvalFunc) point_nearest, &q->nearest,
+		   1, &q->results[j]);
+  }
+  gts_object_destroy (GTS_OBJECT (p));
+}
+
+/**
+ * gts_bvh_points_nearest:
+ * @bvh: a #GtsBVH.
+ * @points: an array of @n query points.
+ * @n: the number of query points.
+ * @nearest: a #GtsBBoxNearestFunc.
+ * @results: an array of @n #GtsBBoxNearest.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Sets @results[i] as gts_bvh_point_nearest() would for @points[i].
+ * For example, for a #GtsBVH built by gts_bvh_surface() and
+ * gts_point_triangle_nearest() as @nearest, @results[i] is set to the
+ * square of the distance between @points[i] and the surface, to the
+ * closest point of the surface and to the bounding box of the closest
+ * triangle.
+ *
+ * The queries are processed in the Morton order of @points, so that
+ * consecutive queries visit mostly the same nodes of @bvh, and runs of
+ * consecutive queries are split between @nthreads threads. @nearest
+ * must then be safe to call concurrently. It is given a #GtsPoint
+ * reused for all the queries of a run.
+ */
+void gts_bvh_points_nearest (GtsBVH * bvh,
+			     GtsVector * points,
+			     guint n,
+			     GtsBBoxNearestFunc nearest,
+			     GtsBBoxNearest * results,
+			     guint nthreads)
+{
+  PointsNearest q;
+  guint i, nchunks;
+
+  g_return_if_fail (bvh != NULL);
+  g_return_if_fail (n == 0 || points != NULL);
+  g_return_if_fail (nearest != NULL);
+  g_return_if_fail (n == 0 || results != NULL);
+
+  if (n == 0)
+    return;
+
+  q.bvh = bvh;
+  q.points = points;
+  q.order = n > 1 ? morton_order (points, n) : NULL;
+  q.nearest = nearest;
+  q.results = results;
+
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+  nchunks = (n + QUERY_CHUNK - 1)/QUERY_CHUNK;
+  if (nthreads > 1 && nchunks > 1) {
+    GThreadPool * pool = g_thread_pool_new ((GFunc) points_nearest_chunk, &q,
+					    nthreads, TRUE, NULL);
+    PointsChunk * chunks = g_malloc (nchunks*sizeof (PointsChunk));
+
+    for (i = 0; i < nchunks; i++) {
+      chunks[i].start = i*QUERY_CHUNK;
+      chunks[i].end = MIN ((i + 1)*QUERY_CHUNK, n);
+      g_thread_pool_push (pool, &chunks[i], NULL);
+    }
+    /* waits for all the chunks to be processed */
+    g_thread_pool_free (pool, FALSE, TRUE);
+    g_free (chunks);
+  }
+  else {
+    PointsChunk chunk;
+
+    chunk.start = 0;
+    chunk.end = n;
+    points_nearest_chunk (&chunk, &q);
+  }
+  g_free (q.order);
+}
@@ -25,180 +25,48 @@
 #include <math.h>
 #include "gts.h"
 
-#ifdef USE_SURFACE_BTREE
-
-static gint find_closest (GtsTriangle * t, gpointer value, gpointer * data)
-{
-  guint * ns = data[2];
-  guint * n = data[3];
-
-  if (*n >= *ns)
-    return TRUE;
-  else {
-    gdouble * dmin = data[0];
-    gpointer * closest = data[1];
-    GtsPoint * p = data[4];
-
-    if (gts_triangle_orientation (t) > 0.) {
-      GtsPoint * p1 = GTS_POINT (GTS_SEGMENT (t->e1)->v1);
-      gdouble d = (p->x - p1->x)*(p->x - p1->x) + (p->y - p1->y)*(p->y - p1->y);
-      
-      if (d < *dmin) {
-	*dmin = d;
-	*closest = t;
-      }
-      (*n)++;
-    }
-  }
-  return FALSE;
-}
-
-/* select the face closest to @p among n^1/3 randomly picked faces
- *  of @surface */
+/* select the face closest to @p among n^1/3 faces of @surface, evenly
+ * spaced in its set of faces */
 static GtsFace * closest_face (GtsSurface * s, GtsPoint * p)
 {
-  guint n = 0, nt, ns;
+  guint i, nt, step;
   gdouble dmin = G_MAXDOUBLE;
   GtsFace * closest = NULL;
-  gpointer data[5];
 
   nt = gts_surface_face_number (s);
   if (!nt)
     return NULL;
-  ns = exp (log ((gdouble) nt)/3.);
 
-  data[0] = &dmin;
-  data[1] = &closest;
-  data[2] = &ns;
-  data[3] = &n;
-  data[4] = p;
-  g_tree_traverse (s->faces, (GTraverseFunc) find_closest, G_IN_ORDER, data);
+  step = MAX (nt/(guint) exp (log ((gdouble) nt)/3.), 1);
+  for (i = 0; i < nt; i += step) {
+    GtsFace * f = s->faces.items[i];
 
-  return closest;
-}
-
-#else /* not USE_SURFACE_BTREE */
-
-#  if GLIB_CHECK_VERSION(2,4,0)
-/* finally, with g_hash_table_find we are able to stop iteration over the hash 
-   table in the middle */
-
-typedef struct _SFindClosest SFindClosest; 
-
-struct _SFindClosest {
-  gdouble dmin; 
-  GtsFace *closest;
-  GtsPoint * p;
-  gint stop;
-};
-
-static gboolean find_closest (gpointer key, gpointer value, gpointer user_data)
-{
-  SFindClosest * data = (SFindClosest *) user_data;
-  GtsFace * f = GTS_FACE (value);
-  
-  if (gts_triangle_orientation (GTS_TRIANGLE (f)) > 0.) {
-    GtsPoint * p1 = GTS_POINT (GTS_SEGMENT (GTS_TRIANGLE (f)->e1)->v1);
-    gdouble d = ((data->p->x - p1->x)*(data->p->x - p1->x) + 
-		 (data->p->y - p1->y)*(data->p->y - p1->y));
-
-    if (d < data->dmin) {
-      data->dmin = d;
-      data->closest = f;
-    }
-  }
-  data->stop--;
-  return !(data->stop > 0);
-}
-
-static GtsFace * closest_face (GtsSurface * s, GtsPoint * p)
-{
-  SFindClosest fc;
-
-  fc.dmin = G_MAXDOUBLE;
-  fc.closest = NULL;
-  fc.p = p;
-  fc.stop = (gint) exp (log ((gdouble) g_hash_table_size (s->faces))/3.);
-  g_hash_table_find (s->faces, find_closest, &fc);
-  
-  return fc.closest;
-}
-
-#  else /* VERSION < 2.4.0 */
-
-/* Due to an unkown reason g_hash_table_foreach does not allow to stop 
- * the loop, hence the redefinition. I hope they don't change
- * the GHashTable, GHashNode structures ... */
-typedef struct _GHashNode      GHashNode;
-
-struct _GHashNode
-{
-  gpointer key;
-  gpointer value;
-  GHashNode *next;
-};
-
-struct _GHashTable
-{
-  gint size;
-  gint nnodes;
-  guint frozen;
-  GHashNode **nodes;
-  GHashFunc hash_func;
-  GCompareFunc key_compare_func;
-};
-
-/* select the face closest to @p among n^1/3 randomly picked faces
- * of @surface */
-static GtsFace * closest_face (GtsSurface * s, GtsPoint * p)
-{
-  guint i, n, nt, ns;
-  gdouble dmin = G_MAXDOUBLE;
-  GtsFace * closest = NULL;
-  GHashNode * node;
-  GHashTable * hash_table = s->faces;
-
-  nt = g_hash_table_size (hash_table);
-  if (!nt)
-    return NULL;
+    if (gts_triangle_orientation (GTS_TRIANGLE (f)) > 0.) {
+      GtsPoint * p1 = GTS_POINT (GTS_SEGMENT (GTS_TRIANGLE (f)->e1)->v1);
+      gdouble d = (p->x - p1->x)*(p->x - p1->x) + (p->y - p1->y)*(p->y - p1->y);
 
-  ns = exp(log((gdouble) nt)/3.);
-  for (i = 0, n = 0; i < hash_table->size && n < ns; i++)
-    for (node = hash_table->nodes[i]; node && n < ns; node = node->next) {
-      GtsFace * f = node->key;
-
-      if (gts_triangle_orientation (GTS_TRIANGLE (f)) > 0.) {
-	GtsPoint * p1 = GTS_POINT (GTS_SEGMENT (GTS_TRIANGLE (f)->e1)->v1);
-	gdouble d = (p->x - p1->x)*(p->x - p1->x) + (p->y - p1->y)*(p->y - p1->y);
-		 
-	if (d < dmin) {
-	  dmin = d;
-	  closest = f;
-	}
-	n++;
+      if (d < dmin) {
+	dmin = d;
+	closest = f;
       }
     }
+  }
   return closest;
 }
-#  endif /* VERSION < 2.4.0 */
-#endif /* not USE_SURFACE_BTREE */
 
 /* returns the face belonging to @surface and neighbor of @f via @e */
 static GtsFace * neighbor (GtsFace * f,
 			   GtsEdge * e,
 			   GtsSurface * surface)
 {
-  GSList * i = e->triangles;
-  GtsTriangle * t = GTS_TRIANGLE (f);
+  GtsTriangle * t = GTS_TRIANGLE (f), * t1;
+  guint i;
 
-  while (i) {
-    GtsTriangle * t1 = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t1)
     if (t1 != t &&
 	GTS_IS_FACE (t1) &&
 	gts_face_has_parent_surface (GTS_FACE (t1), surface))
       return GTS_FACE (t1);
-    i = i->next;
-  }
   return NULL;
 }
 
@@ -417,8 +285,9 @@ struct _GtsConstraintClass {
 GtsConstraintClass * gts_constraint_class (void)
 {
   static GtsConstraintClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo constraint_info = {
       "GtsConstraint",
       sizeof (GtsConstraint),
@@ -430,6 +299,7 @@ GtsConstraintClass * gts_constraint_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_edge_class ()), 
 				  &constraint_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -837,7 +707,7 @@ void gts_delaunay_remove_vertex (GtsSurface * surface, GtsVertex * v)
 
 #define NEXT_CUT(edge, edge1, list) { next = neighbor (f, edge, surface);\
                                       remove_triangles (e, surface);\
-                                      if (!constraint && !e->triangles)\
+                                      if (!constraint && !e->triangles.n)\
 				        gts_object_destroy (GTS_OBJECT (e));\
                                       g_assert (next);\
 				      *list = g_slist_prepend (*list, edge1);\
@@ -848,15 +718,12 @@ void gts_delaunay_remove_vertex (GtsSurface * surface, GtsVertex * v)
 
 static void remove_triangles (GtsEdge * e, GtsSurface * s)
 {
-  GSList * i = e->triangles;
+  GtsTriangle * t;
+  guint i;
 
-  while (i) {
-    GSList * next = i->next;
-
-    if (GTS_IS_FACE (i->data) && gts_face_has_parent_surface (i->data, s))
-      gts_surface_remove_face (s, i->data);
-    i = next;
-  }
+  GTS_ADJACENCY_FOREACH_REVERSE (&e->triangles, i, t)
+    if (GTS_IS_FACE (t) && gts_face_has_parent_surface (GTS_FACE (t), s))
+      gts_surface_remove_face (s, GTS_FACE (t));
 }
 
 static GSList * 
@@ -886,7 +753,7 @@ remove_intersected_edge (GtsSegment * s,
   if (o1 == 0.) {
     g_assert (o2 == 0.);
     remove_triangles (e, surface);
-    if (!constraint && !e->triangles)
+    if (!constraint && !e->triangles.n)
       gts_object_destroy (GTS_OBJECT (e));
     *left = g_slist_prepend (*left, e2);
     *right = g_slist_prepend (*right, e1);
@@ -1147,7 +1014,7 @@ void gts_delaunay_remove_hull (GtsSurface * surface)
 	  boundary = g_slist_prepend (boundary, t->e3);
 	gts_surface_remove_face (surface, GTS_FACE (t));
       }
-      if (!e->triangles)
+      if (!e->triangles.n)
 	gts_object_destroy (GTS_OBJECT (e));
     }
   }
@@ -1172,8 +1039,9 @@ static void gts_list_face_class_init (GtsFaceClass * klass)
 GtsFaceClass * gts_list_face_class (void)
 {
   static GtsFaceClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo gts_list_face_info = {
       "GtsListFace",
       sizeof (GtsListFace),
@@ -1185,6 +1053,7 @@ GtsFaceClass * gts_list_face_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_face_class ()),
 				  &gts_list_face_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
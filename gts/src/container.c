@@ -33,8 +33,9 @@ static void containee_class_init (GtsContaineeClass * klass)
 GtsContaineeClass * gts_containee_class (void)
 {
   static GtsContaineeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo containee_info = {
       "GtsContainee",
       sizeof (GtsContainee),
@@ -46,6 +47,7 @@ GtsContaineeClass * gts_containee_class (void)
     };
     klass = gts_object_class_new (gts_object_class (),
 				  &containee_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -163,8 +165,9 @@ static void slist_containee_init (GtsSListContainee * object)
 GtsSListContaineeClass * gts_slist_containee_class (void)
 {
   static GtsSListContaineeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo slist_containee_info = {
       "GtsSListContainee",
       sizeof (GtsSListContainee),
@@ -176,6 +179,7 @@ GtsSListContaineeClass * gts_slist_containee_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_containee_class ()),
 				  &slist_containee_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -240,8 +244,9 @@ static void container_class_init (GtsContainerClass * klass)
 GtsContainerClass * gts_container_class (void)
 {
   static GtsContainerClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo container_info = {
       "GtsContainer",
       sizeof (GtsContainer),
@@ -254,6 +259,7 @@ GtsContainerClass * gts_container_class (void)
     klass = 
       gts_object_class_new (GTS_OBJECT_CLASS (gts_slist_containee_class ()), 
 			    &container_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -384,8 +390,9 @@ static void hash_container_init (GtsHashContainer * object)
 GtsHashContainerClass * gts_hash_container_class (void)
 {
   static GtsHashContainerClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo hash_container_info = {
       "GtsHashContainer",
       sizeof (GtsHashContainer),
@@ -397,6 +404,7 @@ GtsHashContainerClass * gts_hash_container_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_container_class ()),
 				  &hash_container_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -474,8 +482,9 @@ static void slist_container_init (GtsSListContainer * object)
 GtsSListContainerClass * gts_slist_container_class (void)
 {
   static GtsSListContainerClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo slist_container_info = {
       "GtsSListContainer",
       sizeof (GtsSListContainer),
@@ -487,6 +496,7 @@ GtsSListContainerClass * gts_slist_container_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_container_class ()),
 				  &slist_container_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
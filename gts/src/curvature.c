@@ -338,7 +338,8 @@ void gts_vertex_principal_directions (GtsVertex * v, GtsSurface * s,
 {
   GtsVector N;
   gdouble normKh;
-  GSList * i, * j;
+  GSList * i;
+  guint k, l;
   GtsVector basis1, basis2, d, eig;
   gdouble ve2, vdotN;
   gdouble aterm_da, bterm_da, cterm_da, const_da;
@@ -397,25 +398,22 @@ void gts_vertex_principal_directions (GtsVertex * v, GtsSurface * s,
   aterm_da = bterm_da = cterm_da = const_da = 0.0;
   aterm_db = bterm_db = cterm_db = const_db = 0.0;
 
-  weights = g_malloc (sizeof (gdouble)*g_slist_length (v->segments));
-  kappas = g_malloc (sizeof (gdouble)*g_slist_length (v->segments));
-  d1s = g_malloc (sizeof (gdouble)*g_slist_length (v->segments));
-  d2s = g_malloc (sizeof (gdouble)*g_slist_length (v->segments));
+  weights = g_malloc (sizeof (gdouble)*v->segments.n);
+  kappas = g_malloc (sizeof (gdouble)*v->segments.n);
+  d1s = g_malloc (sizeof (gdouble)*v->segments.n);
+  d2s = g_malloc (sizeof (gdouble)*v->segments.n);
   edge_count = 0;
 
-  i = v->segments;
-  while (i) {
+  for (k = 0; k < v->segments.n; k++) {
     GtsEdge * e;
     GtsFace * f1, * f2;
     gdouble weight, kappa, d1, d2;
     GtsVector vec_edge;
 
-    if (! GTS_IS_EDGE (i->data)) {
-      i = i->next;
+    if (! GTS_IS_EDGE (v->segments.items[k]))
       continue;
-    }
 
-    e = i->data;
+    e = v->segments.items[k];
 
     /* since this vertex passed the tests in
      * gts_vertex_mean_curvature_normal(), this should be true. */
@@ -423,20 +421,18 @@ void gts_vertex_principal_directions (GtsVertex * v, GtsSurface * s,
 
     /* identify the two triangles bordering e in s */
     f1 = f2 = NULL;
-    j = e->triangles;
-    while (j) {
-      if ((! GTS_IS_FACE (j->data)) || 
-          (! gts_face_has_parent_surface (GTS_FACE (j->data), s))) {
-        j = j->next;
+    for (l = 0; l < e->triangles.n; l++) {
+      GtsTriangle * t = e->triangles.items[l];
+
+      if ((! GTS_IS_FACE (t)) || 
+          (! gts_face_has_parent_surface (GTS_FACE (t), s)))
         continue;
-      }
       if (f1 == NULL)
-        f1 = GTS_FACE (j->data);
+        f1 = GTS_FACE (t);
       else {
-        f2 = GTS_FACE (j->data);
+        f2 = GTS_FACE (t);
         break;
       }
-      j = j->next;
     }
     g_assert (f2 != NULL);
 
@@ -532,8 +528,6 @@ void gts_vertex_principal_directions (GtsVertex * v, GtsSurface * s,
     bterm_db += weight * d1 * d2 * 2 * d1 * d2;
     cterm_db += weight * d1 * d2 * d2 * d2;
     const_db += weight * d1 * d2 * (- kappa);
-
-    i = i->next;
   }
 
   /* now use the identity (Section 5.3) a + c = |Kh| = 2 * kappa_h */
@@ -19,20 +19,18 @@
 
 #include "gts.h"
 
-gboolean gts_allow_floating_edges = FALSE;
+GTS_THREAD_LOCAL gboolean gts_allow_floating_edges = FALSE;
 
 static void edge_destroy (GtsObject * object)
 {
   GtsEdge * edge = GTS_EDGE (object);
-  GSList * i;
+  GtsAdjacency * triangles = &edge->triangles;
 
-  i = edge->triangles;
-  while (i) {
-    GSList * next = i->next;
-    gts_object_destroy (i->data);
-    i = next;
-  }
-  g_assert (edge->triangles == NULL);
+  /* each triangle removes itself from the array */
+  while (triangles->n > 0)
+    gts_object_destroy (triangles->items[triangles->n - 1]);
+  gts_adjacency_free (triangles, edge->triangle_slots,
+		      GTS_EDGE_TRIANGLE_SLOTS);
 
   (* GTS_OBJECT_CLASS (gts_edge_class ())->parent_class->destroy) (object);
 }
@@ -42,7 +40,9 @@ static void edge_clone (GtsObject * clone, GtsObject * object)
   (* GTS_OBJECT_CLASS (gts_edge_class ())->parent_class->clone) (clone,
 								 object);
   GTS_SEGMENT (clone)->v1 = GTS_SEGMENT (clone)->v2 = NULL;
-  GTS_EDGE (clone)->triangles = NULL;
+  gts_adjacency_init (&GTS_EDGE (clone)->triangles, 
+		      GTS_EDGE (clone)->triangle_slots,
+		      GTS_EDGE_TRIANGLE_SLOTS);
 }
 
 static void edge_class_init (GtsObjectClass * klass)
@@ -53,7 +53,8 @@ static void edge_class_init (GtsObjectClass * klass)
 
 static void edge_init (GtsEdge * edge)
 {
-  edge->triangles = NULL;
+  gts_adjacency_init (&edge->triangles, edge->triangle_slots,
+		      GTS_EDGE_TRIANGLE_SLOTS);
 }
 
 /**
@@ -64,8 +65,9 @@ static void edge_init (GtsEdge * edge)
 GtsEdgeClass * gts_edge_class (void)
 {
   static GtsEdgeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo edge_info = {
       "GtsEdge",
       sizeof (GtsEdge),
@@ -77,6 +79,7 @@ GtsEdgeClass * gts_edge_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_segment_class ()), 
 				  &edge_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -102,28 +105,25 @@ GtsEdge * gts_edge_new (GtsEdgeClass * klass,
  * @with: a #GtsEdge.
  *
  * Replaces @e with @with. For each triangle which uses @e as an
- * edge, @e is replaced with @with. The @with->triangles list is
- * updated appropriately and the @e->triangles list is freed and set
- * to %NULL.
+ * edge, @e is replaced with @with. The @with->triangles array is
+ * updated appropriately and the @e->triangles array is emptied.
  */
 void gts_edge_replace (GtsEdge * e, GtsEdge * with)
 {
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
 
   g_return_if_fail (e != NULL && with != NULL && e != with);
 
-  i = e->triangles;
-  while (i) {
-    GtsTriangle * t = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t) {
     if (t->e1 == e) t->e1 = with;
     if (t->e2 == e) t->e2 = with;
     if (t->e3 == e) t->e3 = with;
-    if (!g_slist_find (with->triangles, t))
-      with->triangles = g_slist_prepend (with->triangles, t);
-    i = i->next;
+    if (!gts_adjacency_contains (&with->triangles, t))
+      gts_edge_add_triangle (with, t);
   }
-  g_slist_free (e->triangles);
-  e->triangles = NULL;
+  gts_adjacency_free (&e->triangles, e->triangle_slots, 
+		      GTS_EDGE_TRIANGLE_SLOTS);
 }
 
 /**
@@ -135,17 +135,15 @@ void gts_edge_replace (GtsEdge * e, GtsEdge * with)
  */
 GtsFace * gts_edge_has_parent_surface (GtsEdge * e, GtsSurface * surface)
 {
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
 
   g_return_val_if_fail (e != NULL, NULL);
 
-  i = e->triangles;
-  while (i) {
-    if (GTS_IS_FACE (i->data) && 
-	gts_face_has_parent_surface (i->data, surface))
-      return i->data;
-    i = i->next;
-  }
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t) && 
+	gts_face_has_parent_surface (GTS_FACE (t), surface))
+      return GTS_FACE (t);
   return NULL;
 }
 
@@ -159,17 +157,14 @@ GtsFace * gts_edge_has_parent_surface (GtsEdge * e, GtsSurface * surface)
  */
 GtsFace * gts_edge_has_any_parent_surface (GtsEdge * e)
 {
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
 
   g_return_val_if_fail (e != NULL, NULL);
 
-  i = e->triangles;
-  while (i) {
-    GtsTriangle * t = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
     if (GTS_IS_FACE (t) && GTS_FACE (t)->surfaces != NULL)
       return GTS_FACE (t);
-    i = i->next;
-  }
   return NULL;
 }
 
@@ -185,22 +180,20 @@ GtsFace * gts_edge_has_any_parent_surface (GtsEdge * e)
  */
 GtsFace * gts_edge_is_boundary (GtsEdge * e, GtsSurface * surface)
 {
-  GSList * i;
+  GtsTriangle * t;
   GtsFace * f = NULL;
+  guint i;
   
   g_return_val_if_fail (e != NULL, NULL);
   
-  i = e->triangles;
-  while (i) {
-    if (GTS_IS_FACE (i->data)) {
-      if (!surface || gts_face_has_parent_surface (i->data, surface)) {
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t)) {
+      if (!surface || gts_face_has_parent_surface (GTS_FACE (t), surface)) {
 	if (f != NULL)
 	  return NULL;
-	f = i->data;
+	f = GTS_FACE (t);
       }
     }
-    i = i->next;    
-  }
   return f;
 }
 
@@ -222,17 +215,16 @@ GSList * gts_edges_from_vertices (GSList * vertices, GtsSurface * parent)
   hash = g_hash_table_new (NULL, NULL);
   i = vertices;
   while (i) {
-    GSList * j = GTS_VERTEX (i->data)->segments;
-    while (j) {
-      GtsSegment * s = j->data;
+    GtsSegment * s;
+    guint j;
+
+    GTS_ADJACENCY_FOREACH (&GTS_VERTEX (i->data)->segments, j, s)
       if (GTS_IS_EDGE (s) &&
 	  gts_edge_has_parent_surface (GTS_EDGE (s), parent) && 
 	  g_hash_table_lookup (hash, s) == NULL) {
 	edges = g_slist_prepend (edges, s);
 	g_hash_table_insert (hash, s, i);
       }
-      j = j->next;
-    }
     i = i->next;
   }
   g_hash_table_destroy (hash);
@@ -248,19 +240,16 @@ GSList * gts_edges_from_vertices (GSList * vertices, GtsSurface * parent)
  */
 guint gts_edge_face_number (GtsEdge * e, GtsSurface * s)
 {
-  GSList * i;
-  guint nt = 0;
+  GtsTriangle * t;
+  guint i, nt = 0;
 
   g_return_val_if_fail (e != NULL, 0);
   g_return_val_if_fail (s != NULL, 0);
 
-  i = e->triangles;
-  while (i) {
-    if (GTS_IS_FACE (i->data) && 
-	gts_face_has_parent_surface (GTS_FACE (i->data), s))
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t) && 
+	gts_face_has_parent_surface (GTS_FACE (t), s))
       nt++;
-    i = i->next;
-  }
   return nt;
 }
 
@@ -273,30 +262,28 @@ guint gts_edge_face_number (GtsEdge * e, GtsSurface * s)
  */
 GtsEdge * gts_edge_is_duplicate (GtsEdge * e)
 {
-  GSList * i;
+  GtsAdjacency * segments;
+  GtsSegment * s;
   GtsVertex * v2;
+  guint i;
 
   g_return_val_if_fail (e != NULL, NULL);
 
   v2 = GTS_SEGMENT (e)->v2;
-  i = GTS_SEGMENT (e)->v1->segments;
+  segments = &GTS_SEGMENT (e)->v1->segments;
   if (GTS_SEGMENT (e)->v1 == v2) /* e is degenerate: special treatment */
-    while (i) {
-      GtsSegment * s = i->data;
+    GTS_ADJACENCY_FOREACH (segments, i, s) {
       if (s != GTS_SEGMENT (e) &&
 	  GTS_IS_EDGE (s) && 
 	  s->v1 == v2 && s->v2 == v2)
 	return GTS_EDGE (s);
-      i = i->next;
     }
   else /* e is not degenerate */
-    while (i) {
-      GtsSegment * s = i->data;
+    GTS_ADJACENCY_FOREACH (segments, i, s) {
       if (s != GTS_SEGMENT (e) &&
 	  GTS_IS_EDGE (s) && 
 	  (s->v1 == v2 || s->v2 == v2))
 	return GTS_EDGE (s);
-      i = i->next;
     }
   return NULL;
 }
@@ -369,33 +356,32 @@ static void triangle_vertices_edges (GtsTriangle * t,
  */
 gboolean gts_edge_belongs_to_tetrahedron (GtsEdge * e)
 {
-  GSList * i;
+  GtsAdjacency * triangles;
   GtsVertex * v1, * v2;
+  guint i, j;
 
   g_return_val_if_fail (e != NULL, FALSE);
 
   v1 = GTS_SEGMENT (e)->v1;
   v2 = GTS_SEGMENT (e)->v2;
-  i = e->triangles;
-  while (i) {
+  triangles = &e->triangles;
+  for (i = 0; i < triangles->n; i++) {
     GtsEdge * e1, * e2;
     GtsVertex * vt1;
-    GSList * j = i->next;
-    triangle_vertices_edges (i->data, e, &vt1, &e1, &e2);
-    while (j) {      
+
+    triangle_vertices_edges (triangles->items[i], e, &vt1, &e1, &e2);
+    for (j = i + 1; j < triangles->n; j++) {
       GtsSegment * s5;
       GtsEdge * e3, * e4;
       GtsVertex * vt2;
 
-      triangle_vertices_edges (j->data, e, &vt2, &e3, &e4);
+      triangle_vertices_edges (triangles->items[j], e, &vt2, &e3, &e4);
       s5 = gts_vertices_are_connected (vt1, vt2);
       if (GTS_IS_EDGE (s5) &&
 	  gts_triangle_use_edges (e1, e3, GTS_EDGE (s5)) &&
 	  gts_triangle_use_edges (e2, e4, GTS_EDGE (s5)))
 	return TRUE;
-      j = j->next;
     }
-    i = i->next;
   }
 
   return FALSE;
@@ -426,17 +412,14 @@ static GtsEdge * next_edge (GtsTriangle * t,
 
 static void triangle_next (GtsEdge * e1, GtsEdge * e)
 {
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
 
-  i = e1->triangles;
-  while (i) {
-    GtsTriangle * t = i->data;
+  GTS_ADJACENCY_FOREACH (&e1->triangles, i, t)
     if (GTS_OBJECT (t)->reserved) {
       GTS_OBJECT (t)->reserved = NULL;
       triangle_next (next_edge (t, e1, e), e);
     }
-    i = i->next;
-  }
 }
 
 /** 
@@ -449,7 +432,8 @@ static void triangle_next (GtsEdge * e1, GtsEdge * e)
 guint gts_edge_is_contact (GtsEdge * e)
 {
   GSList * i, * triangles;
-  guint ncomponent = 0;
+  GtsTriangle * t;
+  guint j, ncomponent = 0;
 
   g_return_val_if_fail (e != NULL, 0);
 
@@ -460,9 +444,7 @@ guint gts_edge_is_contact (GtsEdge * e)
     i = i->next;
   }
 
-  i = e->triangles;
-  while (i) {
-    GtsTriangle * t = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, j, t)
     if (GTS_OBJECT (t)->reserved) {
       GtsEdge * e1;
       GTS_OBJECT (t)->reserved = NULL;
@@ -471,8 +453,6 @@ guint gts_edge_is_contact (GtsEdge * e)
       triangle_next (next_edge (t, e1, e), e);
       ncomponent++;
     }
-    i = i->next;
-  }
    
   g_slist_foreach (triangles, (GFunc) gts_object_reset_reserved, NULL);
   g_slist_free (triangles);
@@ -492,7 +472,7 @@ void gts_edge_swap (GtsEdge * e, GtsSurface * s)
 {
   GtsTriangle * t1 = NULL, * t2 = NULL, * t;
   GtsFace * f;
-  GSList * i;
+  guint i;
   GtsVertex * v1, * v2, * v3, * v4, * v5, * v6;
   GtsEdge * e1, * e2, * e3, * e4;
   GtsSegment * v3v6;
@@ -500,18 +480,15 @@ void gts_edge_swap (GtsEdge * e, GtsSurface * s)
   g_return_if_fail (e != NULL);
   g_return_if_fail (s != NULL);
 
-  i = e->triangles;
-  while (i) {
-    if (GTS_IS_FACE (i->data) && gts_face_has_parent_surface (i->data, s)) {
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t) && gts_face_has_parent_surface (GTS_FACE (t), s)) {
       if (!t1)
-	t1 = i->data;
+	t1 = t;
       else if (!t2)
-	t2 = i->data;
+	t2 = t;
       else
 	g_return_if_fail (gts_edge_face_number (e, s) == 2);
     }
-    i = i->next;
-  }
   g_assert (t1 && t2);
 
   gts_triangle_vertices_edges (t1, e, &v1, &v2, &v3, &e, &e1, &e2);
@@ -556,7 +533,8 @@ void gts_edge_swap (GtsEdge * e, GtsSurface * s)
 gboolean gts_edge_manifold_faces (GtsEdge * e, GtsSurface * s,
 				  GtsFace ** f1, GtsFace ** f2)
 {
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
 
   g_return_val_if_fail (e != NULL, FALSE);
   g_return_val_if_fail (s != NULL, FALSE);
@@ -564,15 +542,12 @@ gboolean gts_edge_manifold_faces (GtsEdge * e, GtsSurface * s,
   g_return_val_if_fail (f2 != NULL, FALSE);
 
   *f1 = *f2 = NULL;
-  i = e->triangles;
-  while (i) {
-    if (GTS_IS_FACE (i->data) && gts_face_has_parent_surface (i->data, s)) {
-      if (!(*f1)) *f1 = i->data;
-      else if (!(*f2)) *f2 = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_IS_FACE (t) && gts_face_has_parent_surface (GTS_FACE (t), s)) {
+      if (!(*f1)) *f1 = GTS_FACE (t);
+      else if (!(*f2)) *f2 = GTS_FACE (t);
       else return FALSE;
     }
-    i = i->next;
-  }
 
   return (*f1 && *f2);
 }
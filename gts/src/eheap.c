@@ -17,20 +17,96 @@
  * Boston, MA 02111-1307, USA.
  */
 
-#include <stdlib.h>
+#include <string.h>
 #include "gts.h"
 
-#define PARENT(i) ((i) >= 2 ? (i)/2 : 0)
-#define LEFT_CHILD(i) (2*(i))
-#define RIGHT_CHILD(i) (2*(i) + 1)
+/* The heap is 4-ary: the children of the entry i are the entries 4i + 1
+   to 4i + 4, which share a cache line. Each entry holds the key of its
+   item, so that sifting does not follow any pointer, and the pair of the
+   item, which does not move while the item is in the heap. */
+#define ARITY 4
+#define PARENT(i) (((i) - 1)/ARITY)
+#define FIRST_CHILD(i) (ARITY*(i) + 1)
+#define CACHE_LINE 64
+#define PAIR_BLOCK 1024
+
+typedef struct {
+  gdouble key;
+  GtsEHeapPair * pair;
+} EHeapEntry;
 
 struct _GtsEHeap {
-  GPtrArray * elts;
+  EHeapEntry * entries;
+  gpointer buffer;
+  guint len, size;
+  GSList * blocks;
+  GtsEHeapPair * free_pairs;
+  guint32 seed;
   GtsKeyFunc func;
   gpointer data;
   gboolean frozen, randomized;
 };
 
+static void reserve (GtsEHeap * heap, guint n)
+{
+  gpointer buffer;
+  EHeapEntry * entries;
+
+  if (n <= heap->size)
+    return;
+  n = MAX (n, MAX (2*heap->size, 64));
+  /* three entries before the first one align the children of each
+     entry on a cache line */
+  buffer = g_malloc ((n + 3)*sizeof (EHeapEntry) + CACHE_LINE);
+  entries = (EHeapEntry *) 
+    ((gchar *) buffer + (CACHE_LINE - (gsize) buffer % CACHE_LINE)) + 3;
+  if (heap->len)
+    memcpy (entries, heap->entries, heap->len*sizeof (EHeapEntry));
+  g_free (heap->buffer);
+  heap->buffer = buffer;
+  heap->entries = entries;
+  heap->size = n;
+}
+
+static GtsEHeapPair * pair_new (GtsEHeap * heap, gpointer p, gdouble key)
+{
+  GtsEHeapPair * pair;
+
+  if (heap->free_pairs == NULL) {
+    GtsEHeapPair * block = g_malloc (PAIR_BLOCK*sizeof (GtsEHeapPair));
+    guint i;
+
+    for (i = 0; i < PAIR_BLOCK - 1; i++)
+      block[i].data = &block[i + 1];
+    block[PAIR_BLOCK - 1].data = NULL;
+    heap->free_pairs = block;
+    heap->blocks = g_slist_prepend (heap->blocks, block);
+  }
+  pair = heap->free_pairs;
+  heap->free_pairs = pair->data;
+  pair->data = p;
+  pair->key = key;
+  return pair;
+}
+
+static void pair_free (GtsEHeap * heap, GtsEHeapPair * pair)
+{
+  pair->data = heap->free_pairs;
+  heap->free_pairs = pair;
+}
+
+/* xorshift32 */
+static gboolean random_bit (GtsEHeap * heap)
+{
+  guint32 x = heap->seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  heap->seed = x;
+  return x >> 31;
+}
+
 /**
  * gts_eheap_new:
  * @key_func: a #GtsKeyFunc or %NULL.
@@ -43,10 +119,10 @@ GtsEHeap * gts_eheap_new (GtsKeyFunc key_func,
 {
   GtsEHeap * heap;
 
-  heap = g_malloc (sizeof(GtsEHeap));
-  heap->elts = g_ptr_array_new ();
+  heap = g_malloc0 (sizeof(GtsEHeap));
   heap->func = key_func;
   heap->data = data;
+  heap->seed = 2463534242U;
   heap->frozen = FALSE;
   heap->randomized = FALSE;
   return heap;
@@ -54,26 +130,61 @@ GtsEHeap * gts_eheap_new (GtsKeyFunc key_func,
 
 static void sift_up (GtsEHeap * heap, guint i)
 {
-  GtsEHeapPair * parent, * child;
-  guint p;
-  gpointer * pdata = heap->elts->pdata;
-  gdouble key;
+  EHeapEntry * entries = heap->entries;
+  EHeapEntry moving = entries[i];
+
+  while (i > 0) {
+    guint p = PARENT (i);
 
-  child = pdata[i - 1];
-  key = child->key;
-  while ((p = PARENT (i))) {
-    parent = pdata[p - 1];
-    if (parent->key > key ||
-	(heap->randomized && parent->key == key && rand () < RAND_MAX/2)) {
-      pdata[p - 1] = child;
-      pdata[i - 1] = parent;
-      child->pos = p;
-      parent->pos = i;
+    if (entries[p].key > moving.key ||
+	(heap->randomized && entries[p].key == moving.key &&
+	 random_bit (heap))) {
+      entries[i] = entries[p];
+      entries[i].pair->pos = i;
       i = p;
     }
     else
-      i = 0;
+      break;
   }
+  entries[i] = moving;
+  moving.pair->pos = i;
+}
+
+static void sift_down (GtsEHeap * heap, guint i)
+{
+  EHeapEntry * entries = heap->entries;
+  EHeapEntry moving = entries[i];
+  guint len = heap->len, c;
+
+  while ((c = FIRST_CHILD (i)) < len) {
+    guint j, last = MIN (c + ARITY, len);
+
+    for (j = c + 1; j < last; j++)
+      if (entries[j].key < entries[c].key)
+	c = j;
+    if (!(moving.key > entries[c].key))
+      break;
+    entries[i] = entries[c];
+    entries[i].pair->pos = i;
+    i = c;
+  }
+  entries[i] = moving;
+  moving.pair->pos = i;
+}
+
+static GtsEHeapPair * insert (GtsEHeap * heap, gpointer p, gdouble key)
+{
+  GtsEHeapPair * pair = pair_new (heap, p, key);
+  guint i;
+
+  reserve (heap, heap->len + 1);
+  i = heap->len++;
+  heap->entries[i].key = key;
+  heap->entries[i].pair = pair;
+  pair->pos = i;
+  if (!heap->frozen)
+    sift_up (heap, i);
+  return pair;
 }
 
 /**
@@ -85,25 +196,14 @@ static void sift_up (GtsEHeap * heap, guint i)
  *
  * Returns: a #GtsEHeapPair describing the position of the element in the heap.
  * This pointer is necessary for gts_eheap_remove() and 
- * gts_eheap_decrease_key().
+ * gts_eheap_decrease_key(). It stays valid until the element is removed.
  */
 GtsEHeapPair * gts_eheap_insert (GtsEHeap * heap, gpointer p)
 {
-  GtsEHeapPair * pair;
-  GPtrArray * elts;
-
   g_return_val_if_fail (heap != NULL, NULL);
   g_return_val_if_fail (heap->func != NULL, NULL);
 
-  elts = heap->elts;
-  pair = g_malloc (sizeof (GtsEHeapPair));
-  g_ptr_array_add (elts, pair);
-  pair->data = p;
-  pair->pos = elts->len;
-  pair->key = (*heap->func) (p, heap->data);
-  if (!heap->frozen)
-    sift_up (heap, elts->len);
-  return pair;
+  return insert (heap, p, (*heap->func) (p, heap->data));
 }
 
 /**
@@ -116,66 +216,63 @@ GtsEHeapPair * gts_eheap_insert (GtsEHeap * heap, gpointer p)
  *
  * Returns: a #GtsEHeapPair describing the position of the element in the heap.
  * This pointer is necessary for gts_eheap_remove() and 
- * gts_eheap_decrease_key().
+ * gts_eheap_decrease_key(). It stays valid until the element is removed.
  */
 GtsEHeapPair * gts_eheap_insert_with_key (GtsEHeap * heap, 
 					  gpointer p, 
 					  gdouble key)
 {
-  GtsEHeapPair * pair;
-  GPtrArray * elts;
-
   g_return_val_if_fail (heap != NULL, NULL);
 
-  elts = heap->elts;
-  pair = g_malloc (sizeof (GtsEHeapPair));
-  g_ptr_array_add (elts, pair);
-  pair->data = p;
-  pair->pos = elts->len;
-  pair->key = key;
-  if (!heap->frozen)
-    sift_up (heap, elts->len);
-  return pair;
+  return insert (heap, p, key);
 }
 
-static void sift_down (GtsEHeap * heap, guint i)
+/**
+ * gts_eheap_insert_array:
+ * @heap: a #GtsEHeap.
+ * @items: an array of @n pointers to add to the heap.
+ * @keys: the values of the keys associated to @items or %NULL.
+ * @n: the number of items.
+ * @pairs: an array of @n #GtsEHeapPair pointers to be filled or %NULL.
+ *
+ * Inserts all the elements of @items in the heap at once. Unless the
+ * heap is frozen, it is then reordered in O(n) time, n being its new
+ * size, rather than in O(@n log n) time as for @n successive
+ * insertions. When @n is small compared to n, the elements are
+ * inserted one by one instead. If @keys is %NULL, the keys are
+ * computed with the key function of @heap.
+ *
+ * If @pairs is not %NULL, @pairs[i] is set to the #GtsEHeapPair of
+ * @items[i].
+ */
+void gts_eheap_insert_array (GtsEHeap * heap,
+			     gpointer * items,
+			     gdouble * keys,
+			     guint n,
+			     GtsEHeapPair ** pairs)
 {
-  GtsEHeapPair * left_child, * right_child, * child, * parent;
-  guint lc, rc, c;
-  gpointer * pdata = heap->elts->pdata;
-  guint len = heap->elts->len;
-  gdouble key;
+  gboolean frozen;
+  guint i;
 
-  lc = LEFT_CHILD (i);
-  rc = RIGHT_CHILD (i);
-  left_child = lc <= len ? pdata[lc - 1] : NULL;
-  right_child = rc <= len ? pdata[rc - 1] : NULL;
-
-  parent = pdata[i - 1];
-  key = parent->key;
-  while (left_child != NULL) {
-    if (right_child == NULL || left_child->key  < right_child->key) {
-      child = left_child;
-      c = lc;
-    }
-    else {
-      child = right_child;
-      c = rc;
-    }
-    if (key > child->key) {
-      pdata[i - 1] = child;
-      child->pos = i;
-      pdata[c - 1] = parent;
-      parent->pos = c;
-      i = c;
-      lc = LEFT_CHILD (i);
-      rc = RIGHT_CHILD (i);
-      left_child = lc <= len ? pdata[lc - 1] : NULL;
-      right_child = rc <= len ? pdata[rc - 1] : NULL;      
-    }
-    else
-      left_child = NULL;
+  g_return_if_fail (heap != NULL);
+  g_return_if_fail (n == 0 || items != NULL);
+  g_return_if_fail (keys != NULL || heap->func != NULL);
+
+  reserve (heap, heap->len + n);
+  frozen = heap->frozen;
+  /* sifting up the new entries of a large heap is cheaper than
+     rebuilding all of it */
+  if (n*16 >= heap->len)
+    heap->frozen = TRUE;
+  for (i = 0; i < n; i++) {
+    GtsEHeapPair * pair = insert (heap, items[i], keys ? keys[i] :
+				  (*heap->func) (items[i], heap->data));
+
+    if (pairs)
+      pairs[i] = pair;
   }
+  if (!frozen)
+    gts_eheap_thaw (heap);
 }
 
 /**
@@ -190,36 +287,23 @@ static void sift_down (GtsEHeap * heap, guint i)
  */
 gpointer gts_eheap_remove_top (GtsEHeap * heap, gdouble * key)
 {
-  gpointer root;
-  GPtrArray * elts;
-  guint len;
   GtsEHeapPair * pair;
+  gpointer root;
 
   g_return_val_if_fail (heap != NULL, NULL);
 
-  elts = heap->elts; 
-  len = elts->len;
-
-  if (len == 0)
+  if (heap->len == 0)
     return NULL;
-  if (len == 1) {
-    pair = g_ptr_array_remove_index (elts, 0);
-    root = pair->data;
-    if (key) 
-      *key = pair->key;
-    g_free (pair);
-    return root;
-  }
 
-  pair = elts->pdata[0];
+  pair = heap->entries[0].pair;
   root = pair->data;
   if (key) 
     *key = pair->key;
-  g_free (pair);
-  pair = g_ptr_array_remove_index (elts, len - 1);
-  elts->pdata[0] = pair;
-  pair->pos = 1;
-  sift_down (heap, 1);
+  pair_free (heap, pair);
+  if (--heap->len > 0) {
+    heap->entries[0] = heap->entries[heap->len];
+    sift_down (heap, 0);
+  }
   return root;
 }
 
@@ -234,16 +318,13 @@ gpointer gts_eheap_remove_top (GtsEHeap * heap, gdouble * key)
 gpointer gts_eheap_top (GtsEHeap * heap, gdouble * key)
 {
   GtsEHeapPair * pair;
-  GPtrArray * elts;
 
   g_return_val_if_fail (heap != NULL, NULL);
 
-  elts = heap->elts;
-
-  if (elts->len == 0)
+  if (heap->len == 0)
     return NULL;
 
-  pair = elts->pdata[0];
+  pair = heap->entries[0].pair;
   if (key)
     *key = pair->key;
   return pair->data;
@@ -257,13 +338,14 @@ gpointer gts_eheap_top (GtsEHeap * heap, gdouble * key)
  */
 void gts_eheap_destroy (GtsEHeap * heap)
 {
-  guint i;
+  GSList * i;
 
   g_return_if_fail (heap != NULL);
 
-  for (i = 0; i < heap->elts->len; i++)
-    g_free (heap->elts->pdata[i]);
-  g_ptr_array_free (heap->elts, TRUE);
+  for (i = heap->blocks; i; i = i->next)
+    g_free (i->data);
+  g_slist_free (heap->blocks);
+  g_free (heap->buffer);
   g_free (heap);
 }
 
@@ -283,7 +365,7 @@ void gts_eheap_thaw (GtsEHeap * heap)
   if (!heap->frozen)
     return;
 
-  for (i = heap->elts->len/2; i > 0; i--)
+  for (i = heap->len > 1 ? PARENT (heap->len - 1) + 1 : 0; i-- > 0;)
     sift_down (heap, i);
 
   heap->frozen = FALSE;
@@ -300,14 +382,12 @@ void gts_eheap_foreach (GtsEHeap * heap,
 			gpointer data)
 {
   guint i;
-  GPtrArray * elts;
   
   g_return_if_fail (heap != NULL);
   g_return_if_fail (func != NULL);
 
-  elts = heap->elts;
-  for (i = 0; i < elts->len; i++)
-    (*func) (((GtsEHeapPair *) elts->pdata[i])->data, data);
+  for (i = 0; i < heap->len; i++)
+    (*func) (heap->entries[i].pair->data, data);
 }
 
 /**
@@ -321,32 +401,30 @@ void gts_eheap_foreach (GtsEHeap * heap,
  */
 gpointer gts_eheap_remove (GtsEHeap * heap, GtsEHeapPair * p)
 {
-  GtsEHeapPair ** pdata;
-  GtsEHeapPair * parent;
-  guint i, par;
+  EHeapEntry * entries;
+  guint i;
   gpointer data;
 
   g_return_val_if_fail (heap != NULL, NULL);
   g_return_val_if_fail (p != NULL, NULL);
 
-  pdata = (GtsEHeapPair **)heap->elts->pdata;
+  entries = heap->entries;
   i = p->pos;
   data = p->data;
 
-  g_return_val_if_fail (i > 0 && i <= heap->elts->len, NULL);
-  g_return_val_if_fail (p == pdata[i - 1], NULL);
-
-  /* move element to the top */
-  while ((par = PARENT (i))) {
-    parent = pdata[par - 1];
-    pdata[par - 1] = p;
-    pdata[i - 1] = parent;
-    p->pos = par;
-    parent->pos = i;
-    i = par;
-  }
+  g_return_val_if_fail (i < heap->len, NULL);
+  g_return_val_if_fail (p == entries[i].pair, NULL);
 
-  gts_eheap_remove_top (heap, NULL);
+  pair_free (heap, p);
+  if (i < --heap->len) {
+    entries[i] = entries[heap->len];
+    if (heap->frozen)
+      entries[i].pair->pos = i;
+    else if (i > 0 && entries[PARENT (i)].key > entries[i].key)
+      sift_up (heap, i);
+    else
+      sift_down (heap, i);
+  }
 
   return data;
 }
@@ -370,16 +448,50 @@ void gts_eheap_decrease_key (GtsEHeap * heap,
   g_return_if_fail (p != NULL);
 
   i = p->pos;
-  g_return_if_fail (i > 0 && i <= heap->elts->len);
-  g_return_if_fail (p == heap->elts->pdata[i - 1]);
+  g_return_if_fail (i < heap->len);
+  g_return_if_fail (p == heap->entries[i].pair);
 
   g_return_if_fail (new_key <= p->key);
 
-  p->key = new_key;
+  p->key = heap->entries[i].key = new_key;
   if (!heap->frozen)
     sift_up (heap, i);
 }
 
+/**
+ * gts_eheap_change_key:
+ * @heap: a #GtsEHeap.
+ * @p: a #GtsEHeapPair.
+ * @new_key: the new value of the key for this element.
+ *
+ * Changes the value of the key of the element at position @p, which
+ * stays valid. This is cheaper than removing the element and inserting
+ * it again.
+ */
+void gts_eheap_change_key (GtsEHeap * heap, 
+			   GtsEHeapPair * p,
+			   gdouble new_key)
+{
+  guint i;
+  gdouble old_key;
+
+  g_return_if_fail (heap != NULL);
+  g_return_if_fail (p != NULL);
+
+  i = p->pos;
+  g_return_if_fail (i < heap->len);
+  g_return_if_fail (p == heap->entries[i].pair);
+
+  old_key = p->key;
+  p->key = heap->entries[i].key = new_key;
+  if (heap->frozen)
+    return;
+  if (new_key < old_key)
+    sift_up (heap, i);
+  else if (new_key > old_key)
+    sift_down (heap, i);
+}
+
 /**
  * gts_eheap_freeze:
  * @heap: a #GtsEHeap.
@@ -405,7 +517,7 @@ guint gts_eheap_size (GtsEHeap * heap)
 {
   g_return_val_if_fail (heap != NULL, 0);
 
-  return heap->elts->len;
+  return heap->len;
 }
 
 /**
@@ -416,24 +528,17 @@ guint gts_eheap_size (GtsEHeap * heap)
  */
 void gts_eheap_update (GtsEHeap * heap)
 {
-  guint i, len;
-  GtsEHeapPair ** pairs;
-  gpointer data;
-  GtsKeyFunc func;
+  guint i;
 
   g_return_if_fail (heap != NULL);
   g_return_if_fail (heap->func != NULL);
 
   heap->frozen = TRUE;
 
-  len = heap->elts->len;
-  pairs = (GtsEHeapPair **) heap->elts->pdata;
-  data = heap->data;
-  func = heap->func;
+  for (i = 0; i < heap->len; i++) {
+    GtsEHeapPair * pair = heap->entries[i].pair;
 
-  for (i = 0; i < len; i++) {
-    GtsEHeapPair * pair = pairs[i];
-    pair->key = (*func) (pair->data, data);
+    pair->key = heap->entries[i].key = (*heap->func) (pair->data, heap->data);
   }
   
   gts_eheap_thaw (heap);
@@ -458,6 +563,9 @@ gdouble gts_eheap_key (GtsEHeap * heap, gpointer p)
  * gts_eheap_randomized:
  * @heap: a #GtsEHeap.
  * @randomized: whether @heap should be randomized.
+ *
+ * If @randomized is %TRUE, elements with the same key are ordered at
+ * random, using a pseudo-random generator private to @heap.
  */
 void gts_eheap_randomized (GtsEHeap * heap, gboolean randomized)
 {
@@ -465,3 +573,20 @@ void gts_eheap_randomized (GtsEHeap * heap, gboolean randomized)
 
   heap->randomized = randomized;
 }
+
+/**
+ * gts_eheap_seed:
+ * @heap: a #GtsEHeap.
+ * @seed: a non-zero seed.
+ *
+ * Seeds the pseudo-random generator of @heap used when it is
+ * randomized. All the heaps start with the same seed, so that a
+ * randomized heap gives the same results on every run.
+ */
+void gts_eheap_seed (GtsEHeap * heap, guint32 seed)
+{
+  g_return_if_fail (heap != NULL);
+  g_return_if_fail (seed != 0);
+
+  heap->seed = seed;
+}
@@ -19,7 +19,7 @@
 
 #include "gts.h"
 
-gboolean gts_allow_floating_faces = FALSE;
+GTS_THREAD_LOCAL gboolean gts_allow_floating_faces = FALSE;
 
 static void face_destroy (GtsObject * object)
 {
@@ -63,8 +63,9 @@ static void face_init (GtsFace * face)
 GtsFaceClass * gts_face_class (void)
 {
   static GtsFaceClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo face_info = {
       "GtsFace",
       sizeof (GtsFace),
@@ -76,6 +77,7 @@ GtsFaceClass * gts_face_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_triangle_class ()), 
 				  &face_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -141,17 +143,16 @@ GSList * gts_faces_from_edges (GSList * edges, GtsSurface * s)
   hash = g_hash_table_new (NULL, NULL);
   i = edges;
   while (i) {
-    GSList * j = GTS_EDGE (i->data)->triangles;
-    while (j) {
-      GtsTriangle * t = j->data;
+    GtsTriangle * t;
+    guint j;
+
+    GTS_ADJACENCY_FOREACH (&GTS_EDGE (i->data)->triangles, j, t)
       if (GTS_IS_FACE (t) &&
 	  (!s || gts_face_has_parent_surface (GTS_FACE (t), s)) && 
 	  g_hash_table_lookup (hash, t) == NULL) {
 	faces = g_slist_prepend (faces, t);
 	g_hash_table_insert (hash, t, i);
       }
-      j = j->next;
-    }
     i = i->next;
   }
   g_hash_table_destroy (hash);
@@ -168,8 +169,8 @@ GSList * gts_faces_from_edges (GSList * edges, GtsSurface * s)
  */
 guint gts_face_neighbor_number (GtsFace * f, GtsSurface * s)
 {
-  GSList * i;
-  guint nn = 0;
+  GtsTriangle * t;
+  guint i, nn = 0;
   GtsEdge * e[4], ** e1 = e;
   
   g_return_val_if_fail (f != NULL, 0);
@@ -179,15 +180,12 @@ guint gts_face_neighbor_number (GtsFace * f, GtsSurface * s)
   e[2] = GTS_TRIANGLE (f)->e3; 
   e[3] = NULL;
   while (*e1) {
-    i = (*e1++)->triangles;
-    while (i) {
-      GtsTriangle * t = i->data;
+    GTS_ADJACENCY_FOREACH (&(*e1)->triangles, i, t)
       if (GTS_FACE (t) != f && 
 	  GTS_IS_FACE (t) && 
 	  (!s || gts_face_has_parent_surface (GTS_FACE (t), s)))
 	nn++;
-      i = i->next;
-    }
+    e1++;
   }
 
   return nn;
@@ -202,7 +200,9 @@ guint gts_face_neighbor_number (GtsFace * f, GtsSurface * s)
  */
 GSList * gts_face_neighbors (GtsFace * f, GtsSurface * s)
 {
-  GSList * i, * list = NULL;
+  GSList * list = NULL;
+  GtsTriangle * t;
+  guint i;
   GtsEdge * e[4], ** e1 = e;
   
   g_return_val_if_fail (f != NULL, NULL);
@@ -212,15 +212,12 @@ GSList * gts_face_neighbors (GtsFace * f, GtsSurface * s)
   e[2] = GTS_TRIANGLE (f)->e3; 
   e[3] = NULL;
   while (*e1) {
-    i = (*e1++)->triangles;
-    while (i) {
-      GtsTriangle * t = i->data;
+    GTS_ADJACENCY_FOREACH (&(*e1)->triangles, i, t)
       if (GTS_FACE (t) != f && 
 	  GTS_IS_FACE (t) && 
 	  (!s || gts_face_has_parent_surface (GTS_FACE (t), s)))
 	list = g_slist_prepend (list, t);
-      i = i->next;
-    }
+    e1++;
   }
 
   return list;
@@ -240,7 +237,8 @@ void gts_face_foreach_neighbor (GtsFace * f,
 				GtsFunc func,
 				gpointer data)
 {
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
   GtsEdge * e[4], ** e1 = e;
   
   g_return_if_fail (f != NULL);
@@ -251,30 +249,26 @@ void gts_face_foreach_neighbor (GtsFace * f,
   e[2] = GTS_TRIANGLE (f)->e3; 
   e[3] = NULL;
   while (*e1) {
-    i = (*e1++)->triangles;
-    while (i) {
-      GtsTriangle * t = i->data;
+    GTS_ADJACENCY_FOREACH (&(*e1)->triangles, i, t)
       if (GTS_FACE (t) != f && 
 	  GTS_IS_FACE (t) && 
 	  (!s || gts_face_has_parent_surface (GTS_FACE (t), s)))
 	(* func) (t, data);
-      i = i->next;
-    }
+    e1++;
   }
 }
 
 static gboolean triangle_is_incompatible (GtsTriangle * t, GtsEdge * e, GtsSurface * s)
 {
-  GSList * i = e->triangles;
+  GtsTriangle * t1;
+  guint i;
 
-  while (i) {
-    if (i->data != t &&
-	GTS_IS_FACE (i->data) &&
-	gts_face_has_parent_surface (i->data, s) &&
-	!gts_triangles_are_compatible (t, i->data, e))
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t1)
+    if (t1 != t &&
+	GTS_IS_FACE (t1) &&
+	gts_face_has_parent_surface (GTS_FACE (t1), s) &&
+	!gts_triangles_are_compatible (t, t1, e))
       return TRUE;
-    i = i->next;
-  }
   return FALSE;
 }
 
@@ -23,7 +23,7 @@
 
 /* GtsGNode */
 
-gboolean gts_allow_floating_gnodes = FALSE;
+GTS_THREAD_LOCAL gboolean gts_allow_floating_gnodes = FALSE;
 
 static void gnode_remove_container (GtsContainee * i, GtsContainer * c)
 {
@@ -54,8 +54,9 @@ static void gnode_init (GtsGNode * n)
 GtsGNodeClass * gts_gnode_class (void)
 {
   static GtsGNodeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo gnode_info = {
       "GtsGNode",
       sizeof (GtsGNode),
@@ -68,6 +69,7 @@ GtsGNodeClass * gts_gnode_class (void)
     klass = 
       gts_object_class_new (GTS_OBJECT_CLASS (gts_slist_container_class ()),
 			    &gnode_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -246,8 +248,9 @@ static void ngnode_init (GtsNGNode * n)
 GtsNGNodeClass * gts_ngnode_class (void)
 {
   static GtsNGNodeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo ngnode_info = {
       "GtsNGNode",
       sizeof (GtsNGNode),
@@ -259,6 +262,7 @@ GtsNGNodeClass * gts_ngnode_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_gnode_class ()),
 				  &ngnode_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -306,8 +310,9 @@ static void wgnode_init (GtsWGNode * n)
 GtsWGNodeClass * gts_wgnode_class (void)
 {
   static GtsWGNodeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo wgnode_info = {
       "GtsWGNode",
       sizeof (GtsWGNode),
@@ -319,6 +324,7 @@ GtsWGNodeClass * gts_wgnode_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_gnode_class ()),
 				  &wgnode_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -372,8 +378,9 @@ static void pnode_init (GtsPNode * pn)
 GtsPNodeClass * gts_pnode_class (void)
 {
   static GtsPNodeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo pnode_info = {
       "GtsPNode",
       sizeof (GtsPNode),
@@ -385,6 +392,7 @@ GtsPNodeClass * gts_pnode_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_gnode_class ()),
 				  &pnode_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -432,8 +440,9 @@ static void fnode_init (GtsFNode * fn)
 GtsFNodeClass * gts_fnode_class (void)
 {
   static GtsFNodeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo fnode_info = {
       "GtsFNode",
       sizeof (GtsFNode),
@@ -445,6 +454,7 @@ GtsFNodeClass * gts_fnode_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_gnode_class ()),
 				  &fnode_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -537,8 +547,9 @@ static void gedge_init (GtsGEdge * object)
 GtsGEdgeClass * gts_gedge_class (void)
 {
   static GtsGEdgeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo gedge_info = {
       "GtsGEdge",
       sizeof (GtsGEdge),
@@ -550,6 +561,7 @@ GtsGEdgeClass * gts_gedge_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_containee_class ()),
 				  &gedge_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -605,7 +617,7 @@ static void pgedge_write (GtsGEdge * ge, FILE * fp)
 {
   if (GTS_IS_EDGE (GTS_PGEDGE (ge)->data)) {
     GtsEdge * e = GTS_PGEDGE (ge)->data;
-    guint n = g_slist_length (e->triangles);
+    guint n = e->triangles.n;
 
     fprintf (fp, "label=\"%p:%s:%d\",color=%s", e,
 	     GTS_IS_NEDGE (e) ? GTS_NEDGE (e)->name : "",
@@ -639,8 +651,9 @@ static void pgedge_init (GtsPGEdge * e)
 GtsPGEdgeClass * gts_pgedge_class (void)
 {
   static GtsPGEdgeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo pgedge_info = {
       "GtsPGEdge",
       sizeof (GtsPGEdge),
@@ -652,6 +665,7 @@ GtsPGEdgeClass * gts_pgedge_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_gedge_class ()),
 				  &pgedge_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -704,8 +718,9 @@ static void wgedge_init (GtsWGEdge * e)
 GtsWGEdgeClass * gts_wgedge_class (void)
 {
   static GtsWGEdgeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo wgedge_info = {
       "GtsWGEdge",
       sizeof (GtsWGEdge),
@@ -717,6 +732,7 @@ GtsWGEdgeClass * gts_wgedge_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_gedge_class ()),
 				  &wgedge_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -816,8 +832,9 @@ static void graph_class_init (GtsGraphClass * klass)
 GtsGraphClass * gts_graph_class (void)
 {
   static GtsGraphClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo graph_info = {
       "GtsGraph",
       sizeof (GtsGraph),
@@ -829,6 +846,7 @@ GtsGraphClass * gts_graph_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_hash_container_class ()),
 				  &graph_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -1596,8 +1614,9 @@ static void wgraph_init (GtsWGraph * g)
 GtsWGraphClass * gts_wgraph_class (void)
 {
   static GtsWGraphClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo wgraph_info = {
       "GtsWGraph",
       sizeof (GtsWGraph),
@@ -1609,6 +1628,7 @@ GtsWGraphClass * gts_wgraph_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_graph_class ()),
 				  &wgraph_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -1651,23 +1671,19 @@ static void create_node (GtsFace * f, GtsGraph * graph)
 
 static void create_edge (GtsEdge * e, GtsSurface * s)
 {
-  GSList * i = e->triangles;
+  guint i, j;
   
-  while (i) {
-    GtsFace * f = i->data;
-    if (GTS_IS_FACE (f) && gts_face_has_parent_surface (f, s)) {
-      GSList * j = i->next;
-      while (j) {
-	GtsFace * f1 = j->data;
+  for (i = 0; i < e->triangles.n; i++) {
+    GtsFace * f = e->triangles.items[i];
+    if (GTS_IS_FACE (f) && gts_face_has_parent_surface (f, s))
+      for (j = i + 1; j < e->triangles.n; j++) {
+	GtsFace * f1 = e->triangles.items[j];
 	if (GTS_IS_FACE (f1) && gts_face_has_parent_surface (f1, s))
 	  gts_pgedge_new (gts_pgedge_class (), 
 			  GTS_OBJECT (f)->reserved,
 			  GTS_OBJECT (f1)->reserved,
 			  e);
-	j = j->next;
       }
-    }
-    i = i->next;
   }
 }
 
@@ -34,4 +34,8 @@ void gts_write_triangle (GtsTriangle * t, GtsPoint * o, FILE * fptr);
 void gts_write_segment (GtsSegment * s, GtsPoint * o, FILE * fptr);
 #endif /* DEBUG_FUNCTIONS */
 
+/* bbtree.c */
+guint gts_bbox_nearest_insert (GtsBBoxNearest * n, guint k, guint m,
+			       const GtsBBoxNearest * hit);
+
 #endif /* __GTS_PRIVATE_H__ */
@@ -48,6 +48,17 @@ extern "C" {
 #  define GTS_C_VAR extern
 #endif /* not NATIVE_WIN32 */
 
+/* Variables with one instance per thread, such as the
+   gts_allow_floating_* switches. Thread-local variables can't be exported
+   from a DLL: they are shared by all the threads with NATIVE_WIN32. */
+#if defined (NATIVE_WIN32)
+#  define GTS_THREAD_LOCAL
+#elif defined (_MSC_VER)
+#  define GTS_THREAD_LOCAL __declspec(thread)
+#else
+#  define GTS_THREAD_LOCAL __thread
+#endif
+
 GTS_C_VAR const guint gts_major_version;
 GTS_C_VAR const guint gts_minor_version;
 GTS_C_VAR const guint gts_micro_version;
@@ -68,6 +79,8 @@ GTS_C_VAR const guint gts_binary_age;
 typedef struct _GtsObjectClassInfo     GtsObjectClassInfo;
 typedef struct _GtsObject        GtsObject;
 typedef struct _GtsObjectClass   GtsObjectClass;
+typedef struct _GtsSlab          GtsSlab;
+typedef struct _GtsArena         GtsArena;
 typedef struct _GtsPoint         GtsPoint;
 typedef struct _GtsPointClass    GtsPointClass;
 typedef struct _GtsVertex        GtsVertex;
@@ -102,6 +115,20 @@ typedef GtsVector4               GtsMatrix;
  */
 typedef gdouble                  (*GtsKeyFunc)    (gpointer item,
 						   gpointer data);
+/**
+ * GtsKeyBatchFunc:
+ * @items: an array of @n items.
+ * @keys: an array of @n keys to be filled.
+ * @n: the number of items.
+ * @data: user data.
+ *
+ * Sets @keys[i] to the value of the key for @items[i], as a #GtsKeyFunc
+ * would.
+ */
+typedef void                     (*GtsKeyBatchFunc) (gpointer * items,
+						     gdouble * keys,
+						     guint n,
+						     gpointer data);
 typedef enum 
 { 
   GTS_OUT = -1,
@@ -117,6 +144,38 @@ struct _GtsColor {
 
 typedef gint   (*GtsFunc)              (gpointer item,
 					gpointer data);
+/**
+ * GtsParallelFunc:
+ * @item: an item.
+ * @state: the reduction state of the chunk of items being processed or
+ * %NULL.
+ * @data: user data.
+ *
+ * Called concurrently on the items of a parallel traversal.
+ */
+typedef void   (*GtsParallelFunc)      (gpointer item,
+					gpointer state,
+					gpointer data);
+/**
+ * GtsReduceFunc:
+ * @result: the result of a reduction.
+ * @state: a reduction state.
+ * @data: user data.
+ *
+ * Initializes @state from @result or merges @state into @result.
+ */
+typedef void   (*GtsReduceFunc)        (gpointer result,
+					gpointer state,
+					gpointer data);
+
+typedef struct _GtsReduction     GtsReduction;
+
+struct _GtsReduction {
+  gpointer result;
+  gsize state_size;
+  GtsReduceFunc init;
+  GtsReduceFunc merge;
+};
 
 /* misc.c */
 
@@ -217,7 +276,8 @@ void           gts_file_destroy           (GtsFile * f);
 typedef enum
 {
   GTS_DESTROYED         = 1 << 0,
-  GTS_USER_FLAG         = 1 /* user flags start from here */
+  GTS_ARENA             = 1 << 1, /* allocated from a GtsArena */
+  GTS_USER_FLAG         = 2 /* user flags start from here */
 } GtsObjectFlags;
 
 #define GTS_OBJECT_FLAGS(obj)             (GTS_OBJECT (obj)->flags)
@@ -240,6 +300,7 @@ struct _GtsObject {
 
   gpointer reserved;
   guint32 flags;
+  guint64 stamp; /* used by the surface traversals */
 };
 
 struct _GtsObjectClass {
@@ -252,6 +313,8 @@ struct _GtsObjectClass {
   void        (* write)      (GtsObject *, FILE *);
   GtsColor    (* color)      (GtsObject *);
   void        (* attributes) (GtsObject *, GtsObject *);
+
+  GtsSlab * slab;
 };
 
 gpointer         gts_object_class_new      (GtsObjectClass * parent_class,
@@ -317,6 +380,15 @@ void             gts_object_reset_reserved      (GtsObject * object);
 void             gts_object_destroy             (GtsObject * object);
 void             gts_finalize                   (void);
 
+void             gts_object_class_use_slab      (GtsObjectClass * klass);
+GtsArena *       gts_arena_new                  (void);
+void             gts_arena_push                 (GtsArena * arena);
+void             gts_arena_pop                  (GtsArena * arena);
+void             gts_arena_foreach              (GtsArena * arena,
+						 GtsFunc func,
+						 gpointer data);
+void             gts_arena_destroy              (GtsArena * arena);
+
 /* Ranges: surface.c */
 typedef struct _GtsRange               GtsRange;
 
@@ -414,6 +486,9 @@ gdouble       gts_point_segment_distance             (GtsPoint * p,
 void          gts_point_segment_closest              (GtsPoint * p, 
 						      GtsSegment * s,
 						      GtsPoint * closest);
+gdouble       gts_point_segment_nearest              (GtsPoint * p, 
+						      GtsSegment * s,
+						      GtsVector closest);
 gdouble       gts_point_triangle_distance2           (GtsPoint * p, 
 						      GtsTriangle * t);
 gdouble       gts_point_triangle_distance            (GtsPoint * p, 
@@ -421,10 +496,62 @@ gdouble       gts_point_triangle_distance            (GtsPoint * p,
 void          gts_point_triangle_closest             (GtsPoint * p,
 						      GtsTriangle * t,
 						      GtsPoint * closest);
+gdouble       gts_point_triangle_nearest             (GtsPoint * p,
+						      GtsTriangle * t,
+						      GtsVector closest);
 gboolean      gts_point_is_inside_surface            (GtsPoint * p, 
 						      GNode * tree,
 						      gboolean is_open);
 
+/* Adjacency arrays: vertex.c */
+
+typedef struct _GtsAdjacency         GtsAdjacency;
+
+struct _GtsAdjacency {
+  gpointer * items;
+  guint n;
+  guint size;
+};
+
+/**
+ * GTS_ADJACENCY_FOREACH:
+ * @a: a #GtsAdjacency.
+ * @i: a #guint variable.
+ * @item: a variable set to each item of @a in turn.
+ *
+ * Loops over the items of @a in the order they were added. @a must not
+ * be modified by the body of the loop.
+ */
+#define GTS_ADJACENCY_FOREACH(a, i, item) \
+  for ((i) = 0; (i) < (a)->n && ((item) = (a)->items[i], TRUE); (i)++)
+/**
+ * GTS_ADJACENCY_FOREACH_REVERSE:
+ * @a: a #GtsAdjacency.
+ * @i: a #guint variable.
+ * @item: a variable set to each item of @a in turn.
+ *
+ * Loops over the items of @a starting from the last one. The body of
+ * the loop can remove @item from @a, but no other item.
+ */
+#define GTS_ADJACENCY_FOREACH_REVERSE(a, i, item) \
+  for ((i) = (a)->n; (i)-- > 0 && ((item) = (a)->items[i], TRUE);)
+
+void          gts_adjacency_init           (GtsAdjacency * a,
+					    gpointer * slots,
+					    guint nslots);
+void          gts_adjacency_add            (GtsAdjacency * a,
+					    gpointer item,
+					    gpointer * slots);
+gboolean      gts_adjacency_remove         (GtsAdjacency * a,
+					    gpointer item);
+gboolean      gts_adjacency_contains       (GtsAdjacency * a,
+					    gpointer item);
+void          gts_adjacency_free           (GtsAdjacency * a,
+					    gpointer * slots,
+					    guint nslots);
+GSList *      gts_adjacency_list           (GtsAdjacency * a,
+					    GSList * list);
+
 /* Vertices: vertex.c */
 
 #define GTS_IS_VERTEX(obj)   (gts_object_is_from_class (obj,\
@@ -435,10 +562,13 @@ gboolean      gts_point_is_inside_surface            (GtsPoint * p,
 #define GTS_VERTEX_CLASS(klass)     GTS_OBJECT_CLASS_CAST (klass,\
 							   GtsVertexClass,\
 							   gts_vertex_class ())
+#define GTS_VERTEX_SEGMENT_SLOTS 6
+
 struct _GtsVertex {
   GtsPoint p;
   
-  GSList * segments;
+  GtsAdjacency segments;
+  gpointer segment_slots[GTS_VERTEX_SEGMENT_SLOTS];
 };
 
 struct _GtsVertexClass {
@@ -449,7 +579,7 @@ struct _GtsVertexClass {
 					   GtsObject *);
 };
 
-GTS_C_VAR 
+GTS_C_VAR GTS_THREAD_LOCAL
 gboolean      gts_allow_floating_vertices;
 
 GtsVertexClass * gts_vertex_class          (void);
@@ -457,6 +587,11 @@ GtsVertex *   gts_vertex_new               (GtsVertexClass * klass,
 					    gdouble x,
 					    gdouble y,
 					    gdouble z);
+#define       gts_vertex_add_segment(v, s) (gts_adjacency_add (&(v)->segments,\
+                                                            (s),\
+                                                            (v)->segment_slots))
+#define       gts_vertex_remove_segment(v, s) (gts_adjacency_remove (&(v)->segments,\
+                                                                    (s)))
 void          gts_vertex_replace           (GtsVertex * v, 
 					    GtsVertex * with);
 gboolean      gts_vertex_is_unattached     (GtsVertex * v);
@@ -578,17 +713,20 @@ gboolean      gts_segment_is_ok                      (GtsSegment * s);
 							GtsEdgeClass,\
 							gts_edge_class ())
 
+#define GTS_EDGE_TRIANGLE_SLOTS 2
+
 struct _GtsEdge {
   GtsSegment segment;
 
-  GSList * triangles;
+  GtsAdjacency triangles;
+  gpointer triangle_slots[GTS_EDGE_TRIANGLE_SLOTS];
 };
 
 struct _GtsEdgeClass {
   GtsSegmentClass parent_class;
 };
 
-GTS_C_VAR 
+GTS_C_VAR GTS_THREAD_LOCAL
 gboolean      gts_allow_floating_edges;
 
 GtsEdgeClass * gts_edge_class                     (void);
@@ -601,7 +739,12 @@ GtsEdge *     gts_edge_new                        (GtsEdgeClass * klass,
  *
  * Evaluates to %TRUE if no triangles uses @s as an edge, %FALSE otherwise.
  */
-#define       gts_edge_is_unattached(s) ((s)->triangles == NULL ? TRUE : FALSE)
+#define       gts_edge_is_unattached(s) ((s)->triangles.n == 0 ? TRUE : FALSE)
+#define       gts_edge_add_triangle(e, t) (gts_adjacency_add (&(e)->triangles,\
+                                                             (t),\
+                                                             (e)->triangle_slots))
+#define       gts_edge_remove_triangle(e, t) (gts_adjacency_remove (&(e)->triangles,\
+                                                                   (t)))
 GtsFace *     gts_edge_has_parent_surface         (GtsEdge * e, 
 						   GtsSurface * surface);
 GtsFace *     gts_edge_has_any_parent_surface     (GtsEdge * e);
@@ -711,9 +854,17 @@ void          gts_triangle_vertices         (GtsTriangle * t,
 					     GtsVertex ** v3);
 GtsPoint *    gts_triangle_circumcircle_center (GtsTriangle * t,
 						GtsPointClass * point_class);
+gboolean      gts_points_are_folded         (GtsPoint * A,
+					     GtsPoint * B,
+					     GtsPoint * C,
+					     GtsPoint * D,
+					     gdouble max);
 gboolean      gts_triangles_are_folded      (GSList * triangles,
 					     GtsVertex * A, GtsVertex * B,
 					     gdouble max);
+gboolean      gts_edge_triangles_are_folded (GtsEdge * e,
+					     GtsVertex * A, GtsVertex * B,
+					     gdouble max);
 GtsObject *   gts_triangle_is_stabbed       (GtsTriangle * t,
 					     GtsPoint * p,
 					     gdouble * orientation);
@@ -741,7 +892,7 @@ struct _GtsFaceClass {
   GtsTriangleClass parent_class;
 };
 
-GTS_C_VAR 
+GTS_C_VAR GTS_THREAD_LOCAL
 gboolean      gts_allow_floating_faces;
 
 GtsFaceClass * gts_face_class                       (void);
@@ -844,6 +995,52 @@ GSList *      gts_kdtree_range                       (GNode * tree,
 						      (const void *, 
 						      const void *));
 
+/* Flat kd-trees, unrelated to the GNode trees of gts_kdtree_new() */
+
+typedef struct _GtsKdTree GtsKdTree;
+
+struct _GtsKdTree {
+  guint n;
+  /* the node of range [start, end) is point m = start + (end - start)/2,
+     its children being the nodes of [start, m) and [m + 1, end) */
+  GtsVector * coords;
+  GtsPoint ** points;
+  guint8 * axis;      /* splitting axis of each node */
+};
+
+GtsKdTree *   gts_kd_flat_new                        (GPtrArray * points,
+						      guint nthreads);
+void          gts_kd_flat_destroy                    (GtsKdTree * tree);
+guint         gts_kd_flat_range                      (GtsKdTree * tree,
+						      GtsBBox * bbox,
+						      GtsPoint ** points,
+						      guint size);
+guint         gts_kd_flat_radius                     (GtsKdTree * tree,
+						      GtsPoint * p,
+						      gdouble radius,
+						      GtsPoint ** points,
+						      guint size);
+guint         gts_kd_flat_k_nearest                  (GtsKdTree * tree,
+						      GtsPoint * p,
+						      guint k,
+						      GtsPoint ** points,
+						      gdouble * distance2);
+void          gts_kd_flat_points_k_nearest           (GtsKdTree * tree,
+						      GtsVector * queries,
+						      guint n,
+						      guint k,
+						      GtsPoint ** points,
+						      gdouble * distance2,
+						      guint nthreads);
+void          gts_kd_flat_points_radius              (GtsKdTree * tree,
+						      GtsVector * queries,
+						      guint n,
+						      gdouble radius,
+						      guint size,
+						      GtsPoint ** points,
+						      guint * count,
+						      guint nthreads);
+
 /* Bboxtrees: bbtree.c */
 
 /**
@@ -882,6 +1079,28 @@ typedef gdouble (*GtsBBoxDistFunc)               (GtsPoint * p,
  */
 typedef GtsPoint * (*GtsBBoxClosestFunc)         (GtsPoint * p,
 						  gpointer bounded);
+/**
+ * GtsBBoxNearestFunc:
+ * @p: a #GtsPoint.
+ * @bounded: an object bounded by a #GtsBBox.
+ * @closest: a #GtsVector.
+ * 
+ * User function setting @closest to the coordinates of the point
+ * belonging to the object defined by @bounded and closest to @p.
+ *
+ * Returns: the square of the Euclidean distance between @p and @closest.
+ */
+typedef gdouble (*GtsBBoxNearestFunc)            (GtsPoint * p,
+						  gpointer bounded,
+						  GtsVector closest);
+
+typedef struct _GtsBBoxNearest GtsBBoxNearest;
+
+struct _GtsBBoxNearest {
+  GtsBBox * bbox;     /* bounding box of the object, %NULL if none */
+  gdouble distance2;  /* square of the distance to the object */
+  GtsVector closest;  /* point of the object closest to the query point */
+};
 
 /**
  * GTS_IS_BBOX:
@@ -1002,6 +1221,14 @@ GtsPoint * gts_bb_tree_point_closest         (GNode * tree,
 					      GtsPoint * p,
 					      GtsBBoxClosestFunc closest,
 					      gdouble * distance);
+GtsBBoxNearest gts_bb_tree_point_nearest     (GNode * tree,
+					      GtsPoint * p,
+					      GtsBBoxNearestFunc nearest);
+guint      gts_bb_tree_point_k_nearest       (GNode * tree,
+					      GtsPoint * p,
+					      GtsBBoxNearestFunc nearest,
+					      guint k,
+					      GtsBBoxNearest * n);
 void       gts_bb_tree_segment_distance      (GNode * tree, 
 					      GtsSegment * s,
 					      GtsBBoxDistFunc distance,
@@ -1026,6 +1253,112 @@ void       gts_bb_tree_surface_boundary_distance
 void       gts_bb_tree_destroy               (GNode * tree, 
 					      gboolean free_leaves);
 
+/* Flat bounding volume hierarchies: bvh.c */
+
+typedef struct _GtsBVHBoxes GtsBVHBoxes;
+
+struct _GtsBVHBoxes {
+  gdouble * x1, * y1, * z1, * x2, * y2, * z2;
+};
+
+typedef struct _GtsBVH GtsBVH;
+
+struct _GtsBVH {
+  guint nnodes, nitems, depth;
+
+  /* nodes, the root being node 0 */
+  GtsBVHBoxes node;
+  guint32 * first; /* first child (the second is next) or first item */
+  guint32 * count; /* number of items of a leaf, 0 for an inner node */
+  guint32 * parent; /* parent node, the root being its own parent */
+  /* items, in the order of the leaves */
+  GtsBVHBoxes item;
+  GtsBBox ** bboxes;
+  guint32 * leaf;   /* leaf node holding each item */
+
+  /* surface area heuristic cost, now and when last built */
+  gdouble cost, build_cost;
+  guint nthreads;
+  GHashTable * index; /* bounded objects to items, see gts_bvh_refit() */
+};
+
+GtsBVH *   gts_bvh_new                       (GSList * bboxes,
+					      guint nthreads);
+GtsBVH *   gts_bvh_surface                   (GtsSurface * s,
+					      guint nthreads);
+GSList *   gts_bvh_stabbed                   (GtsBVH * bvh,
+					      GtsPoint * p);
+GSList *   gts_bvh_overlap                   (GtsBVH * bvh,
+					      GtsBBox * bbox);
+gboolean   gts_bvh_is_overlapping            (GtsBVH * bvh,
+					      GtsBBox * bbox);
+void       gts_bvh_traverse_overlapping      (GtsBVH * bvh1,
+					      GtsBVH * bvh2,
+					      GtsBBTreeTraverseFunc func,
+					      gpointer data);
+gdouble    gts_bvh_point_distance            (GtsBVH * bvh,
+					      GtsPoint * p,
+					      GtsBBoxDistFunc distance,
+					      GtsBBox ** bbox);
+GtsPoint * gts_bvh_point_closest             (GtsBVH * bvh,
+					      GtsPoint * p,
+					      GtsBBoxClosestFunc closest,
+					      gdouble * distance);
+GtsBBoxNearest gts_bvh_point_nearest         (GtsBVH * bvh,
+					      GtsPoint * p,
+					      GtsBBoxNearestFunc nearest);
+guint      gts_bvh_point_k_nearest           (GtsBVH * bvh,
+					      GtsPoint * p,
+					      GtsBBoxNearestFunc nearest,
+					      guint k,
+					      GtsBBoxNearest * n);
+void       gts_bvh_points_nearest            (GtsBVH * bvh,
+					      GtsVector * points,
+					      guint n,
+					      GtsBBoxNearestFunc nearest,
+					      GtsBBoxNearest * results,
+					      guint nthreads);
+gboolean   gts_bvh_refit                     (GtsBVH * bvh,
+					      GSList * vertices,
+					      gdouble max_cost);
+void       gts_bvh_destroy                   (GtsBVH * bvh,
+					      gboolean free_leaves);
+
+/* Pointer sets: surface.c */
+
+typedef struct _GtsPointerSet        GtsPointerSet;
+
+struct _GtsPointerSet {
+  gpointer * items;
+  guint n;
+  guint size;
+  guint32 * slots;
+  guint mask;
+};
+
+/**
+ * GTS_POINTER_SET_FOREACH:
+ * @set: a #GtsPointerSet.
+ * @i: a #guint variable.
+ * @item: a variable set to each item of @set in turn.
+ *
+ * Loops over the items of @set, stored contiguously in @items. @set
+ * must not be modified by the body of the loop.
+ */
+#define GTS_POINTER_SET_FOREACH(set, i, item) \
+  for ((i) = 0; (i) < (set)->n && ((item) = (set)->items[i], TRUE); (i)++)
+
+void          gts_pointer_set_init         (GtsPointerSet * set);
+void          gts_pointer_set_reserve      (GtsPointerSet * set,
+					    guint n);
+gboolean      gts_pointer_set_add          (GtsPointerSet * set,
+					    gpointer item);
+gboolean      gts_pointer_set_remove       (GtsPointerSet * set,
+					    gpointer item);
+gboolean      gts_pointer_set_contains     (GtsPointerSet * set,
+					    gpointer item);
+void          gts_pointer_set_free         (GtsPointerSet * set);
+
 /* Surfaces: surface.c */
 
 typedef struct _GtsSurfaceStats        GtsSurfaceStats;
@@ -1062,15 +1395,12 @@ struct _GtsSurfaceQualityStats {
 struct _GtsSurface {
   GtsObject object;
 
-#ifdef USE_SURFACE_BTREE
-  GTree * faces;
-#else /* not USE_SURFACE_BTREE */
-  GHashTable * faces;
-#endif /* not USE_SURFACE_BTREE */
+  GtsPointerSet faces;
   GtsFaceClass * face_class;
   GtsEdgeClass * edge_class;
   GtsVertexClass * vertex_class;
   gboolean keep_faces;
+  GtsArena * arena;
 };
 
 struct _GtsSurfaceClass {
@@ -1094,6 +1424,8 @@ GtsSurface * gts_surface_new               (GtsSurfaceClass * klass,
 					    GtsFaceClass * face_class,
 					    GtsEdgeClass * edge_class,
 					    GtsVertexClass * vertex_class);
+void         gts_surface_set_arena         (GtsSurface * s,
+					    GtsArena * arena);
 void         gts_surface_add_face          (GtsSurface * s, 
 					    GtsFace * f);
 void         gts_surface_remove_face       (GtsSurface * s, 
@@ -1115,6 +1447,19 @@ void         gts_surface_write_vtk         (GtsSurface * s,
 					    FILE * fptr);
 void         gts_surface_write_oogl_boundary (GtsSurface * s, 
 					      FILE * fptr);
+
+typedef struct _GtsSurfaceBuffers GtsSurfaceBuffers;
+
+struct _GtsSurfaceBuffers {
+  guint nvertices, nfaces;
+  guint stride;
+  gfloat * vertices;
+  guint32 * indices;
+};
+
+GtsSurfaceBuffers * gts_surface_buffers_new (GtsSurface * s,
+					     gboolean normals);
+void         gts_surface_buffers_destroy   (GtsSurfaceBuffers * buffers);
 void         gts_surface_foreach_vertex    (GtsSurface * s, 
 					    GtsFunc func, 
 					    gpointer data);
@@ -1127,6 +1472,21 @@ void         gts_surface_foreach_face      (GtsSurface * s,
 guint        gts_surface_foreach_face_remove (GtsSurface * s,
 					      GtsFunc func, 
 					      gpointer data);
+void         gts_surface_parallel_foreach_vertex (GtsSurface * s,
+						  GtsParallelFunc func,
+						  gpointer data,
+						  GtsReduction * reduction,
+						  guint nthreads);
+void         gts_surface_parallel_foreach_edge (GtsSurface * s,
+						GtsParallelFunc func,
+						gpointer data,
+						GtsReduction * reduction,
+						guint nthreads);
+void         gts_surface_parallel_foreach_face (GtsSurface * s,
+						GtsParallelFunc func,
+						gpointer data,
+						GtsReduction * reduction,
+						guint nthreads);
 typedef struct _GtsSurfaceTraverse GtsSurfaceTraverse;
 GtsSurfaceTraverse * gts_surface_traverse_new (GtsSurface * s,
 					       GtsFace * f);
@@ -1140,6 +1500,47 @@ void         gts_surface_refine            (GtsSurface * surface,
 					    gpointer refine_data,
 					    GtsStopFunc stop_func,
 					    gpointer stop_data);
+void         gts_surface_refine_parallel   (GtsSurface * surface,
+					    GtsKeyFunc cost_func,
+					    gpointer cost_data,
+					    GtsRefineFunc refine_func,
+					    gpointer refine_data,
+					    GtsStopFunc stop_func,
+					    gpointer stop_data,
+					    guint nthreads);
+void         gts_surface_refine_batch      (GtsSurface * surface,
+					    GtsKeyBatchFunc batch_func,
+					    GtsKeyFunc cost_func,
+					    gpointer cost_data,
+					    GtsRefineFunc refine_func,
+					    gpointer refine_data,
+					    GtsStopFunc stop_func,
+					    gpointer stop_data,
+					    guint nthreads);
+void         gts_surface_refine_independent (GtsSurface * surface,
+					     GtsKeyBatchFunc batch_func,
+					     GtsKeyFunc cost_func,
+					     gpointer cost_data,
+					     GtsRefineFunc refine_func,
+					     gpointer refine_data,
+					     GtsStopFunc stop_func,
+					     gpointer stop_data,
+					     gdouble slack,
+					     guint nthreads);
+
+typedef struct _GtsRefineTolerance GtsRefineTolerance;
+
+struct _GtsRefineTolerance {
+  gdouble tolerance;
+  guint max_faces;
+
+  gdouble bound;
+  gboolean budget_exceeded;
+};
+
+gboolean     gts_refine_stop_tolerance     (gdouble cost,
+					    guint nedge,
+					    GtsRefineTolerance * t);
 gboolean     gts_edge_collapse_is_valid    (GtsEdge * e);
 void         gts_surface_coarsen           (GtsSurface * surface,
 					    GtsKeyFunc cost_func,
@@ -1149,6 +1550,16 @@ void         gts_surface_coarsen           (GtsSurface * surface,
 					    GtsStopFunc stop_func,
 					    gpointer stop_data,
 					    gdouble minangle);
+void         gts_surface_coarsen_independent (GtsSurface * surface,
+					      GtsKeyFunc cost_func,
+					      gpointer cost_data,
+					      GtsCoarsenFunc coarsen_func,
+					      gpointer coarsen_data,
+					      GtsStopFunc stop_func,
+					      gpointer stop_data,
+					      gdouble minangle,
+					      gdouble slack,
+					      guint nthreads);
 gboolean     gts_coarsen_stop_number       (gdouble cost, 
 					    guint nedge, 
 					    guint * min_number);
@@ -1158,6 +1569,11 @@ gboolean     gts_coarsen_stop_cost         (gdouble cost,
 void         gts_surface_tessellate        (GtsSurface * s,
 					    GtsRefineFunc refine_func,
 					    gpointer refine_data);
+void         gts_surface_subdivide_uniform (GtsSurface * s,
+					    guint levels,
+					    GtsRefineFunc refine_func,
+					    gpointer refine_data,
+					    guint nthreads);
 GtsSurface * gts_surface_generate_sphere   (GtsSurface * s,
 					    guint geodesation_order);
 GtsSurface * gts_surface_copy              (GtsSurface * s1,
@@ -1175,6 +1591,8 @@ gdouble      gts_surface_center_of_area    (GtsSurface * s,
 guint        gts_surface_vertex_number     (GtsSurface * s);
 guint        gts_surface_edge_number       (GtsSurface * s);
 guint        gts_surface_face_number       (GtsSurface * s);
+void         gts_surface_reserve           (GtsSurface * s,
+					    guint nfaces);
 void         gts_surface_distance          (GtsSurface * s1, 
 					    GtsSurface * s2, 
 					    gdouble delta,
@@ -1183,6 +1601,82 @@ void         gts_surface_distance          (GtsSurface * s1,
 GSList *     gts_surface_boundary          (GtsSurface * surface);
 GSList *     gts_surface_split             (GtsSurface * s);
 
+/* Half-edge meshes: hmesh.c */
+
+#define GTS_HMESH_NONE ((guint32) G_MAXUINT32)
+
+typedef struct _GtsHMesh GtsHMesh;
+
+struct _GtsHMesh {
+  guint nv, nh, nf;
+  guint vsize, fsize;
+  guint nv_removed, nf_removed;
+
+  /* vertices */
+  gdouble * x, * y, * z;
+  guint32 * vhalf;
+  /* half-edges */
+  guint32 * next, * twin, * vertex, * face;
+  /* faces */
+  guint32 * fhalf;
+};
+
+#define gts_hmesh_prev(m, h)   ((m)->next[(m)->next[h]])
+#define gts_hmesh_target(m, h) ((m)->vertex[(m)->next[h]])
+#define GTS_HMESH_FOREACH_OUTGOING(m, v, h)\
+  for ((h) = (m)->vhalf[v]; (h) != GTS_HMESH_NONE;\
+       (h) = gts_hmesh_vertex_next_outgoing ((m), (v), (h)))
+
+GtsHMesh *   gts_hmesh_new                 (void);
+void         gts_hmesh_destroy             (GtsHMesh * m);
+void         gts_hmesh_reserve             (GtsHMesh * m,
+					    guint nv,
+					    guint nf);
+guint32      gts_hmesh_add_vertex          (GtsHMesh * m,
+					    gdouble x,
+					    gdouble y,
+					    gdouble z);
+guint32      gts_hmesh_add_face            (GtsHMesh * m,
+					    guint32 v1,
+					    guint32 v2,
+					    guint32 v3);
+void         gts_hmesh_link_twins          (GtsHMesh * m);
+GtsHMesh *   gts_hmesh_new_from_surface    (GtsSurface * s);
+void         gts_hmesh_to_surface          (GtsHMesh * m,
+					    GtsSurface * s);
+guint32      gts_hmesh_vertex_next_outgoing (GtsHMesh * m,
+					     guint32 v,
+					     guint32 h);
+guint        gts_hmesh_vertex_valence      (GtsHMesh * m,
+					    guint32 v);
+gboolean     gts_hmesh_vertex_is_boundary  (GtsHMesh * m,
+					    guint32 v);
+guint32      gts_hmesh_find_halfedge       (GtsHMesh * m,
+					    guint32 v1,
+					    guint32 v2);
+void         gts_hmesh_face_vertices       (GtsHMesh * m,
+					    guint32 f,
+					    guint32 * v1,
+					    guint32 * v2,
+					    guint32 * v3);
+guint        gts_hmesh_vertex_number       (GtsHMesh * m);
+guint        gts_hmesh_edge_number         (GtsHMesh * m);
+guint        gts_hmesh_face_number         (GtsHMesh * m);
+guint32      gts_hmesh_split_edge          (GtsHMesh * m,
+					    guint32 h,
+					    gdouble x,
+					    gdouble y,
+					    gdouble z);
+gboolean     gts_hmesh_collapse_is_valid   (GtsHMesh * m,
+					    guint32 h);
+guint32      gts_hmesh_collapse_edge       (GtsHMesh * m,
+					    guint32 h);
+gboolean     gts_hmesh_flip_is_valid       (GtsHMesh * m,
+					    guint32 h);
+void         gts_hmesh_flip_edge           (GtsHMesh * m,
+					    guint32 h);
+void         gts_hmesh_compact             (GtsHMesh * m);
+
 /* Discrete differential operators: curvature.c */
 
 gboolean gts_vertex_mean_curvature_normal  (GtsVertex * v, 
@@ -1344,6 +1838,11 @@ GtsEHeapPair * gts_eheap_insert       (GtsEHeap * heap,
 GtsEHeapPair * gts_eheap_insert_with_key (GtsEHeap * heap, 
 					  gpointer p, 
 					  gdouble key);
+void           gts_eheap_insert_array (GtsEHeap * heap,
+				       gpointer * items,
+				       gdouble * keys,
+				       guint n,
+				       GtsEHeapPair ** pairs);
 gpointer       gts_eheap_remove_top   (GtsEHeap * heap,
 				       gdouble * key);
 gpointer       gts_eheap_top          (GtsEHeap * heap, 
@@ -1357,6 +1856,9 @@ gpointer       gts_eheap_remove       (GtsEHeap * heap,
 void           gts_eheap_decrease_key (GtsEHeap * heap,
 				       GtsEHeapPair * p,
 				       gdouble new_key);
+void           gts_eheap_change_key   (GtsEHeap * heap,
+				       GtsEHeapPair * p,
+				       gdouble new_key);
 void           gts_eheap_freeze       (GtsEHeap * heap);
 guint          gts_eheap_size         (GtsEHeap * heap);
 void           gts_eheap_update       (GtsEHeap * heap);
@@ -1364,6 +1866,8 @@ gdouble        gts_eheap_key          (GtsEHeap * heap,
 				       gpointer p);
 void           gts_eheap_randomized   (GtsEHeap * heap, 
 				       gboolean randomized);
+void           gts_eheap_seed         (GtsEHeap * heap,
+				       guint32 seed);
 void           gts_eheap_destroy      (GtsEHeap * heap);
 
 /* FIFO queues: fifo.c */
@@ -2105,7 +2609,7 @@ gfloat          gts_gnode_move_cost            (GtsGNode * n,
 						GtsGraph * dst);
 gfloat          gts_gnode_weight               (GtsGNode * n);
 
-GTS_C_VAR
+GTS_C_VAR GTS_THREAD_LOCAL
 gboolean        gts_allow_floating_gnodes;
 
 /* GtsNGNode: graph.c */
@@ -0,0 +1,869 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "gts.h"
+
+#define NONE GTS_HMESH_NONE
+
+static void vertices_reserve (GtsHMesh * m, guint n)
+{
+  guint size;
+
+  if (n <= m->vsize)
+    return;
+  size = MAX (n, 2*m->vsize);
+  m->x = g_realloc (m->x, size*sizeof (gdouble));
+  m->y = g_realloc (m->y, size*sizeof (gdouble));
+  m->z = g_realloc (m->z, size*sizeof (gdouble));
+  m->vhalf = g_realloc (m->vhalf, size*sizeof (guint32));
+  m->vsize = size;
+}
+
+static void faces_reserve (GtsHMesh * m, guint n)
+{
+  guint size;
+
+  if (n <= m->fsize)
+    return;
+  size = MAX (n, 2*m->fsize);
+  m->fhalf = g_realloc (m->fhalf, size*sizeof (guint32));
+  m->next = g_realloc (m->next, 3*size*sizeof (guint32));
+  m->twin = g_realloc (m->twin, 3*size*sizeof (guint32));
+  m->vertex = g_realloc (m->vertex, 3*size*sizeof (guint32));
+  m->face = g_realloc (m->face, 3*size*sizeof (guint32));
+  m->fsize = size;
+}
+
+/* Appends @n faces together with their 3@n half-edges, the half-edges
+   of face f being 3f, 3f + 1 and 3f + 2 on return */
+static guint32 faces_append (GtsHMesh * m, guint n)
+{
+  guint32 f = m->nf;
+
+  faces_reserve (m, m->nf + n);
+  m->nf += n;
+  m->nh += 3*n;
+  return f;
+}
+
+static void face_remove (GtsHMesh * m, guint32 f)
+{
+  guint32 h = m->fhalf[f], i;
+
+  for (i = 0; i < 3; i++) {
+    guint32 next = m->next[h];
+
+    m->face[h] = m->twin[h] = NONE;
+    h = next;
+  }
+  m->fhalf[f] = NONE;
+  m->nf_removed++;
+}
+
+/* Makes the outgoing half-edge of @v the first of its fan, starting
+   from @h, which must leave @v */
+static void vertex_set_halfedge (GtsHMesh * m, guint32 v, guint32 h)
+{
+  guint32 start = h;
+
+  while (m->twin[h] != NONE) {
+    h = m->next[m->twin[h]];
+    if (h == start)
+      break;
+  }
+  m->vhalf[v] = h;
+}
+
+static gboolean vertex_has_neighbor (GtsHMesh * m, guint32 v, guint32 u)
+{
+  guint32 h;
+
+  GTS_HMESH_FOREACH_OUTGOING (m, v, h) {
+    guint32 prev = gts_hmesh_prev (m, h);
+
+    if (gts_hmesh_target (m, h) == u ||
+	(m->twin[prev] == NONE && m->vertex[prev] == u))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/**
+ * gts_hmesh_new:
+ *
+ * Returns: a new empty #GtsHMesh.
+ */
+GtsHMesh * gts_hmesh_new (void)
+{
+  return g_malloc0 (sizeof (GtsHMesh));
+}
+
+/**
+ * gts_hmesh_destroy:
+ * @m: a #GtsHMesh.
+ *
+ * Frees all the memory allocated for @m.
+ */
+void gts_hmesh_destroy (GtsHMesh * m)
+{
+  g_return_if_fail (m != NULL);
+
+  g_free (m->x);
+  g_free (m->y);
+  g_free (m->z);
+  g_free (m->vhalf);
+  g_free (m->next);
+  g_free (m->twin);
+  g_free (m->vertex);
+  g_free (m->face);
+  g_free (m->fhalf);
+  g_free (m);
+}
+
+/**
+ * gts_hmesh_reserve:
+ * @m: a #GtsHMesh.
+ * @nv: a number of vertices.
+ * @nf: a number of faces.
+ *
+ * Makes room in @m for @nv vertices and @nf faces in total, so that
+ * adding them does not reallocate its arrays.
+ */
+void gts_hmesh_reserve (GtsHMesh * m, guint nv, guint nf)
+{
+  g_return_if_fail (m != NULL);
+
+  vertices_reserve (m, nv);
+  faces_reserve (m, nf);
+}
+
+/**
+ * gts_hmesh_add_vertex:
+ * @m: a #GtsHMesh.
+ * @x: the x-coordinate of the new vertex.
+ * @y: the y-coordinate of the new vertex.
+ * @z: the z-coordinate of the new vertex.
+ *
+ * Returns: the index of a new vertex of @m, not used by any face yet.
+ */
+guint32 gts_hmesh_add_vertex (GtsHMesh * m, gdouble x, gdouble y, gdouble z)
+{
+  guint32 v;
+
+  g_return_val_if_fail (m != NULL, NONE);
+
+  vertices_reserve (m, m->nv + 1);
+  v = m->nv++;
+  m->x[v] = x;
+  m->y[v] = y;
+  m->z[v] = z;
+  m->vhalf[v] = NONE;
+  return v;
+}
+
+/**
+ * gts_hmesh_add_face:
+ * @m: a #GtsHMesh.
+ * @v1: a vertex of @m.
+ * @v2: a vertex of @m.
+ * @v3: a vertex of @m.
+ *
+ * Adds to @m the face (@v1, @v2, @v3), its half-edges going from @v1
+ * to @v2, @v2 to @v3 and @v3 to @v1. Its half-edges are left without
+ * twins, gts_hmesh_link_twins() must be called once all the faces are
+ * added.
+ *
+ * Returns: the index of the new face.
+ */
+guint32 gts_hmesh_add_face (GtsHMesh * m, guint32 v1, guint32 v2, guint32 v3)
+{
+  guint32 f, h, v[3];
+  guint i;
+
+  g_return_val_if_fail (m != NULL, NONE);
+  g_return_val_if_fail (v1 < m->nv && v2 < m->nv && v3 < m->nv, NONE);
+
+  v[0] = v1; v[1] = v2; v[2] = v3;
+  f = faces_append (m, 1);
+  h = 3*f;
+  for (i = 0; i < 3; i++) {
+    m->next[h + i] = h + (i + 1) % 3;
+    m->twin[h + i] = NONE;
+    m->vertex[h + i] = v[i];
+    m->face[h + i] = f;
+    if (m->vhalf[v[i]] == NONE)
+      m->vhalf[v[i]] = h + i;
+  }
+  m->fhalf[f] = h;
+  return f;
+}
+
+/**
+ * gts_hmesh_link_twins:
+ * @m: a #GtsHMesh.
+ *
+ * Pairs the half-edges of @m without twins which join the same
+ * vertices in opposite directions. Half-edges shared by more than two
+ * faces (non-manifold edges) or by two faces of inconsistent
+ * orientation are left on the boundary.
+ *
+ * The outgoing half-edge of each vertex is then chosen on the
+ * boundary, if any, so that iterating with
+ * GTS_HMESH_FOREACH_OUTGOING() visits all its faces. This only holds
+ * for manifold vertices, the faces of which form a single fan, which
+ * the topological operators of #GtsHMesh expect.
+ */
+void gts_hmesh_link_twins (GtsHMesh * m)
+{
+  guint32 * start, * bucket, h;
+  guint i, j, k;
+
+  g_return_if_fail (m != NULL);
+
+  /* bucket the unpaired half-edges by their smaller vertex */
+  start = g_malloc0 ((m->nv + 1)*sizeof (guint32));
+  bucket = g_malloc (MAX (m->nh, 1)*sizeof (guint32));
+  for (h = 0; h < m->nh; h++)
+    if (m->face[h] != NONE && m->twin[h] == NONE)
+      start[MIN (m->vertex[h], gts_hmesh_target (m, h)) + 1]++;
+  for (i = 0; i < m->nv; i++)
+    start[i + 1] += start[i];
+  for (h = 0; h < m->nh; h++)
+    if (m->face[h] != NONE && m->twin[h] == NONE)
+      bucket[start[MIN (m->vertex[h], gts_hmesh_target (m, h))]++] = h;
+
+  /* start[i] is now the end of bucket i */
+  for (i = 0; i < m->nv; i++)
+    for (j = i > 0 ? start[i - 1] : 0; j < start[i]; j++) {
+      guint32 h1 = bucket[j], h2 = NONE;
+      guint32 a = m->vertex[h1], b = gts_hmesh_target (m, h1);
+      guint n = 0;
+
+      if (m->twin[h1] != NONE)
+	continue;
+      for (k = i > 0 ? start[i - 1] : 0; k < start[i]; k++) {
+	guint32 h3 = bucket[k];
+
+	if (h3 != h1 && MAX (m->vertex[h3], gts_hmesh_target (m, h3)) ==
+	    MAX (a, b)) {
+	  h2 = h3;
+	  n++;
+	}
+      }
+      if (n == 1 && m->vertex[h2] == b) {
+	m->twin[h1] = h2;
+	m->twin[h2] = h1;
+      }
+    }
+  g_free (bucket);
+  g_free (start);
+
+  for (i = 0; i < m->nv; i++)
+    if (m->vhalf[i] != NONE)
+      vertex_set_halfedge (m, i, m->vhalf[i]);
+}
+
+static void hmesh_add_vertex (GtsPoint * p, GtsHMesh * m)
+{
+  GTS_OBJECT (p)->reserved =
+    GUINT_TO_POINTER (gts_hmesh_add_vertex (m, p->x, p->y, p->z));
+}
+
+static void hmesh_add_face (GtsTriangle * t, GtsHMesh * m)
+{
+  GtsVertex * v1, * v2, * v3;
+
+  gts_triangle_vertices (t, &v1, &v2, &v3);
+  gts_hmesh_add_face (m,
+		      GPOINTER_TO_UINT (GTS_OBJECT (v1)->reserved),
+		      GPOINTER_TO_UINT (GTS_OBJECT (v2)->reserved),
+		      GPOINTER_TO_UINT (GTS_OBJECT (v3)->reserved));
+}
+
+/**
+ * gts_hmesh_new_from_surface:
+ * @s: a #GtsSurface.
+ *
+ * Builds the half-edge representation of @s. The faces of @s are
+ * oriented as given by gts_triangle_vertices() and the edges of @s
+ * shared by two consistently oriented faces become pairs of twin
+ * half-edges.
+ *
+ * The reserved field of the vertices of @s is used and reset to %NULL.
+ *
+ * Returns: a new #GtsHMesh.
+ */
+GtsHMesh * gts_hmesh_new_from_surface (GtsSurface * s)
+{
+  GtsHMesh * m;
+
+  g_return_val_if_fail (s != NULL, NULL);
+
+  m = gts_hmesh_new ();
+  gts_hmesh_reserve (m, gts_surface_vertex_number (s),
+		     gts_surface_face_number (s));
+  gts_surface_foreach_vertex (s, (GtsFunc) hmesh_add_vertex, m);
+  gts_surface_foreach_face (s, (GtsFunc) hmesh_add_face, m);
+  gts_surface_foreach_vertex (s, (GtsFunc) gts_object_reset_reserved, NULL);
+  gts_hmesh_link_twins (m);
+
+  return m;
+}
+
+/**
+ * gts_hmesh_to_surface:
+ * @m: a #GtsHMesh.
+ * @s: a #GtsSurface.
+ *
+ * Adds the faces of @m to @s, creating new vertices, edges and faces
+ * of the classes of @s. Each pair of twin half-edges becomes a single
+ * edge shared by two faces, each boundary half-edge an edge of its
+ * face only. Vertices of @m not used by any face are ignored.
+ */
+void gts_hmesh_to_surface (GtsHMesh * m, GtsSurface * s)
+{
+  GtsVertex ** vertices;
+  GtsEdge ** edges;
+  guint32 i;
+
+  g_return_if_fail (m != NULL);
+  g_return_if_fail (s != NULL);
+
+  if (s->arena)
+    gts_arena_push (s->arena);
+  gts_surface_reserve (s, gts_surface_face_number (s) +
+		       gts_hmesh_face_number (m));
+
+  vertices = g_malloc (MAX (m->nv, 1)*sizeof (GtsVertex *));
+  for (i = 0; i < m->nv; i++)
+    vertices[i] = m->vhalf[i] == NONE ? NULL :
+      gts_vertex_new (s->vertex_class, m->x[i], m->y[i], m->z[i]);
+
+  edges = g_malloc0 (MAX (m->nh, 1)*sizeof (GtsEdge *));
+  for (i = 0; i < m->nh; i++)
+    if (m->face[i] != NONE && edges[i] == NULL) {
+      edges[i] = gts_edge_new (s->edge_class,
+			       vertices[m->vertex[i]],
+			       vertices[gts_hmesh_target (m, i)]);
+      if (m->twin[i] != NONE)
+	edges[m->twin[i]] = edges[i];
+    }
+
+  for (i = 0; i < m->nf; i++) {
+    guint32 h = m->fhalf[i];
+
+    if (h != NONE)
+      gts_surface_add_face (s,
+			    gts_face_new (s->face_class,
+					  edges[h],
+					  edges[m->next[h]],
+					  edges[gts_hmesh_prev (m, h)]));
+  }
+
+  g_free (edges);
+  g_free (vertices);
+
+  if (s->arena)
+    gts_arena_pop (s->arena);
+}
+
+/**
+ * gts_hmesh_vertex_next_outgoing:
+ * @m: a #GtsHMesh.
+ * @v: a vertex of @m.
+ * @h: a half-edge leaving @v.
+ *
+ * Used by GTS_HMESH_FOREACH_OUTGOING().
+ *
+ * Returns: the half-edge leaving @v after @h, turning around @v in
+ * the direction of the faces, or %GTS_HMESH_NONE if all the half-edges
+ * leaving @v have been visited starting from its outgoing half-edge.
+ */
+guint32 gts_hmesh_vertex_next_outgoing (GtsHMesh * m, guint32 v, guint32 h)
+{
+  h = m->twin[gts_hmesh_prev (m, h)];
+  return h == m->vhalf[v] ? NONE : h;
+}
+
+/**
+ * gts_hmesh_vertex_valence:
+ * @m: a #GtsHMesh.
+ * @v: a vertex of @m.
+ *
+ * Returns: the number of vertices of @m joined to @v by an edge.
+ */
+guint gts_hmesh_vertex_valence (GtsHMesh * m, guint32 v)
+{
+  guint32 h, last = NONE;
+  guint n = 0;
+
+  g_return_val_if_fail (m != NULL, 0);
+  g_return_val_if_fail (v < m->nv, 0);
+
+  GTS_HMESH_FOREACH_OUTGOING (m, v, h) {
+    last = h;
+    n++;
+  }
+  /* the last edge of a boundary vertex has no half-edge leaving it */
+  if (last != NONE && m->twin[gts_hmesh_prev (m, last)] == NONE)
+    n++;
+  return n;
+}
+
+/**
+ * gts_hmesh_vertex_is_boundary:
+ * @m: a #GtsHMesh.
+ * @v: a vertex of @m.
+ *
+ * Returns: %TRUE if @v is used by a boundary half-edge of @m, %FALSE
+ * otherwise.
+ */
+gboolean gts_hmesh_vertex_is_boundary (GtsHMesh * m, guint32 v)
+{
+  g_return_val_if_fail (m != NULL, FALSE);
+  g_return_val_if_fail (v < m->nv, FALSE);
+
+  return m->vhalf[v] != NONE && m->twin[m->vhalf[v]] == NONE;
+}
+
+/**
+ * gts_hmesh_find_halfedge:
+ * @m: a #GtsHMesh.
+ * @v1: a vertex of @m.
+ * @v2: a vertex of @m.
+ *
+ * Returns: the half-edge of @m going from @v1 to @v2 or
+ * %GTS_HMESH_NONE if there is none.
+ */
+guint32 gts_hmesh_find_halfedge (GtsHMesh * m, guint32 v1, guint32 v2)
+{
+  guint32 h;
+
+  g_return_val_if_fail (m != NULL, NONE);
+  g_return_val_if_fail (v1 < m->nv, NONE);
+
+  GTS_HMESH_FOREACH_OUTGOING (m, v1, h)
+    if (gts_hmesh_target (m, h) == v2)
+      return h;
+  return NONE;
+}
+
+/**
+ * gts_hmesh_face_vertices:
+ * @m: a #GtsHMesh.
+ * @f: a face of @m.
+ * @v1: a pointer on a vertex index.
+ * @v2: a pointer on a vertex index.
+ * @v3: a pointer on a vertex index.
+ *
+ * Fills @v1, @v2 and @v3 with the vertices of @f, in the direction of
+ * its half-edges.
+ */
+void gts_hmesh_face_vertices (GtsHMesh * m, guint32 f,
+			      guint32 * v1, guint32 * v2, guint32 * v3)
+{
+  guint32 h;
+
+  g_return_if_fail (m != NULL);
+  g_return_if_fail (f < m->nf && m->fhalf[f] != NONE);
+  g_return_if_fail (v1 != NULL && v2 != NULL && v3 != NULL);
+
+  h = m->fhalf[f];
+  *v1 = m->vertex[h];
+  h = m->next[h];
+  *v2 = m->vertex[h];
+  *v3 = m->vertex[m->next[h]];
+}
+
+/**
+ * gts_hmesh_vertex_number:
+ * @m: a #GtsHMesh.
+ *
+ * Returns: the number of vertices of @m, not counting the vertices
+ * removed by gts_hmesh_collapse_edge().
+ */
+guint gts_hmesh_vertex_number (GtsHMesh * m)
+{
+  g_return_val_if_fail (m != NULL, 0);
+
+  return m->nv - m->nv_removed;
+}
+
+/**
+ * gts_hmesh_edge_number:
+ * @m: a #GtsHMesh.
+ *
+ * Returns: the number of edges of @m, counting each pair of twin
+ * half-edges once.
+ */
+guint gts_hmesh_edge_number (GtsHMesh * m)
+{
+  guint32 h;
+  guint n = 0;
+
+  g_return_val_if_fail (m != NULL, 0);
+
+  for (h = 0; h < m->nh; h++)
+    if (m->face[h] != NONE && (m->twin[h] == NONE || h < m->twin[h]))
+      n++;
+  return n;
+}
+
+/**
+ * gts_hmesh_face_number:
+ * @m: a #GtsHMesh.
+ *
+ * Returns: the number of faces of @m.
+ */
+guint gts_hmesh_face_number (GtsHMesh * m)
+{
+  g_return_val_if_fail (m != NULL, 0);
+
+  return m->nf - m->nf_removed;
+}
+
+/**
+ * gts_hmesh_split_edge:
+ * @m: a #GtsHMesh.
+ * @h: a half-edge of @m.
+ * @x: the x-coordinate of the new vertex.
+ * @y: the y-coordinate of the new vertex.
+ * @z: the z-coordinate of the new vertex.
+ *
+ * Inserts a new vertex in the middle of the edge of @h, splitting the
+ * face of @h, and of its twin if any, in two. This is the half-edge
+ * counterpart of the edge splits of gts_surface_refine(): @h keeps
+ * its origin and ends at the new vertex.
+ *
+ * Returns: the index of the new vertex.
+ */
+guint32 gts_hmesh_split_edge (GtsHMesh * m, guint32 h,
+			      gdouble x, gdouble y, gdouble z)
+{
+  guint32 hn, hp, t, c, w, f, f1, x1, y0, y2;
+
+  g_return_val_if_fail (m != NULL, NONE);
+  g_return_val_if_fail (h < m->nh && m->face[h] != NONE, NONE);
+
+  hn = m->next[h];
+  hp = m->next[hn];
+  t = m->twin[h];
+  c = m->vertex[hp];
+  f = m->face[h];
+  w = gts_hmesh_add_vertex (m, x, y, z);
+  f1 = faces_append (m, t == NONE ? 1 : 2);
+  x1 = 3*f1; y0 = x1 + 1; y2 = x1 + 2;
+
+  /* f becomes (a, w, c) */
+  m->vertex[x1] = w; m->face[x1] = f; m->next[x1] = hp;
+  m->next[h] = x1;
+  m->fhalf[f] = h;
+
+  /* f1 is (w, b, c) */
+  m->vertex[y0] = w; m->face[y0] = f1; m->next[y0] = hn;
+  m->face[hn] = f1; m->next[hn] = y2;
+  m->vertex[y2] = c; m->face[y2] = f1; m->next[y2] = y0;
+  m->fhalf[f1] = y0;
+
+  m->twin[x1] = y2; m->twin[y2] = x1;
+  m->twin[y0] = NONE;
+
+  if (t != NONE) {
+    guint32 tn = m->next[t], tp = m->next[tn], d = m->vertex[tp];
+    guint32 g = m->face[t], g1 = f1 + 1;
+    guint32 u1 = 3*g1, z0 = u1 + 1, z2 = u1 + 2;
+
+    /* g becomes (b, w, d) */
+    m->vertex[u1] = w; m->face[u1] = g; m->next[u1] = tp;
+    m->next[t] = u1;
+    m->fhalf[g] = t;
+
+    /* g1 is (w, a, d) */
+    m->vertex[z0] = w; m->face[z0] = g1; m->next[z0] = tn;
+    m->face[tn] = g1; m->next[tn] = z2;
+    m->vertex[z2] = d; m->face[z2] = g1; m->next[z2] = z0;
+    m->fhalf[g1] = z0;
+
+    m->twin[u1] = z2; m->twin[z2] = u1;
+    m->twin[h] = z0; m->twin[z0] = h;
+    m->twin[t] = y0; m->twin[y0] = t;
+  }
+  m->vhalf[w] = y0;
+
+  return w;
+}
+
+/**
+ * gts_hmesh_collapse_is_valid:
+ * @m: a #GtsHMesh.
+ * @h: a half-edge of @m.
+ *
+ * Checks that collapsing the origin of @h onto its target with
+ * gts_hmesh_collapse_edge() keeps @m a manifold, in the same way as
+ * gts_edge_collapse_is_valid(): the vertices of @h must not share
+ * neighbors other than the opposite vertices of the faces of @h and
+ * its twin, an interior edge must not join two boundary vertices and
+ * the faces removed must not leave a vertex or a face dangling.
+ *
+ * Returns: %TRUE if @h can be collapsed, %FALSE otherwise.
+ */
+gboolean gts_hmesh_collapse_is_valid (GtsHMesh * m, guint32 h)
+{
+  guint32 hn, hp, t, a, b, c, d = NONE, i;
+
+  g_return_val_if_fail (m != NULL, FALSE);
+  g_return_val_if_fail (h < m->nh && m->face[h] != NONE, FALSE);
+
+  hn = m->next[h];
+  hp = m->next[hn];
+  t = m->twin[h];
+  a = m->vertex[h];
+  b = m->vertex[hn];
+  c = m->vertex[hp];
+
+  if (m->twin[hn] == NONE && m->twin[hp] == NONE)
+    return FALSE;
+  if (!gts_hmesh_vertex_is_boundary (m, c) &&
+      gts_hmesh_vertex_valence (m, c) <= 3)
+    return FALSE;
+  if (t != NONE) {
+    guint32 tn = m->next[t], tp = m->next[tn];
+
+    d = m->vertex[tp];
+    if (m->twin[tn] == NONE && m->twin[tp] == NONE)
+      return FALSE;
+    if (!gts_hmesh_vertex_is_boundary (m, d) &&
+	gts_hmesh_vertex_valence (m, d) <= 3)
+      return FALSE;
+    if (gts_hmesh_vertex_is_boundary (m, a) &&
+	gts_hmesh_vertex_is_boundary (m, b))
+      return FALSE;
+  }
+
+  GTS_HMESH_FOREACH_OUTGOING (m, a, i) {
+    guint32 prev = gts_hmesh_prev (m, i), u = gts_hmesh_target (m, i);
+
+    if (u != b && u != c && u != d && vertex_has_neighbor (m, b, u))
+      return FALSE;
+    if (m->twin[prev] == NONE) {
+      u = m->vertex[prev];
+      if (u != b && u != c && u != d && vertex_has_neighbor (m, b, u))
+	return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/**
+ * gts_hmesh_collapse_edge:
+ * @m: a #GtsHMesh.
+ * @h: a half-edge of @m.
+ *
+ * Collapses the origin of @h onto its target, removing the face of
+ * @h, and of its twin if any, and the origin of @h from @m. The
+ * target keeps its position, which can be moved afterwards.
+ *
+ * The collapse must be valid as checked by
+ * gts_hmesh_collapse_is_valid(). The removed elements keep their
+ * indices, marked with %GTS_HMESH_NONE, until gts_hmesh_compact() is
+ * called.
+ *
+ * Returns: the target of @h.
+ */
+guint32 gts_hmesh_collapse_edge (GtsHMesh * m, guint32 h)
+{
+  guint32 hn, hp, t, a, b, c, thn, thp, i;
+
+  g_return_val_if_fail (m != NULL, NONE);
+  g_return_val_if_fail (h < m->nh && m->face[h] != NONE, NONE);
+
+  hn = m->next[h];
+  hp = m->next[hn];
+  t = m->twin[h];
+  a = m->vertex[h];
+  b = m->vertex[hn];
+  c = m->vertex[hp];
+  thn = m->twin[hn];
+  thp = m->twin[hp];
+
+  GTS_HMESH_FOREACH_OUTGOING (m, a, i)
+    m->vertex[i] = b;
+
+  if (thp != NONE)
+    m->twin[thp] = thn;
+  if (thn != NONE)
+    m->twin[thn] = thp;
+  face_remove (m, m->face[h]);
+
+  if (t != NONE) {
+    guint32 tn = m->next[t], tp = m->next[tn], d = m->vertex[tp];
+    guint32 ttn = m->twin[tn], ttp = m->twin[tp];
+
+    if (ttn != NONE)
+      m->twin[ttn] = ttp;
+    if (ttp != NONE)
+      m->twin[ttp] = ttn;
+    face_remove (m, m->face[t]);
+    vertex_set_halfedge (m, d, ttn != NONE ? ttn : m->next[ttp]);
+  }
+
+  m->vhalf[a] = NONE;
+  m->nv_removed++;
+  vertex_set_halfedge (m, b, thp != NONE ? thp : m->next[thn]);
+  vertex_set_halfedge (m, c, thn != NONE ? thn : m->next[thp]);
+
+  return b;
+}
+
+/**
+ * gts_hmesh_flip_is_valid:
+ * @m: a #GtsHMesh.
+ * @h: a half-edge of @m.
+ *
+ * Returns: %TRUE if the edge of @h is an interior edge which can be
+ * flipped with gts_hmesh_flip_edge() without creating a duplicate
+ * edge or an interior vertex of valence two, %FALSE otherwise.
+ */
+gboolean gts_hmesh_flip_is_valid (GtsHMesh * m, guint32 h)
+{
+  guint32 t, a, b, c, d;
+
+  g_return_val_if_fail (m != NULL, FALSE);
+  g_return_val_if_fail (h < m->nh && m->face[h] != NONE, FALSE);
+
+  t = m->twin[h];
+  if (t == NONE)
+    return FALSE;
+  a = m->vertex[h];
+  b = m->vertex[t];
+  c = m->vertex[gts_hmesh_prev (m, h)];
+  d = m->vertex[gts_hmesh_prev (m, t)];
+  if (c == d || vertex_has_neighbor (m, c, d))
+    return FALSE;
+  if (!gts_hmesh_vertex_is_boundary (m, a) &&
+      gts_hmesh_vertex_valence (m, a) <= 3)
+    return FALSE;
+  if (!gts_hmesh_vertex_is_boundary (m, b) &&
+      gts_hmesh_vertex_valence (m, b) <= 3)
+    return FALSE;
+  return TRUE;
+}
+
+/**
+ * gts_hmesh_flip_edge:
+ * @m: a #GtsHMesh.
+ * @h: a half-edge of @m.
+ *
+ * Replaces the edge of @h, shared by the faces (a, b, c) and (b, a,
+ * d), with the edge joining c and d, the faces becoming (a, d, c) and
+ * (b, c, d). @h then goes from d to c and its twin from c to d.
+ *
+ * The flip must be valid as checked by gts_hmesh_flip_is_valid().
+ */
+void gts_hmesh_flip_edge (GtsHMesh * m, guint32 h)
+{
+  guint32 hn, hp, t, tn, tp, a, b, f, g;
+
+  g_return_if_fail (m != NULL);
+  g_return_if_fail (h < m->nh && m->face[h] != NONE);
+  g_return_if_fail (m->twin[h] != NONE);
+
+  hn = m->next[h];
+  hp = m->next[hn];
+  t = m->twin[h];
+  tn = m->next[t];
+  tp = m->next[tn];
+  a = m->vertex[h];
+  b = m->vertex[t];
+  f = m->face[h];
+  g = m->face[t];
+
+  m->vertex[h] = m->vertex[tp];
+  m->vertex[t] = m->vertex[hp];
+  m->next[tn] = h; m->next[h] = hp; m->next[hp] = tn;
+  m->next[hn] = t; m->next[t] = tp; m->next[tp] = hn;
+  m->face[tn] = f;
+  m->face[hn] = g;
+  m->fhalf[f] = h;
+  m->fhalf[g] = t;
+
+  if (m->vhalf[a] == h)
+    m->vhalf[a] = tn;
+  if (m->vhalf[b] == t)
+    m->vhalf[b] = hn;
+}
+
+/**
+ * gts_hmesh_compact:
+ * @m: a #GtsHMesh.
+ *
+ * Renumbers the vertices, half-edges and faces of @m so that the
+ * elements removed by gts_hmesh_collapse_edge(), and the vertices not
+ * used by any face, do not take any space in its arrays. The relative
+ * order of the remaining elements is preserved.
+ */
+void gts_hmesh_compact (GtsHMesh * m)
+{
+  guint32 * vmap, * hmap, * fmap, i;
+  guint nv = 0, nh = 0, nf = 0;
+
+  g_return_if_fail (m != NULL);
+
+  vmap = g_malloc (MAX (m->nv, 1)*sizeof (guint32));
+  hmap = g_malloc (MAX (m->nh, 1)*sizeof (guint32));
+  fmap = g_malloc (MAX (m->nf, 1)*sizeof (guint32));
+  for (i = 0; i < m->nv; i++)
+    vmap[i] = m->vhalf[i] == NONE ? NONE : nv++;
+  for (i = 0; i < m->nh; i++)
+    hmap[i] = m->face[i] == NONE ? NONE : nh++;
+  for (i = 0; i < m->nf; i++)
+    fmap[i] = m->fhalf[i] == NONE ? NONE : nf++;
+
+  /* the new index of an element is never larger than the old one */
+  for (i = 0; i < m->nv; i++)
+    if (vmap[i] != NONE) {
+      guint32 j = vmap[i];
+
+      m->x[j] = m->x[i];
+      m->y[j] = m->y[i];
+      m->z[j] = m->z[i];
+      m->vhalf[j] = hmap[m->vhalf[i]];
+    }
+  for (i = 0; i < m->nh; i++)
+    if (hmap[i] != NONE) {
+      guint32 j = hmap[i];
+
+      m->next[j] = hmap[m->next[i]];
+      m->twin[j] = m->twin[i] == NONE ? NONE : hmap[m->twin[i]];
+      m->vertex[j] = vmap[m->vertex[i]];
+      m->face[j] = fmap[m->face[i]];
+    }
+  for (i = 0; i < m->nf; i++)
+    if (fmap[i] != NONE)
+      m->fhalf[fmap[i]] = hmap[m->fhalf[i]];
+
+  m->nv = nv;
+  m->nh = nh;
+  m->nf = nf;
+  m->nv_removed = m->nf_removed = 0;
+
+  g_free (vmap);
+  g_free (hmap);
+  g_free (fmap);
+}
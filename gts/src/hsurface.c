@@ -40,8 +40,9 @@ static void hsplit_init (GtsHSplit * hsplit)
 GtsHSplitClass * gts_hsplit_class (void)
 {
   static GtsHSplitClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo hsplit_info = {
       "GtsHSplit",
       sizeof (GtsHSplit),
@@ -53,6 +54,7 @@ GtsHSplitClass * gts_hsplit_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_split_class ()), 
 				  &hsplit_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -188,8 +190,9 @@ static void hsurface_init (GtsHSurface * hsurface)
 GtsHSurfaceClass * gts_hsurface_class (void)
 {
   static GtsHSurfaceClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo hsurface_info = {
       "GtsHSurface",
       sizeof (GtsHSurface),
@@ -201,6 +204,7 @@ GtsHSurfaceClass * gts_hsurface_class (void)
     };
     klass = gts_object_class_new (gts_object_class (), 
 				  &hsurface_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -48,13 +48,39 @@ static int compare_z (const void * p1, const void * p2) {
   return -1;
 }
 
+/* Moves the points of @p so that p[k] is the one which would be at
+   position k if @p were sorted along @axis, those before being smaller
+   or equal and those after larger or equal (Wirth's selection) */
+static void points_select (gpointer * p, gint n, gint k, guint axis)
+{
+  gint l = 0, r = n - 1;
+
+  while (l < r) {
+    gdouble pivot = (&GTS_POINT (p[k])->x)[axis];
+    gint i = l, j = r;
+
+    do {
+      while ((&GTS_POINT (p[i])->x)[axis] < pivot) i++;
+      while (pivot < (&GTS_POINT (p[j])->x)[axis]) j--;
+      if (i <= j) {
+	gpointer tmp = p[i];
+	p[i++] = p[j];
+	p[j--] = tmp;
+      }
+    } while (i <= j);
+    if (j < k) l = i;
+    if (k < i) r = j;
+  }
+}
+
 /**
  * gts_kdtree_new:
  * @points: an array of #GtsPoint.
  * @compare: always %NULL.
  *
  * Note that the order of the points in array @points is modified by this
- * function.
+ * function. gts_kd_flat_new() builds a #GtsKdTree instead, which does
+ * not modify @points and is faster to build and to query.
  * 
  * Returns: a new 3D tree for @points.
  */
@@ -69,13 +95,14 @@ GNode * gts_kdtree_new (GPtrArray * points,
   g_return_val_if_fail (points != NULL, NULL);
   g_return_val_if_fail (points->len > 0, NULL);
 
-  /* sort the points */
+  /* select the median point */
+  middle = (points->len - 1)/2;
   if (compare == compare_x) compare = compare_y;
   else if (compare == compare_y) compare = compare_z;
   else compare = compare_x;
-  qsort (points->pdata, points->len, sizeof (gpointer), compare);
+  points_select (points->pdata, points->len, middle,
+		 compare == compare_x ? 0 : compare == compare_y ? 1 : 2);
 
-  middle = (points->len - 1)/2;
   point = points->pdata[middle];
   node = g_node_new (point);
 
@@ -150,3 +177,528 @@ GSList * gts_kdtree_range (GNode * tree_3d,
   return list;
 }
 
+
+/* Flat kd-trees */
+
+/* number of consecutive queries of a batch processed by a thread at once */
+#define QUERY_CHUNK 256
+/* number of points from which the subtrees are built in parallel */
+#define PARALLEL_BUILD_MIN 4096
+
+typedef struct {
+  GtsVector c;
+  GtsPoint * p;
+} KdItem;
+
+typedef struct {
+  guint start, end;
+} KdRange;
+
+typedef struct {
+  KdItem * items;
+  guint8 * axis;
+} KdBuild;
+
+/* Same as points_select() for items */
+static void items_select (KdItem * a, gint n, gint k, guint axis)
+{
+  gint l = 0, r = n - 1;
+
+  while (l < r) {
+    gdouble pivot = a[k].c[axis];
+    gint i = l, j = r;
+
+    do {
+      while (a[i].c[axis] < pivot) i++;
+      while (pivot < a[j].c[axis]) j--;
+      if (i <= j) {
+	KdItem tmp = a[i];
+	a[i++] = a[j];
+	a[j--] = tmp;
+      }
+    } while (i <= j);
+    if (j < k) l = i;
+    if (k < i) r = j;
+  }
+}
+
+/* The node of range [start, end) is its middle point m, splitting the
+   range along axis[m] into [start, m) and [m + 1, end). If @tasks is
+   not %NULL, ranges smaller than @task_size are added to @tasks rather
+   than being built. */
+static void kd_build (KdBuild * b, guint start, guint end,
+		      guint task_size, GArray * tasks)
+{
+  while (end - start > 1) {
+    gdouble min[3], max[3];
+    guint i, m = start + (end - start)/2, axis = 0;
+
+    if (tasks && end - start <= task_size) {
+      KdRange r;
+
+      r.start = start;
+      r.end = end;
+      g_array_append_val (tasks, r);
+      return;
+    }
+
+    /* split along the largest extent */
+    for (i = 0; i < 3; i++)
+      min[i] = max[i] = b->items[start].c[i];
+    for (i = start + 1; i < end; i++) {
+      gdouble * c = b->items[i].c;
+
+      min[0] = MIN (min[0], c[0]); max[0] = MAX (max[0], c[0]);
+      min[1] = MIN (min[1], c[1]); max[1] = MAX (max[1], c[1]);
+      min[2] = MIN (min[2], c[2]); max[2] = MAX (max[2], c[2]);
+    }
+    if (max[1] - min[1] > max[axis] - min[axis]) axis = 1;
+    if (max[2] - min[2] > max[axis] - min[axis]) axis = 2;
+
+    items_select (&b->items[start], end - start, m - start, axis);
+    b->axis[m] = axis;
+    kd_build (b, start, m, task_size, tasks);
+    start = m + 1;
+  }
+  if (end - start == 1)
+    b->axis[start] = 0;
+}
+
+static void kd_build_task (KdRange * r, KdBuild * b)
+{
+  kd_build (b, r->start, r->end, 0, NULL);
+}
+
+/* Calls @func on chunks of QUERY_CHUNK queries covering [0, n) using
+   @nthreads threads from a pool, or directly from the calling thread */
+static void kd_flat_foreach_chunk (GFunc func, gpointer data,
+				   guint n, guint nthreads)
+{
+  guint i, nchunks = (n + QUERY_CHUNK - 1)/QUERY_CHUNK;
+
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+  if (nthreads > 1 && nchunks > 1) {
+    GThreadPool * pool = g_thread_pool_new (func, data, nthreads, TRUE, NULL);
+    KdRange * chunks = g_malloc (nchunks*sizeof (KdRange));
+
+    for (i = 0; i < nchunks; i++) {
+      chunks[i].start = i*QUERY_CHUNK;
+      chunks[i].end = MIN ((i + 1)*QUERY_CHUNK, n);
+      g_thread_pool_push (pool, &chunks[i], NULL);
+    }
+    /* waits for all the chunks to be processed */
+    g_thread_pool_free (pool, FALSE, TRUE);
+    g_free (chunks);
+  }
+  else if (n > 0) {
+    KdRange chunk;
+
+    chunk.start = 0;
+    chunk.end = n;
+    (*func) (&chunk, data);
+  }
+}
+
+/**
+ * gts_kd_flat_new:
+ * @points: an array of #GtsPoint.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Builds a balanced kd-tree for @points, stored in flat arrays. Each
+ * node is the median point, along the axis of largest extent, of the
+ * points of its subtree and its children are found implicitly from
+ * its position. The medians are found by selection, so that building
+ * the tree takes O(n log n) time. For a large number of points, the
+ * subtrees below the top levels are built by @nthreads threads.
+ *
+ * Unlike gts_kdtree_new(), the order of @points is not modified.
+ *
+ * Returns: a new #GtsKdTree.
+ */
+GtsKdTree * gts_kd_flat_new (GPtrArray * points, guint nthreads)
+{
+  GtsKdTree * tree;
+  GArray * tasks = NULL;
+  KdBuild b;
+  guint i, n;
+
+  g_return_val_if_fail (points != NULL, NULL);
+
+  n = points->len;
+  b.items = g_malloc (MAX (n, 1)*sizeof (KdItem));
+  b.axis = g_malloc (MAX (n, 1)*sizeof (guint8));
+  for (i = 0; i < n; i++) {
+    GtsPoint * p = points->pdata[i];
+
+    b.items[i].c[0] = p->x;
+    b.items[i].c[1] = p->y;
+    b.items[i].c[2] = p->z;
+    b.items[i].p = p;
+  }
+
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+  if (nthreads > 1 && n >= PARALLEL_BUILD_MIN)
+    tasks = g_array_new (FALSE, FALSE, sizeof (KdRange));
+  kd_build (&b, 0, n, tasks ? n/(4*nthreads) : 0, tasks);
+  if (tasks) {
+    GThreadPool * pool = g_thread_pool_new ((GFunc) kd_build_task, &b,
+					    nthreads, TRUE, NULL);
+
+    for (i = 0; i < tasks->len; i++)
+      g_thread_pool_push (pool, &g_array_index (tasks, KdRange, i), NULL);
+    g_thread_pool_free (pool, FALSE, TRUE);
+    g_array_free (tasks, TRUE);
+  }
+
+  tree = g_malloc (sizeof (GtsKdTree));
+  tree->n = n;
+  tree->coords = g_malloc (MAX (n, 1)*sizeof (GtsVector));
+  tree->points = g_malloc (MAX (n, 1)*sizeof (GtsPoint *));
+  tree->axis = b.axis;
+  for (i = 0; i < n; i++) {
+    tree->coords[i][0] = b.items[i].c[0];
+    tree->coords[i][1] = b.items[i].c[1];
+    tree->coords[i][2] = b.items[i].c[2];
+    tree->points[i] = b.items[i].p;
+  }
+  g_free (b.items);
+
+  return tree;
+}
+
+/**
+ * gts_kd_flat_destroy:
+ * @tree: a #GtsKdTree.
+ *
+ * Frees all the memory allocated for @tree. The points are not
+ * destroyed.
+ */
+void gts_kd_flat_destroy (GtsKdTree * tree)
+{
+  g_return_if_fail (tree != NULL);
+
+  g_free (tree->coords);
+  g_free (tree->points);
+  g_free (tree->axis);
+  g_free (tree);
+}
+
+static guint kd_flat_range (GtsKdTree * tree, guint start, guint end,
+			    const gdouble * min, const gdouble * max,
+			    GtsPoint ** points, guint size, guint n)
+{
+  while (start < end) {
+    guint m = start + (end - start)/2, axis = tree->axis[m];
+    gdouble * c = tree->coords[m];
+
+    if (c[0] >= min[0] && c[0] <= max[0] &&
+	c[1] >= min[1] && c[1] <= max[1] &&
+	c[2] >= min[2] && c[2] <= max[2]) {
+      if (n < size)
+	points[n] = tree->points[m];
+      n++;
+    }
+    if (min[axis] <= c[axis]) {
+      if (max[axis] >= c[axis])
+	n = kd_flat_range (tree, start, m, min, max, points, size, n);
+      else {
+	end = m;
+	continue;
+      }
+    }
+    start = m + 1;
+  }
+  return n;
+}
+
+/**
+ * gts_kd_flat_range:
+ * @tree: a #GtsKdTree.
+ * @bbox: a #GtsBBox.
+ * @points: an array of at least @size #GtsPoint or %NULL if @size is 0.
+ * @size: the size of @points.
+ *
+ * Sets the first elements of @points to the points of @tree which are
+ * inside @bbox (boundary included), in no particular order. Only the
+ * first @size such points are stored.
+ *
+ * Returns: the number of points of @tree inside @bbox, which can be
+ * larger than @size.
+ */
+guint gts_kd_flat_range (GtsKdTree * tree,
+			 GtsBBox * bbox,
+			 GtsPoint ** points,
+			 guint size)
+{
+  gdouble min[3], max[3];
+
+  g_return_val_if_fail (tree != NULL, 0);
+  g_return_val_if_fail (bbox != NULL, 0);
+  g_return_val_if_fail (size == 0 || points != NULL, 0);
+
+  min[0] = bbox->x1; min[1] = bbox->y1; min[2] = bbox->z1;
+  max[0] = bbox->x2; max[1] = bbox->y2; max[2] = bbox->z2;
+  return kd_flat_range (tree, 0, tree->n, min, max, points, size, 0);
+}
+
+static guint kd_flat_radius (GtsKdTree * tree, guint start, guint end,
+			     const gdouble * p, gdouble r2,
+			     GtsPoint ** points, guint size, guint n)
+{
+  while (start < end) {
+    guint m = start + (end - start)/2, axis = tree->axis[m];
+    gdouble * c = tree->coords[m];
+    gdouble dx = c[0] - p[0], dy = c[1] - p[1], dz = c[2] - p[2];
+    gdouble d = p[axis] - c[axis];
+
+    if (dx*dx + dy*dy + dz*dz <= r2) {
+      if (n < size)
+	points[n] = tree->points[m];
+      n++;
+    }
+    if (d*d <= r2) { /* both sides */
+      n = kd_flat_radius (tree, start, m, p, r2, points, size, n);
+      start = m + 1;
+    }
+    else if (d < 0.)
+      end = m;
+    else
+      start = m + 1;
+  }
+  return n;
+}
+
+/**
+ * gts_kd_flat_radius:
+ * @tree: a #GtsKdTree.
+ * @p: a #GtsPoint.
+ * @radius: the radius of the search.
+ * @points: an array of at least @size #GtsPoint or %NULL if @size is 0.
+ * @size: the size of @points.
+ *
+ * Sets the first elements of @points to the points of @tree whose
+ * distance to @p is smaller than or equal to @radius, in no particular
+ * order. Only the first @size such points are stored.
+ *
+ * Returns: the number of points of @tree within @radius of @p, which
+ * can be larger than @size.
+ */
+guint gts_kd_flat_radius (GtsKdTree * tree,
+			  GtsPoint * p,
+			  gdouble radius,
+			  GtsPoint ** points,
+			  guint size)
+{
+  gdouble q[3];
+
+  g_return_val_if_fail (tree != NULL, 0);
+  g_return_val_if_fail (p != NULL, 0);
+  g_return_val_if_fail (size == 0 || points != NULL, 0);
+
+  q[0] = p->x; q[1] = p->y; q[2] = p->z;
+  return kd_flat_radius (tree, 0, tree->n, q, radius*radius, 
+			 points, size, 0);
+}
+
+typedef struct {
+  const gdouble * p;
+  GtsPoint ** points;
+  gdouble * distance2;
+  guint k, m;
+} KdNearest;
+
+static void kd_flat_nearest (GtsKdTree * tree, guint start, guint end,
+			     KdNearest * q)
+{
+  while (start < end) {
+    guint m = start + (end - start)/2, axis = tree->axis[m];
+    gdouble * c = tree->coords[m];
+    gdouble dx = c[0] - q->p[0], dy = c[1] - q->p[1], dz = c[2] - q->p[2];
+    gdouble d2 = dx*dx + dy*dy + dz*dz, d = q->p[axis] - c[axis];
+
+    /* insertion into the k closest points found so far */
+    if (q->m < q->k || d2 < q->distance2[q->k - 1]) {
+      guint i = q->m < q->k ? q->m++ : q->k - 1;
+
+      for (; i > 0 && q->distance2[i - 1] > d2; i--) {
+	q->distance2[i] = q->distance2[i - 1];
+	q->points[i] = q->points[i - 1];
+      }
+      q->distance2[i] = d2;
+      q->points[i] = tree->points[m];
+    }
+    /* the side containing p first, then the other if it can be closer */
+    if (d < 0.) {
+      kd_flat_nearest (tree, start, m, q);
+      if (q->m == q->k && d*d >= q->distance2[q->k - 1])
+	return;
+      start = m + 1;
+    }
+    else {
+      kd_flat_nearest (tree, m + 1, end, q);
+      if (q->m == q->k && d*d >= q->distance2[q->k - 1])
+	return;
+      end = m;
+    }
+  }
+}
+
+/**
+ * gts_kd_flat_k_nearest:
+ * @tree: a #GtsKdTree.
+ * @p: a #GtsPoint.
+ * @k: the number of points to look for.
+ * @points: an array of at least @k #GtsPoint.
+ * @distance2: an array of at least @k #gdouble.
+ *
+ * Sets the first elements of @points to the @k points of @tree closest
+ * to @p, by increasing distance, and the first elements of @distance2
+ * to the squares of their distances to @p. Nothing is allocated.
+ *
+ * Returns: the number of points found, i.e. the smallest of @k and
+ * the number of points of @tree.
+ */
+guint gts_kd_flat_k_nearest (GtsKdTree * tree,
+			     GtsPoint * p,
+			     guint k,
+			     GtsPoint ** points,
+			     gdouble * distance2)
+{
+  KdNearest q;
+  gdouble c[3];
+
+  g_return_val_if_fail (tree != NULL, 0);
+  g_return_val_if_fail (p != NULL, 0);
+  g_return_val_if_fail (k == 0 || (points != NULL && distance2 != NULL), 0);
+
+  if (k == 0)
+    return 0;
+  c[0] = p->x; c[1] = p->y; c[2] = p->z;
+  q.p = c;
+  q.points = points;
+  q.distance2 = distance2;
+  q.k = k;
+  q.m = 0;
+  kd_flat_nearest (tree, 0, tree->n, &q);
+  return q.m;
+}
+
+typedef struct {
+  GtsKdTree * tree;
+  GtsVector * queries;
+  gdouble r2;
+  guint k;
+  GtsPoint ** points;
+  gdouble * distance2;
+  guint * count;
+} KdBatch;
+
+static void k_nearest_chunk (KdRange * r, KdBatch * b)
+{
+  guint i;
+
+  for (i = r->start; i < r->end; i++) {
+    KdNearest q;
+
+    q.p = b->queries[i];
+    q.points = &b->points[i*b->k];
+    q.distance2 = &b->distance2[i*b->k];
+    q.k = b->k;
+    q.m = 0;
+    kd_flat_nearest (b->tree, 0, b->tree->n, &q);
+  }
+}
+
+/**
+ * gts_kd_flat_points_k_nearest:
+ * @tree: a #GtsKdTree.
+ * @queries: an array of @n query points.
+ * @n: the number of query points.
+ * @k: the number of points to look for.
+ * @points: an array of @n*@k #GtsPoint.
+ * @distance2: an array of @n*@k #gdouble.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Calls gts_kd_flat_k_nearest() for each of @queries, @points + i*@k
+ * and @distance2 + i*@k receiving the results for @queries[i]. The
+ * queries are split between @nthreads threads sharing @tree.
+ */
+void gts_kd_flat_points_k_nearest (GtsKdTree * tree,
+				   GtsVector * queries,
+				   guint n,
+				   guint k,
+				   GtsPoint ** points,
+				   gdouble * distance2,
+				   guint nthreads)
+{
+  KdBatch b;
+
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (n == 0 || queries != NULL);
+  g_return_if_fail (n == 0 || k == 0 || 
+		    (points != NULL && distance2 != NULL));
+
+  if (k == 0)
+    return;
+  b.tree = tree;
+  b.queries = queries;
+  b.k = k;
+  b.points = points;
+  b.distance2 = distance2;
+  kd_flat_foreach_chunk ((GFunc) k_nearest_chunk, &b, n, nthreads);
+}
+
+static void radius_chunk (KdRange * r, KdBatch * b)
+{
+  guint i;
+
+  for (i = r->start; i < r->end; i++)
+    b->count[i] = kd_flat_radius (b->tree, 0, b->tree->n, b->queries[i], 
+				  b->r2, &b->points[i*b->k], b->k, 0);
+}
+
+/**
+ * gts_kd_flat_points_radius:
+ * @tree: a #GtsKdTree.
+ * @queries: an array of @n query points.
+ * @n: the number of query points.
+ * @radius: the radius of the search.
+ * @size: the maximum number of points stored for each query.
+ * @points: an array of @n*@size #GtsPoint.
+ * @count: an array of @n #guint.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Calls gts_kd_flat_radius() for each of @queries, @points + i*@size
+ * receiving the points found for @queries[i] and @count[i] their
+ * number (which can be larger than @size). The queries are split
+ * between @nthreads threads sharing @tree.
+ */
+void gts_kd_flat_points_radius (GtsKdTree * tree,
+				GtsVector * queries,
+				guint n,
+				gdouble radius,
+				guint size,
+				GtsPoint ** points,
+				guint * count,
+				guint nthreads)
+{
+  KdBatch b;
+
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (n == 0 || queries != NULL);
+  g_return_if_fail (n == 0 || size == 0 || points != NULL);
+  g_return_if_fail (n == 0 || count != NULL);
+
+  b.tree = tree;
+  b.queries = queries;
+  b.r2 = radius*radius;
+  b.k = size;
+  b.points = points;
+  b.count = count;
+  kd_flat_foreach_chunk ((GFunc) radius_chunk, &b, n, nthreads);
+}
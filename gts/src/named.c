@@ -59,8 +59,9 @@ static void nvertex_init (GtsNVertex * nvertex)
 GtsNVertexClass * gts_nvertex_class (void)
 {
   static GtsNVertexClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo nvertex_info = {
       "GtsNVertex",
       sizeof (GtsNVertex),
@@ -72,6 +73,7 @@ GtsNVertexClass * gts_nvertex_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_vertex_class ()), 
 				  &nvertex_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -114,8 +116,9 @@ static void nedge_init (GtsNEdge * nedge)
 GtsNEdgeClass * gts_nedge_class (void)
 {
   static GtsNEdgeClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo nedge_info = {
       "GtsNEdge",
       sizeof (GtsNEdge),
@@ -127,6 +130,7 @@ GtsNEdgeClass * gts_nedge_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_edge_class ()), 
 				  &nedge_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -169,8 +173,9 @@ static void nface_init (GtsNFace * nface)
 GtsNFaceClass * gts_nface_class (void)
 {
   static GtsNFaceClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo nface_info = {
       "GtsNFace",
       sizeof (GtsNFace),
@@ -182,6 +187,7 @@ GtsNFaceClass * gts_nface_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_face_class ()), 
 				  &nface_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -21,7 +21,164 @@
 #include "gts.h"
 #include "gts-private.h"
 
+/* classes may be created concurrently from several threads */
 static GHashTable * class_table = NULL;
+static GMutex class_table_mutex;
+
+/* Objects of the classes using a slab are allocated from the arena on top
+   of the stack of the calling thread, if any */
+#define ARENA_STACK_SIZE 32
+
+static GTS_THREAD_LOCAL GtsArena * arena_stack[ARENA_STACK_SIZE];
+static GTS_THREAD_LOCAL guint arena_stack_top = 0;
+
+static GtsArena * current_arena (void)
+{
+  return arena_stack_top ? arena_stack[arena_stack_top - 1] : NULL;
+}
+
+#define ALLOC_ALIGN 16
+#define ALLOC_SIZE(size) (((size) + ALLOC_ALIGN - 1) & ~(gsize) (ALLOC_ALIGN - 1))
+#define SLAB_CHUNK_SIZE  (64*1024)
+#define ARENA_CHUNK_SIZE (256*1024)
+
+struct _GtsSlab {
+  GMutex mutex;
+  gsize size;
+  gpointer free_list;
+  GSList * chunks;
+  guchar * next, * end;
+};
+
+typedef struct _ArenaChunk ArenaChunk;
+
+struct _ArenaChunk {
+  ArenaChunk * next;
+  guchar * used, * end;
+};
+
+/* Each object of an arena is preceded by its size, so that the arena can
+   be walked */
+#define ARENA_CHUNK_DATA(c) ((guchar *) (c) + ALLOC_SIZE (sizeof (ArenaChunk)))
+
+struct _GtsArena {
+  GMutex mutex;
+  ArenaChunk * chunks;
+};
+
+/* chunks of destroyed arenas, kept for the next ones */
+static ArenaChunk * free_chunks = NULL;
+static GMutex free_chunks_mutex;
+
+static GtsSlab * slab_new (gsize size)
+{
+  GtsSlab * slab = g_malloc0 (sizeof (GtsSlab));
+
+  g_mutex_init (&slab->mutex);
+  /* room for the free list link */
+  slab->size = ALLOC_SIZE (MAX (size, sizeof (gpointer)));
+  return slab;
+}
+
+static gpointer slab_alloc (GtsSlab * slab)
+{
+  gpointer p;
+
+  g_mutex_lock (&slab->mutex);
+  if (slab->free_list) {
+    p = slab->free_list;
+    slab->free_list = *((gpointer *) p);
+  }
+  else {
+    if (slab->next + slab->size > slab->end) {
+      gsize n = MAX (SLAB_CHUNK_SIZE/slab->size, 16);
+
+      slab->next = g_malloc (n*slab->size);
+      slab->end = slab->next + n*slab->size;
+      slab->chunks = g_slist_prepend (slab->chunks, slab->next);
+    }
+    p = slab->next;
+    slab->next += slab->size;
+  }
+  g_mutex_unlock (&slab->mutex);
+
+  memset (p, 0, slab->size);
+  return p;
+}
+
+static void slab_free (GtsSlab * slab, gpointer p)
+{
+  g_mutex_lock (&slab->mutex);
+  *((gpointer *) p) = slab->free_list;
+  slab->free_list = p;
+  g_mutex_unlock (&slab->mutex);
+}
+
+static void slab_destroy (GtsSlab * slab)
+{
+  GSList * i = slab->chunks;
+
+  while (i) {
+    g_free (i->data);
+    i = i->next;
+  }
+  g_slist_free (slab->chunks);
+  g_mutex_clear (&slab->mutex);
+  g_free (slab);
+}
+
+static gpointer arena_alloc (GtsArena * arena, gsize size)
+{
+  gsize needed = ALLOC_ALIGN + ALLOC_SIZE (size);
+  ArenaChunk * c;
+  guchar * p;
+
+  g_mutex_lock (&arena->mutex);
+  c = arena->chunks;
+  if (c == NULL || c->used + needed > c->end) {
+    gsize csize = MAX (ARENA_CHUNK_SIZE, 
+		       ALLOC_SIZE (sizeof (ArenaChunk)) + needed);
+
+    c = NULL;
+    if (csize == ARENA_CHUNK_SIZE) {
+      g_mutex_lock (&free_chunks_mutex);
+      if ((c = free_chunks))
+	free_chunks = c->next;
+      g_mutex_unlock (&free_chunks_mutex);
+    }
+    if (c == NULL)
+      c = g_malloc (csize);
+    c->used = ARENA_CHUNK_DATA (c);
+    c->end = (guchar *) c + csize;
+    c->next = arena->chunks;
+    arena->chunks = c;
+  }
+  p = c->used;
+  c->used += needed;
+  g_mutex_unlock (&arena->mutex);
+
+  *((gsize *) p) = needed;
+  memset (p + ALLOC_ALIGN, 0, needed - ALLOC_ALIGN);
+  return p + ALLOC_ALIGN;
+}
+
+/* Returns an uninitialized object of class @klass, zeroed */
+static GtsObject * object_alloc (GtsObjectClass * klass)
+{
+  GtsObject * object;
+  GtsArena * arena;
+
+  if (klass->slab == NULL)
+    object = g_malloc0 (klass->info.object_size);
+  else if ((arena = current_arena ())) {
+    object = arena_alloc (arena, klass->info.object_size);
+    object->flags = GTS_ARENA;
+  }
+  else
+    object = slab_alloc (klass->slab);
+  object->klass = klass;
+  return object;
+}
 
 static void gts_object_class_init (GtsObjectClass * klass,
 				   GtsObjectClass * parent_class)
@@ -59,9 +216,11 @@ gpointer gts_object_class_new (GtsObjectClass * parent_class,
   klass->parent_class = parent_class;
   gts_object_class_init (klass, klass);
 
+  g_mutex_lock (&class_table_mutex);
   if (!class_table)
     class_table = g_hash_table_new (g_str_hash, g_str_equal);
   g_hash_table_insert (class_table, klass->info.name, klass);
+  g_mutex_unlock (&class_table_mutex);
 
   return klass;
 }
@@ -75,11 +234,15 @@ gpointer gts_object_class_new (GtsObjectClass * parent_class,
  */
 GtsObjectClass * gts_object_class_from_name (const gchar * name)
 {
+  GtsObjectClass * klass = NULL;
+
   g_return_val_if_fail (name != NULL, NULL);
 
-  if (!class_table)
-    return NULL;
-  return g_hash_table_lookup (class_table, name);
+  g_mutex_lock (&class_table_mutex);
+  if (class_table)
+    klass = g_hash_table_lookup (class_table, name);
+  g_mutex_unlock (&class_table_mutex);
+  return klass;
 }
 
 static void object_destroy (GtsObject * object)
@@ -93,14 +256,29 @@ static void object_destroy (GtsObject * object)
 #endif
   id_remove (object);
 #endif
-  object->klass = NULL;
-  g_free (object);
+  if (object->flags & GTS_ARENA)
+    /* the memory is released together with the arena */
+    object->klass = NULL;
+  else if (object->klass->slab) {
+    GtsSlab * slab = object->klass->slab;
+
+    object->klass = NULL;
+    slab_free (slab, object);
+  }
+  else {
+    object->klass = NULL;
+    g_free (object);
+  }
 }
 
 static void object_clone (GtsObject * clone, GtsObject * object)
 {
+  guint32 arena = clone->flags & GTS_ARENA;
+
   memcpy (clone, object, object->klass->info.object_size);
   clone->reserved = NULL;
+  clone->flags = (clone->flags & ~GTS_ARENA) | arena;
+  clone->stamp = 0;
 }
 
 static void object_class_init (GtsObjectClass * klass)
@@ -116,7 +294,8 @@ static void object_class_init (GtsObjectClass * klass)
 static void object_init (GtsObject * object)
 {
   object->reserved = NULL;
-  object->flags = 0;
+  /* where the object was allocated from does not change */
+  object->flags &= GTS_ARENA;
 }
 
 /**
@@ -127,8 +306,9 @@ static void object_init (GtsObject * object)
 GtsObjectClass * gts_object_class (void)
 {
   static GtsObjectClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo object_info = {
       "GtsObject",
       sizeof (GtsObject),
@@ -139,6 +319,7 @@ GtsObjectClass * gts_object_class (void)
       (GtsArgGetFunc) NULL
     };
     klass = gts_object_class_new (NULL, &object_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -234,8 +415,7 @@ GtsObject * gts_object_new (GtsObjectClass * klass)
 
   g_return_val_if_fail (klass != NULL, NULL);
 
-  object = g_malloc0 (klass->info.object_size);
-  object->klass = klass;
+  object = object_alloc (klass);
   gts_object_init (object, klass);
 
 #ifdef DEBUG_IDENTITY
@@ -266,8 +446,7 @@ GtsObject * gts_object_clone (GtsObject * object)
   g_return_val_if_fail (object != NULL, NULL);
   g_return_val_if_fail (object->klass->clone, NULL);
 
-  clone = g_malloc0 (object->klass->info.object_size);
-  clone->klass = object->klass;
+  clone = object_alloc (object->klass);
   object_init (clone);
   (* object->klass->clone) (clone, object);
 
@@ -326,9 +505,21 @@ void gts_object_attributes (GtsObject * object, GtsObject * from)
 
 static void free_class (gchar * name, GtsObjectClass * klass)
 {
+  if (klass->slab)
+    slab_destroy (klass->slab);
   g_free (klass);
 }
 
+static void free_arena_chunks (ArenaChunk * c)
+{
+  while (c) {
+    ArenaChunk * next = c->next;
+
+    g_free (c);
+    c = next;
+  }
+}
+
 /**
  * gts_finalize:
  *
@@ -337,9 +528,151 @@ static void free_class (gchar * name, GtsObjectClass * klass)
  */
 void gts_finalize (void)
 {
+  g_mutex_lock (&class_table_mutex);
   if (class_table) {
     g_hash_table_foreach (class_table, (GHFunc) free_class, NULL);
     g_hash_table_destroy (class_table);
     class_table = NULL;
   }
+  g_mutex_unlock (&class_table_mutex);
+  free_arena_chunks (free_chunks);
+  free_chunks = NULL;
+}
+
+/**
+ * gts_object_class_use_slab:
+ * @klass: a #GtsObjectClass.
+ *
+ * Makes the objects of @klass (but not of the classes derived from it) be
+ * allocated from a slab of memory owned by @klass, recycling the memory
+ * of the destroyed objects, rather than individually with g_malloc(). The
+ * objects of @klass are also allocated from the current #GtsArena, if
+ * any (see gts_arena_push()).
+ *
+ * This function must be called before any object of @klass is created,
+ * typically right after the class itself has been created. The memory of
+ * the slab is only released by gts_finalize().
+ */
+void gts_object_class_use_slab (GtsObjectClass * klass)
+{
+  g_return_if_fail (klass != NULL);
+
+  g_mutex_lock (&class_table_mutex);
+  if (klass->slab == NULL)
+    klass->slab = slab_new (klass->info.object_size);
+  g_mutex_unlock (&class_table_mutex);
+}
+
+/**
+ * gts_arena_new:
+ *
+ * Returns: a new empty #GtsArena.
+ */
+GtsArena * gts_arena_new (void)
+{
+  GtsArena * arena = g_malloc0 (sizeof (GtsArena));
+
+  g_mutex_init (&arena->mutex);
+  return arena;
+}
+
+/**
+ * gts_arena_push:
+ * @arena: a #GtsArena.
+ *
+ * Makes @arena the current arena of the calling thread, until the
+ * matching call to gts_arena_pop(). While it is current, the objects of
+ * the classes using a slab (see gts_object_class_use_slab()) created by
+ * this thread are allocated from @arena. Each thread has its own stack of
+ * arenas: the same arena can be current in several threads at once, and
+ * pushed again in the same thread.
+ *
+ * Destroying one of these objects does not release its memory, which is
+ * released all at once by gts_arena_destroy().
+ */
+void gts_arena_push (GtsArena * arena)
+{
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (arena_stack_top < ARENA_STACK_SIZE);
+
+  arena_stack[arena_stack_top++] = arena;
+}
+
+/**
+ * gts_arena_pop:
+ * @arena: the current #GtsArena of the calling thread.
+ *
+ * Restores the arena which was current before @arena was pushed.
+ */
+void gts_arena_pop (GtsArena * arena)
+{
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (arena == current_arena ());
+
+  arena_stack[--arena_stack_top] = NULL;
+}
+
+/**
+ * gts_arena_foreach:
+ * @arena: a #GtsArena.
+ * @func: a #GtsFunc.
+ * @data: user data to be passed to @func.
+ *
+ * Calls @func for each object allocated from @arena which has not been
+ * destroyed.
+ */
+void gts_arena_foreach (GtsArena * arena, GtsFunc func, gpointer data)
+{
+  ArenaChunk * c;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (func != NULL);
+
+  for (c = arena->chunks; c; c = c->next) {
+    guchar * p = ARENA_CHUNK_DATA (c);
+
+    while (p < c->used) {
+      GtsObject * object = (GtsObject *) (p + ALLOC_ALIGN);
+
+      if (object->klass)
+	(* func) (object, data);
+      p += *((gsize *) p);
+    }
+  }
+}
+
+/**
+ * gts_arena_destroy:
+ * @arena: a #GtsArena which is not current in any thread.
+ *
+ * Releases the memory of all the objects allocated from @arena, without
+ * calling their destroy method, and frees @arena. The memory is kept for
+ * the next arenas until gts_finalize() is called.
+ */
+void gts_arena_destroy (GtsArena * arena)
+{
+  ArenaChunk * c, * large = NULL;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (arena != current_arena ());
+
+  c = arena->chunks;
+  g_mutex_lock (&free_chunks_mutex);
+  while (c) {
+    ArenaChunk * next = c->next;
+
+    if (c->end - (guchar *) c == ARENA_CHUNK_SIZE) {
+      c->next = free_chunks;
+      free_chunks = c;
+    }
+    else {
+      c->next = large;
+      large = c;
+    }
+    c = next;
+  }
+  g_mutex_unlock (&free_chunks_mutex);
+  free_arena_chunks (large);
+  g_mutex_clear (&arena->mutex);
+  g_free (arena);
 }
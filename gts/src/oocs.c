@@ -84,8 +84,9 @@ static void cluster_init (GtsCluster * c)
 GtsClusterClass * gts_cluster_class (void)
 {
   static GtsClusterClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo cluster_info = {
       "GtsCluster",
       sizeof (GtsCluster),
@@ -96,6 +97,7 @@ GtsClusterClass * gts_cluster_class (void)
       (GtsArgGetFunc) NULL
     };
     klass = gts_object_class_new (gts_object_class (), &cluster_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -205,8 +207,9 @@ static void cluster_grid_init (GtsClusterGrid * cluster_grid)
 GtsClusterGridClass * gts_cluster_grid_class (void)
 {
   static GtsClusterGridClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo cluster_grid_info = {
       "GtsClusterGrid",
       sizeof (GtsClusterGrid),
@@ -217,6 +220,7 @@ GtsClusterGridClass * gts_cluster_grid_class (void)
       (GtsArgGetFunc) NULL
     };
     klass = gts_object_class_new (gts_object_class (), &cluster_grid_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -59,8 +59,9 @@ static void gnode_split_init (GtsGNodeSplit * ns)
 GtsGNodeSplitClass * gts_gnode_split_class (void)
 {
   static GtsGNodeSplitClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo gnode_split_info = {
       "GtsGNodeSplit",
       sizeof (GtsGNodeSplit),
@@ -71,6 +72,7 @@ GtsGNodeSplitClass * gts_gnode_split_class (void)
       (GtsArgGetFunc) NULL
     };
     klass = gts_object_class_new (gts_object_class (), &gnode_split_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -303,8 +305,9 @@ static void pgraph_init (GtsPGraph * pg)
 GtsPGraphClass * gts_pgraph_class (void)
 {
   static GtsPGraphClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo pgraph_info = {
       "GtsPGraph",
       sizeof (GtsPGraph),
@@ -315,6 +318,7 @@ GtsPGraphClass * gts_pgraph_class (void)
       (GtsArgGetFunc) NULL
     };
     klass = gts_object_class_new (gts_object_class (), &pgraph_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -93,8 +93,9 @@ static void point_class_init (GtsObjectClass * klass)
 GtsPointClass * gts_point_class (void)
 {
   static GtsPointClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo point_info = {
       "GtsPoint",
       sizeof (GtsPoint),
@@ -106,6 +107,7 @@ GtsPointClass * gts_point_class (void)
     };
     klass = gts_object_class_new (gts_object_class (), 
 				  &point_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -382,6 +384,56 @@ gdouble gts_point_segment_distance (GtsPoint * p, GtsSegment * s)
   return sqrt (gts_point_segment_distance2 (p, s));
 }
 
+/**
+ * gts_point_segment_nearest:
+ * @p: a #GtsPoint.
+ * @s: a #GtsSegment.
+ * @closest: a #GtsVector.
+ *
+ * Sets @closest to the coordinates of the point belonging to @s
+ * closest to @p. This function can be used as a #GtsBBoxNearestFunc.
+ *
+ * Returns: the square of the minimum Euclidean distance between @p and @s.
+ */
+gdouble gts_point_segment_nearest (GtsPoint * p, 
+				   GtsSegment * s,
+				   GtsVector closest)
+{
+  gdouble t, ns2, x, y, z;
+  GtsPoint * p1, * p2;
+
+  g_return_val_if_fail (p != NULL, 0.0);
+  g_return_val_if_fail (s != NULL, 0.0);
+  g_return_val_if_fail (closest != NULL, 0.0);
+
+  p1 = GTS_POINT (s->v1);
+  p2 = GTS_POINT (s->v2);
+  ns2 = gts_point_distance2 (p1, p2);
+
+  if (ns2 == 0.0)
+    t = 0.0;
+  else
+    t = ((p2->x - p1->x)*(p->x - p1->x) + 
+	 (p2->y - p1->y)*(p->y - p1->y) +
+	 (p2->z - p1->z)*(p->z - p1->z))/ns2;
+
+  if (t > 1.0) {
+    closest[0] = p2->x; closest[1] = p2->y; closest[2] = p2->z;
+  }
+  else if (t <= 0.0) {
+    closest[0] = p1->x; closest[1] = p1->y; closest[2] = p1->z;
+  }
+  else {
+    closest[0] = (1. - t)*p1->x + t*p2->x;
+    closest[1] = (1. - t)*p1->y + t*p2->y;
+    closest[2] = (1. - t)*p1->z + t*p2->z;
+  }
+  x = closest[0] - p->x;
+  y = closest[1] - p->y;
+  z = closest[2] - p->z;
+  return x*x + y*y + z*z;
+}
+
 /**
  * gts_point_segment_closest:
  * @p: a #GtsPoint.
@@ -395,35 +447,14 @@ void gts_point_segment_closest (GtsPoint * p,
 				GtsSegment * s,
 				GtsPoint * closest)
 {
-  gdouble t, ns2;
-  GtsPoint * p1, * p2;
+  GtsVector c;
 
   g_return_if_fail (p != NULL);
   g_return_if_fail (s != NULL);
   g_return_if_fail (closest != NULL);
 
-  p1 = GTS_POINT (s->v1);
-  p2 = GTS_POINT (s->v2);
-  ns2 = gts_point_distance2 (p1, p2);
-
-  if (ns2 == 0.0) {
-    gts_point_set (closest, p1->x, p1->y, p1->z);
-    return;
-  }
-
-  t = ((p2->x - p1->x)*(p->x - p1->x) + 
-       (p2->y - p1->y)*(p->y - p1->y) +
-       (p2->z - p1->z)*(p->z - p1->z))/ns2;
-
-  if (t > 1.0)
-    gts_point_set (closest, p2->x, p2->y, p2->z);
-  else if (t < 0.0)
-    gts_point_set (closest, p1->x, p1->y, p1->z);
-  else
-    gts_point_set (closest,
-		   (1. - t)*p1->x + t*p2->x,
-		   (1. - t)*p1->y + t*p2->y,
-		   (1. - t)*p1->z + t*p2->z);
+  gts_point_segment_nearest (p, s, c);
+  gts_point_set (closest, c[0], c[1], c[2]);
 }
 
 /**
@@ -504,27 +535,29 @@ gdouble gts_point_triangle_distance (GtsPoint * p, GtsTriangle * t)
 }
 
 /**
- * gts_point_triangle_closest:
+ * gts_point_triangle_nearest:
  * @p: a #GtsPoint.
  * @t: a #GtsTriangle.
- * @closest: a #GtsPoint.
+ * @closest: a #GtsVector.
  *
- * Set the coordinates of @closest to those of the point belonging to @t and 
- * closest to @p.
+ * Sets @closest to the coordinates of the point belonging to @t and
+ * closest to @p. This function can be used as a #GtsBBoxNearestFunc.
+ *
+ * Returns: the square of the minimum Euclidean distance between @p and @t.
  */
-void gts_point_triangle_closest (GtsPoint * p, 
-				 GtsTriangle * t, 
-				 GtsPoint * closest)
+gdouble gts_point_triangle_nearest (GtsPoint * p, 
+				    GtsTriangle * t, 
+				    GtsVector closest)
 {
   GtsPoint * p1, * p2, * p3;
   GtsEdge * e1, * e2, * e3;
   GtsVector p1p2, p1p3, pp1;
   gdouble A, B, C, D, E, det;
-  gdouble t1, t2;
+  gdouble t1, t2, x, y, z;
 
-  g_return_if_fail (p != NULL);
-  g_return_if_fail (t != NULL);
-  g_return_if_fail (closest != NULL);
+  g_return_val_if_fail (p != NULL, 0.0);
+  g_return_val_if_fail (t != NULL, 0.0);
+  g_return_val_if_fail (closest != NULL, 0.0);
 
   gts_triangle_vertices_edges (t, NULL, 
 			       (GtsVertex **) &p1, 
@@ -542,15 +575,15 @@ void gts_point_triangle_closest (GtsPoint * p,
   
   det = B*B - E*C;
   if (det == 0.) { /* p1p2 and p1p3 are colinear */
-    GtsPoint * cp = 
-      GTS_POINT (gts_object_new (GTS_OBJECT_CLASS (gts_point_class ())));
-    gts_point_segment_closest (p, GTS_SEGMENT (e1), cp);
-    gts_point_segment_closest (p, GTS_SEGMENT (e3), closest);
-
-    if (gts_point_distance2 (cp, p) < gts_point_distance2 (closest, p))
-      gts_point_set (closest, cp->x, cp->y, cp->z);
-    gts_object_destroy (GTS_OBJECT (cp));
-    return;
+    GtsVector c1;
+    gdouble d1 = gts_point_segment_nearest (p, GTS_SEGMENT (e1), c1);
+    gdouble d3 = gts_point_segment_nearest (p, GTS_SEGMENT (e3), closest);
+
+    if (d1 < d3) {
+      closest[0] = c1[0]; closest[1] = c1[1]; closest[2] = c1[2];
+      return d1;
+    }
+    return d3;
   }
 
   A = gts_vector_scalar (p1p3, pp1);
@@ -560,16 +593,42 @@ void gts_point_triangle_closest (GtsPoint * p,
   t2 = (A*E - D*B)/det;
 
   if (t1 < 0.)
-    gts_point_segment_closest (p, GTS_SEGMENT (e3), closest);
-  else if (t2 < 0.)
-    gts_point_segment_closest (p, GTS_SEGMENT (e1), closest);
-  else if (t1 + t2 > 1.)
-    gts_point_segment_closest (p, GTS_SEGMENT (e2), closest);
-  else
-    gts_point_set (closest, 
-		   p1->x + t1*p1p2[0] + t2*p1p3[0],
-		   p1->y + t1*p1p2[1] + t2*p1p3[1],
-		   p1->z + t1*p1p2[2] + t2*p1p3[2]);
+    return gts_point_segment_nearest (p, GTS_SEGMENT (e3), closest);
+  if (t2 < 0.)
+    return gts_point_segment_nearest (p, GTS_SEGMENT (e1), closest);
+  if (t1 + t2 > 1.)
+    return gts_point_segment_nearest (p, GTS_SEGMENT (e2), closest);
+
+  closest[0] = p1->x + t1*p1p2[0] + t2*p1p3[0];
+  closest[1] = p1->y + t1*p1p2[1] + t2*p1p3[1];
+  closest[2] = p1->z + t1*p1p2[2] + t2*p1p3[2];
+  x = closest[0] - p->x;
+  y = closest[1] - p->y;
+  z = closest[2] - p->z;
+  return x*x + y*y + z*z;
+}
+
+/**
+ * gts_point_triangle_closest:
+ * @p: a #GtsPoint.
+ * @t: a #GtsTriangle.
+ * @closest: a #GtsPoint.
+ *
+ * Set the coordinates of @closest to those of the point belonging to @t and 
+ * closest to @p.
+ */
+void gts_point_triangle_closest (GtsPoint * p, 
+				 GtsTriangle * t, 
+				 GtsPoint * closest)
+{
+  GtsVector c;
+
+  g_return_if_fail (p != NULL);
+  g_return_if_fail (t != NULL);
+  g_return_if_fail (closest != NULL);
+
+  gts_point_triangle_nearest (p, t, c);
+  gts_point_set (closest, c[0], c[1], c[2]);
 }
 
 /**
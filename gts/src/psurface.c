@@ -64,8 +64,9 @@ static void psurface_init (GtsPSurface * psurface)
 GtsPSurfaceClass * gts_psurface_class (void)
 {
   static GtsPSurfaceClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo psurface_info = {
       "GtsPSurface",
       sizeof (GtsPSurface),
@@ -77,6 +78,7 @@ GtsPSurfaceClass * gts_psurface_class (void)
     };
     klass = gts_object_class_new (gts_object_class (), 
 				  &psurface_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -101,7 +103,7 @@ static GtsVertex * edge_collapse (GtsPSurface * ps,
 
   if (!gts_edge_collapse_is_valid (e) ||
       /* check that a non-manifold edge is not a contact edge */
-      (g_slist_length (e->triangles) > 2 && gts_edge_is_contact (e) > 1)) {
+      (e->triangles.n > 2 && gts_edge_is_contact (e) > 1)) {
     GTS_OBJECT (e)->reserved = 
       gts_eheap_insert_with_key (heap, e, G_MAXDOUBLE);
     return NULL;
@@ -134,23 +136,20 @@ static GtsVertex * edge_collapse (GtsPSurface * ps,
 
 static void update_2nd_closest_neighbors (GtsVertex * v, GtsEHeap * heap)
 {
-  GSList * i = v->segments;
-  GSList * list = NULL;
+  GtsSegment * s;
+  GSList * i, * list = NULL;
+  guint k;
   
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v->segments, k, s)
     if (GTS_IS_EDGE (s)) {
       GtsVertex * v1 = s->v1 == v ? s->v2 : s->v1;
-      GSList * j = v1->segments;
-      while (j) {
-	GtsSegment * s1 = j->data;
+      GtsSegment * s1;
+      guint l;
+
+      GTS_ADJACENCY_FOREACH (&v1->segments, l, s1)
 	if (GTS_IS_EDGE (s1) && !g_slist_find (list, s1))
 	  list = g_slist_prepend (list, s1);
-	j = j->next;
-      }
     }
-    i = i->next;
-  }
 
   i = list;
   while (i) {
@@ -184,18 +183,18 @@ static void check_fold (GtsTriangle * t, gdouble * maxcosine2)
   GtsEdge * e1 = t->e1, * e2 = t->e2, * e3 = t->e3;
 
   
-  if (gts_triangles_are_folded (e1->triangles, 
-				GTS_SEGMENT (e1)->v1,
-				GTS_SEGMENT (e1)->v2,
-				*maxcosine2) ||
-      gts_triangles_are_folded (e2->triangles, 
-				GTS_SEGMENT (e2)->v1,
-				GTS_SEGMENT (e2)->v2,
-				*maxcosine2) ||
-      gts_triangles_are_folded (e3->triangles, 
-				GTS_SEGMENT (e3)->v1,
-				GTS_SEGMENT (e3)->v2,
-				*maxcosine2)) {
+  if (gts_edge_triangles_are_folded (e1, 
+				     GTS_SEGMENT (e1)->v1,
+				     GTS_SEGMENT (e1)->v2,
+				     *maxcosine2) ||
+      gts_edge_triangles_are_folded (e2, 
+				     GTS_SEGMENT (e2)->v1,
+				     GTS_SEGMENT (e2)->v2,
+				     *maxcosine2) ||
+      gts_edge_triangles_are_folded (e3, 
+				     GTS_SEGMENT (e3)->v1,
+				     GTS_SEGMENT (e3)->v2,
+				     *maxcosine2)) {
     fprintf (stderr, "triangle %p:(%p,%p,%p) is folded\n", t, e1, e2, e3);
     g_assert_not_reached ();
   }
@@ -59,22 +59,19 @@ GtsVertex * gts_edge_is_encroached (GtsEdge * e,
 				    GtsEncroachFunc encroaches,
 				    gpointer data)
 {
-  GSList * i;
+  GtsFace * f;
+  guint i;
 
   g_return_val_if_fail (e != NULL, NULL);
   g_return_val_if_fail (s != NULL, NULL);
   g_return_val_if_fail (encroaches != NULL, NULL);
 
-  i = e->triangles;
-  while (i) {
-    GtsFace * f = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, f)
     if (GTS_IS_FACE (f) && gts_face_has_parent_surface (f, s)) {
       GtsVertex * v = gts_triangle_vertex_opposite (GTS_TRIANGLE (f), e);
       if ((* encroaches) (v, e, s, data))
 	return v;
     }
-    i = i->next;
-  }
 
   return NULL;
 }
@@ -136,12 +133,12 @@ static void make_encroached_fifo (GtsEdge * e, gpointer * datas)
 static GtsVertex * split_edge (GtsEdge * e,
 			       GtsSurface * surface)
 {
-  GSList * i = e->triangles;
   GtsEdge * c = NULL;
+  guint i;
 
   /* look for constraints touching e */
-  while (i && !c) {
-    GtsTriangle * t = i->data;
+  for (i = 0; i < e->triangles.n && !c; i++) {
+    GtsTriangle * t = e->triangles.items[i];
     if (GTS_IS_FACE (t) && 
 	gts_face_has_parent_surface (GTS_FACE (t), surface)) {
       GtsEdge * e1, * e2;
@@ -153,7 +150,6 @@ static GtsVertex * split_edge (GtsEdge * e,
       else if (GTS_IS_CONSTRAINT (e2) && !GTS_IS_CONSTRAINT (e1))
 	c = e2;
     }
-    i = i->next;
   }
   if (c) {
     /* use power of two concentric shells */
@@ -199,14 +195,14 @@ static gint split_encroached (GtsSurface * surface,
     GtsEdge * e2 = GTS_EDGE (gts_object_clone (GTS_OBJECT (s)));
 
     GTS_SEGMENT (e1)->v1 = s->v1;
-    s->v1->segments = g_slist_prepend (s->v1->segments, e1);
+    gts_vertex_add_segment (s->v1, e1);
     GTS_SEGMENT (e1)->v2 = v;
-    v->segments = g_slist_prepend (v->segments, e1);
+    gts_vertex_add_segment (v, e1);
 
     GTS_SEGMENT (e2)->v1 = v;
-    v->segments = g_slist_prepend (v->segments, e2);
+    gts_vertex_add_segment (v, e2);
     GTS_SEGMENT (e2)->v2 = s->v2;
-    s->v2->segments = g_slist_prepend (s->v2->segments, e2);
+    gts_vertex_add_segment (s->v2, e2);
 #else
     GtsEdge * e1 = gts_edge_new (GTS_EDGE_CLASS (GTS_OBJECT (s)->klass),
 				 s->v1, v);
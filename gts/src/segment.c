@@ -25,14 +25,14 @@ static void segment_destroy (GtsObject * object)
   GtsVertex * v1 = segment->v1;
   GtsVertex * v2 = segment->v2;
 
-  v1->segments = g_slist_remove (v1->segments, segment);
+  gts_vertex_remove_segment (v1, segment);
   if (!GTS_OBJECT_DESTROYED (v1) &&
-      !gts_allow_floating_vertices && v1->segments == NULL)
+      !gts_allow_floating_vertices && v1->segments.n == 0)
     gts_object_destroy (GTS_OBJECT (v1));
 
-  v2->segments = g_slist_remove (v2->segments, segment);
+  gts_vertex_remove_segment (v2, segment);
   if (!GTS_OBJECT_DESTROYED (v2) &&
-      !gts_allow_floating_vertices && v2->segments == NULL)
+      !gts_allow_floating_vertices && v2->segments.n == 0)
     gts_object_destroy (GTS_OBJECT (v2));
 
   (* GTS_OBJECT_CLASS (gts_segment_class ())->parent_class->destroy) (object);
@@ -56,8 +56,9 @@ static void segment_init (GtsSegment * segment)
 GtsSegmentClass * gts_segment_class (void)
 {
   static GtsSegmentClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo segment_info = {
       "GtsSegment",
       sizeof (GtsSegment),
@@ -69,6 +70,7 @@ GtsSegmentClass * gts_segment_class (void)
     };
     klass = gts_object_class_new (gts_object_class (), 
 				  &segment_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -94,8 +96,8 @@ GtsSegment * gts_segment_new (GtsSegmentClass * klass,
   s = GTS_SEGMENT (gts_object_new (GTS_OBJECT_CLASS (klass)));
   s->v1 = v1;
   s->v2 = v2;
-  v1->segments = g_slist_prepend (v1->segments, s);
-  v2->segments = g_slist_prepend (v2->segments, s);
+  gts_vertex_add_segment (v1, s);
+  gts_vertex_add_segment (v2, s);
   
   return s;
 }
@@ -109,26 +111,22 @@ GtsSegment * gts_segment_new (GtsSegmentClass * klass,
  */
 GtsSegment * gts_segment_is_duplicate (GtsSegment * s)
 {
-  GSList * i;
+  GtsSegment * s1;
   GtsVertex * v2;
+  guint i;
 
   g_return_val_if_fail (s != NULL, NULL);
 
   v2 = s->v2;
-  i = s->v1->segments;
   if (s->v1 == v2) /* s is degenerate: special treatment */
-    while (i) {
-      GtsSegment * s1 = i->data;
+    GTS_ADJACENCY_FOREACH (&s->v1->segments, i, s1) {
       if (s1 != s && s1->v1 == v2 && s1->v2 == v2)
 	return s1;
-      i = i->next;
     }
   else /* s is not degenerate */
-    while (i) {
-      GtsSegment * s1 = i->data;
+    GTS_ADJACENCY_FOREACH (&s->v1->segments, i, s1) {
       if (s1 != s && (s1->v1 == v2 || s1->v2 == v2))
 	return s1;
-      i = i->next;
     }
   return NULL;
 }
@@ -201,15 +199,14 @@ GSList * gts_segments_from_vertices (GSList * vertices)
   hash = g_hash_table_new (NULL, NULL);
   i = vertices;
   while (i) {
-    GSList * j = GTS_VERTEX (i->data)->segments;
-    while (j) {
-      GtsSegment * s = j->data;
+    GtsSegment * s;
+    guint j;
+
+    GTS_ADJACENCY_FOREACH (&GTS_VERTEX (i->data)->segments, j, s)
       if (g_hash_table_lookup (hash, s) == NULL) {
 	segments = g_slist_prepend (segments, s);
 	g_hash_table_insert (hash, s, i);
       }
-      j = j->next;
-    }
     i = i->next;
   }
   g_hash_table_destroy (hash);
@@ -82,8 +82,9 @@ struct _CFaceClass {
 static GtsObjectClass * cface_class (void)
 {
   static GtsObjectClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo cface_info = {
       "GtsCFace",
       sizeof (CFace),
@@ -95,6 +96,7 @@ static GtsObjectClass * cface_class (void)
     };
     klass = gts_object_class_new (gts_object_class (), &cface_info);
     g_assert (sizeof (CFace) <= sizeof (GtsFace));
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -115,75 +117,61 @@ static GtsTriangle * replace_edge_collapse (GtsEdge * e,
 #endif
 					    )
 {
-  GSList * i;
-  GtsTriangle * rt = NULL;
+  GtsTriangle * t, * rt = NULL;
+  guint i;
 #ifdef DYNAMIC_SPLIT
   guint size;
   GtsTriangle ** a;
 #endif
 
 #ifdef NEW
-  i = e->triangles;
-  e->triangles = NULL;
-  size = g_slist_length (i)*sizeof (GtsTriangle *);
+  guint n = 0;
+
+  size = e->triangles.n*sizeof (GtsTriangle *);
   *a1 = a = g_malloc (size > 0 ? size : sizeof (GtsTriangle *));
-  while (i) {
-    GtsTriangle * t = i->data;
-    GSList * next = i->next;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
     if (t != ((GtsTriangle *) cf)) {
       if (IS_CFACE (t)) {
-	i->next = e->triangles;
-	e->triangles = i;
+	e->triangles.items[n++] = t;
 	/* set the edge given by edge_flag (CFACE_E1 or CFACE_E2) */
 	GTS_OBJECT (t)->reserved = GUINT_TO_POINTER (edge_flag);
 	cf->flags |= CFACE_KEEP_VVS;
       }
       else {
 	TRIANGLE_REPLACE_EDGE (t, e, with);
-	i->next = with->triangles;
-	with->triangles = i;
+	gts_edge_add_triangle (with, t);
 	rt = t;
 	*(a++) = t;
       }
     }
-    else
-      g_slist_free_1 (i);
-    i = next;
-  }
+  e->triangles.n = n;
   *a = NULL;
-  if (!e->triangles) {
+  if (!e->triangles.n) {
     if (heap)
       HEAP_REMOVE_OBJECT (heap, e);
     gts_object_destroy (GTS_OBJECT (e));
   }
 #else /* not NEW */
-  i = e->triangles;
 #ifdef DYNAMIC_SPLIT
-  size = g_slist_length (i)*sizeof (GtsTriangle *);
+  size = e->triangles.n*sizeof (GtsTriangle *);
   *a1 = a = g_malloc (size > 0 ? size : sizeof (GtsTriangle *));
 #endif
-  while (i) {
-    GtsTriangle * t = i->data;
-    GSList * next = i->next;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
     if (t != ((GtsTriangle *) cf)) {
       TRIANGLE_REPLACE_EDGE (t, e, with);
-      i->next = with->triangles;
-      with->triangles = i;
+      gts_edge_add_triangle (with, t);
       rt = t;
 #ifdef DYNAMIC_SPLIT
       *(a++) = t;
 #endif
     }
-    else
-      g_slist_free_1 (i);
-    i = next;
-  }
 #ifdef DYNAMIC_SPLIT
   *a = NULL;
 #endif
   if (heap)
     HEAP_REMOVE_OBJECT (heap, e);
-  e->triangles = NULL;
+  gts_adjacency_free (&e->triangles, e->triangle_slots, 
+		      GTS_EDGE_TRIANGLE_SLOTS);
   gts_object_destroy (GTS_OBJECT (e));
 #endif /* NEW */
 
@@ -336,7 +324,7 @@ static void replace_edge_expand (GtsEdge * e,
 	     t, id (t), e, id (e), with, id (with));
 #endif
     TRIANGLE_REPLACE_EDGE (t, e, with);
-    with->triangles = g_slist_prepend (with->triangles, t);
+    gts_edge_add_triangle (with, t);
     if (GTS_OBJECT (t)->reserved) {
       /* apart from the triangles having e as an edge, t is the only
 	 triangle using v */
@@ -391,13 +379,13 @@ static void cface_expand (CFace * cf,
 
 #ifdef NEW
   if (!(flags & CFACE_KEEP_VVS)) {
-    g_slist_free (vvs->triangles);
-    vvs->triangles = NULL;
+    gts_adjacency_free (&vvs->triangles, vvs->triangle_slots,
+			GTS_EDGE_TRIANGLE_SLOTS);
     gts_object_destroy (GTS_OBJECT (vvs));
   }
 #else
-  g_slist_free (vvs->triangles);
-  vvs->triangles = NULL;
+  gts_adjacency_free (&vvs->triangles, vvs->triangle_slots,
+		      GTS_EDGE_TRIANGLE_SLOTS);
   gts_object_destroy (GTS_OBJECT (vvs));
 #endif
 
@@ -426,7 +414,7 @@ static void split_destroy (GtsObject * object)
   }
   g_free (vs->cfaces);
 
-  if (!gts_allow_floating_vertices && vs->v && vs->v->segments == NULL)
+  if (!gts_allow_floating_vertices && vs->v && vs->v->segments.n == 0)
     gts_object_destroy (GTS_OBJECT (vs->v));
 
   (* GTS_OBJECT_CLASS (gts_split_class ())->parent_class->destroy) (object);
@@ -453,8 +441,9 @@ static void split_init (GtsSplit * split)
 GtsSplitClass * gts_split_class (void)
 {
   static GtsSplitClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo split_info = {
       "GtsSplit",
       sizeof (GtsSplit),
@@ -466,6 +455,7 @@ GtsSplitClass * gts_split_class (void)
     };
     klass = gts_object_class_new (gts_object_class (), 
 				  &split_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -474,7 +464,8 @@ GtsSplitClass * gts_split_class (void)
 #ifdef DEBUG
 static gboolean edge_collapse_is_valid (GtsEdge * e)
 {
-  GSList * i;
+  GtsEdge * e1;
+  guint i;
 
   g_return_val_if_fail (e != NULL, FALSE);
   
@@ -483,31 +474,28 @@ static gboolean edge_collapse_is_valid (GtsEdge * e)
     return FALSE;
   }
     
-  i = GTS_SEGMENT (e)->v1->segments;
-  while (i) {
-    GtsEdge * e1 = i->data;
+  GTS_ADJACENCY_FOREACH (&GTS_SEGMENT (e)->v1->segments, i, e1)
     if (e1 != e && GTS_IS_EDGE (e1)) {
       GtsEdge * e2 = NULL;
-      GSList * j = GTS_SEGMENT (e1)->v1 == GTS_SEGMENT (e)->v1 ? 
-	GTS_SEGMENT (e1)->v2->segments : GTS_SEGMENT (e1)->v1->segments;
-      while (j && !e2) {
-	GtsEdge * e1 = j->data;
+      GtsAdjacency * segments = GTS_SEGMENT (e1)->v1 == GTS_SEGMENT (e)->v1 ? 
+	&GTS_SEGMENT (e1)->v2->segments : &GTS_SEGMENT (e1)->v1->segments;
+      guint j;
+
+      for (j = 0; j < segments->n && !e2; j++) {
+	GtsEdge * e1 = segments->items[j];
 	if (GTS_IS_EDGE (e1) && 
 	    (GTS_SEGMENT (e1)->v1 == GTS_SEGMENT (e)->v2 || 
 	     GTS_SEGMENT (e1)->v2 == GTS_SEGMENT (e)->v2))
 	  e2 = e1;
-	j = j->next;
       }
       if (e2 && !gts_triangle_use_edges (e, e1, e2)) {
 	g_warning ("collapsing empty triangle");
 	return FALSE;
       }
     }
-    i = i->next;
-  }
 
   if (gts_edge_is_boundary (e, NULL)) {
-    GtsTriangle * t = e->triangles->data;
+    GtsTriangle * t = e->triangles.items[0];
     if (gts_edge_is_boundary (t->e1, NULL) &&
 	gts_edge_is_boundary (t->e2, NULL) &&
 	gts_edge_is_boundary (t->e3, NULL)) {
@@ -566,7 +554,8 @@ void gts_split_collapse (GtsSplit * vs,
 {
   GtsEdge * e;
   GtsVertex * v, * v1, * v2;
-  GSList * i, * end;
+  GtsSegment * s;
+  guint i;
 #ifdef DYNAMIC_SPLIT
   GtsSplitCFace * cf;
   guint j;
@@ -581,7 +570,7 @@ void gts_split_collapse (GtsSplit * vs,
 
   v = vs->v;
 
-  g_return_if_fail (v->segments == NULL);
+  g_return_if_fail (v->segments.n == 0);
   
   /* we don't want to destroy vertices */
   gts_allow_floating_vertices = TRUE;
@@ -614,7 +603,6 @@ void gts_split_collapse (GtsSplit * vs,
   }
 #endif
 
-  i = e->triangles;
 #ifdef DYNAMIC_SPLIT
   cf = vs->cfaces;
   j = vs->ncf;
@@ -625,22 +613,20 @@ void gts_split_collapse (GtsSplit * vs,
   }
   g_free (vs->cfaces);
 
-  vs->ncf = g_slist_length (i);
+  vs->ncf = e->triangles.n;
   g_assert (vs->ncf > 0);
   cf = vs->cfaces = g_malloc (vs->ncf*sizeof (GtsSplitCFace));
 #endif /* DYNAMIC_SPLIT */
 #ifdef NEW
-  while (i) {
-    cf->f = i->data;
+  for (i = 0; i < e->triangles.n; i++) {
+    cf->f = e->triangles.items[i];
     g_assert (GTS_IS_FACE (cf->f));
     GTS_OBJECT (cf->f)->klass = GTS_OBJECT_CLASS (cface_class ());
     cf++;
-    i = i->next;
   }
-  i = e->triangles;
   cf = vs->cfaces;
-  while (i) {
-    cface_new (i->data, e, v1, v2, vs, heap, klass, cf);
+  for (i = 0; i < e->triangles.n; i++) {
+    cface_new (e->triangles.items[i], e, v1, v2, vs, heap, klass, cf);
 #ifdef DEBUG
     fprintf (stderr, "cface: %p->%d t: %p->%d a1: ", 
 	     cf->f, id (cf->f), CFACE (cf->f)->t, id (CFACE (cf->f)->t));
@@ -657,61 +643,45 @@ void gts_split_collapse (GtsSplit * vs,
     }
 #endif
     cf++;
-    i = i->next;
   }
 #else /* not NEW */
-  while (i) {
-    cface_new (i->data, e, v1, v2, vs, heap
+  for (i = 0; i < e->triangles.n; i++) {
+    cface_new (e->triangles.items[i], e, v1, v2, vs, heap
 #ifdef DYNAMIC_SPLIT
 	       , cf
 #endif /* DYNAMIC_SPLIT */
 	       );
 #ifdef DYNAMIC_SPLIT
-    cf->f = i->data;
+    cf->f = e->triangles.items[i];
     cf++;
 #endif /* DYNAMIC_SPLIT */
-    i = i->next;
   }
 #endif /* NEW */
-  g_slist_free (e->triangles);
-  e->triangles = NULL;
+  gts_adjacency_free (&e->triangles, e->triangle_slots, 
+		      GTS_EDGE_TRIANGLE_SLOTS);
   gts_object_destroy (GTS_OBJECT (e));
 
   gts_allow_floating_vertices = FALSE;
 
-  end = NULL;
-  i = v1->segments;
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v1->segments, i, s) {
     if (s->v1 == v1)
       s->v1 = v;
     else
       s->v2 = v;
-    end = i;
-    i = i->next;
-  }
-  if (end) {
-    end->next = v->segments;
-    v->segments = v1->segments;
-    v1->segments = NULL;
+    gts_vertex_add_segment (v, s);
   }
+  gts_adjacency_free (&v1->segments, v1->segment_slots, 
+		      GTS_VERTEX_SEGMENT_SLOTS);
 
-  end = NULL;
-  i = v2->segments;
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v2->segments, i, s) {
     if (s->v1 == v2)
       s->v1 = v;
     else
       s->v2 = v;
-    end = i;
-    i = i->next;
-  }
-  if (end) {
-    end->next = v->segments;
-    v->segments = v2->segments;
-    v2->segments = NULL;
+    gts_vertex_add_segment (v, s);
   }
+  gts_adjacency_free (&v2->segments, v2->segment_slots, 
+		      GTS_VERTEX_SEGMENT_SLOTS);
 
 #ifdef DEBUG
   if (invalid) {
@@ -787,12 +757,11 @@ void gts_split_expand (GtsSplit * vs,
 		       GtsSurface * s,
 		       GtsEdgeClass * klass)
 {
-  GSList * i;
   GtsEdge * e;
   GtsVertex * v, * v1, * v2;  
   gboolean changed = FALSE;
   GtsSplitCFace * cf;
-  guint j;
+  guint j, k;
   
   g_return_if_fail (vs != NULL);
   g_return_if_fail (s != NULL);
@@ -820,46 +789,41 @@ void gts_split_expand (GtsSplit * vs,
   gts_allow_floating_vertices = FALSE;
 
   /* this part is described by figure "expand.fig" */
-  i = v->segments;
-  while (i) {
-    GtsEdge * e1 = i->data;
+  k = 0;
+  while (k < v->segments.n) {
+    GtsEdge * e1 = v->segments.items[k];
     GtsVertex * with = NULL;
-    GSList * j = e1->triangles, * next = i->next;
+    GtsTriangle * t;
+    guint j;
     // fprintf (stderr, "e1: %p->%d\n", e1, id (e1));
-    while (j && !with) {
-      with = GTS_OBJECT (j->data)->reserved;
-      j = j->next;
-    }
+    for (j = 0; j < e1->triangles.n && !with; j++)
+      with = GTS_OBJECT (e1->triangles.items[j])->reserved;
     if (with) {
-      j = e1->triangles;
-      while (j) {
-	GtsTriangle * t = j->data;
+      GTS_ADJACENCY_FOREACH (&e1->triangles, j, t)
 	if (GTS_OBJECT (t)->reserved) {
 	  g_assert (GTS_OBJECT (t)->reserved == with);
 	  GTS_OBJECT (t)->reserved = NULL;
 	}
 	else
 	  GTS_OBJECT (t)->reserved = with;
-	j = j->next;
-      }
       if (GTS_SEGMENT (e1)->v1 == v)
 	GTS_SEGMENT (e1)->v1 = with;
       else
 	GTS_SEGMENT (e1)->v2 = with;
 
-      v->segments = g_slist_remove_link (v->segments, i);
-      i->next = with->segments;
-      with->segments = i;
+      /* the following segments move down to k */
+      gts_vertex_remove_segment (v, e1);
+      gts_vertex_add_segment (with, e1);
       changed = TRUE;
     }
-    if (next)
-      i = next;
-    else {
+    else
+      k++;
+    if (k > 0 && k == v->segments.n) {
       /* check for infinite loop (the crossed out case in 
 	 figure "expand.fig") */
       g_assert (changed);
       changed = FALSE;
-      i = v->segments;
+      k = 0;
     }
   }
 }
@@ -871,32 +835,25 @@ static void cface_neighbors (GtsSplitCFace * cf,
 {
   GtsTriangle * t = GTS_TRIANGLE (cf->f), ** a;
   GtsEdge * e1 = t->e1, * e2 = t->e2, * e3 = t->e3;
-  GSList * i;
-  guint size;
+  guint i, size;
 
   ROTATE_ORIENT (e, e1, e2, e3);
   if (SEGMENT_USE_VERTEX (GTS_SEGMENT (e1), v2)) {
     e3 = e1; e1 = e2; e2 = e3;
   }
   
-  i = e1->triangles;
-  size = g_slist_length (i)*sizeof (GtsTriangle *);
+  size = e1->triangles.n*sizeof (GtsTriangle *);
   a = cf->a1 = g_malloc (size > 0 ? size : sizeof (GtsTriangle *));
-  while (i) {
-    if (i->data != t)
-      *(a++) = i->data;
-    i = i->next;
-  }
+  for (i = 0; i < e1->triangles.n; i++)
+    if (e1->triangles.items[i] != t)
+      *(a++) = e1->triangles.items[i];
   *a = NULL;
 
-  i = e2->triangles;
-  size = g_slist_length (i)*sizeof (GtsTriangle *);
+  size = e2->triangles.n*sizeof (GtsTriangle *);
   a = cf->a2 = g_malloc (size > 0 ? size : sizeof (GtsTriangle *));
-  while (i) {
-    if (i->data != t)
-      *(a++) = i->data;
-    i = i->next;
-  }
+  for (i = 0; i < e2->triangles.n; i++)
+    if (e2->triangles.items[i] != t)
+      *(a++) = e2->triangles.items[i];
   *a = NULL;
 }
 
@@ -920,7 +877,7 @@ GtsSplit * gts_split_new (GtsSplitClass * klass,
   GtsSplit * vs;
   GtsVertex * v1, * v2;
   GtsEdge * e;
-  GSList * i;
+  guint i;
   GtsSplitCFace * cf;
 
   g_return_val_if_fail (klass != NULL, NULL);
@@ -939,14 +896,12 @@ GtsSplit * gts_split_new (GtsSplitClass * klass,
   vs->cfaces = NULL;
 #else
   g_assert ((e = GTS_EDGE (gts_vertices_are_connected (v1, v2))));
-  i = e->triangles;
-  vs->ncf = g_slist_length (i);
+  vs->ncf = e->triangles.n;
   g_assert (vs->ncf > 0);
   cf = vs->cfaces = g_malloc (vs->ncf*sizeof (GtsSplitCFace));
-  while (i) {
-    cf->f = i->data;
+  for (i = 0; i < e->triangles.n; i++) {
+    cf->f = e->triangles.items[i];
     cface_neighbors (cf, e, v1, v2);
-    i = i->next;
     cf++;
   }
 #endif
@@ -1102,12 +1057,14 @@ guint gts_split_height (GtsSplit * root)
   return height + 1;
 }
 
-static gboolean list_array_are_identical (GSList * list, 
+static gboolean list_array_are_identical (GtsAdjacency * list, 
 					  gpointer * array,
 					  gpointer excluded)
 {
-  while (list) {
-    gpointer data = list->data;
+  gpointer data;
+  guint i;
+
+  GTS_ADJACENCY_FOREACH (list, i, data)
     if (data != excluded) {
       gboolean found = FALSE;
       gpointer * a = array;
@@ -1118,8 +1075,6 @@ static gboolean list_array_are_identical (GSList * list,
       if (!found)
 	return FALSE;
     }
-    list = list->next;
-  }
   return TRUE;
 }
 
@@ -1153,9 +1108,9 @@ gboolean gts_split_is_collapsable (GtsSplit * vs)
       e3 = e1; e1 = e2; e2 = e3;
     }
 
-    if (!list_array_are_identical (e1->triangles, (gpointer *) cf->a1, t))
+    if (!list_array_are_identical (&e1->triangles, (gpointer *) cf->a1, t))
       return FALSE;
-    if (!list_array_are_identical (e2->triangles, (gpointer *) cf->a2, t))
+    if (!list_array_are_identical (&e2->triangles, (gpointer *) cf->a2, t))
       return FALSE;
     
     cf++;
@@ -24,6 +24,178 @@
 
 #include "gts-private.h"
 
+/* Fibonacci hashing: the high bits of the product depend on all the
+   bits of the pointer */
+#define POINTER_SET_HASH(p, mask) \
+  ((guint) (((guint64) (gsize) (p)*0x9E3779B97F4A7C15ULL) >> 32) & (mask))
+
+static void pointer_set_rehash (GtsPointerSet * set, guint nslots)
+{
+  guint i;
+
+  g_free (set->slots);
+  set->slots = g_malloc0 (nslots*sizeof (guint32));
+  set->mask = nslots - 1;
+  for (i = 0; i < set->n; i++) {
+    guint j = POINTER_SET_HASH (set->items[i], set->mask);
+
+    while (set->slots[j])
+      j = (j + 1) & set->mask;
+    set->slots[j] = i + 1;
+  }
+}
+
+/* Returns the slot holding @item or the empty slot where it would go */
+static guint pointer_set_lookup (GtsPointerSet * set, gpointer item)
+{
+  guint i = POINTER_SET_HASH (item, set->mask);
+
+  while (set->slots[i] && set->items[set->slots[i] - 1] != item)
+    i = (i + 1) & set->mask;
+  return i;
+}
+
+/**
+ * gts_pointer_set_init:
+ * @set: a #GtsPointerSet.
+ *
+ * Makes @set an empty set.
+ */
+void gts_pointer_set_init (GtsPointerSet * set)
+{
+  g_return_if_fail (set != NULL);
+
+  set->items = NULL;
+  set->n = set->size = 0;
+  set->slots = NULL;
+  set->mask = 0;
+}
+
+/**
+ * gts_pointer_set_reserve:
+ * @set: a #GtsPointerSet.
+ * @n: a number of items.
+ *
+ * Makes room in @set for @n items in total, so that adding them does
+ * not reallocate or rehash it.
+ */
+void gts_pointer_set_reserve (GtsPointerSet * set, guint n)
+{
+  guint nslots = 16;
+
+  g_return_if_fail (set != NULL);
+
+  if (n > set->size) {
+    set->items = g_realloc (set->items, n*sizeof (gpointer));
+    set->size = n;
+  }
+  /* keep the table at most half full */
+  while (nslots < 2*n)
+    nslots *= 2;
+  if (set->slots == NULL || nslots > set->mask + 1)
+    pointer_set_rehash (set, nslots);
+}
+
+/**
+ * gts_pointer_set_add:
+ * @set: a #GtsPointerSet.
+ * @item: a pointer.
+ *
+ * Adds @item to @set, after its other items.
+ *
+ * Returns: %TRUE if @item was added, %FALSE if it already belonged to
+ * @set.
+ */
+gboolean gts_pointer_set_add (GtsPointerSet * set, gpointer item)
+{
+  guint i;
+
+  g_return_val_if_fail (set != NULL, FALSE);
+
+  if (set->slots && set->slots[pointer_set_lookup (set, item)])
+    return FALSE;
+  if (set->n == set->size)
+    gts_pointer_set_reserve (set, MAX (2*set->size, 16));
+  i = pointer_set_lookup (set, item);
+  set->items[set->n++] = item;
+  set->slots[i] = set->n;
+  return TRUE;
+}
+
+/**
+ * gts_pointer_set_remove:
+ * @set: a #GtsPointerSet.
+ * @item: a pointer.
+ *
+ * Removes @item from @set, its last item taking the place of @item.
+ *
+ * Returns: %TRUE if @item was removed, %FALSE if it did not belong to
+ * @set.
+ */
+gboolean gts_pointer_set_remove (GtsPointerSet * set, gpointer item)
+{
+  guint i, j, pos, last;
+
+  g_return_val_if_fail (set != NULL, FALSE);
+
+  if (set->slots == NULL)
+    return FALSE;
+  i = pointer_set_lookup (set, item);
+  if (!set->slots[i])
+    return FALSE;
+  pos = set->slots[i] - 1;
+
+  /* shift back the following items of the cluster which can be
+     reached from their home slot without going through i */
+  for (j = (i + 1) & set->mask; set->slots[j]; j = (j + 1) & set->mask) {
+    guint k = POINTER_SET_HASH (set->items[set->slots[j] - 1], set->mask);
+
+    if (((j - k) & set->mask) >= ((j - i) & set->mask)) {
+      set->slots[i] = set->slots[j];
+      i = j;
+    }
+  }
+  set->slots[i] = 0;
+
+  last = --set->n;
+  if (pos != last) {
+    gpointer moved = set->items[last];
+
+    set->slots[pointer_set_lookup (set, moved)] = pos + 1;
+    set->items[pos] = moved;
+  }
+  return TRUE;
+}
+
+/**
+ * gts_pointer_set_contains:
+ * @set: a #GtsPointerSet.
+ * @item: a pointer.
+ *
+ * Returns: %TRUE if @item belongs to @set, %FALSE otherwise.
+ */
+gboolean gts_pointer_set_contains (GtsPointerSet * set, gpointer item)
+{
+  g_return_val_if_fail (set != NULL, FALSE);
+
+  return set->slots && set->slots[pointer_set_lookup (set, item)];
+}
+
+/**
+ * gts_pointer_set_free:
+ * @set: a #GtsPointerSet.
+ *
+ * Frees the memory allocated for @set, leaving it empty.
+ */
+void gts_pointer_set_free (GtsPointerSet * set)
+{
+  g_return_if_fail (set != NULL);
+
+  g_free (set->items);
+  g_free (set->slots);
+  gts_pointer_set_init (set);
+}
+
 static void destroy_foreach_face (GtsFace * f, GtsSurface * s)
 {
   f->surfaces = g_slist_remove (f->surfaces, s);
@@ -32,18 +204,35 @@ static void destroy_foreach_face (GtsFace * f, GtsSurface * s)
     gts_object_destroy (GTS_OBJECT (f));
 }
 
+static gint free_arena_lists (GtsObject * o)
+{
+  if (GTS_IS_FACE (o))
+    g_slist_free (GTS_FACE (o)->surfaces);
+  else if (GTS_IS_EDGE (o))
+    gts_adjacency_free (&GTS_EDGE (o)->triangles,
+			GTS_EDGE (o)->triangle_slots, GTS_EDGE_TRIANGLE_SLOTS);
+  else if (GTS_IS_VERTEX (o))
+    gts_adjacency_free (&GTS_VERTEX (o)->segments,
+			GTS_VERTEX (o)->segment_slots, GTS_VERTEX_SEGMENT_SLOTS);
+  return 0;
+}
+
 static void surface_destroy (GtsObject * object)
 {
   GtsSurface * surface = GTS_SURFACE (object);
+  GtsArena * arena = surface->arena;
   
-  gts_surface_foreach_face (surface, (GtsFunc) destroy_foreach_face, surface);
-#ifdef USE_SURFACE_BTREE
-  g_tree_destroy (surface->faces);
-#else /* not USE_SURFACE_BTREE */
-  g_hash_table_destroy (surface->faces);
-#endif /* not USE_SURFACE_BTREE */
+  if (arena)
+    gts_arena_foreach (arena, (GtsFunc) free_arena_lists, NULL);
+  else
+    gts_surface_foreach_face (surface, (GtsFunc) destroy_foreach_face, 
+			      surface);
+  gts_pointer_set_free (&surface->faces);
 
   (* GTS_OBJECT_CLASS (gts_surface_class ())->parent_class->destroy) (object);
+
+  if (arena)
+    gts_arena_destroy (arena);
 }
 
 static void surface_write (GtsObject * object, FILE * fptr)
@@ -65,24 +254,9 @@ static void surface_class_init (GtsSurfaceClass * klass)
   klass->remove_face = NULL;
 }
 
-#ifdef USE_SURFACE_BTREE
-static gint compare_pointers (gconstpointer a, gconstpointer b)
-{
-  if (GPOINTER_TO_UINT (a) < GPOINTER_TO_UINT (b))
-    return -1;
-  if (GPOINTER_TO_UINT (a) > GPOINTER_TO_UINT (b))
-    return 1;
-  return 0;
-}
-#endif /* USE_SURFACE_BTREE */
-
 static void surface_init (GtsSurface * surface)
 {
-#ifdef USE_SURFACE_BTREE
-  surface->faces = g_tree_new (compare_pointers);
-#else /* not USE_SURFACE_BTREE */
-  surface->faces = g_hash_table_new (NULL, NULL);
-#endif /* not USE_SURFACE_BTREE */
+  gts_pointer_set_init (&surface->faces);
   surface->vertex_class = gts_vertex_class ();
   surface->edge_class = gts_edge_class ();
   surface->face_class = gts_face_class ();
@@ -97,8 +271,9 @@ static void surface_init (GtsSurface * surface)
 GtsSurfaceClass * gts_surface_class (void)
 {
   static GtsSurfaceClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo surface_info = {
       "GtsSurface",
       sizeof (GtsSurface),
@@ -109,6 +284,7 @@ GtsSurfaceClass * gts_surface_class (void)
       (GtsArgGetFunc) NULL
     };
     klass = gts_object_class_new (gts_object_class (), &surface_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -138,6 +314,35 @@ GtsSurface * gts_surface_new (GtsSurfaceClass * klass,
   return s;
 }
 
+/**
+ * gts_surface_set_arena:
+ * @s: a #GtsSurface.
+ * @arena: a #GtsArena or %NULL.
+ *
+ * Gives @arena to @s. When @s is destroyed, the objects allocated from
+ * @arena are not destroyed one by one: the lists linking them together
+ * are freed and then all their memory is released at once with
+ * gts_arena_destroy().
+ *
+ * All the objects allocated from @arena must be the faces, edges and
+ * vertices of @s or objects destroyed before @s, which must not be used
+ * after @s has been destroyed. In particular, the faces of @s must not
+ * belong to any other surface. The destroy methods of these objects are
+ * not called.
+ *
+ * gts_surface_refine() and gts_surface_subdivide_uniform() make @arena
+ * current while they create new objects. Elsewhere, use gts_arena_push()
+ * explicitly.
+ */
+void gts_surface_set_arena (GtsSurface * s, GtsArena * arena)
+{
+  g_return_if_fail (s != NULL);
+  g_return_if_fail (s->arena == NULL);
+  g_return_if_fail (!(GTS_OBJECT_FLAGS (s) & GTS_ARENA));
+
+  s->arena = arena;
+}
+
 /**
  * gts_surface_add_face:
  * @s: a #GtsSurface.
@@ -152,17 +357,8 @@ void gts_surface_add_face (GtsSurface * s, GtsFace * f)
 
   g_assert (s->keep_faces == FALSE);
 
-#ifdef USE_SURFACE_BTREE
-  if (!g_tree_lookup (s->faces, f)) {
+  if (gts_pointer_set_add (&s->faces, f))
     f->surfaces = g_slist_prepend (f->surfaces, s);
-    g_tree_insert (s->faces, f, f);
-  }
-#else /* not USE_SURFACE_BTREE */
-  if (!g_hash_table_lookup (s->faces, f)) {
-    f->surfaces = g_slist_prepend (f->surfaces, s);
-    g_hash_table_insert (s->faces, f, f);
-  }
-#endif /* not USE_SURFACE_BTREE */
 
   if (GTS_SURFACE_CLASS (GTS_OBJECT (s)->klass)->add_face)
     (* GTS_SURFACE_CLASS (GTS_OBJECT (s)->klass)->add_face) (s, f);
@@ -183,11 +379,7 @@ void gts_surface_remove_face (GtsSurface * s,
 
   g_assert (s->keep_faces == FALSE);
 
-#ifdef USE_SURFACE_BTREE
-  g_tree_remove (s->faces, f);
-#else /* not USE_SURFACE_BTREE */
-  g_hash_table_remove (s->faces, f);
-#endif /* not USE_SURFACE_BTREE */
+  gts_pointer_set_remove (&s->faces, f);
 
   f->surfaces = g_slist_remove (f->surfaces, s);
 
@@ -512,15 +704,13 @@ void gts_range_print (GtsRange * r, FILE * fptr)
 
 static void stats_foreach_vertex (GtsVertex * v, GtsSurfaceStats * stats) 
 {
-  GSList * i = v->segments;
-  guint nedges = 0;
+  GtsSegment * s;
+  guint i, nedges = 0;
 
-  while (i) {
-    if (GTS_IS_EDGE (i->data) && 
-	gts_edge_has_parent_surface (i->data, stats->parent))
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s)
+    if (GTS_IS_EDGE (s) && 
+	gts_edge_has_parent_surface (GTS_EDGE (s), stats->parent))
       nedges++;
-    i = i->next;
-  }
   gts_range_add_value (&stats->edges_per_vertex, nedges);
 }
 
@@ -579,20 +769,17 @@ void gts_surface_stats (GtsSurface * s, GtsSurfaceStats * stats)
 static void quality_foreach_edge (GtsSegment * s,
 				  GtsSurfaceQualityStats * stats) 
 {
-  GSList * i = GTS_EDGE (s)->triangles;
+  GtsAdjacency * triangles = &GTS_EDGE (s)->triangles;
+  guint i, j;
 
   gts_range_add_value (&stats->edge_length, 
 		   gts_point_distance (GTS_POINT (s->v1), 
 				       GTS_POINT (s->v2)));
-  while (i) {
-    GSList * j = i->next;
-    while (j) {
+  for (i = 0; i < triangles->n; i++)
+    for (j = i + 1; j < triangles->n; j++)
       gts_range_add_value (&stats->edge_angle,
-			   fabs (gts_triangles_angle (i->data, j->data)));
-      j = j->next;
-    }
-    i = i->next;
-  }
+			   fabs (gts_triangles_angle (triangles->items[i],
+						      triangles->items[j])));
 }
 
 static void quality_foreach_face (GtsTriangle * t,
@@ -925,15 +1112,151 @@ void gts_surface_write_oogl_boundary (GtsSurface * s, FILE * fptr)
   fputs ("}\n", fptr);
 }
 
-#ifdef USE_SURFACE_BTREE
-static gint vertex_foreach_face (GtsTriangle * t,
-				 gpointer t_data,
-				 gpointer * info)
-#else /* not USE_SURFACE_BTREE */
-static void vertex_foreach_face (GtsTriangle * t,
-				 gpointer t_data,
-				 gpointer * info)
-#endif /* not USE_SURFACE_BTREE */
+static void buffers_vertex (GtsPoint * p, gpointer * data)
+{
+  GtsSurfaceBuffers * buffers = data[0];
+  guint * n = data[1];
+  gfloat * v = buffers->vertices + (*n)*buffers->stride;
+
+  v[0] = p->x; v[1] = p->y; v[2] = p->z;
+  GTS_OBJECT (p)->reserved = GUINT_TO_POINTER ((*n)++);
+}
+
+static void buffers_face (GtsTriangle * t, gpointer * data)
+{
+  GtsSurfaceBuffers * buffers = data[0];
+  guint * n = data[1];
+  guint32 * i = buffers->indices + 3*(*n)++;
+  GtsVertex * v1, * v2, * v3;
+
+  gts_triangle_vertices (t, &v1, &v2, &v3);
+  i[0] = GPOINTER_TO_UINT (GTS_OBJECT (v1)->reserved);
+  i[1] = GPOINTER_TO_UINT (GTS_OBJECT (v2)->reserved);
+  i[2] = GPOINTER_TO_UINT (GTS_OBJECT (v3)->reserved);
+
+  if (buffers->stride == 6) {
+    GtsPoint * p1 = GTS_POINT (v1), * p2 = GTS_POINT (v2), 
+      * p3 = GTS_POINT (v3);
+    gdouble x1 = p2->x - p1->x, y1 = p2->y - p1->y, z1 = p2->z - p1->z;
+    gdouble x2 = p3->x - p1->x, y2 = p3->y - p1->y, z2 = p3->z - p1->z;
+    /* area weighted normal */
+    gdouble nx = y1*z2 - z1*y2, ny = z1*x2 - x1*z2, nz = x1*y2 - y1*x2;
+    guint j;
+
+    for (j = 0; j < 3; j++) {
+      gfloat * normal = buffers->vertices + i[j]*6 + 3;
+      normal[0] += nx; normal[1] += ny; normal[2] += nz;
+    }
+  }
+}
+
+/**
+ * gts_surface_buffers_new:
+ * @s: a #GtsSurface.
+ * @normals: whether vertex normals should be computed.
+ *
+ * Builds an indexed representation of @s suitable for uploading to
+ * vertex and index buffers. Each vertex of @s is stored once in the
+ * @vertices array of the result and each face as three indices into
+ * it, in the order given by gts_triangle_vertices(), so that all the
+ * faces of an orientable surface are wound consistently.
+ *
+ * If @normals is %TRUE, the normal of each vertex (the normalized,
+ * area-weighted average of the normals of its faces) is interleaved
+ * after its coordinates and @stride is 6, otherwise @stride is 3.
+ *
+ * The reserved field of the vertices of @s is used and reset to %NULL.
+ *
+ * Returns: a new #GtsSurfaceBuffers.
+ */
+GtsSurfaceBuffers * gts_surface_buffers_new (GtsSurface * s,
+					     gboolean normals)
+{
+  GtsSurfaceBuffers * buffers;
+  gpointer data[2];
+  guint n;
+
+  g_return_val_if_fail (s != NULL, NULL);
+
+  buffers = g_malloc (sizeof (GtsSurfaceBuffers));
+  buffers->nvertices = gts_surface_vertex_number (s);
+  buffers->nfaces = gts_surface_face_number (s);
+  buffers->stride = normals ? 6 : 3;
+  buffers->vertices = normals ?
+    g_malloc0 (buffers->nvertices*6*sizeof (gfloat)) :
+    g_malloc (buffers->nvertices*3*sizeof (gfloat));
+  buffers->indices = g_malloc (buffers->nfaces*3*sizeof (guint32));
+
+  data[0] = buffers;
+  data[1] = &n;
+  n = 0;
+  gts_surface_foreach_vertex (s, (GtsFunc) buffers_vertex, data);
+  n = 0;
+  gts_surface_foreach_face (s, (GtsFunc) buffers_face, data);
+  gts_surface_foreach_vertex (s, (GtsFunc) gts_object_reset_reserved, NULL);
+
+  if (normals)
+    for (n = 0; n < buffers->nvertices; n++) {
+      gfloat * v = buffers->vertices + n*6 + 3;
+      gdouble l = sqrt (v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+
+      if (l > 0.) {
+	v[0] /= l; v[1] /= l; v[2] /= l;
+      }
+    }
+
+  return buffers;
+}
+
+/**
+ * gts_surface_buffers_destroy:
+ * @buffers: a #GtsSurfaceBuffers.
+ *
+ * Frees all the memory allocated for @buffers.
+ */
+void gts_surface_buffers_destroy (GtsSurfaceBuffers * buffers)
+{
+  g_return_if_fail (buffers != NULL);
+
+  g_free (buffers->vertices);
+  g_free (buffers->indices);
+  g_free (buffers);
+}
+
+/* The traversals of the vertices and edges of a surface mark the
+   objects they visit with a fresh stamp rather than collecting them in
+   a hash table. The stamps are global, so that objects shared by
+   several surfaces are never taken as visited by another traversal.
+   They are 64-bit so that they never wrap around: an object not
+   visited since would otherwise be skipped once its stamp comes back.
+   Only one traversal can use them at a time: nested traversals and
+   traversals running in other threads meanwhile use a hash table. */
+static volatile gint stamp_busy = 0;
+static guint64 stamp_current = 0;
+
+/* Returns a new stamp, never 0 which is the stamp of new objects, or 0
+   if they are in use */
+static guint64 stamp_acquire (void)
+{
+  if (!g_atomic_int_compare_and_exchange (&stamp_busy, 0, 1))
+    return 0;
+  return ++stamp_current;
+}
+
+static void stamp_release (void)
+{
+  g_atomic_int_set (&stamp_busy, 0);
+}
+
+#define STAMP_VISIT(o, stamp, func, data) \
+  G_STMT_START { \
+    if (GTS_OBJECT (o)->stamp != (stamp)) { \
+      GTS_OBJECT (o)->stamp = (stamp); \
+      (*(func)) ((o), (data)); \
+    } \
+  } G_STMT_END
+
+static void vertex_foreach_face (GtsTriangle * t, gpointer * info)
 {
   GHashTable * hash = info[0];
   gpointer data = info[1];
@@ -954,9 +1277,6 @@ static void vertex_foreach_face (GtsTriangle * t,
     g_hash_table_insert (hash, gts_triangle_vertex (t), 
 			 GINT_TO_POINTER (-1));
   }
-#ifdef USE_SURFACE_BTREE
-  return FALSE;
-#endif /* USE_SURFACE_BTREE */
 }
 
 /**
@@ -969,36 +1289,40 @@ static void vertex_foreach_face (GtsTriangle * t,
  */
 void gts_surface_foreach_vertex (GtsSurface * s, GtsFunc func, gpointer data)
 {
-  gpointer info[3];
+  GtsTriangle * t;
+  guint64 stamp;
+  guint i;
 
   g_return_if_fail (s != NULL);
   g_return_if_fail (func != NULL);
 
   /* forbid removal of faces */
   s->keep_faces = TRUE;
-  info[0] = g_hash_table_new (NULL, NULL);
-  info[1] = data;
-  info[2] = func;
-#ifdef USE_SURFACE_BTREE
-  g_tree_traverse (s->faces, (GTraverseFunc) vertex_foreach_face, G_IN_ORDER,
-		   info);
-#else /* not USE_SURFACE_BTREE */
-  g_hash_table_foreach (s->faces, (GHFunc) vertex_foreach_face, info);
-#endif /* not USE_SURFACE_BTREE */
-  g_hash_table_destroy (info[0]);
+  if ((stamp = stamp_acquire ())) {
+    GTS_POINTER_SET_FOREACH (&s->faces, i, t) {
+      GtsSegment * s1 = GTS_SEGMENT (t->e1);
+
+      STAMP_VISIT (s1->v1, stamp, func, data);
+      STAMP_VISIT (s1->v2, stamp, func, data);
+      STAMP_VISIT (gts_triangle_vertex (t), stamp, func, data);
+    }
+    stamp_release ();
+  }
+  else {
+    gpointer info[3];
+
+    info[0] = g_hash_table_new (NULL, NULL);
+    info[1] = data;
+    info[2] = func;
+    GTS_POINTER_SET_FOREACH (&s->faces, i, t)
+      vertex_foreach_face (t, info);
+    g_hash_table_destroy (info[0]);
+  }
   /* allow removal of faces */
   s->keep_faces = FALSE;
 }
 
-#ifdef USE_SURFACE_BTREE
-static gint edge_foreach_face (GtsTriangle * t,
-			       gpointer t_data, 
-			       gpointer * info)
-#else /* not USE_SURFACE_BTREE */
-static void edge_foreach_face (GtsTriangle * t,
-			       gpointer t_data, 
-			       gpointer * info)
-#endif /* not USE_SURFACE_BTREE */
+static void edge_foreach_face (GtsTriangle * t, gpointer * info)
 {
   GHashTable * hash = info[0];
   gpointer data = info[1];
@@ -1016,9 +1340,6 @@ static void edge_foreach_face (GtsTriangle * t,
     (*func) (t->e3, data);
     g_hash_table_insert (hash, t->e3, GINT_TO_POINTER (-1));
   }
-#ifdef USE_SURFACE_BTREE
-  return FALSE;
-#endif /* not USE_SURFACE_BTREE */
 }
 
 /**
@@ -1031,43 +1352,37 @@ static void edge_foreach_face (GtsTriangle * t,
  */
 void gts_surface_foreach_edge (GtsSurface * s, GtsFunc func, gpointer data)
 {
-  gpointer info[3];
+  GtsTriangle * t;
+  guint64 stamp;
+  guint i;
 
   g_return_if_fail (s != NULL);
   g_return_if_fail (func != NULL);
   
   /* forbid removal of faces */
   s->keep_faces = TRUE;
-  info[0] = g_hash_table_new (NULL, NULL);
-  info[1] = data;
-  info[2] = func;
-#ifdef USE_SURFACE_BTREE
-  g_tree_traverse (s->faces, (GTraverseFunc) edge_foreach_face, G_IN_ORDER,
-		   info);
-#else /* not USE_SURFACE_BTREE */
-  g_hash_table_foreach (s->faces, (GHFunc) edge_foreach_face, info);
-#endif /* not USE_SURFACE_BTREE */
-  g_hash_table_destroy (info[0]);
+  if ((stamp = stamp_acquire ())) {
+    GTS_POINTER_SET_FOREACH (&s->faces, i, t) {
+      STAMP_VISIT (t->e1, stamp, func, data);
+      STAMP_VISIT (t->e2, stamp, func, data);
+      STAMP_VISIT (t->e3, stamp, func, data);
+    }
+    stamp_release ();
+  }
+  else {
+    gpointer info[3];
+
+    info[0] = g_hash_table_new (NULL, NULL);
+    info[1] = data;
+    info[2] = func;
+    GTS_POINTER_SET_FOREACH (&s->faces, i, t)
+      edge_foreach_face (t, info);
+    g_hash_table_destroy (info[0]);
+  }
   /* allow removal of faces */
   s->keep_faces = FALSE;
 }
 
-#ifdef USE_SURFACE_BTREE
-static gint foreach_face (GtsFace * f, 
-			  gpointer t_data,
-			  gpointer * info)
-#else /* not USE_SURFACE_BTREE */
-static void foreach_face (GtsFace * f, 
-			  gpointer t_data,
-			  gpointer * info)
-#endif /* not USE_SURFACE_BTREE */
-{
-  (*((GtsFunc) info[0])) (f, info[1]);
-#ifdef USE_SURFACE_BTREE
-  return FALSE;
-#endif /* USE_SURFACE_BTREE */
-}
-
 /**
  * gts_surface_foreach_face:
  * @s: a #GtsSurface.
@@ -1080,71 +1395,20 @@ void gts_surface_foreach_face (GtsSurface * s,
 			       GtsFunc func, 
 			       gpointer data)
 {
-  gpointer info[2];
+  GtsFace * f;
+  guint i;
 
   g_return_if_fail (s != NULL);
   g_return_if_fail (func != NULL);
 
   /* forbid removal of faces */
   s->keep_faces = TRUE;
-  info[0] = func;
-  info[1] = data;
-#ifdef USE_SURFACE_BTREE
-  g_tree_traverse (s->faces, (GTraverseFunc) foreach_face, G_IN_ORDER,
-		   info);
-#else /* not USE_SURFACE_BTREE */
-  g_hash_table_foreach (s->faces, (GHFunc) foreach_face, info);
-#endif /* not USE_SURFACE_BTREE */
+  GTS_POINTER_SET_FOREACH (&s->faces, i, f)
+    (*func) (f, data);
   /* allow removal of faces */
   s->keep_faces = FALSE;
 }
 
-#ifdef USE_SURFACE_BTREE
-static gint foreach_face_remove (GtsFace * f,
-				 gpointer t_data,
-				 gpointer * info)
-{
-  if ((*((GtsFunc) info[0])) (f, info[1])) {
-    GtsSurface * s = info[2];
-    guint * n = info[3];
-
-    f->surfaces = g_slist_remove (f->surfaces, s);
-    if (!GTS_OBJECT_DESTROYED (f) &&
-	!gts_allow_floating_faces && 
-	f->surfaces == NULL)
-      gts_object_destroy (GTS_OBJECT (f));
-    
-    if (GTS_SURFACE_CLASS (GTS_OBJECT (s)->klass)->remove_face)
-      (* GTS_SURFACE_CLASS (GTS_OBJECT (s)->klass)->remove_face) (s, f);
-
-    g_tree_remove (s->faces, f);
-    (*n)++;
-  }
-  return FALSE;
-}
-#else /* not USE_SURFACE_BTREE */
-static gboolean foreach_face_remove (GtsFace * f,
-				     gpointer t_data,
-				     gpointer * info)
-{
-  if ((*((GtsFunc) info[0])) (f, info[1])) {
-    GtsSurface * s = info[2];
-
-    f->surfaces = g_slist_remove (f->surfaces, s);
-    if (!GTS_OBJECT_DESTROYED (f) &&
-	!gts_allow_floating_faces && 
-	f->surfaces == NULL)
-      gts_object_destroy (GTS_OBJECT (f));
-    
-    if (GTS_SURFACE_CLASS (GTS_OBJECT (s)->klass)->remove_face)
-      (* GTS_SURFACE_CLASS (GTS_OBJECT (s)->klass)->remove_face) (s, f);
-
-    return TRUE;
-  }
-  return FALSE;
-}
-#endif /* not USE_SURFACE_BTREE */
-
 /**
  * gts_surface_foreach_face_remove:
  * @s: a #GtsSurface.
@@ -1162,74 +1426,321 @@ guint gts_surface_foreach_face_remove (GtsSurface * s,
 				       GtsFunc func, 
 				       gpointer data)
 {
-  gpointer info[4];
-  guint n = 0;
+  guint i = 0, n = 0;
 
   g_return_val_if_fail (s != NULL, 0);
   g_return_val_if_fail (func != NULL, 0);
 
   /* forbid removal of faces */
   s->keep_faces = TRUE;
-  info[0] = func;
-  info[1] = data;
-  info[2] = s;
-#ifdef USE_SURFACE_BTREE
-  info[3] = &n;
-  g_tree_traverse (s->faces, (GTraverseFunc) foreach_face_remove, G_PRE_ORDER,
-		   info);
-#else /* not USE_SURFACE_BTREE */
-  n = g_hash_table_foreach_remove (s->faces, 
-				   (GHRFunc) foreach_face_remove, 
-				   info);
-#endif /* not USE_SURFACE_BTREE */
+  while (i < s->faces.n) {
+    GtsFace * f = s->faces.items[i];
+
+    if ((*func) (f, data)) {
+      /* the last face takes the place of f */
+      gts_pointer_set_remove (&s->faces, f);
+      f->surfaces = g_slist_remove (f->surfaces, s);
+      if (!GTS_OBJECT_DESTROYED (f) &&
+	  !gts_allow_floating_faces && 
+	  f->surfaces == NULL)
+	gts_object_destroy (GTS_OBJECT (f));
+
+      if (GTS_SURFACE_CLASS (GTS_OBJECT (s)->klass)->remove_face)
+	(* GTS_SURFACE_CLASS (GTS_OBJECT (s)->klass)->remove_face) (s, f);
+      n++;
+    }
+    else
+      i++;
+  }
   /* allow removal of faces */
   s->keep_faces = FALSE;
   
   return n;
 }
 
+typedef struct {
+  guint start, end;
+  guint index;
+} SurfaceChunk;
+
+/* Returns the number of chunks surface_foreach_chunk() splits n items
+   into */
+static guint surface_chunk_number (guint n, guint nthreads)
+{
+  /* a few chunks per thread to balance uneven costs */
+  return nthreads > 1 && n > 1 ? MIN (4*nthreads, n) : 1;
+}
+
+/* Calls @func on chunks covering [0, n) using @nthreads threads from a
+   pool, or directly from the calling thread if there is only one. */
+static void surface_foreach_chunk (GFunc func, gpointer data,
+				   guint n, guint nthreads)
+{
+  guint i, nchunks, chunk_size;
+
+  nchunks = surface_chunk_number (n, nthreads);
+  if (nchunks > 1) {
+    GThreadPool * pool = g_thread_pool_new (func, data, nthreads, TRUE, NULL);
+    SurfaceChunk * chunks = g_malloc (nchunks*sizeof (SurfaceChunk));
+
+    chunk_size = (n + nchunks - 1)/nchunks;
+    for (i = 0; i < nchunks; i++) {
+      chunks[i].start = MIN (i*chunk_size, n);
+      chunks[i].end = MIN ((i + 1)*chunk_size, n);
+      chunks[i].index = i;
+      if (chunks[i].start < chunks[i].end)
+	g_thread_pool_push (pool, &chunks[i], NULL);
+    }
+    /* waits for all the chunks to be processed */
+    g_thread_pool_free (pool, FALSE, TRUE);
+    g_free (chunks);
+  }
+  else {
+    SurfaceChunk chunk;
+
+    chunk.start = 0;
+    chunk.end = n;
+    chunk.index = 0;
+    (*func) (&chunk, data);
+  }
+}
+
+typedef struct {
+  gpointer * items;
+  GtsParallelFunc func;
+  gpointer data;
+  gchar * states;
+  gsize stride;
+} ParallelForeach;
+
+static void parallel_foreach_chunk (SurfaceChunk * chunk, ParallelForeach * p)
+{
+  gpointer state = p->states ? p->states + chunk->index*p->stride : NULL;
+  guint i;
+
+  for (i = chunk->start; i < chunk->end; i++)
+    (*p->func) (p->items[i], state, p->data);
+}
+
+static void parallel_foreach (gpointer * items, guint n,
+			      GtsParallelFunc func, gpointer data,
+			      GtsReduction * reduction, guint nthreads)
+{
+  ParallelForeach p;
+  guint nchunks, i;
+
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+  nchunks = surface_chunk_number (n, nthreads);
+
+  p.items = items;
+  p.func = func;
+  p.data = data;
+  p.states = NULL;
+  p.stride = 0;
+  if (reduction) {
+    /* a cache line at least per state, so that the threads do not
+       write to the same lines */
+    p.stride = (MAX (reduction->state_size, 1) + 63) & ~(gsize) 63;
+    p.states = g_malloc0 (nchunks*p.stride);
+    if (reduction->init)
+      for (i = 0; i < nchunks; i++)
+	(*reduction->init) (reduction->result, p.states + i*p.stride, data);
+  }
+
+  surface_foreach_chunk ((GFunc) parallel_foreach_chunk, &p, n, nthreads);
+
+  if (reduction) {
+    /* in order, so that the result does not depend on the scheduling */
+    if (reduction->merge)
+      for (i = 0; i < nchunks; i++)
+	(*reduction->merge) (reduction->result, p.states + i*p.stride, data);
+    g_free (p.states);
+  }
+}
+
+static gint create_array_parallel (gpointer item, GPtrArray * items)
+{
+  g_ptr_array_add (items, item);
+  return 0;
+}
+
+/**
+ * gts_surface_parallel_foreach_face:
+ * @s: a #GtsSurface.
+ * @func: a #GtsParallelFunc.
+ * @data: user data to be passed to @func.
+ * @reduction: a #GtsReduction or %NULL.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Calls @func once for each face of @s, the faces being split into a
+ * few contiguous chunks per thread processed concurrently by
+ * @nthreads threads. @func must be thread-safe: it must not modify @s
+ * and any state it shares through @data must be protected by the
+ * caller.
+ *
+ * If @reduction is not %NULL, each chunk gets its own state of
+ * @reduction->state_size bytes, passed to @func together with the
+ * faces of the chunk. The states are zeroed and then given to the @init function
+ * of @reduction, if any, together with its @result. Once all the faces
+ * have been visited, the @merge function of @reduction merges the
+ * states into @result from the calling thread, in the order of the
+ * chunks, so that the result does not depend on the scheduling of the
+ * threads.
+ */
+void gts_surface_parallel_foreach_face (GtsSurface * s,
+					GtsParallelFunc func,
+					gpointer data,
+					GtsReduction * reduction,
+					guint nthreads)
+{
+  g_return_if_fail (s != NULL);
+  g_return_if_fail (func != NULL);
+
+  /* forbid removal of faces */
+  s->keep_faces = TRUE;
+  parallel_foreach (s->faces.items, s->faces.n, func, data,
+		    reduction, nthreads);
+  /* allow removal of faces */
+  s->keep_faces = FALSE;
+}
+
+/**
+ * gts_surface_parallel_foreach_edge:
+ * @s: a #GtsSurface.
+ * @func: a #GtsParallelFunc.
+ * @data: user data to be passed to @func.
+ * @reduction: a #GtsReduction or %NULL.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Same as gts_surface_parallel_foreach_face() for the edges of @s,
+ * which are first collected with gts_surface_foreach_edge().
+ */
+void gts_surface_parallel_foreach_edge (GtsSurface * s,
+					GtsParallelFunc func,
+					gpointer data,
+					GtsReduction * reduction,
+					guint nthreads)
+{
+  GPtrArray * edges;
+
+  g_return_if_fail (s != NULL);
+  g_return_if_fail (func != NULL);
+
+  edges = g_ptr_array_sized_new (3*s->faces.n/2 + 1);
+  gts_surface_foreach_edge (s, (GtsFunc) create_array_parallel, edges);
+  s->keep_faces = TRUE;
+  parallel_foreach (edges->pdata, edges->len, func, data,
+		    reduction, nthreads);
+  s->keep_faces = FALSE;
+  g_ptr_array_free (edges, TRUE);
+}
+
+/**
+ * gts_surface_parallel_foreach_vertex:
+ * @s: a #GtsSurface.
+ * @func: a #GtsParallelFunc.
+ * @data: user data to be passed to @func.
+ * @reduction: a #GtsReduction or %NULL.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Same as gts_surface_parallel_foreach_face() for the vertices of @s,
+ * which are first collected with gts_surface_foreach_vertex().
+ */
+void gts_surface_parallel_foreach_vertex (GtsSurface * s,
+					  GtsParallelFunc func,
+					  gpointer data,
+					  GtsReduction * reduction,
+					  guint nthreads)
+{
+  GPtrArray * vertices;
+
+  g_return_if_fail (s != NULL);
+  g_return_if_fail (func != NULL);
+
+  vertices = g_ptr_array_sized_new (s->faces.n/2 + 3);
+  gts_surface_foreach_vertex (s, (GtsFunc) create_array_parallel, vertices);
+  s->keep_faces = TRUE;
+  parallel_foreach (vertices->pdata, vertices->len, func, data,
+		    reduction, nthreads);
+  s->keep_faces = FALSE;
+  g_ptr_array_free (vertices, TRUE);
+}
+
+typedef struct {
+  GtsEdge ** edges;
+  GtsVertex ** midvertices;
+  GtsRefineFunc refine_func;
+  gpointer refine_data;
+  GtsVertexClass * vertex_class;
+  GtsArena * arena;
+} RefineMidvertices;
+
+static void refine_midvertices_chunk (SurfaceChunk * chunk,
+				      RefineMidvertices * m)
+{
+  guint i;
+
+  /* the arena is only current in the thread which pushed it */
+  if (m->arena)
+    gts_arena_push (m->arena);
+  for (i = chunk->start; i < chunk->end; i++)
+    m->midvertices[i] = (*m->refine_func) (m->edges[i], m->vertex_class,
+					   m->refine_data);
+  if (m->arena)
+    gts_arena_pop (m->arena);
+}
+
+/* Adds @e to @heap or, if @heap is %NULL, to the array of the edges
+   whose costs are evaluated later */
+static void refine_add_edge (GtsEdge * e, GtsEHeap * heap, GPtrArray * created)
+{
+  if (heap)
+    gts_eheap_insert (heap, e);
+  else
+    g_ptr_array_add (created, e);
+}
+
 static void midvertex_insertion (GtsEdge * e,
+				 GtsVertex * midvertex,
 				 GtsSurface * surface,
 				 GtsEHeap * heap,
-				 GtsRefineFunc refine_func,
-				 gpointer refine_data,
-				 GtsVertexClass * vertex_class,
+				 GPtrArray * created,
 				 GtsEdgeClass * edge_class)
 {
-  GtsVertex * midvertex;
   GtsEdge * e1, * e2;
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
 
-  midvertex = (*refine_func) (e, vertex_class, refine_data);
   e1 = gts_edge_new (edge_class, GTS_SEGMENT (e)->v1, midvertex);
-  gts_eheap_insert (heap, e1);
+  refine_add_edge (e1, heap, created);
   e2 = gts_edge_new (edge_class, GTS_SEGMENT (e)->v2, midvertex);
-  gts_eheap_insert (heap, e2);
+  refine_add_edge (e2, heap, created);
   
   /* creates new faces and modifies old ones */
-  i = e->triangles;
-  while (i) {
-    GtsTriangle * t = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t) {
     GtsVertex * v1, * v2, * v3;
     GtsEdge * te2, * te3, * ne, * tmp;
 
     gts_triangle_vertices_edges (t, e, &v1, &v2, &v3, &e, &te2, &te3);
     ne = gts_edge_new (edge_class, midvertex, v3);
-    gts_eheap_insert (heap, ne);
+    refine_add_edge (ne, heap, created);
     if (GTS_SEGMENT (e1)->v1 == v2) {
       tmp = e1; e1 = e2; e2 = tmp;
     }
-    e1->triangles = g_slist_prepend (e1->triangles, t);
-    ne->triangles = g_slist_prepend (ne->triangles, t);
-    te2->triangles = g_slist_remove (te2->triangles, t);
+    gts_edge_add_triangle (e1, t);
+    gts_edge_add_triangle (ne, t);
+    gts_edge_remove_triangle (te2, t);
     t->e1 = e1; t->e2 = ne; t->e3 = te3;
     gts_surface_add_face (surface, 
 			  gts_face_new (surface->face_class, e2, te2, ne));
-    i = i->next;
   }
   /* destroys edge */
-  g_slist_free (e->triangles);
-  e->triangles = NULL;
+  gts_adjacency_free (&e->triangles, e->triangle_slots,
+		      GTS_EDGE_TRIANGLE_SLOTS);
   gts_object_destroy (GTS_OBJECT (e));
 }
 
@@ -1243,6 +1754,30 @@ static void create_heap_refine (GtsEdge * e, GtsEHeap * heap)
   gts_eheap_insert (heap, e);
 }
 
+static void surface_refine (GtsSurface * surface,
+			    GtsEHeap * heap,
+			    GtsRefineFunc refine_func,
+			    gpointer refine_data,
+			    GtsStopFunc stop_func,
+			    gpointer stop_data)
+{
+  GtsEdge * e;
+  gdouble top_cost;
+
+  if (surface->arena)
+    gts_arena_push (surface->arena);
+  while ((e = gts_eheap_remove_top (heap, &top_cost)) &&
+	 !(*stop_func) (top_cost,
+			gts_eheap_size (heap) + 
+			gts_edge_face_number (e, surface) + 2,
+			stop_data))
+    midvertex_insertion (e, (*refine_func) (e, surface->vertex_class,
+					    refine_data),
+			 surface, heap, NULL, surface->edge_class);
+  if (surface->arena)
+    gts_arena_pop (surface->arena);
+}
+
 /**
  * gts_surface_refine:
  * @surface: a #GtsSurface.
@@ -1273,8 +1808,6 @@ void gts_surface_refine (GtsSurface * surface,
 			 gpointer stop_data)
 {
   GtsEHeap * heap;
-  GtsEdge * e;
-  gdouble top_cost;
 
   g_return_if_fail (surface != NULL);
   g_return_if_fail (stop_func != NULL);
@@ -1288,26 +1821,409 @@ void gts_surface_refine (GtsSurface * surface,
   gts_eheap_freeze (heap);
   gts_surface_foreach_edge (surface, (GtsFunc) create_heap_refine, heap);
   gts_eheap_thaw (heap);
-  while ((e = gts_eheap_remove_top (heap, &top_cost)) &&
-	 !(*stop_func) (top_cost,
-			gts_eheap_size (heap) + 
-			gts_edge_face_number (e, surface) + 2,
-			stop_data))
-    midvertex_insertion (e, surface, heap, refine_func, refine_data,
-			 surface->vertex_class, surface->edge_class);
+  surface_refine (surface, heap, refine_func, refine_data,
+		  stop_func, stop_data);
   gts_eheap_destroy (heap);
 }
 
-static GSList * edge_triangles (GtsEdge * e1, GtsEdge * e)
+typedef struct {
+  GtsEdge ** edges;
+  gdouble * costs;
+  GtsKeyBatchFunc batch_func;
+  GtsKeyFunc cost_func;
+  gpointer cost_data;
+} EdgeCosts;
+
+static void edge_costs_chunk (SurfaceChunk * chunk, EdgeCosts * costs)
+{
+  guint i;
+
+  if (costs->batch_func) {
+    (*costs->batch_func) ((gpointer *) costs->edges + chunk->start,
+			  costs->costs + chunk->start,
+			  chunk->end - chunk->start,
+			  costs->cost_data);
+    return;
+  }
+  for (i = chunk->start; i < chunk->end; i++)
+    costs->costs[i] = (*costs->cost_func) (costs->edges[i], 
+					   costs->cost_data);
+}
+
+static void create_array_refine (GtsEdge * e, GPtrArray * edges)
 {
-  GSList * i = e1->triangles;
-  GSList * triangles = NULL;
+  g_ptr_array_add (edges, e);
+}
+
+/**
+ * gts_surface_refine_parallel:
+ * @surface: a #GtsSurface.
+ * @cost_func: a function returning the cost for a given edge.
+ * @cost_data: user data to be passed to @cost_func.
+ * @refine_func: a #GtsRefineFunc.
+ * @refine_data: user data to be passed to @refine_func.
+ * @stop_func: a #GtsStopFunc.
+ * @stop_data: user data to be passed to @stop_func.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Same as gts_surface_refine() but the initial costs of the edges of
+ * @surface are evaluated in parallel using @nthreads threads before the
+ * heap is built in O(n) time. The edges are then processed in the same
+ * order as with gts_surface_refine().
+ *
+ * @cost_func is called concurrently from several threads, for
+ * different edges, while the initial costs are evaluated. It must
+ * therefore be thread-safe: it must not modify @surface and any state
+ * it shares through @cost_data must be protected by the caller. Once
+ * the heap is built, all the functions are called from the calling
+ * thread only.
+ */
+void gts_surface_refine_parallel (GtsSurface * surface,
+				  GtsKeyFunc cost_func,
+				  gpointer cost_data,
+				  GtsRefineFunc refine_func,
+				  gpointer refine_data,
+				  GtsStopFunc stop_func,
+				  gpointer stop_data,
+				  guint nthreads)
+{
+  gts_surface_refine_batch (surface, NULL, cost_func, cost_data,
+			    refine_func, refine_data,
+			    stop_func, stop_data, nthreads);
+}
+
+/**
+ * gts_surface_refine_batch:
+ * @surface: a #GtsSurface.
+ * @batch_func: a function setting the costs of an array of edges or
+ * %NULL.
+ * @cost_func: a function returning the cost for a given edge.
+ * @cost_data: user data to be passed to @batch_func and @cost_func.
+ * @refine_func: a #GtsRefineFunc.
+ * @refine_data: user data to be passed to @refine_func.
+ * @stop_func: a #GtsStopFunc.
+ * @stop_data: user data to be passed to @stop_func.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Same as gts_surface_refine_parallel() but the initial costs are
+ * evaluated by calling @batch_func on contiguous arrays of edges, each
+ * thread handling a few of them. This lets @batch_func evaluate many
+ * edges at once, using SIMD instructions for example. @cost_func must
+ * return the same costs as @batch_func; it is used for the edges
+ * created during refinement. If @batch_func is %NULL, @cost_func is
+ * used for all the edges.
+ *
+ * @batch_func is called concurrently, for disjoint arrays of edges,
+ * and must be thread-safe in the same way as @cost_func.
+ */
+void gts_surface_refine_batch (GtsSurface * surface,
+			       GtsKeyBatchFunc batch_func,
+			       GtsKeyFunc cost_func,
+			       gpointer cost_data,
+			       GtsRefineFunc refine_func,
+			       gpointer refine_data,
+			       GtsStopFunc stop_func,
+			       gpointer stop_data,
+			       guint nthreads)
+{
+  GtsEHeap * heap;
+  GPtrArray * edges;
+  EdgeCosts costs;
+
+  g_return_if_fail (surface != NULL);
+  g_return_if_fail (stop_func != NULL);
+  g_return_if_fail (batch_func == NULL || cost_func != NULL);
+
+  if (cost_func == NULL)
+    cost_func = (GtsKeyFunc) edge_length2_inverse;
+  if (refine_func == NULL)
+    refine_func = (GtsRefineFunc) gts_segment_midvertex;
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+
+  edges = g_ptr_array_new ();
+  gts_surface_foreach_edge (surface, (GtsFunc) create_array_refine, edges);
+
+  costs.edges = (GtsEdge **) edges->pdata;
+  costs.costs = g_malloc (edges->len*sizeof (gdouble));
+  costs.batch_func = batch_func;
+  costs.cost_func = cost_func;
+  costs.cost_data = cost_data;
+
+  surface_foreach_chunk ((GFunc) edge_costs_chunk, &costs,
+			 edges->len, nthreads);
+
+  heap = gts_eheap_new (cost_func, cost_data);
+  gts_eheap_insert_array (heap, edges->pdata, costs.costs, edges->len, NULL);
+  g_free (costs.costs);
+  g_ptr_array_free (edges, TRUE);
+
+  surface_refine (surface, heap, refine_func, refine_data,
+		  stop_func, stop_data);
+  gts_eheap_destroy (heap);
+}
+
+/* number of edges per thread taken from the heap at each round of
+   gts_surface_refine_independent() */
+#define REFINE_CANDIDATES_PER_THREAD 256
+
+/* The vertices of the triangles of the edges selected during a round are
+   marked with the surface in their reserved field */
+static gboolean edge_ring_is_free (GtsEdge * e, GtsSurface * s)
+{
+  GtsTriangle * t;
+  guint i;
+
+  if (GTS_OBJECT (GTS_SEGMENT (e)->v1)->reserved == s ||
+      GTS_OBJECT (GTS_SEGMENT (e)->v2)->reserved == s)
+    return FALSE;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
+    if (GTS_OBJECT (gts_triangle_vertex_opposite (t, e))->reserved == s)
+      return FALSE;
+  return TRUE;
+}
+
+static void edge_ring_mark (GtsEdge * e, GtsSurface * s, GPtrArray * marked)
+{
+  GtsTriangle * t;
+  guint i;
+
+  GTS_OBJECT (GTS_SEGMENT (e)->v1)->reserved = s;
+  g_ptr_array_add (marked, GTS_SEGMENT (e)->v1);
+  GTS_OBJECT (GTS_SEGMENT (e)->v2)->reserved = s;
+  g_ptr_array_add (marked, GTS_SEGMENT (e)->v2);
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t) {
+    GtsVertex * v = gts_triangle_vertex_opposite (t, e);
+
+    GTS_OBJECT (v)->reserved = s;
+    g_ptr_array_add (marked, v);
+  }
+}
+
+/**
+ * gts_surface_refine_independent:
+ * @surface: a #GtsSurface.
+ * @batch_func: a function setting the costs of an array of edges or
+ * %NULL.
+ * @cost_func: a function returning the cost for a given edge.
+ * @cost_data: user data to be passed to @batch_func and @cost_func.
+ * @refine_func: a #GtsRefineFunc.
+ * @refine_data: user data to be passed to @refine_func.
+ * @stop_func: a #GtsStopFunc.
+ * @stop_data: user data to be passed to @stop_func.
+ * @slack: how far from the order of the costs the edges may be refined.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Same as gts_surface_refine_batch() but the edges are refined by
+ * rounds, @refine_func and @cost_func (or @batch_func) being called in
+ * parallel within each round.
+ *
+ * Each round takes the edges on top of the heap whose cost is not
+ * larger than the cost c of the top edge plus @slack |c|, and selects
+ * those which share no vertex with the triangles of the edges already
+ * selected, the others being kept for the next rounds. The midvertices
+ * of the selected edges are computed in parallel, the edges are split
+ * by the calling thread and the costs of the new edges are evaluated in
+ * parallel before they are added to the heap all at once. @stop_func
+ * is called for each selected edge in order, as with
+ * gts_surface_refine(): a round ends when it returns %TRUE and the
+ * refinement stops when it does so for the top edge of a round.
+ *
+ * The larger @slack, the more edges can be refined in parallel but the
+ * further the edges refined are from the order of their costs. With a
+ * @slack of zero, only edges of equal cost are refined together.
+ *
+ * @refine_func is called concurrently for different edges and must
+ * be thread-safe in the same way as @cost_func. It must not modify the
+ * topology of @surface.
+ */
+void gts_surface_refine_independent (GtsSurface * surface,
+				     GtsKeyBatchFunc batch_func,
+				     GtsKeyFunc cost_func,
+				     gpointer cost_data,
+				     GtsRefineFunc refine_func,
+				     gpointer refine_data,
+				     GtsStopFunc stop_func,
+				     gpointer stop_data,
+				     gdouble slack,
+				     guint nthreads)
+{
+  GtsEHeap * heap;
+  GPtrArray * edges, * selected, * deferred, * marked;
+  GArray * deferred_costs;
+  EdgeCosts costs;
+  RefineMidvertices m;
+  guint i, max_candidates;
+
+  g_return_if_fail (surface != NULL);
+  g_return_if_fail (stop_func != NULL);
+  g_return_if_fail (batch_func == NULL || cost_func != NULL);
+  g_return_if_fail (slack >= 0.);
+
+  if (cost_func == NULL)
+    cost_func = (GtsKeyFunc) edge_length2_inverse;
+  if (refine_func == NULL)
+    refine_func = (GtsRefineFunc) gts_segment_midvertex;
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+  max_candidates = REFINE_CANDIDATES_PER_THREAD*nthreads;
+
+  edges = g_ptr_array_new ();
+  gts_surface_foreach_edge (surface, (GtsFunc) create_array_refine, edges);
+
+  costs.costs = NULL;
+  costs.batch_func = batch_func;
+  costs.cost_func = cost_func;
+  costs.cost_data = cost_data;
+
+  heap = gts_eheap_new (cost_func, cost_data);
+  selected = g_ptr_array_new ();
+  deferred = g_ptr_array_new ();
+  deferred_costs = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  marked = g_ptr_array_new ();
+
+  m.refine_func = refine_func;
+  m.refine_data = refine_data;
+  m.vertex_class = surface->vertex_class;
+  m.arena = surface->arena;
+  m.midvertices = NULL;
+
+  if (surface->arena)
+    gts_arena_push (surface->arena);
+  /* the edges of the first round are the initial edges, whose costs are
+     evaluated in the same way as the edges created by each round */
+  while (edges->len > 0) {
+    guint nedges;
+    gdouble top_cost = 0.;
+    GtsEdge * e;
+
+    costs.edges = (GtsEdge **) edges->pdata;
+    costs.costs = g_realloc (costs.costs, edges->len*sizeof (gdouble));
+    surface_foreach_chunk ((GFunc) edge_costs_chunk, &costs,
+			   edges->len, nthreads);
+    gts_eheap_insert_array (heap, edges->pdata, costs.costs, edges->len,
+			    NULL);
+    g_ptr_array_set_size (edges, 0);
+
+    /* selects the edges of this round */
+    nedges = gts_eheap_size (heap);
+    g_ptr_array_set_size (selected, 0);
+    g_ptr_array_set_size (deferred, 0);
+    g_array_set_size (deferred_costs, 0);
+    while (selected->len + deferred->len < max_candidates) {
+      gdouble cost;
+
+      if (!(e = gts_eheap_top (heap, &cost)))
+	break;
+      if (selected->len + deferred->len == 0)
+	top_cost = cost;
+      else if (cost > top_cost + slack*fabs (top_cost))
+	break;
+      if (!edge_ring_is_free (e, surface)) {
+	gts_eheap_remove_top (heap, NULL);
+	g_ptr_array_add (deferred, e);
+	g_array_append_val (deferred_costs, cost);
+	continue;
+      }
+      /* the edges deferred and created by this round may still come
+	 before e: refinement only stops with an empty round */
+      nedges += gts_edge_face_number (e, surface) + 1;
+      if ((*stop_func) (cost, nedges, stop_data))
+	break;
+      gts_eheap_remove_top (heap, NULL);
+      edge_ring_mark (e, surface, marked);
+      g_ptr_array_add (selected, e);
+    }
+    for (i = 0; i < marked->len; i++)
+      GTS_OBJECT (marked->pdata[i])->reserved = NULL;
+    g_ptr_array_set_size (marked, 0);
+    gts_eheap_insert_array (heap, deferred->pdata,
+			    (gdouble *) deferred_costs->data, deferred->len,
+			    NULL);
+
+    /* refines them */
+    m.edges = (GtsEdge **) selected->pdata;
+    m.midvertices = g_realloc (m.midvertices,
+			       selected->len*sizeof (GtsVertex *));
+    surface_foreach_chunk ((GFunc) refine_midvertices_chunk, &m,
+			   selected->len, nthreads);
+    for (i = 0; i < selected->len; i++)
+      midvertex_insertion (selected->pdata[i], m.midvertices[i],
+			   surface, NULL, edges, surface->edge_class);
+  }
+  if (surface->arena)
+    gts_arena_pop (surface->arena);
+
+  g_free (costs.costs);
+  g_free (m.midvertices);
+  g_ptr_array_free (edges, TRUE);
+  g_ptr_array_free (selected, TRUE);
+  g_ptr_array_free (deferred, TRUE);
+  g_array_free (deferred_costs, TRUE);
+  g_ptr_array_free (marked, TRUE);
+  gts_eheap_destroy (heap);
+}
+
+/**
+ * gts_refine_stop_tolerance:
+ * @cost: the cost of the edge considered for refinement.
+ * @nedge: the number of edges of the surface once the edge is refined.
+ * @t: a #GtsRefineTolerance.
+ *
+ * This function is to be used as the @stop_func argument of
+ * gts_surface_refine() or gts_surface_refine_parallel(). The cost of
+ * an edge must be minus its approximation error (for example the
+ * distance between its midpoint and the surface), so that the edge
+ * with the largest error is refined first.
+ *
+ * Refinement stops as soon as the largest error left falls below
+ * @t->tolerance or when refining the edge could take the surface
+ * above @t->max_faces faces (if @t->max_faces is not zero). The
+ * number of faces of a triangulated surface is bounded by two thirds
+ * of its number of edges, so that @t->max_faces is a hard cap.
+ *
+ * When refinement stops, @t->bound is set to the largest error of
+ * the edges left unrefined, i.e. the bound achieved by the refined
+ * surface, and @t->budget_exceeded tells whether this bound is larger
+ * than @t->tolerance because the face budget was exhausted first.
+ *
+ * Returns: %TRUE if refinement should stop, %FALSE otherwise.
+ */
+gboolean gts_refine_stop_tolerance (gdouble cost,
+				    guint nedge,
+				    GtsRefineTolerance * t)
+{
+  g_return_val_if_fail (t != NULL, TRUE);
+
+  if (-cost <= t->tolerance) {
+    t->bound = MAX (-cost, 0.);
+    t->budget_exceeded = FALSE;
+    return TRUE;
+  }
+  if (t->max_faces > 0 && 2*(gdouble) nedge/3. > t->max_faces) {
+    t->bound = -cost;
+    t->budget_exceeded = TRUE;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* Adds to @triangles the triangles of @e1 once @e has been collapsed:
+   the triangles of @e are replaced with the triangles on the other side
+   of their third edge */
+static void edge_triangles (GtsEdge * e1, GtsEdge * e, GPtrArray * triangles)
+{
+  GtsTriangle * t;
+  guint i;
   
-  while (i) {
-    GtsTriangle * t = i->data;
+  GTS_ADJACENCY_FOREACH (&e1->triangles, i, t) {
     if (t->e1 == e || t->e2 == e || t->e3 == e) {
       GtsEdge * e2;
-      GSList * j;
+      GtsTriangle * t2;
+      guint j;
       if (t->e1 == e) {
 	if (t->e2 == e1)
 	  e2 = t->e3;
@@ -1326,31 +2242,86 @@ static GSList * edge_triangles (GtsEdge * e1, GtsEdge * e)
 	else
 	  e2 = t->e2;
       }
-      j = e2->triangles;
-      while (j) {
-	GtsTriangle * t = j->data;
-	if (t->e1 != e && t->e2 != e && t->e3 != e)
-	  triangles = g_slist_prepend (triangles, t);
-	j = j->next;
-      }
+      GTS_ADJACENCY_FOREACH (&e2->triangles, j, t2)
+	if (t2->e1 != e && t2->e2 != e && t2->e3 != e)
+	  g_ptr_array_add (triangles, t2);
+    }
+    else
+      g_ptr_array_add (triangles, t);
+  }
+}
+
+/* Vertex @u once the edge @v1 @v2 has been collapsed to @v */
+#define COLLAPSED(u, v1, v2, v) ((u) == (v1) || (u) == (v2) ? (v) : (u))
+
+/* Returns the vertex of @t other than @A and @B once the edge @v1 @v2 has
+   been collapsed to @v */
+static GtsVertex * collapsed_third_vertex (GtsTriangle * t,
+					   GtsVertex * A, GtsVertex * B,
+					   GtsVertex * v1, GtsVertex * v2,
+					   GtsVertex * v)
+{
+  GtsVertex * a = COLLAPSED (GTS_SEGMENT (t->e1)->v1, v1, v2, v);
+  GtsVertex * b = COLLAPSED (GTS_SEGMENT (t->e1)->v2, v1, v2, v);
+
+  if (a != A && a != B)
+    return a;
+  if (b != A && b != B)
+    return b;
+  return COLLAPSED (gts_triangle_vertex (t), v1, v2, v);
+}
+
+/* Same as gts_triangles_are_folded() for the @n @triangles once the edge
+   @v1 @v2 has been collapsed to @v */
+static gboolean collapsed_triangles_are_folded (GtsTriangle ** triangles,
+						guint n,
+						GtsVertex * A, GtsVertex * B,
+						GtsVertex * v1, GtsVertex * v2,
+						GtsVertex * v,
+						gdouble max)
+{
+  guint i, j;
+
+  for (i = 0; i < n; i++) {
+    GtsVertex * C = collapsed_third_vertex (triangles[i], A, B, v1, v2, v);
+
+    for (j = i + 1; j < n; j++) {
+      GtsVertex * D = collapsed_third_vertex (triangles[j], A, B, 
+					      v1, v2, v);
+
+      if (gts_points_are_folded (GTS_POINT (A), GTS_POINT (B),
+				 GTS_POINT (C), GTS_POINT (D), max))
+	return TRUE;
     }
-    else
-      triangles = g_slist_prepend (triangles, t);
-    i = i->next;
   }
-  return triangles;
+  return FALSE;
 }
 
-static void replace_vertex (GSList * i, GtsVertex * v1, GtsVertex * v)
+/* Returns the edge of @t touching neither @v1 nor @v2 or %NULL */
+static GtsEdge * triangle_edge_away (GtsTriangle * t,
+				     GtsVertex * v1, GtsVertex * v2)
 {
-  while (i) {
-    GtsSegment * s = i->data;
-    if (s->v1 == v1)
-      s->v1 = v;
-    else
-      s->v2 = v;
-    i = i->next;
+  GtsEdge * edges[3];
+  guint i;
+
+  edges[0] = t->e1; edges[1] = t->e2; edges[2] = t->e3;
+  for (i = 0; i < 3; i++) {
+    GtsSegment * s = GTS_SEGMENT (edges[i]);
+
+    if (s->v1 != v1 && s->v1 != v2 && s->v2 != v1 && s->v2 != v2)
+      return edges[i];
   }
+  return NULL;
+}
+
+/* Returns the first edge of @t using @v */
+static GtsEdge * triangle_first_edge_using (GtsTriangle * t, GtsVertex * v)
+{
+  if (GTS_SEGMENT (t->e1)->v1 == v || GTS_SEGMENT (t->e1)->v2 == v)
+    return t->e1;
+  if (GTS_SEGMENT (t->e2)->v1 == v || GTS_SEGMENT (t->e2)->v2 == v)
+    return t->e2;
+  return t->e3;
 }
 
 /**
@@ -1360,6 +2331,9 @@ static void replace_vertex (GSList * i, GtsVertex * v1, GtsVertex * v)
  * @max:  the maximum value of the square of the cosine of the angle between
  * two triangles.
  *
+ * This function does not modify the surface of @e, so that it can be
+ * called concurrently for different edges.
+ *
  * Returns: %TRUE if collapsing edge @e to vertex @v would create
  * faces making an angle the cosine squared of which would be larger than max,
  * %FALSE otherwise.  
@@ -1368,68 +2342,62 @@ gboolean gts_edge_collapse_creates_fold (GtsEdge * e,
 					 GtsVertex * v,
 					 gdouble max)
 {
-  GtsVertex * v1, * v2;
-  GtsSegment * s;
-  GSList * i;
+  GtsVertex * v1, * v2, * ends[2];
+  GPtrArray * triangles;
+  guint j, k;
   gboolean folded = FALSE;
 
   g_return_val_if_fail (e != NULL, TRUE);
   g_return_val_if_fail (v != NULL, TRUE);
 
-  s = GTS_SEGMENT (e);
-  v1 = s->v1;
-  v2 = s->v2;
-  replace_vertex (v1->segments, v1, v);
-  replace_vertex (v2->segments, v2, v);
-
-  i = v1->segments;
-  while (i && !folded) {
-    GtsSegment * s = i->data;
-    if (GTS_IS_EDGE (s)) {
-      GtsEdge * e1 = GTS_EDGE (s);
-      if (e1 != e) {
-	GSList * triangles = edge_triangles (e1, e);
-	folded = gts_triangles_are_folded (triangles, s->v1, s->v2, max);
-	g_slist_free (triangles);
-      }
-    }
-    i = i->next;
-  }
-
-  i = v2->segments;
-  while (i && !folded) {
-    GtsSegment * s = i->data;
-    if (GTS_IS_EDGE (s)) {
-      GtsEdge * e1 = GTS_EDGE (s);
-      if (e1 != e) {
-	GSList * triangles = edge_triangles (e1, e);
-	folded = gts_triangles_are_folded (triangles, s->v1, s->v2, max);
-	g_slist_free (triangles);
+  v1 = ends[0] = GTS_SEGMENT (e)->v1;
+  v2 = ends[1] = GTS_SEGMENT (e)->v2;
+
+  /* the triangles of the edges of v1 and v2 */
+  triangles = g_ptr_array_new ();
+  for (k = 0; k < 2 && !folded; k++)
+    for (j = 0; j < ends[k]->segments.n && !folded; j++) {
+      GtsSegment * s = ends[k]->segments.items[j];
+      if (GTS_IS_EDGE (s) && GTS_EDGE (s) != e) {
+	g_ptr_array_set_size (triangles, 0);
+	edge_triangles (GTS_EDGE (s), e, triangles);
+	folded = collapsed_triangles_are_folded ((GtsTriangle **)
+						 triangles->pdata,
+						 triangles->len,
+						 COLLAPSED (s->v1, v1, v2, v),
+						 COLLAPSED (s->v2, v1, v2, v),
+						 v1, v2, v, max);
       }
     }
-    i = i->next;
-  }
-#if 1
-  if (!folded) {
-    GSList * triangles = gts_vertex_triangles (v1, NULL);
-    i = triangles = gts_vertex_triangles (v2, triangles);
-    while (i && !folded) {
-      GtsTriangle * t = i->data;
-      if (t->e1 != e && t->e2 != e && t->e3 != e) {
-	GtsEdge * e1 = gts_triangle_edge_opposite (t, v);
-	g_assert (e1);
-	folded = gts_triangles_are_folded (e1->triangles, 
-					   GTS_SEGMENT (e1)->v1,
-					   GTS_SEGMENT (e1)->v2,
-					   max);
+  g_ptr_array_free (triangles, TRUE);
+
+  /* the triangles on the other side of the triangles of v1 and v2, each
+     of those being visited from its first edge using v1 or v2 */
+  for (k = 0; k < 2 && !folded; k++)
+    for (j = 0; j < ends[k]->segments.n && !folded; j++) {
+      GtsSegment * s = ends[k]->segments.items[j];
+      GtsTriangle * t;
+      guint i;
+
+      if (!GTS_IS_EDGE (s))
+	continue;
+      for (i = 0; i < GTS_EDGE (s)->triangles.n && !folded; i++) {
+	GtsEdge * e1;
+
+	t = GTS_EDGE (s)->triangles.items[i];
+	if (t->e1 == e || t->e2 == e || t->e3 == e ||
+	    triangle_first_edge_using (t, ends[k]) != GTS_EDGE (s) ||
+	    !(e1 = triangle_edge_away (t, v1, v2)))
+	  continue;
+	folded = collapsed_triangles_are_folded ((GtsTriangle **)
+						 e1->triangles.items,
+						 e1->triangles.n,
+						 GTS_SEGMENT (e1)->v1,
+						 GTS_SEGMENT (e1)->v2,
+						 v1, v2, v, max);
       }
-      i = i->next;
     }
-    g_slist_free (triangles);
-  }
-#endif
-  replace_vertex (v1->segments, v, v1);
-  replace_vertex (v2->segments, v, v2);
+
   return folded;
 }
 
@@ -1445,33 +2413,31 @@ gboolean gts_edge_collapse_creates_fold (GtsEdge * e,
  */
 gboolean gts_edge_collapse_is_valid (GtsEdge * e)
 {
-  GSList * i;
+  GtsEdge * e1;
+  guint i;
 
   g_return_val_if_fail (e != NULL, FALSE);
 
-  i = GTS_SEGMENT (e)->v1->segments;
-  while (i) {
-    GtsEdge * e1 = i->data;
+  GTS_ADJACENCY_FOREACH (&GTS_SEGMENT (e)->v1->segments, i, e1)
     if (e1 != e && GTS_IS_EDGE (e1)) {
       GtsEdge * e2 = NULL;
-      GSList * j = GTS_SEGMENT (e1)->v1 == GTS_SEGMENT (e)->v1 ? 
-	GTS_SEGMENT (e1)->v2->segments : GTS_SEGMENT (e1)->v1->segments;
-      while (j && !e2) {
-	GtsEdge * e1 = j->data;
+      GtsAdjacency * segments = GTS_SEGMENT (e1)->v1 == GTS_SEGMENT (e)->v1 ? 
+	&GTS_SEGMENT (e1)->v2->segments : &GTS_SEGMENT (e1)->v1->segments;
+      guint j;
+
+      for (j = 0; j < segments->n && !e2; j++) {
+	GtsEdge * e1 = segments->items[j];
 	if (GTS_IS_EDGE (e1) && 
 	    (GTS_SEGMENT (e1)->v1 == GTS_SEGMENT (e)->v2 || 
 	     GTS_SEGMENT (e1)->v2 == GTS_SEGMENT (e)->v2))
 	  e2 = e1;
-	j = j->next;
       }
       if (e2 && !gts_triangle_use_edges (e, e1, e2))
 	return FALSE;
     }
-    i = i->next;
-  }
 
   if (gts_edge_is_boundary (e, NULL)) {
-    GtsTriangle * t = e->triangles->data;
+    GtsTriangle * t = e->triangles.items[0];
     if (gts_edge_is_boundary (t->e1, NULL) &&
 	gts_edge_is_boundary (t->e2, NULL) &&
 	gts_edge_is_boundary (t->e3, NULL))
@@ -1492,6 +2458,55 @@ gboolean gts_edge_collapse_is_valid (GtsEdge * e)
 #define HEAP_REMOVE_EDGE(h, e) (gts_eheap_remove (h, GTS_OBJECT (e)->reserved),\
                                 GTS_OBJECT (e)->reserved = NULL)
 
+/* Replaces the vertices of @e, which has passed the validity and fold
+   tests, with @mid */
+static GtsVertex * edge_collapse_commit (GtsEdge * e,
+					 GtsVertex * mid,
+					 GtsEHeap * heap)
+{
+  GtsVertex  * v1 = GTS_SEGMENT (e)->v1, * v2 = GTS_SEGMENT (e)->v2;
+  guint i;
+
+  gts_object_destroy (GTS_OBJECT (e));
+
+  gts_vertex_replace (v1, mid);
+  gts_object_destroy (GTS_OBJECT (v1));
+  gts_vertex_replace (v2, mid);
+  gts_object_destroy (GTS_OBJECT (v2));
+
+  /* destroy duplicate edges */
+  i = 0;
+  while (i < mid->segments.n) {
+    GtsEdge * e1 = mid->segments.items[i];
+    GtsEdge * duplicate;
+    while ((duplicate = gts_edge_is_duplicate (e1))) {
+      gts_edge_replace (duplicate, GTS_EDGE (e1));
+      HEAP_REMOVE_EDGE (heap, duplicate);
+      gts_object_destroy (GTS_OBJECT (duplicate));
+    }
+    /* removing the duplicates may have moved e1 towards the front */
+    while (mid->segments.items[i] != e1)
+      i--;
+    if (e1->triangles.n == 0) {
+      gboolean last = (mid->segments.n == 1);
+
+      /* e1 is the result of the collapse of one edge of a pair of identical
+	 faces (it should not happen unless duplicate triangles are present in
+	 the initial surface) */
+      g_warning ("file %s: line %d (%s): probably duplicate triangle.",
+		 __FILE__, __LINE__, G_GNUC_PRETTY_FUNCTION);
+      HEAP_REMOVE_EDGE (heap, e1);
+      gts_object_destroy (GTS_OBJECT (e1));
+      if (last && !gts_allow_floating_vertices) /* mid has been destroyed */
+	return NULL;
+    }
+    else
+      i++;
+  }
+
+  return mid;
+}
+
 static GtsVertex * edge_collapse (GtsEdge * e,
 				  GtsEHeap * heap,
 				  GtsCoarsenFunc coarsen_func,
@@ -1499,7 +2514,6 @@ static GtsVertex * edge_collapse (GtsEdge * e,
 				  GtsVertexClass * klass,
 				  gdouble maxcosine2)
 {
-  GSList * i;
   GtsVertex  * v1 = GTS_SEGMENT (e)->v1, * v2 = GTS_SEGMENT (e)->v2, * mid;
 
   /* if the edge is degenerate (i.e. v1 == v2), destroy and return */
@@ -1523,73 +2537,37 @@ static GtsVertex * edge_collapse (GtsEdge * e,
     return NULL;
   }
 
-  gts_object_destroy (GTS_OBJECT (e));
-
-  gts_vertex_replace (v1, mid);
-  gts_object_destroy (GTS_OBJECT (v1));
-  gts_vertex_replace (v2, mid);
-  gts_object_destroy (GTS_OBJECT (v2));
-
-  /* destroy duplicate edges */
-  i = mid->segments;
-  while (i) {
-    GtsEdge * e1 = i->data;
-    GtsEdge * duplicate;
-    while ((duplicate = gts_edge_is_duplicate (e1))) {
-      gts_edge_replace (duplicate, GTS_EDGE (e1));
-      HEAP_REMOVE_EDGE (heap, duplicate);
-      gts_object_destroy (GTS_OBJECT (duplicate));
-    }
-    i = i->next;
-    if (!e1->triangles) {
-      /* e1 is the result of the collapse of one edge of a pair of identical
-	 faces (it should not happen unless duplicate triangles are present in
-	 the initial surface) */
-      g_warning ("file %s: line %d (%s): probably duplicate triangle.",
-		 __FILE__, __LINE__, G_GNUC_PRETTY_FUNCTION);
-      HEAP_REMOVE_EDGE (heap, e1);
-      gts_object_destroy (GTS_OBJECT (e1));
-      if (i == NULL) /* mid has been destroyed */
-	mid = NULL;
-    }
-  }
-
-  return mid;
+  return edge_collapse_commit (e, mid, heap);
 }
 
 static void update_closest_neighbors (GtsVertex * v, GtsEHeap * heap)
 {
-  GSList * i = v->segments;
+  GtsSegment * s;
+  guint i;
   
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s)
     if (GTS_IS_EDGE (s)) {
       HEAP_REMOVE_EDGE (heap, GTS_EDGE (s));
       HEAP_INSERT_EDGE (heap, GTS_EDGE (s));
     }
-    i = i->next;
-  }
 }
 
 static void update_2nd_closest_neighbors (GtsVertex * v, GtsEHeap * heap)
 {
-  GSList * i = v->segments;
-  GSList * list = NULL;
+  GtsSegment * s;
+  GSList * i, * list = NULL;
+  guint k;
   
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v->segments, k, s)
     if (GTS_IS_EDGE (s)) {
       GtsVertex * v1 = s->v1 == v ? s->v2 : s->v1;
-      GSList * j = v1->segments;
-      while (j) {
-	GtsSegment * s1 = j->data;
+      GtsSegment * s1;
+      guint l;
+
+      GTS_ADJACENCY_FOREACH (&v1->segments, l, s1)
 	if (GTS_IS_EDGE (s1) && !g_slist_find (list, s1))
 	  list = g_slist_prepend (list, s1);
-	j = j->next;
-      }
     }
-    i = i->next;
-  }
 
   i = list;
   while (i) {
@@ -1686,6 +2664,367 @@ void gts_surface_coarsen (GtsSurface * surface,
   gts_eheap_destroy (heap);
 }
 
+/* number of edges per thread taken from the heap at each round of
+   gts_surface_coarsen_independent() */
+#define COARSEN_CANDIDATES_PER_THREAD 256
+
+/* The vertices of the one-rings of the endpoints of the edges selected
+   during a round are marked with the surface in their reserved field */
+static gboolean vertex_ring_is_free (GtsVertex * v, GtsSurface * s)
+{
+  GtsSegment * s1;
+  guint i;
+
+  if (GTS_OBJECT (v)->reserved == s)
+    return FALSE;
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s1)
+    if (GTS_OBJECT (s1->v1 == v ? s1->v2 : s1->v1)->reserved == s)
+      return FALSE;
+  return TRUE;
+}
+
+static void vertex_ring_mark (GtsVertex * v, GtsSurface * s,
+			      GPtrArray * marked)
+{
+  GtsSegment * s1;
+  guint i;
+
+  if (GTS_OBJECT (v)->reserved != s) {
+    GTS_OBJECT (v)->reserved = s;
+    g_ptr_array_add (marked, v);
+  }
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s1) {
+    GtsVertex * v1 = s1->v1 == v ? s1->v2 : s1->v1;
+
+    if (GTS_OBJECT (v1)->reserved != s) {
+      GTS_OBJECT (v1)->reserved = s;
+      g_ptr_array_add (marked, v1);
+    }
+  }
+}
+
+typedef struct {
+  GtsEdge ** edges;
+  GtsVertex ** midvertices;
+  gboolean * folded;
+  GtsCoarsenFunc coarsen_func;
+  gpointer coarsen_data;
+  GtsVertexClass * vertex_class;
+  gdouble maxcosine2;
+  GtsArena * arena;
+} CoarsenMidvertices;
+
+static void coarsen_midvertices_chunk (SurfaceChunk * chunk,
+				       CoarsenMidvertices * m)
+{
+  guint i;
+
+  if (m->arena)
+    gts_arena_push (m->arena);
+  for (i = chunk->start; i < chunk->end; i++) {
+    GtsEdge * e = m->edges[i];
+
+    m->folded[i] = FALSE;
+    if (!gts_edge_collapse_is_valid (e))
+      m->midvertices[i] = NULL;
+    else {
+      m->midvertices[i] = (*m->coarsen_func) (e, m->vertex_class,
+					      m->coarsen_data);
+      m->folded[i] = gts_edge_collapse_creates_fold (e, m->midvertices[i],
+						     m->maxcosine2);
+    }
+  }
+  if (m->arena)
+    gts_arena_pop (m->arena);
+}
+
+static void heap_insert_edges (GtsEHeap * heap,
+			       GPtrArray * edges,
+			       gdouble * costs,
+			       GPtrArray * pairs)
+{
+  guint i;
+
+  g_ptr_array_set_size (pairs, edges->len);
+  gts_eheap_insert_array (heap, edges->pdata, costs, edges->len,
+			  (GtsEHeapPair **) pairs->pdata);
+  for (i = 0; i < edges->len; i++)
+    GTS_OBJECT (edges->pdata[i])->reserved = pairs->pdata[i];
+}
+
+/* Adds to @edges the edges using the neighbors of the vertices in
+   @vertices, each of them once */
+static void collect_2nd_closest_neighbors (GPtrArray * vertices,
+					   GPtrArray * edges,
+					   GPtrArray * marked,
+					   GtsSurface * s)
+{
+  guint i, j, k;
+
+  for (i = 0; i < vertices->len; i++) {
+    GtsVertex * v = vertices->pdata[i];
+    GtsSegment * s1;
+
+    GTS_ADJACENCY_FOREACH (&v->segments, j, s1) {
+      GtsVertex * v1 = s1->v1 == v ? s1->v2 : s1->v1;
+
+      if (GTS_IS_EDGE (s1) && GTS_OBJECT (v1)->reserved != s) {
+	GTS_OBJECT (v1)->reserved = s;
+	g_ptr_array_add (marked, v1);
+      }
+    }
+  }
+  /* the neighbors already visited are marked with @edges so that the
+     edges joining two of them are only taken once */
+  for (i = 0; i < marked->len; i++) {
+    GtsVertex * v = marked->pdata[i];
+    GtsSegment * s1;
+
+    GTS_ADJACENCY_FOREACH (&v->segments, k, s1)
+      if (GTS_IS_EDGE (s1) &&
+	  GTS_OBJECT (s1->v1 == v ? s1->v2 : s1->v1)->reserved != edges)
+	g_ptr_array_add (edges, s1);
+    GTS_OBJECT (v)->reserved = edges;
+  }
+  for (i = 0; i < marked->len; i++)
+    GTS_OBJECT (marked->pdata[i])->reserved = NULL;
+  g_ptr_array_set_size (marked, 0);
+}
+
+/**
+ * gts_surface_coarsen_independent:
+ * @surface: a #GtsSurface.
+ * @cost_func: a function returning the cost for a given edge.
+ * @cost_data: user data to be passed to @cost_func.
+ * @coarsen_func: a #GtsCoarsenVertexFunc.
+ * @coarsen_data: user data to be passed to @coarsen_func.
+ * @stop_func: a #GtsStopFunc.
+ * @stop_data: user data to be passed to @stop_func.
+ * @minangle: minimum angle between two neighboring triangles.
+ * @slack: how far from the order of the costs the edges may be collapsed.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Same as gts_surface_coarsen() but the edges are collapsed by rounds,
+ * @cost_func, @coarsen_func and the validity and fold tests being
+ * called in parallel within each round.
+ *
+ * Each round takes the edges on top of the heap whose cost is not
+ * larger than the cost c of the top edge plus @slack |c|, and selects
+ * those whose endpoints and their neighbors are not neighbors of the
+ * endpoints of the edges already selected, the others being kept for
+ * the next rounds. The collapses of the selected edges are then
+ * independent: they are tested and their vertices computed in
+ * parallel, they are applied by the calling thread in the order of
+ * their costs and the costs of the edges around the new vertices are
+ * evaluated in parallel before they are updated in the heap all at
+ * once. @stop_func is called by the calling thread before each
+ * collapse, with the number of edges left as with
+ * gts_surface_coarsen(), and coarsening stops as soon as it returns
+ * %TRUE.
+ *
+ * The larger @slack, the more edges can be collapsed in parallel but
+ * the further the edges collapsed are from the order of their costs.
+ * With a @slack of zero, only edges of equal cost are collapsed in the
+ * same round. If all the costs are different, the edges are then
+ * collapsed one by one in the same order as by gts_surface_coarsen()
+ * and the resulting surface is the same.
+ *
+ * @cost_func and @coarsen_func are called concurrently for different
+ * edges. They must be thread-safe and must not modify @surface.
+ */
+void gts_surface_coarsen_independent (GtsSurface * surface,
+				      GtsKeyFunc cost_func,
+				      gpointer cost_data,
+				      GtsCoarsenFunc coarsen_func,
+				      gpointer coarsen_data,
+				      GtsStopFunc stop_func,
+				      gpointer stop_data,
+				      gdouble minangle,
+				      gdouble slack,
+				      guint nthreads)
+{
+  GtsEHeap * heap;
+  GPtrArray * edges, * selected, * deferred, * marked, * pairs, * vertices;
+  GArray * selected_costs, * deferred_costs;
+  EdgeCosts costs;
+  CoarsenMidvertices m;
+  guint i, max_candidates;
+  gboolean progress = TRUE;
+
+  g_return_if_fail (surface != NULL);
+  g_return_if_fail (stop_func != NULL);
+  g_return_if_fail (slack >= 0.);
+
+  if (cost_func == NULL)
+    cost_func = (GtsKeyFunc) edge_length2;
+  if (coarsen_func == NULL)
+    coarsen_func = (GtsCoarsenFunc) gts_segment_midvertex;
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+  max_candidates = COARSEN_CANDIDATES_PER_THREAD*nthreads;
+
+  edges = g_ptr_array_new ();
+  gts_surface_foreach_edge (surface, (GtsFunc) create_array_refine, edges);
+
+  costs.batch_func = NULL;
+  costs.cost_func = cost_func;
+  costs.cost_data = cost_data;
+  costs.edges = (GtsEdge **) edges->pdata;
+  costs.costs = g_malloc (edges->len*sizeof (gdouble));
+  surface_foreach_chunk ((GFunc) edge_costs_chunk, &costs,
+			 edges->len, nthreads);
+
+  heap = gts_eheap_new (cost_func, cost_data);
+  pairs = g_ptr_array_new ();
+  heap_insert_edges (heap, edges, costs.costs, pairs);
+  g_ptr_array_set_size (edges, 0);
+
+  selected = g_ptr_array_new ();
+  selected_costs = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  deferred = g_ptr_array_new ();
+  deferred_costs = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  marked = g_ptr_array_new ();
+  vertices = g_ptr_array_new ();
+
+  m.coarsen_func = coarsen_func;
+  m.coarsen_data = coarsen_data;
+  m.vertex_class = surface->vertex_class;
+  m.maxcosine2 = cos (minangle); m.maxcosine2 *= m.maxcosine2;
+  m.arena = surface->arena;
+  m.midvertices = NULL;
+  m.folded = NULL;
+
+  /* we want to control edge destruction manually */
+  gts_allow_floating_edges = TRUE;
+  while (progress) {
+    gdouble top_cost = 0.;
+    GtsEdge * e;
+
+    /* selects the edges of this round */
+    progress = FALSE;
+    g_ptr_array_set_size (selected, 0);
+    g_array_set_size (selected_costs, 0);
+    g_ptr_array_set_size (deferred, 0);
+    g_array_set_size (deferred_costs, 0);
+    while (selected->len + deferred->len < max_candidates) {
+      GtsVertex * v1, * v2;
+      gdouble cost;
+
+      if (!(e = gts_eheap_top (heap, &cost)) || cost == G_MAXDOUBLE)
+	break;
+      if (selected->len + deferred->len == 0)
+	top_cost = cost;
+      else if (cost > top_cost + slack*fabs (top_cost))
+	break;
+      v1 = GTS_SEGMENT (e)->v1;
+      v2 = GTS_SEGMENT (e)->v2;
+      if (v1 == v2) {
+	/* degenerate edge */
+	gts_eheap_remove_top (heap, NULL);
+	GTS_OBJECT (e)->reserved = NULL;
+	gts_object_destroy (GTS_OBJECT (e));
+	progress = TRUE;
+	continue;
+      }
+      if (!vertex_ring_is_free (v1, surface) ||
+	  !vertex_ring_is_free (v2, surface)) {
+	gts_eheap_remove_top (heap, NULL);
+	g_ptr_array_add (deferred, e);
+	g_array_append_val (deferred_costs, cost);
+	continue;
+      }
+      gts_eheap_remove_top (heap, NULL);
+      GTS_OBJECT (e)->reserved = NULL;
+      vertex_ring_mark (v1, surface, marked);
+      vertex_ring_mark (v2, surface, marked);
+      g_ptr_array_add (selected, e);
+      g_array_append_val (selected_costs, cost);
+    }
+    for (i = 0; i < marked->len; i++)
+      GTS_OBJECT (marked->pdata[i])->reserved = NULL;
+    g_ptr_array_set_size (marked, 0);
+    heap_insert_edges (heap, deferred, (gdouble *) deferred_costs->data,
+		       pairs);
+    if (selected->len == 0)
+      continue;
+    progress = TRUE;
+
+    /* tests the collapses and computes the new vertices */
+    m.edges = (GtsEdge **) selected->pdata;
+    m.midvertices = g_realloc (m.midvertices,
+			       selected->len*sizeof (GtsVertex *));
+    m.folded = g_realloc (m.folded, selected->len*sizeof (gboolean));
+    surface_foreach_chunk ((GFunc) coarsen_midvertices_chunk, &m,
+			   selected->len, nthreads);
+
+    /* collapses the edges, the edges left being the ones in the heap
+       and the selected edges not processed yet */
+    g_ptr_array_set_size (vertices, 0);
+    for (i = 0; i < selected->len; i++) {
+      GtsVertex * mid = m.midvertices[i];
+      gdouble cost = g_array_index (selected_costs, gdouble, i);
+
+      e = selected->pdata[i];
+      if (progress &&
+	  (*stop_func) (cost, gts_eheap_size (heap) + selected->len - i - 1
+			- gts_edge_face_number (e, surface), stop_data))
+	progress = FALSE;
+      if (!progress) {
+	/* puts back the edges which will not be collapsed */
+	GTS_OBJECT (e)->reserved = gts_eheap_insert_with_key (heap, e, cost);
+	if (mid)
+	  gts_object_destroy (GTS_OBJECT (mid));
+      }
+      else if (mid == NULL || m.folded[i]) {
+	GTS_OBJECT (e)->reserved = 
+	  gts_eheap_insert_with_key (heap, e, G_MAXDOUBLE);
+	if (mid)
+	  gts_object_destroy (GTS_OBJECT (mid));
+      }
+      else if ((mid = edge_collapse_commit (e, mid, heap)))
+	g_ptr_array_add (vertices, mid);
+    }
+
+    /* updates the costs of the edges around the new vertices */
+    collect_2nd_closest_neighbors (vertices, edges, marked, surface);
+    costs.edges = (GtsEdge **) edges->pdata;
+    costs.costs = g_realloc (costs.costs, edges->len*sizeof (gdouble));
+    surface_foreach_chunk ((GFunc) edge_costs_chunk, &costs,
+			   edges->len, nthreads);
+    /* setting many keys is cheaper with a single reordering of the heap */
+    if (edges->len*16 >= gts_eheap_size (heap)) {
+      gts_eheap_freeze (heap);
+      for (i = 0; i < edges->len; i++)
+	gts_eheap_change_key (heap, GTS_OBJECT (edges->pdata[i])->reserved,
+			      costs.costs[i]);
+      gts_eheap_thaw (heap);
+    }
+    else
+      for (i = 0; i < edges->len; i++)
+	gts_eheap_change_key (heap, GTS_OBJECT (edges->pdata[i])->reserved,
+			      costs.costs[i]);
+    g_ptr_array_set_size (edges, 0);
+  }
+  gts_allow_floating_edges = FALSE;
+
+  /* set reserved field of remaining edges back to NULL */
+  gts_eheap_foreach (heap, (GFunc) gts_object_reset_reserved, NULL);
+
+  g_free (costs.costs);
+  g_free (m.midvertices);
+  g_free (m.folded);
+  g_ptr_array_free (edges, TRUE);
+  g_ptr_array_free (selected, TRUE);
+  g_array_free (selected_costs, TRUE);
+  g_ptr_array_free (deferred, TRUE);
+  g_array_free (deferred_costs, TRUE);
+  g_ptr_array_free (marked, TRUE);
+  g_ptr_array_free (pairs, TRUE);
+  g_ptr_array_free (vertices, TRUE);
+  gts_eheap_destroy (heap);
+}
+
 /**
  * gts_coarsen_stop_number:
  * @cost: the cost of the edge collapse considered.
@@ -1885,9 +3224,9 @@ static void tessellate_face (GtsFace * f,
     g_assert_not_reached ();
   }
 
-  e1->triangles = g_slist_remove (e1->triangles, t);
-  e2->triangles = g_slist_remove (e2->triangles, t);
-  e3->triangles = g_slist_remove (e3->triangles, t);
+  gts_edge_remove_triangle (e1, t);
+  gts_edge_remove_triangle (e2, t);
+  gts_edge_remove_triangle (e3, t);
   
   if (GTS_OBJECT (e1)->reserved) {
     dum = (GTS_OBJECT (e1)->reserved);
@@ -1941,19 +3280,19 @@ static void tessellate_face (GtsFace * f,
     GTS_OBJECT (e3)->reserved = dum;
   }
   
-  if (e1->triangles == NULL) {
+  if (e1->triangles.n == 0) {
     g_slist_free (GTS_OBJECT (e1)->reserved);
     GTS_OBJECT (e1)->reserved = NULL;
     gts_object_destroy (GTS_OBJECT (e1));
     e1 = NULL;
   }
-  if (e2->triangles == NULL) {
+  if (e2->triangles.n == 0) {
     g_slist_free (GTS_OBJECT (e2)->reserved);
     GTS_OBJECT (e2)->reserved = NULL;
     gts_object_destroy (GTS_OBJECT (e2));
     e2 = NULL;
   }
-  if (e3->triangles == NULL) {
+  if (e3->triangles.n == 0) {
     g_slist_free (GTS_OBJECT (e3)->reserved);
     GTS_OBJECT (e3)->reserved = NULL;
     gts_object_destroy (GTS_OBJECT (e3));
@@ -1963,9 +3302,9 @@ static void tessellate_face (GtsFace * f,
   e56 = gts_edge_new (edge_class, v5, v6);
   e64 = gts_edge_new (edge_class, v6, v4);
   e45 = gts_edge_new (edge_class, v4, v5);
-  t->e1 = e56; e56->triangles = g_slist_prepend (e56->triangles, t);
-  t->e2 = e64; e64->triangles = g_slist_prepend (e64->triangles, t);
-  t->e3 = e45; e45->triangles = g_slist_prepend (e45->triangles, t);
+  t->e1 = e56; gts_edge_add_triangle (e56, t);
+  t->e2 = e64; gts_edge_add_triangle (e64, t);
+  t->e3 = e45; gts_edge_add_triangle (e45, t);
   
   gts_surface_add_face (s, gts_face_new (s->face_class, e16, e56, e15));
   gts_surface_add_face (s, gts_face_new (s->face_class, e26, e24, e64));
@@ -2014,6 +3353,180 @@ void gts_surface_tessellate (GtsSurface * s,
   g_ptr_array_free (array, TRUE);
 }
 
+/* edges are numbered from 1 in their reserved field */
+#define SUBDIVIDE_INDEX(e) (GPOINTER_TO_UINT (GTS_OBJECT (e)->reserved) - 1)
+
+static void subdivide_number_edges (GtsFace * f, GPtrArray * edges)
+{
+  GtsTriangle * t = GTS_TRIANGLE (f);
+  GtsEdge * e[3];
+  guint i;
+
+  e[0] = t->e1; e[1] = t->e2; e[2] = t->e3;
+  for (i = 0; i < 3; i++)
+    if (GTS_OBJECT (e[i])->reserved == NULL) {
+      g_ptr_array_add (edges, e[i]);
+      GTS_OBJECT (e[i])->reserved = GUINT_TO_POINTER (edges->len);
+    }
+}
+
+/* half of edge @e containing vertex @v */
+#define SUBDIVIDE_HALF(halves, e, v) \
+  ((halves)[2*SUBDIVIDE_INDEX (e) + (GTS_SEGMENT (e)->v1 == (v) ? 0 : 1)])
+
+static void subdivide_face (GtsFace * f,
+			    GtsSurface * s,
+			    GtsVertex ** midvertices,
+			    GPtrArray * edges,
+			    GPtrArray * faces)
+{
+  GtsTriangle * t = GTS_TRIANGLE (f);
+  GtsEdge ** halves = (GtsEdge **) edges->pdata;
+  GtsVertex * v1, * v2, * v3, * m1, * m2, * m3;
+  GtsEdge * e12, * e23, * e31;
+  GtsFace * corner;
+
+  /* e1 = (v1, v2), e2 = (v2, v3) and e3 = (v3, v1) */
+  gts_triangle_vertices (t, &v1, &v2, &v3);
+  m1 = midvertices[SUBDIVIDE_INDEX (t->e1)];
+  m2 = midvertices[SUBDIVIDE_INDEX (t->e2)];
+  m3 = midvertices[SUBDIVIDE_INDEX (t->e3)];
+
+  e12 = gts_edge_new (s->edge_class, m1, m2);
+  e23 = gts_edge_new (s->edge_class, m2, m3);
+  e31 = gts_edge_new (s->edge_class, m3, m1);
+  g_ptr_array_add (edges, e12);
+  g_ptr_array_add (edges, e23);
+  g_ptr_array_add (edges, e31);
+
+  /* the corners keep the orientation of @t */
+  corner = gts_face_new (s->face_class,
+			 SUBDIVIDE_HALF (halves, t->e1, v1),
+			 e31,
+			 SUBDIVIDE_HALF (halves, t->e3, v1));
+  gts_surface_add_face (s, corner);
+  g_ptr_array_add (faces, corner);
+  corner = gts_face_new (s->face_class,
+			 SUBDIVIDE_HALF (halves, t->e2, v2),
+			 e12,
+			 SUBDIVIDE_HALF (halves, t->e1, v2));
+  gts_surface_add_face (s, corner);
+  g_ptr_array_add (faces, corner);
+  corner = gts_face_new (s->face_class,
+			 SUBDIVIDE_HALF (halves, t->e3, v3),
+			 e23,
+			 SUBDIVIDE_HALF (halves, t->e2, v3));
+  gts_surface_add_face (s, corner);
+  g_ptr_array_add (faces, corner);
+
+  /* @t becomes the middle triangle, the former edges are destroyed
+     once all the faces have been subdivided */
+  t->e1 = e12; gts_edge_add_triangle (e12, t);
+  t->e2 = e23; gts_edge_add_triangle (e23, t);
+  t->e3 = e31; gts_edge_add_triangle (e31, t);
+}
+
+/**
+ * gts_surface_subdivide_uniform:
+ * @s: a #GtsSurface.
+ * @levels: the number of subdivision levels.
+ * @refine_func: a #GtsRefineFunc.
+ * @refine_data: user data to be passed to @refine_func.
+ * @nthreads: the number of threads to use or 0 to use one thread per
+ * processor.
+ *
+ * Subdivides each triangle of @s into 4 triangles, @levels times. The
+ * number of triangles is increased by a factor of 4 at each level.
+ *
+ * Unlike gts_surface_refine(), no priority heap is involved: every
+ * edge of a level is split in a single sweep. The new vertices of a
+ * level are first all created by @refine_func, in parallel using
+ * @nthreads threads, then the edges and faces are created in one pass
+ * over the faces of @s. The edges and faces created by a level are
+ * directly those subdivided by the next one. @refine_func must be
+ * thread-safe when @nthreads is not 1.
+ *
+ * If @refine_func is set to %NULL gts_segment_midvertex() is used.
+ */
+void gts_surface_subdivide_uniform (GtsSurface * s,
+				    guint levels,
+				    GtsRefineFunc refine_func,
+				    gpointer refine_data,
+				    guint nthreads)
+{
+  GPtrArray * edges, * faces;
+  guint level, i;
+
+  g_return_if_fail (s != NULL);
+
+  if (levels == 0)
+    return;
+  if (refine_func == NULL)
+    refine_func = (GtsRefineFunc) gts_segment_midvertex;
+  if (nthreads == 0)
+    nthreads = g_get_num_processors ();
+  if (s->arena)
+    gts_arena_push (s->arena);
+
+  faces = g_ptr_array_sized_new (gts_surface_face_number (s));
+  gts_surface_foreach_face (s, (GtsFunc) create_array_tessellate, faces);
+  edges = g_ptr_array_sized_new (3*faces->len/2 + 1);
+  for (i = 0; i < faces->len; i++)
+    subdivide_number_edges (faces->pdata[i], edges);
+
+  for (level = 0; level < levels; level++) {
+    guint nedges = edges->len, nfaces = faces->len;
+    GPtrArray * next;
+    RefineMidvertices m;
+
+    m.edges = (GtsEdge **) edges->pdata;
+    m.midvertices = g_malloc (nedges*sizeof (GtsVertex *));
+    m.refine_func = refine_func;
+    m.refine_data = refine_data;
+    m.vertex_class = s->vertex_class;
+    m.arena = s->arena;
+    surface_foreach_chunk ((GFunc) refine_midvertices_chunk, &m,
+			   nedges, nthreads);
+
+    /* edges of the next level: two halves per edge, followed by
+       three inside edges per face */
+    next = g_ptr_array_sized_new (2*nedges + 3*nfaces);
+    for (i = 0; i < nedges; i++) {
+      GtsSegment * e = edges->pdata[i];
+
+      g_ptr_array_add (next, gts_edge_new (s->edge_class,
+					   e->v1, m.midvertices[i]));
+      g_ptr_array_add (next, gts_edge_new (s->edge_class,
+					   e->v2, m.midvertices[i]));
+    }
+
+    gts_surface_reserve (s, 4*nfaces);
+    for (i = 0; i < nfaces; i++)
+      subdivide_face (faces->pdata[i], s, m.midvertices, next, faces);
+
+    for (i = 0; i < nedges; i++) {
+      GtsEdge * e = edges->pdata[i];
+
+      gts_adjacency_free (&e->triangles, e->triangle_slots,
+			  GTS_EDGE_TRIANGLE_SLOTS);
+      GTS_OBJECT (e)->reserved = NULL;
+      gts_object_destroy (GTS_OBJECT (e));
+    }
+    g_free (m.midvertices);
+    g_ptr_array_free (edges, TRUE);
+
+    edges = next;
+    if (level + 1 < levels)
+      for (i = 0; i < edges->len; i++)
+	GTS_OBJECT (edges->pdata[i])->reserved = GUINT_TO_POINTER (i + 1);
+  }
+
+  g_ptr_array_free (faces, TRUE);
+  g_ptr_array_free (edges, TRUE);
+  if (s->arena)
+    gts_arena_pop (s->arena);
+}
+
 /**
  * gts_surface_generate_sphere:
  * @s: a #GtsSurface.
@@ -2176,15 +3689,14 @@ static void orientable_foreach_edge (GtsEdge * e, gpointer * data)
   if (*is_orientable) {
     GtsSurface * surface = data[1];
     GtsFace * f1 = NULL, * f2 = NULL;
-    GSList * i = e->triangles;
-    while (i && *is_orientable) {
-      GtsFace * f = i->data;
+    guint i;
+    for (i = 0; i < e->triangles.n && *is_orientable; i++) {
+      GtsFace * f = e->triangles.items[i];
       if (GTS_IS_FACE (f) && gts_face_has_parent_surface (f, surface)) {
 	if (!f1) f1 = f;
 	else if (!f2) f2 = f;
 	else *is_orientable = FALSE;
       }
-      i = i->next;
     }
     if (f1 && f2 && !gts_triangles_are_compatible (GTS_TRIANGLE (f1), 
 						   GTS_TRIANGLE (f2), e))
@@ -2417,11 +3929,22 @@ guint gts_surface_face_number (GtsSurface * s)
 {
   g_return_val_if_fail (s != NULL, 0);
 
-#ifdef USE_SURFACE_BTREE
-  return g_tree_nnodes (s->faces);
-#else /* not USE_SURFACE_BTREE */
-  return g_hash_table_size (s->faces);
-#endif /* not USE_SURFACE_BTREE */
+  return s->faces.n;
+}
+
+/**
+ * gts_surface_reserve:
+ * @s: a #GtsSurface.
+ * @nfaces: a number of faces.
+ *
+ * Makes room in @s for @nfaces faces in total, so that adding them
+ * does not grow its set of faces.
+ */
+void gts_surface_reserve (GtsSurface * s, guint nfaces)
+{
+  g_return_if_fail (s != NULL);
+
+  gts_pointer_set_reserve (&s->faces, nfaces);
 }
 
 static void build_list_face (GtsTriangle * t, GSList ** list)
@@ -2613,23 +4136,23 @@ static void traverse_manifold (GtsTriangle * t, GtsSurface * s)
     return;
 
   gts_surface_add_face (s, GTS_FACE (t));
-  if (g_slist_length (t->e1->triangles) == 2) {
-    if (t->e1->triangles->data != t)
-      traverse_manifold (t->e1->triangles->data, s);
+  if (t->e1->triangles.n == 2) {
+    if (t->e1->triangles.items[0] != t)
+      traverse_manifold (t->e1->triangles.items[0], s);
     else
-      traverse_manifold (t->e1->triangles->next->data, s);
+      traverse_manifold (t->e1->triangles.items[1], s);
   }
-  if (g_slist_length (t->e2->triangles) == 2) {
-    if (t->e2->triangles->data != t)
-      traverse_manifold (t->e2->triangles->data, s);
+  if (t->e2->triangles.n == 2) {
+    if (t->e2->triangles.items[0] != t)
+      traverse_manifold (t->e2->triangles.items[0], s);
     else
-      traverse_manifold (t->e2->triangles->next->data, s);
+      traverse_manifold (t->e2->triangles.items[1], s);
   }
-  if (g_slist_length (t->e3->triangles) == 2) {
-    if (t->e3->triangles->data != t)
-      traverse_manifold (t->e3->triangles->data, s);
+  if (t->e3->triangles.n == 2) {
+    if (t->e3->triangles.items[0] != t)
+      traverse_manifold (t->e3->triangles.items[0], s);
     else
-      traverse_manifold (t->e3->triangles->next->data, s);
+      traverse_manifold (t->e3->triangles.items[1], s);
   }
 }
 
@@ -2639,14 +4162,13 @@ static void non_manifold_edges (GtsEdge * e, gpointer * data)
   GSList ** non_manifold = data[1];
 
   if (gts_edge_face_number (e, s) > 2) {
-    GSList * i = e->triangles;
+    GtsFace * f;
+    guint i;
 
-    while (i) {
-      if (gts_face_has_parent_surface (i->data, s) &&
-	  !g_slist_find (*non_manifold, i->data))
-	*non_manifold = g_slist_prepend (*non_manifold, i->data);
-      i = i->next;
-    }
+    GTS_ADJACENCY_FOREACH (&e->triangles, i, f)
+      if (gts_face_has_parent_surface (f, s) &&
+	  !g_slist_find (*non_manifold, f))
+	*non_manifold = g_slist_prepend (*non_manifold, f);
   }
 }
 
@@ -27,19 +27,19 @@ static void triangle_destroy (GtsObject * object)
   GtsEdge * e2 = triangle->e2;
   GtsEdge * e3 = triangle->e3;
 
-  e1->triangles = g_slist_remove (e1->triangles, triangle);
+  gts_edge_remove_triangle (e1, triangle);
   if (!GTS_OBJECT_DESTROYED (e1) &&
-      !gts_allow_floating_edges && e1->triangles == NULL)
+      !gts_allow_floating_edges && e1->triangles.n == 0)
     gts_object_destroy (GTS_OBJECT (e1));
   
-  e2->triangles = g_slist_remove (e2->triangles, triangle);
+  gts_edge_remove_triangle (e2, triangle);
   if (!GTS_OBJECT_DESTROYED (e2) &&
-      !gts_allow_floating_edges && e2->triangles == NULL)
+      !gts_allow_floating_edges && e2->triangles.n == 0)
     gts_object_destroy (GTS_OBJECT (e2));
   
-  e3->triangles = g_slist_remove (e3->triangles, triangle);
+  gts_edge_remove_triangle (e3, triangle);
   if (!GTS_OBJECT_DESTROYED (e3) &&
-      !gts_allow_floating_edges && e3->triangles == NULL)
+      !gts_allow_floating_edges && e3->triangles.n == 0)
     gts_object_destroy (GTS_OBJECT (e3));
 
   (* GTS_OBJECT_CLASS (gts_triangle_class ())->parent_class->destroy) (object);
@@ -63,8 +63,9 @@ static void triangle_init (GtsTriangle * triangle)
 GtsTriangleClass * gts_triangle_class (void)
 {
   static GtsTriangleClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo triangle_info = {
       "GtsTriangle",
       sizeof (GtsTriangle),
@@ -76,6 +77,7 @@ GtsTriangleClass * gts_triangle_class (void)
     };
     klass = gts_object_class_new (gts_object_class (), 
 				  &triangle_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -124,9 +126,9 @@ void gts_triangle_set (GtsTriangle * triangle,
   else
     g_assert_not_reached ();
 
-  e1->triangles = g_slist_prepend (e1->triangles, triangle);
-  e2->triangles = g_slist_prepend (e2->triangles, triangle);
-  e3->triangles = g_slist_prepend (e3->triangles, triangle);
+  gts_edge_add_triangle (e1, triangle);
+  gts_edge_add_triangle (e2, triangle);
+  gts_edge_add_triangle (e3, triangle);
 }
 
 /**
@@ -489,15 +491,14 @@ GSList * gts_triangles_from_edges (GSList * edges)
   hash = g_hash_table_new (NULL, NULL);
   i = edges;
   while (i) {
-    GSList * j = GTS_EDGE (i->data)->triangles;
-    while (j) {
-      GtsTriangle * t = j->data;
+    GtsTriangle * t;
+    guint j;
+
+    GTS_ADJACENCY_FOREACH (&GTS_EDGE (i->data)->triangles, j, t)
       if (g_hash_table_lookup (hash, t) == NULL) {
 	triangles = g_slist_prepend (triangles, t);
 	g_hash_table_insert (hash, t, i);
       }
-      j = j->next;
-    }
     i = i->next;
   }
   g_hash_table_destroy (hash);
@@ -636,21 +637,18 @@ GtsTriangle * gts_triangle_enclosing (GtsTriangleClass * klass,
  */
 guint gts_triangle_neighbor_number (GtsTriangle * t)
 {
-  GSList * i;
-  guint nn = 0;
+  GtsTriangle * t1;
+  guint i, nn = 0;
   GtsEdge * ee[4], ** e = ee;
   
   g_return_val_if_fail (t != NULL, 0);
 
   ee[0] = t->e1; ee[1] = t->e2; ee[2] = t->e3; ee[3] = NULL;
   while (*e) {
-    i = (*e++)->triangles;
-    while (i) {
-      GtsTriangle * t1 = i->data;
+    GTS_ADJACENCY_FOREACH (&(*e)->triangles, i, t1)
       if (t1 != t)
 	nn++;
-      i = i->next;
-    }
+    e++;
   }
   return nn;
 }
@@ -663,20 +661,19 @@ guint gts_triangle_neighbor_number (GtsTriangle * t)
  */
 GSList * gts_triangle_neighbors (GtsTriangle * t)
 {
-  GSList * i, * list = NULL;
+  GSList * list = NULL;
+  GtsTriangle * t1;
+  guint i;
   GtsEdge * ee[4], ** e = ee;
   
   g_return_val_if_fail (t != NULL, NULL);
 
   ee[0] = t->e1; ee[1] = t->e2; ee[2] = t->e3; ee[3] = NULL;
   while (*e) {
-    i = (*e++)->triangles;
-    while (i) {
-      GtsTriangle * t1 = i->data;
+    GTS_ADJACENCY_FOREACH (&(*e)->triangles, i, t1)
       if (t1 != t)
 	list = g_slist_prepend (list, t1);
-      i = i->next;
-    }
+    e++;
   }
   return list;
 }
@@ -713,22 +710,19 @@ GtsEdge * gts_triangles_common_edge (GtsTriangle * t1,
  */
 GtsTriangle * gts_triangle_is_duplicate (GtsTriangle * t)
 {
-  GSList * i;
+  GtsTriangle * t1;
   GtsEdge * e2, * e3;
+  guint i;
 
   g_return_val_if_fail (t != NULL, NULL);
 
   e2 = t->e2;
   e3 = t->e3;
-  i = t->e1->triangles;
-  while (i) {
-    GtsTriangle * t1 = i->data;
+  GTS_ADJACENCY_FOREACH (&t->e1->triangles, i, t1)
     if (t1 != t && 
 	(t1->e1 == e2 || t1->e2 == e2 || t1->e3 == e2) &&
 	(t1->e1 == e3 || t1->e2 == e3 || t1->e3 == e3))
       return t1;
-    i = i->next;
-  }
   
   return NULL;
 }
@@ -746,21 +740,18 @@ GtsTriangle * gts_triangle_use_edges (GtsEdge * e1,
 				      GtsEdge * e2,
 				      GtsEdge * e3)
 {
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
   
   g_return_val_if_fail (e1 != NULL, NULL);
   g_return_val_if_fail (e2 != NULL, NULL);
   g_return_val_if_fail (e3 != NULL, NULL);
 
-  i = e1->triangles;
-  while (i) {
-    GtsTriangle * t = i->data;
+  GTS_ADJACENCY_FOREACH (&e1->triangles, i, t)
     if ((t->e1 == e2 && (t->e2 == e3 || t->e3 == e3)) ||
 	(t->e2 == e2 && (t->e1 == e3 || t->e3 == e3)) ||
 	(t->e3 == e2 && (t->e1 == e3 || t->e2 == e3)))
       return t;
-    i = i->next;
-  }
   
   return NULL;
 }
@@ -883,11 +874,24 @@ GtsPoint * gts_triangle_circumcircle_center (GtsTriangle * t,
 /* square of the maximum area ratio admissible */
 #define AREA_RATIO_MAX2 1e8
 
-static gboolean points_are_folded (GtsPoint * A,
-				   GtsPoint * B,
-				   GtsPoint * C,
-				   GtsPoint * D,
-				   gdouble max)
+/**
+ * gts_points_are_folded:
+ * @A: a #GtsPoint.
+ * @B: another #GtsPoint.
+ * @C: the third #GtsPoint of a triangle of edge @A @B.
+ * @D: the third #GtsPoint of another triangle of edge @A @B.
+ * @max: the maximum value of the square of the cosine of the angle between
+ * two triangles.
+ *
+ * Returns: %TRUE if triangles @A @B @C and @A @B @D make an angle larger
+ * than the value defined by @max or if the ratio of their areas is too
+ * large, %FALSE otherwise.
+ */
+gboolean gts_points_are_folded (GtsPoint * A,
+				GtsPoint * B,
+				GtsPoint * C,
+				GtsPoint * D,
+				gdouble max)
 {
   GtsVector AB, AC, AD;
   GtsVector n1, n2;
@@ -972,11 +976,11 @@ gboolean gts_triangles_are_folded (GSList * triangles,
     GSList * j = i->next;    
     while (j) {
       GtsVertex * D = triangle_use_vertices (j->data, A, B);
-      if (points_are_folded (GTS_POINT (A), 
-			     GTS_POINT (B), 
-			     GTS_POINT (C), 
-			     GTS_POINT (D), 
-			     max))
+      if (gts_points_are_folded (GTS_POINT (A), 
+				 GTS_POINT (B), 
+				 GTS_POINT (C), 
+				 GTS_POINT (D), 
+				 max))
 	return TRUE;
       j = j->next;
     }
@@ -985,6 +989,47 @@ gboolean gts_triangles_are_folded (GSList * triangles,
   return FALSE;
 }
 
+/**
+ * gts_edge_triangles_are_folded:
+ * @e: a #GtsEdge.
+ * @A: a #GtsVertex.
+ * @B: another #GtsVertex.
+ * @max: the maximum value of the square of the cosine of the angle between
+ * two triangles.
+ *
+ * Same as gts_triangles_are_folded() for the triangles of @e.
+ * 
+ * Returns: %TRUE if any pair of triangles of @e makes an angle larger 
+ * than the maximum value, %FALSE otherwise.
+ */
+gboolean gts_edge_triangles_are_folded (GtsEdge * e,
+					GtsVertex * A, GtsVertex * B,
+					gdouble max)
+{
+  GtsAdjacency * triangles;
+  guint i, j;
+
+  g_return_val_if_fail (e != NULL, TRUE);
+  g_return_val_if_fail (A != NULL, TRUE);
+  g_return_val_if_fail (B != NULL, TRUE);
+
+  triangles = &e->triangles;
+  for (i = 0; i < triangles->n; i++) {
+    GtsVertex * C = triangle_use_vertices (triangles->items[i], A, B);
+
+    for (j = i + 1; j < triangles->n; j++) {
+      GtsVertex * D = triangle_use_vertices (triangles->items[j], A, B);
+      if (gts_points_are_folded (GTS_POINT (A), 
+				 GTS_POINT (B), 
+				 GTS_POINT (C), 
+				 GTS_POINT (D), 
+				 max))
+	return TRUE;
+    }
+  }
+  return FALSE;
+}
+
 /**
  * gts_triangle_is_stabbed:
  * @t: a #GtsTriangle.
@@ -18,27 +18,143 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include "gts.h"
 
-gboolean gts_allow_floating_vertices = FALSE;
+GTS_THREAD_LOCAL gboolean gts_allow_floating_vertices = FALSE;
 
-static void vertex_destroy (GtsObject * object)
+/**
+ * gts_adjacency_init:
+ * @a: a #GtsAdjacency.
+ * @slots: an array of @nslots pointers.
+ * @nslots: the number of pointers in @slots.
+ *
+ * Makes @a an empty array storing its first @nslots items in @slots,
+ * typically part of the object holding @a. The items only go to the
+ * heap when more than @nslots are added.
+ */
+void gts_adjacency_init (GtsAdjacency * a, gpointer * slots, guint nslots)
 {
-  GtsVertex * vertex = GTS_VERTEX (object);
-  GSList * i;
+  g_return_if_fail (a != NULL);
 
-  i = vertex->segments;
-  while (i) {
-    GTS_OBJECT_SET_FLAGS (i->data, GTS_DESTROYED);
-    i = i->next;
-  }
-  i = vertex->segments;
-  while (i) {
-    GSList * next = i->next;
-    gts_object_destroy (i->data);
-    i = next;
+  a->items = slots;
+  a->n = 0;
+  a->size = nslots;
+}
+
+/**
+ * gts_adjacency_add:
+ * @a: a #GtsAdjacency.
+ * @item: a pointer.
+ * @slots: the slots @a was initialized with.
+ *
+ * Adds @item at the end of @a.
+ */
+void gts_adjacency_add (GtsAdjacency * a, gpointer item, gpointer * slots)
+{
+  if (a->n == a->size) {
+    a->size = MAX (2*a->size, 4);
+    if (a->items == slots) {
+      a->items = g_malloc (a->size*sizeof (gpointer));
+      memcpy (a->items, slots, a->n*sizeof (gpointer));
+    }
+    else
+      a->items = g_realloc (a->items, a->size*sizeof (gpointer));
   }
-  g_assert (vertex->segments == NULL);
+  a->items[a->n++] = item;
+}
+
+/**
+ * gts_adjacency_remove:
+ * @a: a #GtsAdjacency.
+ * @item: a pointer.
+ *
+ * Removes the first occurence of @item from @a, keeping the order of the
+ * other items.
+ *
+ * Returns: %TRUE if @item was found in @a, %FALSE otherwise.
+ */
+gboolean gts_adjacency_remove (GtsAdjacency * a, gpointer item)
+{
+  guint i;
+
+  for (i = 0; i < a->n; i++)
+    if (a->items[i] == item) {
+      a->n--;
+      memmove (&a->items[i], &a->items[i + 1], 
+	       (a->n - i)*sizeof (gpointer));
+      return TRUE;
+    }
+  return FALSE;
+}
+
+/**
+ * gts_adjacency_contains:
+ * @a: a #GtsAdjacency.
+ * @item: a pointer.
+ *
+ * Returns: %TRUE if @item is in @a, %FALSE otherwise.
+ */
+gboolean gts_adjacency_contains (GtsAdjacency * a, gpointer item)
+{
+  guint i;
+
+  for (i = 0; i < a->n; i++)
+    if (a->items[i] == item)
+      return TRUE;
+  return FALSE;
+}
+
+/**
+ * gts_adjacency_free:
+ * @a: a #GtsAdjacency.
+ * @slots: the slots @a was initialized with.
+ * @nslots: the number of pointers in @slots.
+ *
+ * Frees the memory allocated for the items of @a, leaving it empty.
+ */
+void gts_adjacency_free (GtsAdjacency * a, gpointer * slots, guint nslots)
+{
+  g_return_if_fail (a != NULL);
+
+  if (a->items != slots)
+    g_free (a->items);
+  gts_adjacency_init (a, slots, nslots);
+}
+
+/**
+ * gts_adjacency_list:
+ * @a: a #GtsAdjacency.
+ * @list: a #GSList.
+ *
+ * Returns: @list with the items of @a prepended, for the functions
+ * taking lists.
+ */
+GSList * gts_adjacency_list (GtsAdjacency * a, GSList * list)
+{
+  guint i;
+
+  g_return_val_if_fail (a != NULL, list);
+
+  for (i = a->n; i-- > 0;)
+    list = g_slist_prepend (list, a->items[i]);
+  return list;
+}
+
+static void vertex_destroy (GtsObject * object)
+{
+  GtsVertex * vertex = GTS_VERTEX (object);
+  GtsAdjacency * segments = &vertex->segments;
+  GtsSegment * s;
+  guint i;
+
+  GTS_ADJACENCY_FOREACH (segments, i, s)
+    GTS_OBJECT_SET_FLAGS (s, GTS_DESTROYED);
+  /* each segment removes itself from the array */
+  while (segments->n > 0)
+    gts_object_destroy (segments->items[segments->n - 1]);
+  gts_adjacency_free (segments, vertex->segment_slots, 
+		      GTS_VERTEX_SEGMENT_SLOTS);
 
   (* GTS_OBJECT_CLASS (gts_vertex_class ())->parent_class->destroy) (object);
 }
@@ -47,7 +163,9 @@ static void vertex_clone (GtsObject * clone, GtsObject * object)
 {
   (* GTS_OBJECT_CLASS (gts_vertex_class ())->parent_class->clone) (clone, 
 								   object);
-  GTS_VERTEX (clone)->segments = NULL;
+  gts_adjacency_init (&GTS_VERTEX (clone)->segments, 
+		      GTS_VERTEX (clone)->segment_slots,
+		      GTS_VERTEX_SEGMENT_SLOTS);
 }
 
 static void vertex_class_init (GtsVertexClass * klass)
@@ -59,7 +177,8 @@ static void vertex_class_init (GtsVertexClass * klass)
 
 static void vertex_init (GtsVertex * vertex)
 {
-  vertex->segments = NULL;
+  gts_adjacency_init (&vertex->segments, vertex->segment_slots,
+		      GTS_VERTEX_SEGMENT_SLOTS);
 }
 
 /**
@@ -70,8 +189,9 @@ static void vertex_init (GtsVertex * vertex)
 GtsVertexClass * gts_vertex_class (void)
 {
   static GtsVertexClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo vertex_info = {
       "GtsVertex",
       sizeof (GtsVertex),
@@ -83,6 +203,7 @@ GtsVertexClass * gts_vertex_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_point_class ()), 
 				  &vertex_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -115,28 +236,25 @@ GtsVertex * gts_vertex_new (GtsVertexClass * klass,
  *
  * Replaces vertex @v with vertex @with. @v and @with must be
  * different.  All the #GtsSegment which have @v has one of their
- * vertices are updated.  The segments list of vertex @v is freed and
- * @v->segments is set to %NULL.  
+ * vertices are updated.  The segments array of vertex @v is emptied.
  */
 void gts_vertex_replace (GtsVertex * v, GtsVertex * with)
 {
-  GSList * i;
+  GtsSegment * s;
+  guint i;
 
   g_return_if_fail (v != NULL);
   g_return_if_fail (with != NULL);
   g_return_if_fail (v != with);
 
-  i = v->segments;
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s) {
     if (s->v1 != with && s->v2 != with)
-      with->segments = g_slist_prepend (with->segments, s);
+      gts_vertex_add_segment (with, s);
     if (s->v1 == v) s->v1 = with;
     if (s->v2 == v) s->v2 = with;
-    i = i->next;
   }
-  g_slist_free (v->segments);
-  v->segments = NULL;
+  gts_adjacency_free (&v->segments, v->segment_slots, 
+		      GTS_VERTEX_SEGMENT_SLOTS);
 }
 
 /**
@@ -149,7 +267,7 @@ void gts_vertex_replace (GtsVertex * v, GtsVertex * with)
 gboolean gts_vertex_is_unattached (GtsVertex * v)
 {
   g_return_val_if_fail (v != NULL, FALSE);
-  if (v->segments == NULL)
+  if (v->segments.n == 0)
     return TRUE;
   return FALSE;
 }
@@ -164,19 +282,15 @@ gboolean gts_vertex_is_unattached (GtsVertex * v)
  */
 GtsSegment * gts_vertices_are_connected (GtsVertex * v1, GtsVertex * v2)
 {
-  GSList * i;
+  GtsSegment * s;
+  guint i;
   
   g_return_val_if_fail (v1 != NULL, FALSE);
   g_return_val_if_fail (v2 != NULL, FALSE);
   
-  i = v1->segments;
-  while (i) {
-    GtsSegment * s = i->data;
-
+  GTS_ADJACENCY_FOREACH (&v1->segments, i, s)
     if (s->v1 == v2 || s->v2 == v2)
       return s;
-    i = i->next;
-  }
   return NULL;
 }
 
@@ -224,23 +338,20 @@ GSList * gts_vertices_from_segments (GSList * segments)
 GSList * gts_vertex_triangles (GtsVertex * v, 
 			       GSList * list)
 {
-  GSList * i;
+  GtsSegment * s;
+  guint i;
 
   g_return_val_if_fail (v != NULL, NULL);
 
-  i = v->segments;
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s)
     if (GTS_IS_EDGE (s)) {
-      GSList * j = GTS_EDGE (s)->triangles;
-      while (j) {
-	if (!g_slist_find (list, j->data))
-	  list = g_slist_prepend (list, j->data);
-	j = j->next;
-      }
+      GtsTriangle * t;
+      guint j;
+
+      GTS_ADJACENCY_FOREACH (&GTS_EDGE (s)->triangles, j, t)
+	if (!g_slist_find (list, t))
+	  list = g_slist_prepend (list, t);
     }
-    i = i->next;
-  }
   return list;
 }
 
@@ -260,28 +371,24 @@ GSList * gts_vertex_faces (GtsVertex * v,
 			   GtsSurface * surface, 
 			   GSList * list)
 {
-  GSList * i;
+  GtsSegment * s;
+  guint i;
 
   g_return_val_if_fail (v != NULL, NULL);
 
-  i = v->segments;
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s)
     if (GTS_IS_EDGE (s)) {
-      GSList * j = GTS_EDGE (s)->triangles;
-      while (j) {
-	GtsTriangle * t = j->data;
+      GtsTriangle * t;
+      guint j;
+
+      GTS_ADJACENCY_FOREACH (&GTS_EDGE (s)->triangles, j, t)
 	if (GTS_IS_FACE (t) 
 	    && 
 	    (!surface || gts_face_has_parent_surface (GTS_FACE (t), surface)) 
 	    &&
 	    !g_slist_find (list, t))
 	  list = g_slist_prepend (list, t);
-	j = j->next;
-      }
     }
-    i = i->next;
-  }
   return list;
 }
 
@@ -301,13 +408,12 @@ GSList * gts_vertex_neighbors (GtsVertex * v,
 			       GSList * list,
 			       GtsSurface * surface)
 {
-  GSList * i;
+  GtsSegment * s;
+  guint i;
 
   g_return_val_if_fail (v != NULL, NULL);
 
-  i = v->segments;
-  while (i) {
-    GtsSegment * s = i->data;
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s) {
     GtsVertex * v1 = s->v1 == v ? s->v2 : s->v1;
     if (v1 != v && 
 	(!surface || 
@@ -315,7 +421,6 @@ GSList * gts_vertex_neighbors (GtsVertex * v,
 	  gts_edge_has_parent_surface (GTS_EDGE (s), surface))) &&
 	!g_slist_find (list, v1))
       list = g_slist_prepend (list, v1);
-    i = i->next;
   }
   return list;
 }
@@ -330,17 +435,15 @@ GSList * gts_vertex_neighbors (GtsVertex * v,
  */
 gboolean gts_vertex_is_boundary (GtsVertex * v, GtsSurface * surface)
 {
-  GSList * i;
+  GtsSegment * s;
+  guint i;
 
   g_return_val_if_fail (v != NULL, FALSE);
   
-  i = v->segments;
-  while (i) {
-    if (GTS_IS_EDGE (i->data) && 
-	gts_edge_is_boundary (i->data, surface))
+  GTS_ADJACENCY_FOREACH (&v->segments, i, s)
+    if (GTS_IS_EDGE (s) && 
+	gts_edge_is_boundary (GTS_EDGE (s), surface))
       return TRUE;
-    i = i->next;
-  }
 
   return FALSE;
 }
@@ -356,7 +459,7 @@ gboolean gts_vertex_is_boundary (GtsVertex * v, GtsSurface * surface)
  * @vertices contained in a box centered on v of size 2*@epsilon. If
  * there are and if @check is not %NULL and returns %TRUE, replace
  * them with v (using gts_vertex_replace()), destroy them and remove
- * them from list.  This is done efficiently using Kd-Trees.
+ * them from list.  This is done efficiently using a #GtsKdTree.
  *
  * Returns: the updated list of vertices.  
  */
@@ -366,7 +469,10 @@ GList * gts_vertices_merge (GList * vertices,
 {
   GPtrArray * array;
   GList * i;
-  GNode * kdtree;
+  GtsKdTree * kdtree;
+  GtsBBox * bbox;
+  GtsPoint ** selected;
+  guint size = 16;
 
   g_return_val_if_fail (vertices != NULL, 0);
 
@@ -376,44 +482,48 @@ GList * gts_vertices_merge (GList * vertices,
     g_ptr_array_add (array, i->data);
     i = i->next;
   }
-  kdtree = gts_kdtree_new (array, NULL);
+  kdtree = gts_kd_flat_new (array, 1);
   g_ptr_array_free (array, TRUE);
-  
+
+  bbox = gts_bbox_new (gts_bbox_class (), NULL, 0., 0., 0., 0., 0., 0.);
+  selected = g_malloc (size*sizeof (GtsPoint *));
   i = vertices;
   while (i) {
     GtsVertex * v = i->data;
     if (!GTS_OBJECT (v)->reserved) { /* Do something only if v is active */
-      GtsBBox * bbox;
-      GSList * selected, * j;
+      guint j, n;
 
       /* build bounding box */
-      bbox = gts_bbox_new (gts_bbox_class (),
-			   v, 
-			   GTS_POINT (v)->x - epsilon,
-			   GTS_POINT (v)->y - epsilon,
-			   GTS_POINT (v)->z - epsilon,
-			   GTS_POINT (v)->x + epsilon,
-			   GTS_POINT (v)->y + epsilon,
-			   GTS_POINT (v)->z + epsilon);
+      gts_bbox_set (bbox, v, 
+		    GTS_POINT (v)->x - epsilon,
+		    GTS_POINT (v)->y - epsilon,
+		    GTS_POINT (v)->z - epsilon,
+		    GTS_POINT (v)->x + epsilon,
+		    GTS_POINT (v)->y + epsilon,
+		    GTS_POINT (v)->z + epsilon);
 
       /* select vertices which are inside bbox using kdtree */
-      j = selected = gts_kdtree_range (kdtree, bbox, NULL);
-      while (j) {
-	GtsVertex * sv = j->data;
+      n = gts_kd_flat_range (kdtree, bbox, selected, size);
+      if (n > size) {
+	size = 2*n;
+	selected = g_realloc (selected, size*sizeof (GtsPoint *));
+	gts_kd_flat_range (kdtree, bbox, selected, size);
+      }
+      for (j = 0; j < n; j++) {
+	GtsVertex * sv = GTS_VERTEX (selected[j]);
 	if (sv != v && !GTS_OBJECT (sv)->reserved && (!check || (*check) (sv, v))) {
 	  /* sv is not v and is active */
 	  gts_vertex_replace (sv, v);
 	  GTS_OBJECT (sv)->reserved = sv; /* mark sv as inactive */
 	}
-	j = j->next;
       }
-      g_slist_free (selected);
-      gts_object_destroy (GTS_OBJECT (bbox));
     }
     i = i->next;
   }
+  g_free (selected);
+  gts_object_destroy (GTS_OBJECT (bbox));
 
-  gts_kdtree_destroy (kdtree);
+  gts_kd_flat_destroy (kdtree);
 
   /* destroy inactive vertices and removes them from list */
 
@@ -443,20 +553,17 @@ static GSList * edge_fan_list (GtsVertex * v,
 			       GtsEdge * e,
 			       GtsFace * first)
 {
-  GSList * i = e->triangles;
-  GtsFace * neighbor = NULL;
+  GtsFace * neighbor = NULL, * f1;
   GtsEdge * next = NULL, * enext = NULL;
+  guint i;
 
-  while (i) {
-    GtsFace * f1 = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, f1)
     if (GTS_IS_FACE (f1) &&
 	f1 != f &&
 	gts_face_has_parent_surface (f1, surface)) {
       g_return_val_if_fail (neighbor == NULL, NULL); /* non-manifold edge */
       neighbor = f1;
     }
-    i = i->next;
-  }
   if (neighbor == NULL || neighbor == first) /* end of fan */
     return NULL;
 
@@ -496,28 +603,26 @@ GSList * gts_vertex_fan_oriented (GtsVertex * v, GtsSurface * surface)
 {
   GtsFace * f = NULL;
   guint d = 2;
-  GSList * i;
+  GtsEdge * e;
+  guint i;
   GtsVertex * v1, * v2, * v3;
   GtsEdge * e1, * e2, * e3;
 
   g_return_val_if_fail (v != NULL, NULL);
   g_return_val_if_fail (surface != NULL, NULL);
 
-  i = v->segments;
-  while (i) {
-    GtsEdge * e = i->data;
+  GTS_ADJACENCY_FOREACH (&v->segments, i, e)
     if (GTS_IS_EDGE (e)) {
-      GSList * j = e->triangles;
       GtsFace * f1 = NULL;
-      guint degree = 0;
-      while (j) {
-	if (GTS_IS_FACE (j->data) &&
-	    gts_face_has_parent_surface (j->data, surface)) {
-	  f1 = j->data;
+      GtsTriangle * t;
+      guint degree = 0, j;
+
+      GTS_ADJACENCY_FOREACH (&e->triangles, j, t)
+	if (GTS_IS_FACE (t) &&
+	    gts_face_has_parent_surface (GTS_FACE (t), surface)) {
+	  f1 = GTS_FACE (t);
 	  degree++;
 	}
-	j = j->next;
-      }
       if (f1 != NULL) {
 	g_return_val_if_fail (degree <= 2, NULL); /* non-manifold edge */
 	if (degree == 1) {
@@ -540,8 +645,6 @@ GSList * gts_vertex_fan_oriented (GtsVertex * v, GtsSurface * surface)
 	  f = f1;
       }
     }
-    i = i->next;
-  }
 
   if (f == NULL)
     return NULL;
@@ -583,8 +686,8 @@ static GtsEdge * replace_vertex (GtsTriangle * t,
     GtsSegment * s = GTS_SEGMENT (e);
     if (s->v1 == v) s->v1 = with;
     if (s->v2 == v) s->v2 = with;
-    with->segments = g_slist_prepend (with->segments, s);
-    v->segments = g_slist_remove (v->segments, s);
+    gts_vertex_add_segment (with, s);
+    gts_vertex_remove_segment (v, s);
   }
 
   return e;
@@ -592,20 +695,17 @@ static GtsEdge * replace_vertex (GtsTriangle * t,
 
 static void triangle_next (GtsEdge * e, GtsVertex * v, GtsVertex * with)
 {
-  GSList * i;
+  GtsTriangle * t;
+  guint i;
 
   if (e == NULL)
     return;
     
-  i = e->triangles;
-  while (i) {
-    GtsTriangle * t = i->data;
+  GTS_ADJACENCY_FOREACH (&e->triangles, i, t)
     if (GTS_OBJECT (t)->reserved) {
       GTS_OBJECT (t)->reserved = NULL;
       triangle_next (replace_vertex (t, e, v, with), v, with);
     }
-    i = i->next;
-  }
 }
 
 /** 
@@ -737,8 +837,9 @@ static void gts_vertex_normal_class_init (GtsVertexClass * klass)
 GtsVertexClass * gts_vertex_normal_class (void)
 {
   static GtsVertexClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo gts_vertex_normal_info = {
       "GtsVertexNormal",
       sizeof (GtsVertexNormal),
@@ -750,6 +851,7 @@ GtsVertexClass * gts_vertex_normal_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_vertex_class ()),
 				  &gts_vertex_normal_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
@@ -760,8 +862,9 @@ GtsVertexClass * gts_vertex_normal_class (void)
 GtsVertexClass * gts_color_vertex_class (void)
 {
   static GtsVertexClass * klass = NULL;
+  static gsize initialized = 0;
 
-  if (klass == NULL) {
+  if (g_once_init_enter (&initialized)) {
     GtsObjectClassInfo gts_color_vertex_info = {
       "GtsColorVertex",
       sizeof (GtsColorVertex),
@@ -773,6 +876,7 @@ GtsVertexClass * gts_color_vertex_class (void)
     };
     klass = gts_object_class_new (GTS_OBJECT_CLASS (gts_vertex_class ()),
 				  &gts_color_vertex_info);
+    g_once_init_leave (&initialized, 1);
   }
 
   return klass;
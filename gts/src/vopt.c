@@ -149,25 +149,19 @@ static gdouble boundary_cost (GtsEdge * edge,
 static gdouble edge_boundary_cost (GtsEdge * e, GtsVertex * v)
 {
   gdouble cost = 0.;
-  GSList * i;
-
-  i = GTS_SEGMENT (e)->v1->segments;
-  while (i) {
-    GtsFace * f;
-    if (GTS_IS_EDGE (i->data) && 
-	(f = gts_edge_is_boundary (i->data, NULL)))
-      cost += boundary_cost (i->data, f, v);
-    i = i->next;
-  }
-  i = GTS_SEGMENT (e)->v2->segments;
-  while (i) {
-    GtsFace * f;
-    if (i->data != e && 
-	GTS_IS_EDGE (i->data) && 
-	(f = gts_edge_is_boundary (i->data, NULL)))
-      cost += boundary_cost (i->data, f, v);
-    i = i->next;
-  }
+  GtsEdge * e1;
+  GtsFace * f;
+  guint i;
+
+  GTS_ADJACENCY_FOREACH (&GTS_SEGMENT (e)->v1->segments, i, e1)
+    if (GTS_IS_EDGE (e1) && 
+	(f = gts_edge_is_boundary (e1, NULL)))
+      cost += boundary_cost (e1, f, v);
+  GTS_ADJACENCY_FOREACH (&GTS_SEGMENT (e)->v2->segments, i, e1)
+    if (e1 != e && 
+	GTS_IS_EDGE (e1) && 
+	(f = gts_edge_is_boundary (e1, NULL)))
+      cost += boundary_cost (e1, f, v);
 
   return cost/4.;
 }
@@ -250,7 +244,7 @@ GtsVertex * gts_volume_optimized_vertex (GtsEdge * edge,
   GtsVector cb = {0., 0., 0.};
   GtsVertex * v;
   GtsVertex * v1, * v2;
-  guint n = 0, nb = 0;
+  guint k, n = 0, nb = 0;
 #ifdef DEBUG_VOPT
   guint nold = 0;
 #endif
@@ -265,20 +259,17 @@ GtsVertex * gts_volume_optimized_vertex (GtsEdge * edge,
   v2 = GTS_SEGMENT (edge)->v2;
 
   /* boundary preservation */
-  i = v1->segments;
-  while (i) {
-    GtsEdge * edge1 = i->data;
+  for (k = 0; k < v1->segments.n; k++) {
+    GtsEdge * edge1 = v1->segments.items[k];
     GtsFace * f;
     if (GTS_IS_EDGE (edge1) &&
 	(f = gts_edge_is_boundary (edge1, NULL))) {
       boundary_preservation (edge1, f, e1, e2, Hb, cb);
       nb++;
     }
-    i = i->next;
   }
-  i = v2->segments;
-  while (i) {
-    GtsEdge * edge1 = i->data;
+  for (k = 0; k < v2->segments.n; k++) {
+    GtsEdge * edge1 = v2->segments.items[k];
     GtsFace * f;
     if (edge1 != edge && 
 	GTS_IS_EDGE (edge1) &&
@@ -286,7 +277,6 @@ GtsVertex * gts_volume_optimized_vertex (GtsEdge * edge,
       boundary_preservation (edge1, f, e1, e2, Hb, cb);
       nb++;
     }
-    i = i->next;
   }
   if (nb > 0) {
     GtsMatrix * H = gts_matrix_new (
@@ -0,0 +1,277 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "gts.h"
+
+/* Checks the structure of a #GtsBVH and its queries against a
+   brute-force scan of all the bounding boxes */
+
+#define NT 3000
+#define NQ 300
+
+static gdouble random_double (void)
+{
+  return rand ()/(gdouble) RAND_MAX;
+}
+
+static GtsBBox * random_bbox (gdouble size)
+{
+  gdouble x = random_double (), y = random_double (), z = random_double ();
+
+  return gts_bbox_new (gts_bbox_class (), NULL,
+		       x, y, z,
+		       x + size*random_double (),
+		       y + size*random_double (),
+		       z + size*random_double ());
+}
+
+static void boxes_union (GtsBVHBoxes * b, guint32 start, guint32 end,
+			 gdouble * u)
+{
+  guint32 i;
+
+  u[0] = u[1] = u[2] = G_MAXDOUBLE;
+  u[3] = u[4] = u[5] = - G_MAXDOUBLE;
+  for (i = start; i < end; i++) {
+    u[0] = MIN (u[0], b->x1[i]); u[3] = MAX (u[3], b->x2[i]);
+    u[1] = MIN (u[1], b->y1[i]); u[4] = MAX (u[4], b->y2[i]);
+    u[2] = MIN (u[2], b->z1[i]); u[5] = MAX (u[5], b->z2[i]);
+  }
+}
+
+static void check_structure (GtsBVH * bvh, guint nitems)
+{
+  guint32 i, j;
+  guint n = 0;
+
+  g_assert (bvh->nitems == nitems);
+  for (j = 0; j < bvh->nitems; j++) {
+    GtsBBox * bb = bvh->bboxes[j];
+
+    g_assert (bvh->item.x1[j] == bb->x1 && bvh->item.x2[j] == bb->x2);
+    g_assert (bvh->item.y1[j] == bb->y1 && bvh->item.y2[j] == bb->y2);
+    g_assert (bvh->item.z1[j] == bb->z1 && bvh->item.z2[j] == bb->z2);
+    i = bvh->leaf[j];
+    g_assert (bvh->count[i] > 0);
+    g_assert (j >= bvh->first[i] && j < bvh->first[i] + bvh->count[i]);
+  }
+
+  g_assert (bvh->parent[0] == 0);
+  for (i = 0; i < bvh->nnodes; i++) {
+    gdouble u[6];
+
+    if (bvh->count[i] > 0) {
+      boxes_union (&bvh->item, bvh->first[i], bvh->first[i] + bvh->count[i],
+		   u);
+      n += bvh->count[i];
+    }
+    else {
+      g_assert (bvh->first[i] > i && bvh->first[i] + 1 < bvh->nnodes);
+      g_assert (bvh->parent[bvh->first[i]] == i);
+      g_assert (bvh->parent[bvh->first[i] + 1] == i);
+      boxes_union (&bvh->node, bvh->first[i], bvh->first[i] + 2, u);
+    }
+    g_assert (bvh->node.x1[i] == u[0] && bvh->node.x2[i] == u[3]);
+    g_assert (bvh->node.y1[i] == u[1] && bvh->node.y2[i] == u[4]);
+    g_assert (bvh->node.z1[i] == u[2] && bvh->node.z2[i] == u[5]);
+  }
+  g_assert (n == nitems);
+}
+
+#define SAME_ARRAY(a, b, n) (memcmp ((a), (b), (n)*sizeof (*(a))) == 0)
+
+static void check_same_boxes (GtsBVHBoxes * b1, GtsBVHBoxes * b2, guint n)
+{
+  g_assert (SAME_ARRAY (b1->x1, b2->x1, n));
+  g_assert (SAME_ARRAY (b1->y1, b2->y1, n));
+  g_assert (SAME_ARRAY (b1->z1, b2->z1, n));
+  g_assert (SAME_ARRAY (b1->x2, b2->x2, n));
+  g_assert (SAME_ARRAY (b1->y2, b2->y2, n));
+  g_assert (SAME_ARRAY (b1->z2, b2->z2, n));
+}
+
+static void check_same_bvh (GtsBVH * bvh1, GtsBVH * bvh2)
+{
+  g_assert (bvh1->nnodes == bvh2->nnodes);
+  g_assert (bvh1->nitems == bvh2->nitems);
+  g_assert (bvh1->depth == bvh2->depth);
+  check_same_boxes (&bvh1->node, &bvh2->node, bvh1->nnodes);
+  check_same_boxes (&bvh1->item, &bvh2->item, bvh1->nitems);
+  g_assert (SAME_ARRAY (bvh1->first, bvh2->first, bvh1->nnodes));
+  g_assert (SAME_ARRAY (bvh1->count, bvh2->count, bvh1->nnodes));
+  g_assert (SAME_ARRAY (bvh1->parent, bvh2->parent, bvh1->nnodes));
+  g_assert (SAME_ARRAY (bvh1->bboxes, bvh2->bboxes, bvh1->nitems));
+  g_assert (SAME_ARRAY (bvh1->leaf, bvh2->leaf, bvh1->nitems));
+}
+
+/* Checks that @list contains each of the @n @boxes for which @test is
+   %TRUE exactly once and nothing else. Frees @list. */
+static void check_list (GSList * list, GtsBBox ** boxes, guint n,
+			gboolean (* test) (GtsBBox *, gpointer),
+			gpointer data)
+{
+  GSList * i;
+  guint j, expected = 0;
+
+  for (i = list; i; i = i->next) {
+    GtsBBox * bb = i->data;
+
+    g_assert (GTS_OBJECT (bb)->reserved == NULL);
+    g_assert ((* test) (bb, data));
+    GTS_OBJECT (bb)->reserved = bb;
+  }
+  for (j = 0; j < n; j++)
+    if ((* test) (boxes[j], data))
+      expected++;
+  g_assert (g_slist_length (list) == expected);
+  for (i = list; i; i = i->next)
+    GTS_OBJECT (i->data)->reserved = NULL;
+  g_slist_free (list);
+}
+
+static gboolean is_stabbed (GtsBBox * bb, GtsPoint * p)
+{
+  return gts_bbox_is_stabbed (bb, p);
+}
+
+static gboolean is_overlapping (GtsBBox * bb, GtsBBox * bbox)
+{
+  return gts_bboxes_are_overlapping (bb, bbox);
+}
+
+static void count_pair (GtsBBox * bb1, GtsBBox * bb2, guint * n)
+{
+  g_assert (gts_bboxes_are_overlapping (bb1, bb2));
+  (*n)++;
+}
+
+static gdouble bbox_nearest (GtsPoint * p, GtsBBox * bb, GtsVector c)
+{
+  gdouble min, max;
+
+  c[0] = CLAMP (p->x, bb->x1, bb->x2);
+  c[1] = CLAMP (p->y, bb->y1, bb->y2);
+  c[2] = CLAMP (p->z, bb->z1, bb->z2);
+  gts_bbox_point_distance2 (bb, p, &min, &max);
+  return min;
+}
+
+int main (int argc, char * argv[])
+{
+  GtsBBox * boxes[NT], * others[NQ];
+  GSList * bboxes = NULL, * obboxes = NULL;
+  GtsBVH * bvh, * bvh4, * obvh;
+  GtsBBox * bbox;
+  GtsPoint * p;
+  GtsVector * points;
+  GtsBBoxNearest * r1, * r4;
+  guint i, j, n, expected;
+
+  srand (1);
+  for (i = 0; i < NT; i++) {
+    boxes[i] = random_bbox (0.05);
+    boxes[i]->bounded = boxes[i];
+    bboxes = g_slist_prepend (bboxes, boxes[i]);
+  }
+  for (i = 0; i < NQ; i++) {
+    others[i] = random_bbox (0.05);
+    obboxes = g_slist_prepend (obboxes, others[i]);
+  }
+
+  /* the tree does not depend on the number of threads */
+  bvh = gts_bvh_new (bboxes, 1);
+  check_structure (bvh, NT);
+  bvh4 = gts_bvh_new (bboxes, 4);
+  check_structure (bvh4, NT);
+  check_same_bvh (bvh, bvh4);
+
+  p = gts_point_new (gts_point_class (), 0., 0., 0.);
+  bbox = gts_bbox_new (gts_bbox_class (), NULL, 0., 0., 0., 0., 0., 0.);
+  for (i = 0; i < NQ; i++) {
+    gts_point_set (p, random_double (), random_double (), random_double ());
+    check_list (gts_bvh_stabbed (bvh, p), boxes, NT,
+		(gboolean (*) (GtsBBox *, gpointer)) is_stabbed, p);
+
+    gts_bbox_set (bbox, NULL, p->x, p->y, p->z,
+		  p->x + 0.1*random_double (),
+		  p->y + 0.1*random_double (),
+		  p->z + 0.1*random_double ());
+    check_list (gts_bvh_overlap (bvh, bbox), boxes, NT,
+		(gboolean (*) (GtsBBox *, gpointer)) is_overlapping, bbox);
+    expected = 0;
+    for (j = 0; j < NT && !expected; j++)
+      expected = gts_bboxes_are_overlapping (boxes[j], bbox);
+    g_assert (gts_bvh_is_overlapping (bvh, bbox) == expected);
+  }
+
+  obvh = gts_bvh_new (obboxes, 1);
+  n = expected = 0;
+  gts_bvh_traverse_overlapping (bvh, obvh, (GtsBBTreeTraverseFunc) count_pair,
+				&n);
+  for (i = 0; i < NT; i++)
+    for (j = 0; j < NQ; j++)
+      if (gts_bboxes_are_overlapping (boxes[i], others[j]))
+	expected++;
+  g_assert (n == expected);
+
+  /* batched queries give the same results as single ones, whatever
+     the number of threads */
+  points = g_malloc (NQ*sizeof (GtsVector));
+  r1 = g_malloc (NQ*sizeof (GtsBBoxNearest));
+  r4 = g_malloc (NQ*sizeof (GtsBBoxNearest));
+  for (i = 0; i < NQ; i++) {
+    points[i][0] = 1.2*random_double () - 0.1;
+    points[i][1] = 1.2*random_double () - 0.1;
+    points[i][2] = 1.2*random_double () - 0.1;
+  }
+  gts_bvh_points_nearest (bvh, points, NQ, 
+			  (GtsBBoxNearestFunc) bbox_nearest, r1, 1);
+  gts_bvh_points_nearest (bvh, points, NQ, 
+			  (GtsBBoxNearestFunc) bbox_nearest, r4, 4);
+  for (i = 0; i < NQ; i++) {
+    GtsBBoxNearest n1;
+    gdouble min = G_MAXDOUBLE;
+    GtsVector c;
+
+    gts_point_set (p, points[i][0], points[i][1], points[i][2]);
+    n1 = gts_bvh_point_nearest (bvh, p, (GtsBBoxNearestFunc) bbox_nearest);
+    for (j = 0; j < NT; j++)
+      min = MIN (min, bbox_nearest (p, boxes[j], c));
+    g_assert (n1.distance2 == min);
+    g_assert (r1[i].bbox == n1.bbox && r1[i].distance2 == n1.distance2);
+    g_assert (r4[i].bbox == n1.bbox && r4[i].distance2 == n1.distance2);
+    g_assert (SAME_ARRAY (r1[i].closest, n1.closest, 3));
+    g_assert (SAME_ARRAY (r4[i].closest, n1.closest, 3));
+  }
+  g_free (points);
+  g_free (r1);
+  g_free (r4);
+
+  gts_object_destroy (GTS_OBJECT (p));
+  gts_object_destroy (GTS_OBJECT (bbox));
+  gts_bvh_destroy (obvh, TRUE);
+  gts_bvh_destroy (bvh4, FALSE);
+  gts_bvh_destroy (bvh, TRUE);
+  g_slist_free (bboxes);
+  g_slist_free (obboxes);
+
+  return 0;
+}
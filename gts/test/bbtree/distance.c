@@ -0,0 +1,184 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "gts.h"
+
+/* Checks the point queries of the bounding box trees against a
+   brute-force scan of all the triangles, in particular with distance
+   functions which do not return the Euclidean distance */
+
+#define NT 2000
+#define NQ 500
+#define K 8
+
+static gdouble random_double (void)
+{
+  return rand ()/(gdouble) RAND_MAX;
+}
+
+static GtsTriangle * random_triangle (gdouble size)
+{
+  GtsVertex * v[3];
+  GtsEdge * e1, * e2, * e3;
+  gdouble x = random_double (), y = random_double (), z = random_double ();
+  guint i;
+
+  for (i = 0; i < 3; i++)
+    v[i] = gts_vertex_new (gts_vertex_class (),
+			   x + size*random_double (),
+			   y + size*random_double (),
+			   z + size*random_double ());
+  e1 = gts_edge_new (gts_edge_class (), v[0], v[1]);
+  e2 = gts_edge_new (gts_edge_class (), v[1], v[2]);
+  e3 = gts_edge_new (gts_edge_class (), v[2], v[0]);
+  return gts_triangle_new (gts_triangle_class (), e1, e2, e3);
+}
+
+static GtsPoint * triangle_closest (GtsPoint * p, GtsTriangle * t)
+{
+  GtsPoint * c = gts_point_new (gts_point_class (), 0., 0., 0.);
+
+  gts_point_triangle_closest (p, t, c);
+  return c;
+}
+
+static gdouble brute_distance (GtsTriangle ** t, GtsPoint * p,
+			       GtsBBoxDistFunc distance)
+{
+  gdouble dmin = G_MAXDOUBLE;
+  guint i;
+
+  for (i = 0; i < NT; i++) {
+    gdouble d = (*distance) (p, t[i]);
+
+    if (fabs (d) < fabs (dmin))
+      dmin = d;
+  }
+  return dmin;
+}
+
+static int compare_doubles (const void * a, const void * b)
+{
+  gdouble d1 = *((gdouble *) a), d2 = *((gdouble *) b);
+
+  return d1 < d2 ? -1 : d1 > d2;
+}
+
+static void check_distance (GNode * tree, GtsBVH * bvh,
+			    GtsTriangle ** t, GtsPoint * p,
+			    GtsBBoxDistFunc distance)
+{
+  gdouble d = brute_distance (t, p, distance);
+  GtsBBox * b1 = NULL, * b2 = NULL;
+
+  g_assert (gts_bb_tree_point_distance (tree, p, distance, &b1) == d);
+  g_assert (gts_bvh_point_distance (bvh, p, distance, &b2) == d);
+  g_assert ((*distance) (p, b1->bounded) == d);
+  g_assert ((*distance) (p, b2->bounded) == d);
+}
+
+static void check_closest (GNode * tree, GtsBVH * bvh,
+			   GtsTriangle ** t, GtsPoint * p)
+{
+  gdouble d = brute_distance (t, p, (GtsBBoxDistFunc) 
+			      gts_point_triangle_distance2), d1, d2;
+  GtsPoint * c1, * c2;
+
+  c1 = gts_bb_tree_point_closest (tree, p, (GtsBBoxClosestFunc) 
+				  triangle_closest, &d1);
+  c2 = gts_bvh_point_closest (bvh, p, (GtsBBoxClosestFunc) 
+			      triangle_closest, &d2);
+  g_assert (fabs (d1 - d) <= 1e-12 && fabs (d2 - d) <= 1e-12);
+  g_assert (fabs (gts_point_distance2 (c1, p) - d1) <= 1e-12);
+  g_assert (gts_point_distance2 (c1, c2) <= 1e-24);
+  gts_object_destroy (GTS_OBJECT (c1));
+  gts_object_destroy (GTS_OBJECT (c2));
+}
+
+static void check_nearest (GNode * tree, GtsBVH * bvh,
+			   GtsTriangle ** t, GtsPoint * p)
+{
+  gdouble all[NT];
+  GtsBBoxNearest n1, n2, k1[K], k2[K];
+  GtsVector c;
+  guint i;
+
+  for (i = 0; i < NT; i++)
+    all[i] = gts_point_triangle_nearest (p, t[i], c);
+  qsort (all, NT, sizeof (gdouble), compare_doubles);
+
+  n1 = gts_bb_tree_point_nearest (tree, p, (GtsBBoxNearestFunc)
+				  gts_point_triangle_nearest);
+  n2 = gts_bvh_point_nearest (bvh, p, (GtsBBoxNearestFunc)
+			      gts_point_triangle_nearest);
+  g_assert (n1.distance2 == all[0] && n2.distance2 == all[0]);
+
+  g_assert (gts_bb_tree_point_k_nearest (tree, p, (GtsBBoxNearestFunc)
+					 gts_point_triangle_nearest,
+					 K, k1) == K);
+  g_assert (gts_bvh_point_k_nearest (bvh, p, (GtsBBoxNearestFunc)
+				     gts_point_triangle_nearest,
+				     K, k2) == K);
+  for (i = 0; i < K; i++)
+    g_assert (k1[i].distance2 == all[i] && k2[i].distance2 == all[i]);
+}
+
+int main (int argc, char * argv[])
+{
+  GtsTriangle * t[NT];
+  GSList * bboxes = NULL;
+  GNode * tree;
+  GtsBVH * bvh;
+  GtsPoint * p;
+  guint i;
+
+  srand (1);
+  for (i = 0; i < NT; i++) {
+    t[i] = random_triangle (0.02);
+    bboxes = g_slist_prepend (bboxes, 
+			      gts_bbox_triangle (gts_bbox_class (), t[i]));
+  }
+  tree = gts_bb_tree_new (bboxes);
+  bvh = gts_bvh_new (bboxes, 1);
+
+  p = gts_point_new (gts_point_class (), 0., 0., 0.);
+  for (i = 0; i < NQ; i++) {
+    gts_point_set (p, 
+		   1.2*random_double () - 0.1,
+		   1.2*random_double () - 0.1,
+		   1.2*random_double () - 0.1);
+    check_distance (tree, bvh, t, p, 
+		    (GtsBBoxDistFunc) gts_point_triangle_distance);
+    check_distance (tree, bvh, t, p, 
+		    (GtsBBoxDistFunc) gts_point_triangle_distance2);
+    check_closest (tree, bvh, t, p);
+    check_nearest (tree, bvh, t, p);
+  }
+
+  gts_object_destroy (GTS_OBJECT (p));
+  gts_bb_tree_destroy (tree, TRUE);
+  gts_bvh_destroy (bvh, FALSE);
+  g_slist_free (bboxes);
+  for (i = 0; i < NT; i++)
+    gts_object_destroy (GTS_OBJECT (t[i]));
+
+  return 0;
+}
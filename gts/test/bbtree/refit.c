@@ -0,0 +1,205 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gts.h"
+
+/* Checks that gts_bvh_refit() keeps the boxes of a #GtsBVH tight
+   around a deforming surface and its queries exact */
+
+#define NQ 200
+
+static gdouble random_double (void)
+{
+  return rand ()/(gdouble) RAND_MAX;
+}
+
+static void boxes_union (GtsBVHBoxes * b, guint32 start, guint32 end,
+			 gdouble * u)
+{
+  guint32 i;
+
+  u[0] = u[1] = u[2] = G_MAXDOUBLE;
+  u[3] = u[4] = u[5] = - G_MAXDOUBLE;
+  for (i = start; i < end; i++) {
+    u[0] = MIN (u[0], b->x1[i]); u[3] = MAX (u[3], b->x2[i]);
+    u[1] = MIN (u[1], b->y1[i]); u[4] = MAX (u[4], b->y2[i]);
+    u[2] = MIN (u[2], b->z1[i]); u[5] = MAX (u[5], b->z2[i]);
+  }
+}
+
+/* Checks that the items of @bvh bound their triangles tightly and that
+   each node is the union of its children or items */
+static void check_boxes (GtsBVH * bvh)
+{
+  guint32 i, j;
+
+  for (j = 0; j < bvh->nitems; j++) {
+    GtsBBox * bb = bvh->bboxes[j];
+    GtsBBox * t = gts_bbox_triangle (gts_bbox_class (), bb->bounded);
+
+    g_assert (bb->x1 == t->x1 && bb->y1 == t->y1 && bb->z1 == t->z1);
+    g_assert (bb->x2 == t->x2 && bb->y2 == t->y2 && bb->z2 == t->z2);
+    g_assert (bvh->item.x1[j] == t->x1 && bvh->item.x2[j] == t->x2);
+    g_assert (bvh->item.y1[j] == t->y1 && bvh->item.y2[j] == t->y2);
+    g_assert (bvh->item.z1[j] == t->z1 && bvh->item.z2[j] == t->z2);
+    gts_object_destroy (GTS_OBJECT (t));
+  }
+  for (i = 0; i < bvh->nnodes; i++) {
+    gdouble u[6];
+
+    if (bvh->count[i] > 0)
+      boxes_union (&bvh->item, bvh->first[i], bvh->first[i] + bvh->count[i],
+		   u);
+    else
+      boxes_union (&bvh->node, bvh->first[i], bvh->first[i] + 2, u);
+    g_assert (bvh->node.x1[i] == u[0] && bvh->node.x2[i] == u[3]);
+    g_assert (bvh->node.y1[i] == u[1] && bvh->node.y2[i] == u[4]);
+    g_assert (bvh->node.z1[i] == u[2] && bvh->node.z2[i] == u[5]);
+  }
+}
+
+static void check_nearest (GtsBVH * bvh)
+{
+  GtsPoint * p = gts_point_new (gts_point_class (), 0., 0., 0.);
+  guint i, j;
+
+  for (i = 0; i < NQ; i++) {
+    GtsBBoxNearest n;
+    gdouble min = G_MAXDOUBLE;
+    GtsVector c;
+
+    gts_point_set (p,
+		   3.*random_double () - 1.5,
+		   3.*random_double () - 1.5,
+		   3.*random_double () - 1.5);
+    n = gts_bvh_point_nearest (bvh, p, (GtsBBoxNearestFunc)
+			       gts_point_triangle_nearest);
+    for (j = 0; j < bvh->nitems; j++)
+      min = MIN (min, gts_point_triangle_nearest (p, bvh->bboxes[j]->bounded,
+						  c));
+    g_assert (n.distance2 == min);
+  }
+  gts_object_destroy (GTS_OBJECT (p));
+}
+
+static void prepend_vertex (GtsVertex * v, GSList ** vertices)
+{
+  *vertices = g_slist_prepend (*vertices, v);
+}
+
+static void update_bbox (GtsBBox * bb)
+{
+  GtsBBox * t = gts_bbox_triangle (gts_bbox_class (), bb->bounded);
+
+  gts_bbox_set (bb, bb->bounded, t->x1, t->y1, t->z1, t->x2, t->y2, t->z2);
+  gts_object_destroy (GTS_OBJECT (t));
+}
+
+int main (int argc, char * argv[])
+{
+  GtsSurface * s = gts_surface_new (gts_surface_class (),
+				    gts_face_class (),
+				    gts_edge_class (),
+				    gts_vertex_class ());
+  GSList * vertices = NULL, * i;
+  GtsBVH * bvh;
+  guint32 * first, * count;
+  guint nnodes, frame, j;
+  gdouble cost;
+
+  srand (1);
+  gts_surface_generate_sphere (s, 4);
+  gts_surface_foreach_vertex (s, (GtsFunc) prepend_vertex, &vertices);
+  bvh = gts_bvh_surface (s, 2);
+  check_boxes (bvh);
+  nnodes = bvh->nnodes;
+  first = g_malloc (nnodes*sizeof (guint32));
+  count = g_malloc (nnodes*sizeof (guint32));
+  memcpy (first, bvh->first, nnodes*sizeof (guint32));
+  memcpy (count, bvh->count, nnodes*sizeof (guint32));
+
+  /* small moves of a cap of vertices are refitted without changing the
+     structure of the tree */
+  for (frame = 0; frame < 10; frame++) {
+    gdouble dx = 2.*random_double () - 1., dy = 2.*random_double () - 1.;
+    gdouble dz = 2.*random_double () - 1., l = sqrt (dx*dx + dy*dy + dz*dz);
+    GSList * moved = NULL;
+
+    for (i = vertices; i; i = i->next) {
+      GtsPoint * p = i->data;
+
+      if ((p->x*dx + p->y*dy + p->z*dz)/l > 0.9) {
+	gdouble a = 1. + 0.05*random_double ();
+
+	gts_point_set (p, a*p->x, a*p->y, a*p->z);
+	moved = g_slist_prepend (moved, p);
+      }
+    }
+    g_assert (!gts_bvh_refit (bvh, moved, G_MAXDOUBLE));
+    g_slist_free (moved);
+    check_boxes (bvh);
+    g_assert (bvh->nnodes == nnodes);
+    g_assert (memcmp (first, bvh->first, nnodes*sizeof (guint32)) == 0);
+    g_assert (memcmp (count, bvh->count, nnodes*sizeof (guint32)) == 0);
+  }
+  check_nearest (bvh);
+
+  /* the cost tracked incrementally is the cost of the whole tree */
+  cost = bvh->cost;
+  g_assert (!gts_bvh_refit (bvh, NULL, G_MAXDOUBLE));
+  g_assert (fabs (bvh->cost - cost) <= 1e-9*cost);
+  check_boxes (bvh);
+
+  /* boxes updated by the caller */
+  for (i = vertices; i; i = i->next) {
+    GtsPoint * p = i->data;
+
+    gts_point_set (p, p->x + 0.01*random_double (), p->y, p->z);
+  }
+  for (j = 0; j < bvh->nitems; j++)
+    update_bbox (bvh->bboxes[j]);
+  g_assert (!gts_bvh_refit (bvh, NULL, G_MAXDOUBLE));
+  check_boxes (bvh);
+  check_nearest (bvh);
+
+  /* a large deformation rebuilds the tree */
+  for (i = vertices; i; i = i->next) {
+    GtsPoint * p = i->data;
+
+    gts_point_set (p, p->x + 0.3*(2.*random_double () - 1.), 3.*p->y, p->z);
+  }
+  g_assert (gts_bvh_refit (bvh, vertices, 1.2));
+  g_assert (bvh->cost == bvh->build_cost);
+  check_boxes (bvh);
+  check_nearest (bvh);
+  /* nothing moved */
+  g_assert (!gts_bvh_refit (bvh, vertices, 1.2));
+  check_boxes (bvh);
+
+  g_free (first);
+  g_free (count);
+  g_slist_free (vertices);
+  gts_bvh_destroy (bvh, TRUE);
+  gts_object_destroy (GTS_OBJECT (s));
+
+  return 0;
+}
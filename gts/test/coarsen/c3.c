@@ -132,15 +132,13 @@ fprintf (stderr, "v: %.10g %.10g %.10g\n",
 		     &params);
   fprintf (stderr, "after: check for folds...\n");
   {
-    GSList * i = v->segments;
-    while (i) {
-      GtsEdge * e = i->data;
-      gts_triangles_are_folded (e->triangles,  
-				GTS_SEGMENT (e)->v1,
-				GTS_SEGMENT (e)->v2,
-				0.999695413509);
-      i = i->next;
-    }
+    GtsEdge * e;
+    guint i;
+    GTS_ADJACENCY_FOREACH (&v->segments, i, e)
+      gts_edge_triangles_are_folded (e,  
+				     GTS_SEGMENT (e)->v1,
+				     GTS_SEGMENT (e)->v2,
+				     0.999695413509);
   }
 #endif
 
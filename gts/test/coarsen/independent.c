@@ -0,0 +1,323 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gts.h"
+
+/* Checks gts_surface_coarsen_independent() against gts_surface_coarsen()
+   and the read-only gts_edge_collapse_creates_fold() */
+
+static gdouble random_double (void)
+{
+  return rand ()/(gdouble) RAND_MAX;
+}
+
+static void prepend_vertex (GtsVertex * v, GSList ** vertices)
+{
+  *vertices = g_slist_prepend (*vertices, v);
+}
+
+static GtsSurface * perturbed_sphere (guint level)
+{
+  GtsSurface * s = gts_surface_new (gts_surface_class (),
+				    gts_face_class (),
+				    gts_edge_class (),
+				    gts_vertex_class ());
+  GSList * vertices = NULL, * i;
+
+  gts_surface_generate_sphere (s, level);
+  gts_surface_foreach_vertex (s, (GtsFunc) prepend_vertex, &vertices);
+  for (i = vertices; i; i = i->next) {
+    GtsPoint * p = i->data;
+    gdouble a = 1. + 0.05*(2.*random_double () - 1.);
+
+    gts_point_set (p, a*p->x, a*p->y, a*p->z);
+  }
+  g_slist_free (vertices);
+  return s;
+}
+
+static gchar * surface_contents (GtsSurface * s, glong * size)
+{
+  FILE * fp = tmpfile ();
+  gchar * buf;
+
+  g_assert (fp != NULL);
+  gts_surface_write (s, fp);
+  *size = ftell (fp);
+  rewind (fp);
+  buf = g_malloc (*size + 1);
+  g_assert (fread (buf, 1, *size, fp) == (size_t) *size);
+  fclose (fp);
+  return buf;
+}
+
+static void prepend_edge (GtsEdge * e, GSList ** edges)
+{
+  *edges = g_slist_prepend (*edges, e);
+}
+
+/* The triangles of @e1 once @e is collapsed: those of @e1 using @e are
+   replaced with the triangles of their third edge */
+static GSList * collapsed_edge_triangles (GtsEdge * e1, GtsEdge * e)
+{
+  GSList * triangles = NULL;
+  GtsTriangle * t;
+  guint i;
+
+  GTS_ADJACENCY_FOREACH (&e1->triangles, i, t) {
+    if (t->e1 == e || t->e2 == e || t->e3 == e) {
+      GtsEdge * e2 = t->e1 != e && t->e1 != e1 ? t->e1 :
+	t->e2 != e && t->e2 != e1 ? t->e2 : t->e3;
+      GtsTriangle * t2;
+      guint j;
+
+      GTS_ADJACENCY_FOREACH (&e2->triangles, j, t2)
+	if (t2->e1 != e && t2->e2 != e && t2->e3 != e)
+	  triangles = g_slist_prepend (triangles, t2);
+    }
+    else
+      triangles = g_slist_prepend (triangles, t);
+  }
+  return triangles;
+}
+
+static void replace_vertex (GtsAdjacency * segments,
+			    GtsVertex * v1, GtsVertex * v)
+{
+  GtsSegment * s;
+  guint i;
+
+  GTS_ADJACENCY_FOREACH (segments, i, s)
+    if (s->v1 == v1)
+      s->v1 = v;
+    else
+      s->v2 = v;
+}
+
+/* The fold test done by substituting @v for the vertices of @e in the
+   surface and putting them back afterwards */
+static gboolean creates_fold_in_place (GtsEdge * e, GtsVertex * v,
+				       gdouble max)
+{
+  GtsVertex * v1 = GTS_SEGMENT (e)->v1, * v2 = GTS_SEGMENT (e)->v2;
+  GtsVertex * ends[2];
+  GSList * triangles, * i;
+  gboolean folded = FALSE;
+  guint j, k;
+
+  ends[0] = v1; ends[1] = v2;
+  replace_vertex (&v1->segments, v1, v);
+  replace_vertex (&v2->segments, v2, v);
+  for (k = 0; k < 2 && !folded; k++)
+    for (j = 0; j < ends[k]->segments.n && !folded; j++) {
+      GtsSegment * s = ends[k]->segments.items[j];
+
+      if (GTS_IS_EDGE (s) && GTS_EDGE (s) != e) {
+	triangles = collapsed_edge_triangles (GTS_EDGE (s), e);
+	folded = gts_triangles_are_folded (triangles, s->v1, s->v2, max);
+	g_slist_free (triangles);
+      }
+    }
+  if (!folded) {
+    triangles = gts_vertex_triangles (v1, NULL);
+    triangles = gts_vertex_triangles (v2, triangles);
+    for (i = triangles; i && !folded; i = i->next) {
+      GtsTriangle * t = i->data;
+
+      if (t->e1 != e && t->e2 != e && t->e3 != e) {
+	GtsEdge * e1 = gts_triangle_edge_opposite (t, v);
+
+	folded = gts_edge_triangles_are_folded (e1,
+						GTS_SEGMENT (e1)->v1,
+						GTS_SEGMENT (e1)->v2,
+						max);
+      }
+    }
+    g_slist_free (triangles);
+  }
+  replace_vertex (&v1->segments, v, v1);
+  replace_vertex (&v2->segments, v, v2);
+  return folded;
+}
+
+/* gts_edge_collapse_creates_fold() agrees with the test done in place
+   and leaves the surface untouched, down to the order of the segments
+   of the vertices */
+static void test_creates_fold (void)
+{
+  GtsSurface * s = perturbed_sphere (3);
+  GSList * edges = NULL, * i;
+  gchar * before, * after;
+  glong nbefore, nafter;
+  gdouble max = cos (0.5); max *= max;
+  guint ntests = 0, nfolded = 0;
+
+  gts_surface_foreach_edge (s, (GtsFunc) prepend_edge, &edges);
+  before = surface_contents (s, &nbefore);
+  for (i = edges; i; i = i->next) {
+    GtsEdge * e = i->data;
+    GtsVertex * v1 = GTS_SEGMENT (e)->v1, * v2 = GTS_SEGMENT (e)->v2;
+    gdouble l = gts_point_distance (GTS_POINT (v1), GTS_POINT (v2));
+    guint n1 = v1->segments.n, n2 = v2->segments.n, k;
+    gpointer * s1 = g_malloc (n1*sizeof (gpointer));
+    gpointer * s2 = g_malloc (n2*sizeof (gpointer));
+
+    memcpy (s1, v1->segments.items, n1*sizeof (gpointer));
+    memcpy (s2, v2->segments.items, n2*sizeof (gpointer));
+    for (k = 0; k < 8; k++) {
+      /* vertices around the middle of the edge, further and further */
+      gdouble d = k*l/2.;
+      GtsVertex * v = gts_segment_midvertex (GTS_SEGMENT (e),
+					     gts_vertex_class ());
+      gboolean folded;
+
+      gts_point_set (GTS_POINT (v),
+		     GTS_POINT (v)->x + d*(2.*random_double () - 1.),
+		     GTS_POINT (v)->y + d*(2.*random_double () - 1.),
+		     GTS_POINT (v)->z + d*(2.*random_double () - 1.));
+      folded = gts_edge_collapse_creates_fold (e, v, max);
+      g_assert (folded == creates_fold_in_place (e, v, max));
+      if (folded)
+	nfolded++;
+      ntests++;
+      gts_object_destroy (GTS_OBJECT (v));
+    }
+    g_assert (GTS_SEGMENT (e)->v1 == v1 && GTS_SEGMENT (e)->v2 == v2);
+    g_assert (v1->segments.n == n1 && v2->segments.n == n2);
+    g_assert (!memcmp (s1, v1->segments.items, n1*sizeof (gpointer)));
+    g_assert (!memcmp (s2, v2->segments.items, n2*sizeof (gpointer)));
+    g_free (s1);
+    g_free (s2);
+  }
+  g_assert (nfolded > ntests/10 && nfolded < ntests - ntests/10);
+  after = surface_contents (s, &nafter);
+  g_assert (nbefore == nafter && !memcmp (before, after, nbefore));
+
+  g_free (before);
+  g_free (after);
+  g_slist_free (edges);
+  gts_object_destroy (GTS_OBJECT (s));
+}
+
+static void prepend_point (GtsPoint * p, GArray * coords)
+{
+  g_array_append_vals (coords, &p->x, 3);
+}
+
+static int compare_coords (const void * a, const void * b)
+{
+  const gdouble * p1 = a, * p2 = b;
+  guint c;
+
+  for (c = 0; c < 3; c++)
+    if (p1[c] != p2[c])
+      return p1[c] < p2[c] ? -1 : 1;
+  return 0;
+}
+
+static GArray * sorted_coords (GtsSurface * s)
+{
+  GArray * coords = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+  gts_surface_foreach_vertex (s, (GtsFunc) prepend_point, coords);
+  qsort (coords->data, coords->len/3, 3*sizeof (gdouble), compare_coords);
+  return coords;
+}
+
+/* with a slack of zero and costs all different, the edges are collapsed
+   one at a time in the order of gts_surface_coarsen() */
+static void test_slack_zero (guint nthreads)
+{
+  GtsSurface * s1 = perturbed_sphere (3);
+  GtsSurface * s2 = gts_surface_new (gts_surface_class (),
+				     gts_face_class (),
+				     gts_edge_class (),
+				     gts_vertex_class ());
+  GArray * c1, * c2;
+  guint min = 300;
+
+  gts_surface_copy (s2, s1);
+  gts_surface_coarsen (s1, NULL, NULL, NULL, NULL,
+		       (GtsStopFunc) gts_coarsen_stop_number, &min,
+		       0.1);
+  gts_surface_coarsen_independent (s2, NULL, NULL, NULL, NULL,
+				   (GtsStopFunc) gts_coarsen_stop_number, &min,
+				   0.1, 0., nthreads);
+  g_assert (gts_surface_edge_number (s1) < 3*642/2);
+  g_assert (gts_surface_edge_number (s2) == gts_surface_edge_number (s1));
+  g_assert (gts_surface_face_number (s2) == gts_surface_face_number (s1));
+  c1 = sorted_coords (s1);
+  c2 = sorted_coords (s2);
+  g_assert (c1->len == c2->len);
+  g_assert (!memcmp (c1->data, c2->data, c1->len*sizeof (gdouble)));
+  g_assert (gts_surface_is_closed (s2));
+
+  g_array_free (c1, TRUE);
+  g_array_free (c2, TRUE);
+  gts_object_destroy (GTS_OBJECT (s1));
+  gts_object_destroy (GTS_OBJECT (s2));
+}
+
+typedef struct {
+  GtsSurface * s;
+  guint min, ncalls;
+} StopCount;
+
+/* all the edges of a closed manifold having two faces, a collapse
+   removes three edges */
+static gboolean stop_count (gdouble cost, guint nedge, StopCount * c)
+{
+  g_assert (nedge + 3 == gts_surface_edge_number (c->s));
+  c->ncalls++;
+  return nedge < c->min;
+}
+
+/* the number of edges passed to @stop_func is exact, also after the
+   collapses rejected by the fold test */
+static void test_stop_count (guint nthreads)
+{
+  GtsSurface * s = perturbed_sphere (4);
+  StopCount c;
+
+  c.s = s;
+  c.min = 600;
+  c.ncalls = 0;
+  /* a large minimum angle rejects many collapses */
+  gts_surface_coarsen_independent (s, NULL, NULL, NULL, NULL,
+				   (GtsStopFunc) stop_count, &c,
+				   0.5, 1., nthreads);
+  g_assert (c.ncalls > 0);
+  g_assert (gts_surface_edge_number (s) >= c.min);
+  g_assert (gts_surface_edge_number (s) < c.min + 3);
+  g_assert (gts_surface_is_closed (s));
+  gts_object_destroy (GTS_OBJECT (s));
+}
+
+int main (int argc, char * argv[])
+{
+  srand (1);
+  test_creates_fold ();
+  test_slack_zero (1);
+  test_slack_zero (4);
+  test_stop_count (1);
+  test_stop_count (4);
+  return 0;
+}
@@ -0,0 +1,154 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "gts.h"
+
+/* Checks that converting a surface to a #GtsHMesh and back gives the
+   same faces, with the same orientation, on a closed surface and on a
+   surface with a boundary */
+
+typedef struct {
+  gdouble v[9];
+} FaceKey;
+
+static gint compare_points (GtsPoint * p1, GtsPoint * p2)
+{
+  if (p1->x != p2->x)
+    return p1->x < p2->x ? -1 : 1;
+  if (p1->y != p2->y)
+    return p1->y < p2->y ? -1 : 1;
+  if (p1->z != p2->z)
+    return p1->z < p2->z ? -1 : 1;
+  return 0;
+}
+
+/* Appends to @keys the coordinates of the vertices of @t, in the
+   order given by gts_triangle_vertices(), starting from the smallest */
+static void face_key (GtsTriangle * t, GArray * keys)
+{
+  GtsVertex * v[3];
+  GtsPoint * p;
+  FaceKey key;
+  guint i, first = 0;
+
+  gts_triangle_vertices (t, &v[0], &v[1], &v[2]);
+  for (i = 1; i < 3; i++)
+    if (compare_points (GTS_POINT (v[i]), GTS_POINT (v[first])) < 0)
+      first = i;
+  for (i = 0; i < 3; i++) {
+    p = GTS_POINT (v[(first + i) % 3]);
+    key.v[3*i] = p->x;
+    key.v[3*i + 1] = p->y;
+    key.v[3*i + 2] = p->z;
+  }
+  g_array_append_val (keys, key);
+}
+
+static int compare_keys (const void * a, const void * b)
+{
+  const FaceKey * k1 = a, * k2 = b;
+  guint i;
+
+  for (i = 0; i < 9; i++)
+    if (k1->v[i] != k2->v[i])
+      return k1->v[i] < k2->v[i] ? -1 : 1;
+  return 0;
+}
+
+static GArray * face_keys (GtsSurface * s)
+{
+  GArray * keys = g_array_new (FALSE, FALSE, sizeof (FaceKey));
+
+  gts_surface_foreach_face (s, (GtsFunc) face_key, keys);
+  qsort (keys->data, keys->len, sizeof (FaceKey), compare_keys);
+  return keys;
+}
+
+static guint boundary_edge_number (GtsSurface * s)
+{
+  GSList * boundary = gts_surface_boundary (s);
+  guint n = g_slist_length (boundary);
+
+  g_slist_free (boundary);
+  return n;
+}
+
+static void test_round_trip (GtsSurface * s)
+{
+  GtsHMesh * m = gts_hmesh_new_from_surface (s);
+  GtsSurface * s1 = gts_surface_new (gts_surface_class (),
+				     gts_face_class (),
+				     gts_edge_class (),
+				     gts_vertex_class ());
+  GArray * k, * k1;
+
+  g_assert (gts_hmesh_vertex_number (m) == gts_surface_vertex_number (s));
+  g_assert (gts_hmesh_edge_number (m) == gts_surface_edge_number (s));
+  g_assert (gts_hmesh_face_number (m) == gts_surface_face_number (s));
+
+  gts_hmesh_to_surface (m, s1);
+  g_assert (gts_surface_vertex_number (s1) == 
+	    gts_surface_vertex_number (s));
+  g_assert (gts_surface_edge_number (s1) == gts_surface_edge_number (s));
+  g_assert (gts_surface_face_number (s1) == gts_surface_face_number (s));
+  g_assert (boundary_edge_number (s1) == boundary_edge_number (s));
+  g_assert (gts_surface_is_closed (s1) == gts_surface_is_closed (s));
+  g_assert (gts_surface_is_orientable (s1));
+  g_assert (gts_surface_is_manifold (s1));
+
+  k = face_keys (s);
+  k1 = face_keys (s1);
+  g_assert (k->len == k1->len);
+  g_assert (memcmp (k->data, k1->data, k->len*sizeof (FaceKey)) == 0);
+  g_array_free (k, TRUE);
+  g_array_free (k1, TRUE);
+
+  gts_object_destroy (GTS_OBJECT (s1));
+  gts_hmesh_destroy (m);
+}
+
+static gint top_face (GtsTriangle * t)
+{
+  GtsVertex * v1, * v2, * v3;
+
+  gts_triangle_vertices (t, &v1, &v2, &v3);
+  return GTS_POINT (v1)->z + GTS_POINT (v2)->z + GTS_POINT (v3)->z > 1.5;
+}
+
+int main (int argc, char * argv[])
+{
+  GtsSurface * s = gts_surface_new (gts_surface_class (),
+				    gts_face_class (),
+				    gts_edge_class (),
+				    gts_vertex_class ());
+
+  gts_surface_generate_sphere (s, 3);
+  g_assert (gts_surface_is_closed (s));
+  test_round_trip (s);
+
+  gts_surface_foreach_face_remove (s, (GtsFunc) top_face, NULL);
+  g_assert (!gts_surface_is_closed (s));
+  test_round_trip (s);
+
+  gts_object_destroy (GTS_OBJECT (s));
+
+  return 0;
+}
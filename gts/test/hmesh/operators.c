@@ -0,0 +1,196 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include "gts.h"
+
+/* Checks the invariants of a #GtsHMesh after each of its topological
+   operators, on a closed surface and on a surface with a boundary */
+
+#define NONE GTS_HMESH_NONE
+
+typedef struct {
+  guint nv, nf;
+  gint euler;
+} Counts;
+
+static gint euler_characteristic (GtsHMesh * m)
+{
+  return (gint) gts_hmesh_vertex_number (m) -
+    (gint) gts_hmesh_edge_number (m) + (gint) gts_hmesh_face_number (m);
+}
+
+static void check_mesh (GtsHMesh * m, Counts * c)
+{
+  guint32 h, v, f;
+  guint nv = 0, nf = 0, nh = 0;
+
+  for (h = 0; h < m->nh; h++) {
+    guint32 t = m->twin[h];
+
+    if (m->face[h] == NONE)
+      continue;
+    nh++;
+    g_assert (m->next[h] != h);
+    g_assert (m->next[m->next[m->next[h]]] == h);
+    g_assert (m->face[m->next[h]] == m->face[h]);
+    g_assert (m->fhalf[m->face[h]] != NONE);
+    g_assert (m->vhalf[m->vertex[h]] != NONE);
+    g_assert (m->vertex[h] != gts_hmesh_target (m, h));
+    if (t != NONE) {
+      g_assert (t < m->nh && m->face[t] != NONE);
+      g_assert (m->twin[t] == h);
+      g_assert (m->vertex[t] == gts_hmesh_target (m, h));
+      g_assert (gts_hmesh_target (m, t) == m->vertex[h]);
+      g_assert (m->face[t] != m->face[h]);
+    }
+  }
+
+  for (f = 0; f < m->nf; f++)
+    if (m->fhalf[f] != NONE) {
+      g_assert (m->face[m->fhalf[f]] == f);
+      nf++;
+    }
+  g_assert (nh == 3*nf);
+
+  for (v = 0; v < m->nv; v++) {
+    guint n = 0, outgoing = 0, boundary = 0;
+
+    if (m->vhalf[v] == NONE)
+      continue;
+    nv++;
+    /* the outgoing half-edge leaves its vertex and starts its fan */
+    g_assert (m->face[m->vhalf[v]] != NONE);
+    g_assert (m->vertex[m->vhalf[v]] == v);
+    GTS_HMESH_FOREACH_OUTGOING (m, v, h) {
+      g_assert (m->vertex[h] == v);
+      n++;
+    }
+    for (h = 0; h < m->nh; h++)
+      if (m->face[h] != NONE && m->vertex[h] == v) {
+	outgoing++;
+	if (m->twin[h] == NONE)
+	  boundary++;
+      }
+    g_assert (n == outgoing);
+    g_assert (boundary <= 1);
+    g_assert (gts_hmesh_vertex_is_boundary (m, v) == (boundary == 1));
+  }
+
+  g_assert (gts_hmesh_vertex_number (m) == nv);
+  g_assert (gts_hmesh_face_number (m) == nf);
+  g_assert (nv == c->nv);
+  g_assert (nf == c->nf);
+  g_assert (euler_characteristic (m) == c->euler);
+}
+
+static void test_operators (GtsSurface * s)
+{
+  GtsHMesh * m = gts_hmesh_new_from_surface (s);
+  Counts c;
+  guint i, splits = 0, flips = 0, collapses = 0;
+
+  c.nv = gts_surface_vertex_number (s);
+  c.nf = gts_surface_face_number (s);
+  c.euler = euler_characteristic (m);
+  g_assert (c.euler == (gint) gts_surface_vertex_number (s) -
+	    (gint) gts_surface_edge_number (s) + (gint) c.nf);
+  check_mesh (m, &c);
+
+  for (i = 0; i < 3000; i++) {
+    guint32 h = rand () % m->nh;
+
+    if (m->face[h] == NONE)
+      continue;
+    switch (i % 3) {
+    case 0: {
+      guint32 a = m->vertex[h], b = gts_hmesh_target (m, h), w;
+      gboolean boundary = m->twin[h] == NONE;
+
+      w = gts_hmesh_split_edge (m, h, 
+				(m->x[a] + m->x[b])/2.,
+				(m->y[a] + m->y[b])/2.,
+				(m->z[a] + m->z[b])/2.);
+      c.nv++;
+      c.nf += boundary ? 1 : 2;
+      g_assert (m->vertex[h] == a && gts_hmesh_target (m, h) == w);
+      g_assert (gts_hmesh_find_halfedge (m, w, b) != NONE);
+      splits++;
+      break;
+    }
+    case 1:
+      if (gts_hmesh_flip_is_valid (m, h)) {
+	guint32 c1 = m->vertex[gts_hmesh_prev (m, h)];
+	guint32 d1 = m->vertex[gts_hmesh_prev (m, m->twin[h])];
+
+	gts_hmesh_flip_edge (m, h);
+	g_assert (m->vertex[h] == d1 && gts_hmesh_target (m, h) == c1);
+	flips++;
+      }
+      break;
+    case 2:
+      if (gts_hmesh_collapse_is_valid (m, h)) {
+	guint32 b = gts_hmesh_target (m, h);
+
+	c.nf -= m->twin[h] == NONE ? 1 : 2;
+	g_assert (gts_hmesh_collapse_edge (m, h) == b);
+	c.nv--;
+	collapses++;
+      }
+      break;
+    }
+    check_mesh (m, &c);
+    if (i % 500 == 499) {
+      gts_hmesh_compact (m);
+      g_assert (m->nv == c.nv && m->nf == c.nf && m->nh == 3*c.nf);
+      check_mesh (m, &c);
+    }
+  }
+  g_assert (splits > 0 && flips > 0 && collapses > 0);
+
+  gts_hmesh_destroy (m);
+}
+
+static gint top_face (GtsTriangle * t)
+{
+  GtsVertex * v1, * v2, * v3;
+
+  gts_triangle_vertices (t, &v1, &v2, &v3);
+  return GTS_POINT (v1)->z + GTS_POINT (v2)->z + GTS_POINT (v3)->z > 1.5;
+}
+
+int main (int argc, char * argv[])
+{
+  GtsSurface * s = gts_surface_new (gts_surface_class (),
+				    gts_face_class (),
+				    gts_edge_class (),
+				    gts_vertex_class ());
+
+  srand (1);
+  gts_surface_generate_sphere (s, 2);
+  test_operators (s);
+
+  gts_surface_foreach_face_remove (s, (GtsFunc) top_face, NULL);
+  g_assert (!gts_surface_is_closed (s));
+  test_operators (s);
+
+  gts_object_destroy (GTS_OBJECT (s));
+
+  return 0;
+}
@@ -0,0 +1,263 @@
+/* GTS - Library for the manipulation of triangulated surfaces
+ * Copyright (C) 1999 Stphane Popinet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gts.h"
+
+/* Checks the queries of a #GtsKdTree against a brute-force scan of all
+   the points, many of which share some or all of their coordinates */
+
+#define NP 10000
+#define NQ 300
+#define K 10
+
+static gdouble random_double (void)
+{
+  return rand ()/(gdouble) RAND_MAX;
+}
+
+static GPtrArray * random_points (void)
+{
+  GPtrArray * points = g_ptr_array_new ();
+  guint i;
+
+  for (i = 0; i < NP; i++) {
+    gdouble x = random_double (), y = random_double (), z = random_double ();
+
+    if (i % 3 == 0) { /* on a grid in the plane z = 0.5 */
+      x = floor (20.*x)/20.;
+      y = floor (20.*y)/20.;
+      z = 0.5;
+    }
+    else if (i % 5 == 0) { /* duplicate of the previous point */
+      GtsPoint * p = points->pdata[i - 1];
+
+      x = p->x; y = p->y; z = p->z;
+    }
+    g_ptr_array_add (points, gts_point_new (gts_point_class (), x, y, z));
+  }
+  return points;
+}
+
+static void check_same_tree (GtsKdTree * t1, GtsKdTree * t2)
+{
+  g_assert (t1->n == t2->n);
+  g_assert (!memcmp (t1->coords, t2->coords, t1->n*sizeof (GtsVector)));
+  g_assert (!memcmp (t1->points, t2->points, t1->n*sizeof (GtsPoint *)));
+  g_assert (!memcmp (t1->axis, t2->axis, t1->n*sizeof (guint8)));
+}
+
+/* Checks that the first @n elements of @found are the points of
+   @points for which @test is %TRUE, each exactly once */
+static void check_set (GtsPoint ** found, guint n, GPtrArray * points,
+		       gboolean (* test) (GtsPoint *, gpointer),
+		       gpointer data)
+{
+  guint i, expected = 0;
+
+  for (i = 0; i < n; i++) {
+    g_assert (GTS_OBJECT (found[i])->reserved == NULL);
+    g_assert ((* test) (found[i], data));
+    GTS_OBJECT (found[i])->reserved = found[i];
+  }
+  for (i = 0; i < points->len; i++)
+    if ((* test) (points->pdata[i], data))
+      expected++;
+  g_assert (n == expected);
+  for (i = 0; i < n; i++)
+    GTS_OBJECT (found[i])->reserved = NULL;
+}
+
+static gboolean is_inside (GtsPoint * p, GtsBBox * bbox)
+{
+  return gts_bbox_point_is_inside (bbox, p);
+}
+
+typedef struct {
+  GtsPoint * p;
+  gdouble r2;
+} Sphere;
+
+static gboolean is_within (GtsPoint * p, Sphere * s)
+{
+  return gts_point_distance2 (p, s->p) <= s->r2;
+}
+
+static int compare_doubles (const void * a, const void * b)
+{
+  gdouble d1 = *((gdouble *) a), d2 = *((gdouble *) b);
+
+  return d1 < d2 ? -1 : d1 > d2;
+}
+
+static void check_k_nearest (GtsKdTree * tree, GPtrArray * points,
+			     GtsPoint * p, gdouble * all)
+{
+  GtsPoint * found[K];
+  gdouble d2[K];
+  guint i, n;
+
+  n = gts_kd_flat_k_nearest (tree, p, K, found, d2);
+  g_assert (n == MIN (K, points->len));
+  for (i = 0; i < points->len; i++)
+    all[i] = gts_point_distance2 (p, points->pdata[i]);
+  qsort (all, points->len, sizeof (gdouble), compare_doubles);
+  for (i = 0; i < n; i++) {
+    g_assert (d2[i] == all[i]);
+    g_assert (gts_point_distance2 (p, found[i]) == d2[i]);
+    g_assert (GTS_OBJECT (found[i])->reserved == NULL);
+    GTS_OBJECT (found[i])->reserved = found[i];
+  }
+  for (i = 0; i < n; i++)
+    GTS_OBJECT (found[i])->reserved = NULL;
+}
+
+static void check_small_trees (GPtrArray * points)
+{
+  GPtrArray * a = g_ptr_array_new ();
+  GtsKdTree * tree;
+  GtsPoint * p = points->pdata[0], * found[2];
+  GtsBBox * bbox;
+  gdouble d2[2];
+
+  tree = gts_kd_flat_new (a, 2);
+  bbox = gts_bbox_new (gts_bbox_class (), NULL, 0., 0., 0., 1., 1., 1.);
+  g_assert (gts_kd_flat_range (tree, bbox, NULL, 0) == 0);
+  g_assert (gts_kd_flat_radius (tree, p, 1., NULL, 0) == 0);
+  g_assert (gts_kd_flat_k_nearest (tree, p, 2, found, d2) == 0);
+  gts_kd_flat_destroy (tree);
+
+  g_ptr_array_add (a, p);
+  tree = gts_kd_flat_new (a, 2);
+  g_assert (gts_kd_flat_range (tree, bbox, found, 2) == 1 && found[0] == p);
+  g_assert (gts_kd_flat_k_nearest (tree, p, 2, found, d2) == 1);
+  g_assert (found[0] == p && d2[0] == 0.);
+  gts_kd_flat_destroy (tree);
+
+  gts_object_destroy (GTS_OBJECT (bbox));
+  g_ptr_array_free (a, TRUE);
+}
+
+int main (int argc, char * argv[])
+{
+  GPtrArray * points;
+  GtsKdTree * tree, * tree4;
+  GtsPoint ** found, * p;
+  GtsBBox * bbox;
+  GtsVector * queries;
+  GtsPoint ** kp1, ** kp4, ** rp1, ** rp4;
+  gdouble * kd1, * kd4, * all;
+  guint * count1, * count4;
+  Sphere s;
+  guint i, j, n;
+
+  srand (1);
+  points = random_points ();
+  found = g_malloc (NP*sizeof (GtsPoint *));
+  all = g_malloc (NP*sizeof (gdouble));
+
+  /* the tree does not depend on the number of threads */
+  tree = gts_kd_flat_new (points, 1);
+  tree4 = gts_kd_flat_new (points, 4);
+  check_same_tree (tree, tree4);
+
+  p = gts_point_new (gts_point_class (), 0., 0., 0.);
+  bbox = gts_bbox_new (gts_bbox_class (), NULL, 0., 0., 0., 0., 0., 0.);
+  queries = g_malloc (NQ*sizeof (GtsVector));
+  for (i = 0; i < NQ; i++) {
+    gdouble e = 0.05*random_double (), r;
+
+    /* half of the queries on a point of the grid */
+    if (i % 2)
+      gts_point_set (p, floor (20.*random_double ())/20., 
+		     floor (20.*random_double ())/20., 0.5);
+    else
+      gts_point_set (p, random_double (), random_double (), 
+		     random_double ());
+    queries[i][0] = p->x; queries[i][1] = p->y; queries[i][2] = p->z;
+
+    /* boxes and spheres touching the grid points on their boundary */
+    gts_bbox_set (bbox, NULL, p->x - e, p->y - e, p->z - e,
+		  p->x + 0.05, p->y + 0.05, p->z + e);
+    n = gts_kd_flat_range (tree, bbox, found, NP);
+    check_set (found, n, points,
+	       (gboolean (*) (GtsPoint *, gpointer)) is_inside, bbox);
+    g_assert (gts_kd_flat_range (tree, bbox, found, 1) == n);
+
+    r = i % 2 ? 0.05 : 0.1*random_double ();
+    s.p = p;
+    s.r2 = r*r;
+    n = gts_kd_flat_radius (tree, p, r, found, NP);
+    check_set (found, n, points,
+	       (gboolean (*) (GtsPoint *, gpointer)) is_within, &s);
+    g_assert (gts_kd_flat_radius (tree, p, r, NULL, 0) == n);
+
+    check_k_nearest (tree, points, p, all);
+  }
+
+  /* batched queries give the same results as single ones, whatever
+     the number of threads */
+  kp1 = g_malloc (NQ*K*sizeof (GtsPoint *));
+  kp4 = g_malloc (NQ*K*sizeof (GtsPoint *));
+  kd1 = g_malloc (NQ*K*sizeof (gdouble));
+  kd4 = g_malloc (NQ*K*sizeof (gdouble));
+  gts_kd_flat_points_k_nearest (tree, queries, NQ, K, kp1, kd1, 1);
+  gts_kd_flat_points_k_nearest (tree4, queries, NQ, K, kp4, kd4, 4);
+  rp1 = g_malloc (NQ*K*sizeof (GtsPoint *));
+  rp4 = g_malloc (NQ*K*sizeof (GtsPoint *));
+  count1 = g_malloc (NQ*sizeof (guint));
+  count4 = g_malloc (NQ*sizeof (guint));
+  gts_kd_flat_points_radius (tree, queries, NQ, 0.05, K, rp1, count1, 1);
+  gts_kd_flat_points_radius (tree4, queries, NQ, 0.05, K, rp4, count4, 4);
+  for (i = 0; i < NQ; i++) {
+    GtsPoint * kp[K];
+    gdouble kd[K];
+
+    gts_point_set (p, queries[i][0], queries[i][1], queries[i][2]);
+    g_assert (gts_kd_flat_k_nearest (tree, p, K, kp, kd) == K);
+    for (j = 0; j < K; j++) {
+      g_assert (kp1[i*K + j] == kp[j] && kd1[i*K + j] == kd[j]);
+      g_assert (kp4[i*K + j] == kp[j] && kd4[i*K + j] == kd[j]);
+    }
+
+    n = gts_kd_flat_radius (tree, p, 0.05, found, NP);
+    g_assert (count1[i] == n && count4[i] == n);
+    for (j = 0; j < MIN (n, K); j++)
+      g_assert (rp1[i*K + j] == found[j] && rp4[i*K + j] == found[j]);
+  }
+
+  check_small_trees (points);
+
+  g_free (kp1); g_free (kp4); g_free (kd1); g_free (kd4);
+  g_free (rp1); g_free (rp4); g_free (count1); g_free (count4);
+  g_free (queries);
+  g_free (found);
+  g_free (all);
+  gts_object_destroy (GTS_OBJECT (p));
+  gts_object_destroy (GTS_OBJECT (bbox));
+  gts_kd_flat_destroy (tree);
+  gts_kd_flat_destroy (tree4);
+  for (i = 0; i < NP; i++)
+    gts_object_destroy (points->pdata[i]);
+  g_ptr_array_free (points, TRUE);
+
+  return 0;
+}
@@ -165,7 +165,7 @@ static void foreach_vertex (GtsVertex * v, gpointer * info)
   switch (color) {
   case EPV: {
     Color c = colormap_color (colormap,
-		((gdouble)g_slist_length (v->segments) - min)/(max - min));
+		((gdouble)v->segments.n - min)/(max - min));
     fprintf (fp, " %g %g %g 1.0\n", c.r, c.g, c.b);
     break;
   }
@@ -218,8 +218,8 @@ static void foreach_boundary_edge (GtsEdge * e, gpointer info)
 
 static void foreach_feature_edge (GtsEdge * e, gdouble * angle)
 {
-  if (g_slist_length (e->triangles) == 2 &&
-      fabs (gts_triangles_angle (e->triangles->data, e->triangles->next->data))
+  if (e->triangles.n == 2 &&
+      fabs (gts_triangles_angle (e->triangles.items[0], e->triangles.items[1]))
       < *angle) {
     fputs ("VECT 1 2 0 2 0 ", stdout);
     write_point (GTS_POINT (GTS_SEGMENT (e)->v1), stdout);
@@ -233,7 +233,7 @@ static void foreach_non_manifold_edge (GtsEdge * e, gpointer info)
 {
   FILE * fp = info;
 
-  if (g_slist_length (e->triangles) > 2) {
+  if (e->triangles.n > 2) {
     fputs ("VECT 1 2 0 2 0 ", fp);
     write_point (GTS_POINT (GTS_SEGMENT (e)->v1), fp);
     fputc (' ', fp);
@@ -307,26 +307,21 @@ static void foreach_triangle (GtsTriangle * t, gpointer * info)
   case INCOMP: {
     gboolean compatible = TRUE;
     GtsEdge * e1 = t->e1, * e2 = t->e2, * e3 = t->e3;
-    GSList * i = e1->triangles;
-    while (compatible && i) {
-      GtsTriangle * t1 = i->data;
+    guint i;
+    for (i = 0; compatible && i < e1->triangles.n; i++) {
+      GtsTriangle * t1 = e1->triangles.items[i];
       if (t1 != t && !gts_triangles_are_compatible (t, t1, e1))
 	compatible = FALSE;
-      i = i->next;
     }
-    i = e2->triangles;
-    while (compatible && i) {
-      GtsTriangle * t1 = i->data;
+    for (i = 0; compatible && i < e2->triangles.n; i++) {
+      GtsTriangle * t1 = e2->triangles.items[i];
       if (t1 != t && !gts_triangles_are_compatible (t, t1, e2))
 	compatible = FALSE;
-      i = i->next;
     }
-    i = e3->triangles;
-    while (compatible && i) {
-      GtsTriangle * t1 = i->data;
+    for (i = 0; compatible && i < e3->triangles.n; i++) {
+      GtsTriangle * t1 = e3->triangles.items[i];
       if (t1 != t && !gts_triangles_are_compatible (t, t1, e3))
 	compatible = FALSE;
-      i = i->next;
     }
     if (!compatible)
       fputs (" 1. 0. 0.", fp);
@@ -336,20 +331,20 @@ static void foreach_triangle (GtsTriangle * t, gpointer * info)
   case FOLD: {
     gboolean fold = FALSE;
     GtsEdge * e1 = t->e1, * e2 = t->e2, * e3 = t->e3;
-    fold = gts_triangles_are_folded (e1->triangles, 
-				     GTS_SEGMENT (e1)->v1,
-				     GTS_SEGMENT (e1)->v2,
-				     maxcosine2);
+    fold = gts_edge_triangles_are_folded (e1, 
+					  GTS_SEGMENT (e1)->v1,
+					  GTS_SEGMENT (e1)->v2,
+					  maxcosine2);
     if (!fold)
-      fold = gts_triangles_are_folded (e2->triangles, 
-				       GTS_SEGMENT (e2)->v1,
-				       GTS_SEGMENT (e2)->v2,
-				       maxcosine2);
+      fold = gts_edge_triangles_are_folded (e2, 
+					    GTS_SEGMENT (e2)->v1,
+					    GTS_SEGMENT (e2)->v2,
+					    maxcosine2);
     if (!fold)
-      fold = gts_triangles_are_folded (e3->triangles, 
-				       GTS_SEGMENT (e3)->v1,
-				       GTS_SEGMENT (e3)->v2,
-				       maxcosine2);      
+      fold = gts_edge_triangles_are_folded (e3, 
+					    GTS_SEGMENT (e3)->v1,
+					    GTS_SEGMENT (e3)->v2,
+					    maxcosine2);      
     if (fold) {
       (*nfold)++;
       fputs (" 1. 0. 0.", fp);
@@ -486,17 +481,14 @@ static void oogl_surface (GtsSurface * s, FILE * fptr)
 
 static GtsVertex * next_vertex (GtsVertex * v)
 {
-  GSList * j = v->segments;
-
-  while (j) {
-    GtsSegment * s = j->data;
+  GtsSegment * s;
+  guint j;
 
+  GTS_ADJACENCY_FOREACH (&v->segments, j, s)
     if (GTS_OBJECT (s)->reserved == s) {
       GTS_OBJECT (s)->reserved = NULL;
       return s->v1 != v ? s->v1 : s->v2;
     }
-    j = j->next;
-  }
 
   return NULL;
 }
@@ -0,0 +1,171 @@
+#ifndef SURFACES_H
+#define SURFACES_H
+
+#include <glm/glm.hpp>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+// Height field models z = f(x, y). A model is a type providing
+//
+//     static double value(double x, double y);
+//     static glm::dvec2 gradient(double x, double y);
+//     static glm::dvec3 hessian(double x, double y);  // (fxx, fxy, fyy)
+//     static void evaluate(const double * x, const double * y, double * z,
+//                          size_t n);
+//     static void evaluateGradient(const double * x, const double * y,
+//                                  double * z, double * fx, double * fy,
+//                                  size_t n);
+//
+// The projection and refinement code is instantiated against each model, so
+// that the model is inlined into the solvers.
+//
+// Deriving from SurfaceModel provides gradient() and the batch kernels from
+//
+//     template <typename T> static T value(T x, T y);
+//     template <typename T> static void slope(T x, T y, T & fx, T & fy);
+//
+// written with arithmetic operators only, so that they can be instantiated
+// for SurfaceLanes as well as for double.
+
+// Lanes of the batch kernels, as wide as the vector instructions enabled at
+// compile time (AVX-512 or AVX2), or scalar otherwise
+#if defined(__AVX512F__)
+#define SURFACE_LANES 8
+#elif defined(__AVX2__)
+#define SURFACE_LANES 4
+#else
+#define SURFACE_LANES 1
+#endif
+
+#if SURFACE_LANES > 1
+typedef double SurfaceLanes
+    __attribute__((vector_size(SURFACE_LANES * sizeof(double))));
+#endif
+
+template <typename Model>
+struct SurfaceModel
+{
+    static glm::dvec2 gradient(double x, double y)
+    {
+        double fx, fy;
+        Model::slope(x, y, fx, fy);
+        return glm::dvec2(fx, fy);
+    }
+
+    static void evaluate(const double * x, const double * y, double * z,
+                         size_t n)
+    {
+        size_t i = 0;
+#if SURFACE_LANES > 1
+        for (; i + SURFACE_LANES <= n; i += SURFACE_LANES) {
+            SurfaceLanes vx, vy;
+            memcpy(&vx, x + i, sizeof(vx));
+            memcpy(&vy, y + i, sizeof(vy));
+            const SurfaceLanes vz = Model::value(vx, vy);
+            memcpy(z + i, &vz, sizeof(vz));
+        }
+#endif
+        for (; i < n; i ++)
+            z[i] = Model::value(x[i], y[i]);
+    }
+
+    static void evaluateGradient(const double * x, const double * y,
+                                 double * z, double * fx, double * fy,
+                                 size_t n)
+    {
+        size_t i = 0;
+#if SURFACE_LANES > 1
+        for (; i + SURFACE_LANES <= n; i += SURFACE_LANES) {
+            SurfaceLanes vx, vy, vfx, vfy;
+            memcpy(&vx, x + i, sizeof(vx));
+            memcpy(&vy, y + i, sizeof(vy));
+            const SurfaceLanes vz = Model::value(vx, vy);
+            Model::slope(vx, vy, vfx, vfy);
+            memcpy(z + i, &vz, sizeof(vz));
+            memcpy(fx + i, &vfx, sizeof(vfx));
+            memcpy(fy + i, &vfy, sizeof(vfy));
+        }
+#endif
+        for (; i < n; i ++) {
+            z[i] = Model::value(x[i], y[i]);
+            Model::slope(x[i], y[i], fx[i], fy[i]);
+        }
+    }
+};
+
+// (x^2 + y^2)^5, flat in the middle with a steep rim
+struct Pow5Surface : SurfaceModel<Pow5Surface>
+{
+    template <typename T>
+    static T value(T x, T y)
+    {
+        const T s = x * x + y * y;
+        const T s2 = s * s;
+        return s2 * s2 * s;
+    }
+
+    template <typename T>
+    static void slope(T x, T y, T & fx, T & fy)
+    {
+        const T s = x * x + y * y;
+        const T s4 = (s * s) * (s * s);
+        fx = 10.0 * x * s4;
+        fy = 10.0 * y * s4;
+    }
+
+    static glm::dvec3 hessian(double x, double y)
+    {
+        const double s = x * x + y * y;
+        const double s3 = s * s * s;
+        const double s4 = s3 * s;
+        return glm::dvec3(
+            10.0 * s4 + 80.0 * x * x * s3,
+            80.0 * x * y * s3,
+            10.0 * s4 + 80.0 * y * y * s3);
+    }
+};
+
+struct ParaboloidSurface : SurfaceModel<ParaboloidSurface>
+{
+    template <typename T>
+    static T value(T x, T y)
+    {
+        return x * x + y * y;
+    }
+
+    template <typename T>
+    static void slope(T x, T y, T & fx, T & fy)
+    {
+        fx = 2.0 * x;
+        fy = 2.0 * y;
+    }
+
+    static glm::dvec3 hessian(double x, double y)
+    {
+        return glm::dvec3(2.0, 0.0, 2.0);
+    }
+};
+
+struct SaddleSurface : SurfaceModel<SaddleSurface>
+{
+    template <typename T>
+    static T value(T x, T y)
+    {
+        return x * x - y * y;
+    }
+
+    template <typename T>
+    static void slope(T x, T y, T & fx, T & fy)
+    {
+        fx = 2.0 * x;
+        fy = -2.0 * y;
+    }
+
+    static glm::dvec3 hessian(double x, double y)
+    {
+        return glm::dvec3(2.0, 0.0, -2.0);
+    }
+};
+
+#endif // SURFACES_H
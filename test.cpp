@@ -1,23 +1,14 @@
 #define GLM_SWIZZLE
+#include "triangulation.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
-#include <gsl/gsl_multimin.h>
-#include <gts.h>
 #include <memory>
-#include <stdio.h>
-#include <vector>
-
-#define DEBUG(...) \
-    printf(__VA_ARGS__); \
-    printf("\n");
-
-#define ERROR(...) \
-    DEBUG(__VA_ARGS__); \
-    throw 0;
+#include <stdlib.h>
+#include <string>
 
 #define VGL(func, ...) \
     func(__VA_ARGS__); \
@@ -26,63 +17,12 @@
         ERROR("Failed in " #func "()"); \
     }
 
-#define VECTOR(vertex) \
-    glm::vec3(vertex->p.x, vertex->p.y, vertex->p.z)
-
 glm::vec2 vecAngleXZ;
 glm::mat4 matModel;
 glm::mat4 matView;
 glm::mat4 matProj;
 glm::mat4 matMvp;
 
-double surfaceEquation(double x, double y)
-{
-    return pow(x * x + y * y, 5);
-}
-
-glm::vec3 nearestPoint(glm::vec3 p)
-{
-    std::shared_ptr<gsl_multimin_fminimizer> minimizer(
-        gsl_multimin_fminimizer_alloc(
-            gsl_multimin_fminimizer_nmsimplex2, 2),
-        [] (gsl_multimin_fminimizer * m) {
-            gsl_multimin_fminimizer_free(m);
-        });
-
-    gsl_multimin_function function;
-    function.n = 2;
-    function.params = &p;
-    function.f = [] (const gsl_vector * in, void * params) -> double {
-        const glm::dvec3 p = *reinterpret_cast<glm::vec3*>(params);
-        const double x = gsl_vector_get(in, 0);
-        const double y = gsl_vector_get(in, 1);
-        const double z = surfaceEquation(x, y);
-        return glm::length(p - glm::dvec3(x, y, z));
-    };
-
-    std::shared_ptr<gsl_vector> initVals(gsl_vector_alloc(2),
-        [] (gsl_vector * v) { gsl_vector_free(v); });
-    gsl_vector_set(initVals.get(), 0, p.x);
-    gsl_vector_set(initVals.get(), 1, p.y);
-
-    std::shared_ptr<gsl_vector> initSteps(gsl_vector_alloc(2),
-        [] (gsl_vector * v) { gsl_vector_free(v); });
-    gsl_vector_set(initSteps.get(), 0, 1e-3);
-    gsl_vector_set(initSteps.get(), 1, 1e-3);
-
-    gsl_multimin_fminimizer_set(
-        minimizer.get(), &function, initVals.get(), initSteps.get());
-
-    do {
-        gsl_multimin_fminimizer_iterate(minimizer.get());
-    } while(gsl_multimin_test_size(minimizer->size, 1e-7) == GSL_CONTINUE);
-
-    const double x = gsl_vector_get(minimizer->x, 0);
-    const double y = gsl_vector_get(minimizer->x, 1);
-    const double z = surfaceEquation(x, y);
-    return glm::vec3(x, y, z);
-}
-
 void onResize(GLFWwindow * window, int width, int height)
 {
     VGL(glViewport, 0, 0, width, height);
@@ -106,32 +46,47 @@ void onMouseMove(GLFWwindow * window, double x, double y)
    oldXY = newXY;
 }
 
-gdouble refineCost(gpointer item, gpointer data)
-{
-    GtsEdge * e = GTS_EDGE(item);
-    glm::vec3 v1 = VECTOR(e->segment.v1);
-    glm::vec3 v2 = VECTOR(e->segment.v2);
-    glm::dvec3 mv = (v1 + v2) / 2.0f;
-    glm::dvec3 nv = nearestPoint(mv);
-    return -glm::length(mv - nv);
-}
-
-GtsVertex * refineEdge(GtsEdge * e, GtsVertexClass * vcls, gpointer data)
-{
-    glm::vec3 v1 = VECTOR(e->segment.v1);
-    glm::vec3 v2 = VECTOR(e->segment.v2);
-    glm::dvec3 mv = (v1 + v2) / 2.0f;
-    glm::dvec3 nv = nearestPoint(mv);
-    return gts_vertex_new(vcls, nv.x, nv.y, nv.z);
-}
-
-gboolean refineStop(gdouble cost, guint nedge, gpointer data)
+int main(int argc, char ** argv)
 {
-    return nedge > 1000;
-}
+    GtsRefineTolerance tolerance = {};
+    tolerance.tolerance = 1e-3;
+    tolerance.max_faces = 100000;
+    guint levels = 0;
+
+    for (int i = 1; i < argc; i ++) {
+        const std::string arg = argv[i];
+        if (arg == "--projection=simplex") {
+            projectionEngine = ProjectionEngine::Simplex;
+        } else if (arg == "--projection=newton") {
+            projectionEngine = ProjectionEngine::Newton;
+        } else if (arg == "--cost=exact") {
+            costModel = CostModel::Exact;
+        } else if (arg == "--cost=estimate") {
+            costModel = CostModel::Estimate;
+        } else if (arg == "--allocator=malloc") {
+            objectAllocator = ObjectAllocator::Malloc;
+        } else if (arg == "--allocator=slab") {
+            objectAllocator = ObjectAllocator::Slab;
+        } else if (arg == "--allocator=arena") {
+            objectAllocator = ObjectAllocator::Arena;
+        } else if (arg.compare(0, 10, "--surface=") == 0) {
+            heightField = findHeightField(arg.c_str() + 10);
+            if (heightField == nullptr) {
+                ERROR("Unknown surface: %s", arg.c_str() + 10);
+            }
+        } else if (arg.compare(0, 8, "--slack=") == 0) {
+            refineSlack = atof(arg.c_str() + 8);
+        } else if (arg.compare(0, 12, "--tolerance=") == 0) {
+            tolerance.tolerance = atof(arg.c_str() + 12);
+        } else if (arg.compare(0, 12, "--max-faces=") == 0) {
+            tolerance.max_faces = static_cast<guint>(atoi(arg.c_str() + 12));
+        } else if (arg.compare(0, 9, "--levels=") == 0) {
+            levels = static_cast<guint>(atoi(arg.c_str() + 9));
+        } else {
+            ERROR("Unknown argument: %s", argv[i]);
+        }
+    }
 
-int main()
-{
     DEBUG("Initializing GLFW ...");
     glfwInit();
     glfwWindowHint(GLFW_SAMPLES, 16);
@@ -147,82 +102,46 @@ int main()
     glewInit();
 
     DEBUG("Building surface ...");
-    GtsSurface * gtsSurface = gts_surface_new(
-        gts_surface_class(),
-        gts_face_class(),
-        gts_edge_class(),
-        gts_vertex_class());
-
-    GtsVertexClass * vcls = gts_vertex_class();
-    GtsVertex * v0 = gts_vertex_new(vcls, 0.0f, 0.0f, 0.0f);
-    GtsVertex * v1 = gts_vertex_new(vcls,
-        1.0f, 0.0f, surfaceEquation(1.0f, 0.0f));
-    GtsVertex * v2 = gts_vertex_new(vcls,
-        0.0f, 1.0f, surfaceEquation(0.0f, 1.0f));
-    GtsVertex * v3 = gts_vertex_new(vcls,
-        -1.0f, 0.0f, surfaceEquation(-1.0f, 0.0f));
-    GtsVertex * v4 = gts_vertex_new(vcls,
-        0.0f, -1.0f, surfaceEquation(0.0f, -1.0f));
-
-    GtsEdgeClass * ecls = gts_edge_class();
-    GtsEdge * e1 = gts_edge_new(ecls, v0, v1);
-    GtsEdge * e2 = gts_edge_new(ecls, v0, v2);
-    GtsEdge * e3 = gts_edge_new(ecls, v0, v3);
-    GtsEdge * e4 = gts_edge_new(ecls, v0, v4);
-    GtsEdge * e5 = gts_edge_new(ecls, v1, v2);
-    GtsEdge * e6 = gts_edge_new(ecls, v2, v3);
-    GtsEdge * e7 = gts_edge_new(ecls, v3, v4);
-    GtsEdge * e8 = gts_edge_new(ecls, v4, v1);
-
-    GtsFaceClass * fcls = gts_face_class();
-    GtsFace * f1 = gts_face_new(fcls, e1, e2, e5);
-    GtsFace * f2 = gts_face_new(fcls, e2, e3, e6);
-    GtsFace * f3 = gts_face_new(fcls, e3, e4, e7);
-    GtsFace * f4 = gts_face_new(fcls, e4, e1, e8);
-
-    gts_surface_add_face(gtsSurface, f1);
-    gts_surface_add_face(gtsSurface, f2);
-    gts_surface_add_face(gtsSurface, f3);
-    gts_surface_add_face(gtsSurface, f4);
-
-    gts_surface_refine(gtsSurface,
-        refineCost, nullptr,
-        refineEdge, nullptr,
-        refineStop, nullptr);
+    GtsSurface * gtsSurface = buildSurface();
+
+    ProjectionCache cache = {};
+    if (levels > 0) {
+        gts_surface_subdivide_uniform(gtsSurface, levels,
+            refineEdge, &cache, 0);
+        DEBUG("Subdivided to %u faces", gts_surface_face_number(gtsSurface));
+    } else {
+        refineSurface(gtsSurface, cache, tolerance, 0);
+        DEBUG("Refined to %u faces, deviation %g%s",
+            gts_surface_face_number(gtsSurface), tolerance.bound,
+            tolerance.budget_exceeded ? " (face budget exceeded)" : "");
+    }
+    DEBUG("Projection cache: %zu hits, %zu misses",
+        cache.hits.load(), cache.misses.load());
+    DEBUG("Projection: %zu solves, %zu iterations",
+        projectionStats.calls.load(), projectionStats.iterations.load());
 
-    std::vector<float> buffer;
-    gts_surface_foreach_face(gtsSurface,
-        [] (gpointer item, gpointer data) {
-            std::vector<float> & buffer =
-                *reinterpret_cast<std::vector<float>*>(data);
-            GtsFace * face = GTS_FACE(item);
-            GtsEdge * e1 = face->triangle.e1;
-            GtsEdge * e2 = face->triangle.e2;
-            GtsVertex * v1 = e1->segment.v1;
-            GtsVertex * v2 = e1->segment.v2;
-            GtsVertex * v3 = (e2->segment.v1 == v1 || e2->segment.v1 == v2)
-                ? e2->segment.v2
-                : e2->segment.v1;
-            buffer.push_back(v1->p.x);
-            buffer.push_back(v1->p.y);
-            buffer.push_back(v1->p.z);
-            buffer.push_back(v2->p.x);
-            buffer.push_back(v2->p.y);
-            buffer.push_back(v2->p.z);
-            buffer.push_back(v3->p.x);
-            buffer.push_back(v3->p.y);
-            buffer.push_back(v3->p.z);
-            return 0;
-        }, &buffer);
+    std::shared_ptr<GtsSurfaceBuffers> buffers(
+        gts_surface_buffers_new(gtsSurface, FALSE),
+        [] (GtsSurfaceBuffers * b) { gts_surface_buffers_destroy(b); });
 
     DEBUG("Creating vertex buffer ...");
     GLuint vertexBuffer = 0;
     VGL(glGenBuffers, 1, &vertexBuffer);
     VGL(glBindBuffer, GL_ARRAY_BUFFER, vertexBuffer);
     VGL(glBufferData, GL_ARRAY_BUFFER,
-        buffer.size() * sizeof(float), buffer.data(), GL_STATIC_DRAW);
+        buffers->nvertices * buffers->stride * sizeof(float),
+        buffers->vertices, GL_STATIC_DRAW);
     VGL(glBindBuffer, GL_ARRAY_BUFFER, 0);
 
+    DEBUG("Creating index buffer ...");
+    GLuint indexBuffer = 0;
+    VGL(glGenBuffers, 1, &indexBuffer);
+    VGL(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    VGL(glBufferData, GL_ELEMENT_ARRAY_BUFFER,
+        buffers->nfaces * 3 * sizeof(guint32),
+        buffers->indices, GL_STATIC_DRAW);
+    VGL(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, 0);
+
     DEBUG("Building vertex shader ...");
     const char * vertexShaderSource = R"(
         in vec3 pos;
@@ -278,7 +197,10 @@ int main()
         VGL(glEnableVertexAttribArray, 0);
         VGL(glBindBuffer, GL_ARRAY_BUFFER, 0);
 
-        VGL(glDrawArrays, GL_TRIANGLES, 0, buffer.size() / 3);
+        VGL(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        VGL(glDrawElements,
+            GL_TRIANGLES, buffers->nfaces * 3, GL_UNSIGNED_INT, NULL);
+        VGL(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, 0);
 
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -0,0 +1,408 @@
+#include "triangulation.h"
+#include "surfaces.h"
+#include <gsl/gsl_multimin.h>
+#include <math.h>
+#include <memory>
+#include <string.h>
+
+ProjectionEngine projectionEngine = ProjectionEngine::Newton;
+
+CostModel costModel = CostModel::Exact;
+
+ObjectAllocator objectAllocator = ObjectAllocator::Slab;
+
+double refineSlack = 0.0;
+
+ProjectionStats projectionStats = {};
+
+struct SimplexParams
+{
+    glm::dvec3 p;
+};
+
+template <typename Surface>
+glm::dvec3 nearestPointSimplex(glm::vec3 p, glm::dvec2 start, double step)
+{
+    std::shared_ptr<gsl_multimin_fminimizer> minimizer(
+        gsl_multimin_fminimizer_alloc(
+            gsl_multimin_fminimizer_nmsimplex2, 2),
+        [] (gsl_multimin_fminimizer * m) {
+            gsl_multimin_fminimizer_free(m);
+        });
+
+    SimplexParams params = { glm::dvec3(p) };
+    gsl_multimin_function function;
+    function.n = 2;
+    function.params = &params;
+    function.f = [] (const gsl_vector * in, void * params) -> double {
+        const SimplexParams & sp = *reinterpret_cast<SimplexParams*>(params);
+        const double x = gsl_vector_get(in, 0);
+        const double y = gsl_vector_get(in, 1);
+        const double z = Surface::value(x, y);
+        return glm::length(sp.p - glm::dvec3(x, y, z));
+    };
+
+    std::shared_ptr<gsl_vector> initVals(gsl_vector_alloc(2),
+        [] (gsl_vector * v) { gsl_vector_free(v); });
+    gsl_vector_set(initVals.get(), 0, start.x);
+    gsl_vector_set(initVals.get(), 1, start.y);
+
+    std::shared_ptr<gsl_vector> initSteps(gsl_vector_alloc(2),
+        [] (gsl_vector * v) { gsl_vector_free(v); });
+    gsl_vector_set(initSteps.get(), 0, step);
+    gsl_vector_set(initSteps.get(), 1, step);
+
+    gsl_multimin_fminimizer_set(
+        minimizer.get(), &function, initVals.get(), initSteps.get());
+
+    size_t iterations = 0;
+    do {
+        gsl_multimin_fminimizer_iterate(minimizer.get());
+        iterations ++;
+    } while(gsl_multimin_test_size(minimizer->size, 1e-7) == GSL_CONTINUE);
+    projectionStats.iterations += iterations;
+
+    const double x = gsl_vector_get(minimizer->x, 0);
+    const double y = gsl_vector_get(minimizer->x, 1);
+    const double z = Surface::value(x, y);
+    return glm::dvec3(x, y, z);
+}
+
+// Minimizes d(x, y) = |p - (x, y, f(x, y))|^2 / 2 with Newton steps. Where
+// the Hessian of d is not positive definite the step is damped towards
+// steepest descent, and a backtracking line search keeps every step
+// decreasing d.
+template <typename Surface>
+glm::dvec3 nearestPointNewton(glm::vec3 p, glm::dvec2 start)
+{
+    const glm::dvec3 q = p;
+    auto distance2 = [&] (double x, double y) -> double {
+        const glm::dvec3 d = q - glm::dvec3(x, y, Surface::value(x, y));
+        return glm::dot(d, d);
+    };
+
+    double x = start.x;
+    double y = start.y;
+    size_t iterations = 0;
+    while (iterations < 50) {
+        iterations ++;
+
+        const double dz = Surface::value(x, y) - q.z;
+        const glm::dvec2 g = Surface::gradient(x, y);
+        const glm::dvec3 h = Surface::hessian(x, y);
+        const double gx = (x - q.x) + dz * g.x;
+        const double gy = (y - q.y) + dz * g.y;
+        const double hxx = 1.0 + g.x * g.x + dz * h.x;
+        const double hxy = g.x * g.y + dz * h.y;
+        const double hyy = 1.0 + g.y * g.y + dz * h.z;
+
+        double lambda = 0.0;
+        double det = hxx * hyy - hxy * hxy;
+        while (hxx + lambda <= 0.0 || det <= 0.0) {
+            lambda = (lambda == 0.0)
+                ? 1e-3 * (fabs(hxx) + fabs(hyy) + 1.0)
+                : lambda * 10.0;
+            det = (hxx + lambda) * (hyy + lambda) - hxy * hxy;
+        }
+        const double sx = -((hyy + lambda) * gx - hxy * gy) / det;
+        const double sy = -((hxx + lambda) * gy - hxy * gx) / det;
+
+        const double d0 = distance2(x, y);
+        double t = 1.0;
+        while (t > 1e-10 && distance2(x + t * sx, y + t * sy) > d0)
+            t /= 2.0;
+        x += t * sx;
+        y += t * sy;
+
+        if (t * sqrt(sx * sx + sy * sy) < 1e-10)
+            break;
+    }
+    projectionStats.iterations += iterations;
+
+    return glm::dvec3(x, y, Surface::value(x, y));
+}
+
+template <typename Surface>
+constexpr HeightField heightFieldFor(const char * name)
+{
+    return HeightField {
+        name,
+        Surface::template value<double>,
+        Surface::evaluate,
+        Surface::evaluateGradient,
+        nearestPointSimplex<Surface>,
+        nearestPointNewton<Surface>
+    };
+}
+
+const HeightField heightFields[] = {
+    heightFieldFor<Pow5Surface>("pow5"),
+    heightFieldFor<ParaboloidSurface>("paraboloid"),
+    heightFieldFor<SaddleSurface>("saddle")
+};
+
+const size_t heightFieldCount = sizeof(heightFields) / sizeof(heightFields[0]);
+
+const HeightField * heightField = &heightFields[0];
+
+const HeightField * findHeightField(const char * name)
+{
+    for (size_t i = 0; i < heightFieldCount; i ++)
+        if (strcmp(heightFields[i].name, name) == 0)
+            return &heightFields[i];
+    return nullptr;
+}
+
+// Projects p onto the surface starting from the parameters start. The
+// simplex engine uses step as its initial step size.
+glm::dvec3 nearestPoint(glm::vec3 p, glm::dvec2 start, double step)
+{
+    projectionStats.calls ++;
+    switch (projectionEngine) {
+    case ProjectionEngine::Simplex:
+        return heightField->nearestSimplex(p, start, step);
+    case ProjectionEngine::Newton:
+        return heightField->nearestNewton(p, start);
+    }
+    ERROR("Unknown projection engine");
+}
+
+// The classes are initialized once, whichever thread uses them first
+GtsVertexClass * parametricVertexClass()
+{
+    static GtsVertexClass * const klass = [] {
+        GtsObjectClassInfo info = {
+            "ParametricVertex",
+            sizeof(ParametricVertex),
+            sizeof(GtsVertexClass),
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr
+        };
+        GtsVertexClass * k = GTS_VERTEX_CLASS(gts_object_class_new(
+            GTS_OBJECT_CLASS(gts_vertex_class()), &info));
+        if (objectAllocator != ObjectAllocator::Malloc)
+            gts_object_class_use_slab(GTS_OBJECT_CLASS(k));
+        return k;
+    }();
+
+    return klass;
+}
+
+GtsVertex * surfaceVertex(GtsVertexClass * vcls, double x, double y)
+{
+    GtsVertex * v = gts_vertex_new(vcls, x, y, heightField->f(x, y));
+    if (gts_object_is_from_class(v, parametricVertexClass()))
+        reinterpret_cast<ParametricVertex*>(v)->uv = glm::dvec2(x, y);
+    return v;
+}
+
+glm::dvec2 vertexParameters(GtsVertex * v)
+{
+    if (gts_object_is_from_class(v, parametricVertexClass()))
+        return reinterpret_cast<ParametricVertex*>(v)->uv;
+    return glm::dvec2(v->p.x, v->p.y);
+}
+
+GtsEdgeClass * projectedEdgeClass()
+{
+    static GtsEdgeClass * const klass = [] {
+        GtsObjectClassInfo info = {
+            "ProjectedEdge",
+            sizeof(ProjectedEdge),
+            sizeof(GtsEdgeClass),
+            nullptr,
+            [] (GtsObject * object) {
+                reinterpret_cast<ProjectedEdge*>(object)->projected = false;
+            },
+            nullptr,
+            nullptr
+        };
+        GtsEdgeClass * k = GTS_EDGE_CLASS(gts_object_class_new(
+            GTS_OBJECT_CLASS(gts_edge_class()), &info));
+        if (objectAllocator != ObjectAllocator::Malloc)
+            gts_object_class_use_slab(GTS_OBJECT_CLASS(k));
+        return k;
+    }();
+
+    return klass;
+}
+
+// A private class rather than gts_face_class(), whose slab would also
+// release the faces allocated with malloc before it was enabled
+GtsFaceClass * surfaceFaceClass()
+{
+    static GtsFaceClass * const klass = [] {
+        GtsObjectClassInfo info = {
+            "SurfaceFace",
+            sizeof(GtsFace),
+            sizeof(GtsFaceClass),
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr
+        };
+        GtsFaceClass * k = GTS_FACE_CLASS(gts_object_class_new(
+            GTS_OBJECT_CLASS(gts_face_class()), &info));
+        if (objectAllocator != ObjectAllocator::Malloc)
+            gts_object_class_use_slab(GTS_OBJECT_CLASS(k));
+        return k;
+    }();
+
+    return klass;
+}
+
+// Both endpoints of an edge lie on the surface, so the projection of its
+// midpoint starts from their interpolated parameters, with a step scaled
+// to the length of the edge.
+glm::dvec3 projectMidpoint(GtsEdge * e, ProjectionCache & cache)
+{
+    const bool cacheable = gts_object_is_from_class(e, projectedEdgeClass());
+    ProjectedEdge * pe = reinterpret_cast<ProjectedEdge*>(e);
+    if (cacheable && pe->projected) {
+        cache.hits ++;
+        return pe->projection;
+    }
+
+    cache.misses ++;
+    glm::vec3 v1 = VECTOR(e->segment.v1);
+    glm::vec3 v2 = VECTOR(e->segment.v2);
+    glm::dvec2 start = (vertexParameters(e->segment.v1) +
+        vertexParameters(e->segment.v2)) / 2.0;
+    double step = 0.01 * glm::length(glm::dvec3(v2 - v1));
+    glm::dvec3 projection = nearestPoint((v1 + v2) / 2.0f, start, step);
+    if (cacheable) {
+        pe->projection = projection;
+        pe->projected = true;
+    }
+    return projection;
+}
+
+GtsSurface * buildSurface()
+{
+    GtsSurface * surface = gts_surface_new(
+        gts_surface_class(),
+        surfaceFaceClass(),
+        projectedEdgeClass(),
+        parametricVertexClass());
+    if (objectAllocator == ObjectAllocator::Arena) {
+        gts_surface_set_arena(surface, gts_arena_new());
+        gts_arena_push(surface->arena);
+    }
+
+    GtsVertexClass * vcls = parametricVertexClass();
+    GtsVertex * v0 = surfaceVertex(vcls, 0.0f, 0.0f);
+    GtsVertex * v1 = surfaceVertex(vcls, 1.0f, 0.0f);
+    GtsVertex * v2 = surfaceVertex(vcls, 0.0f, 1.0f);
+    GtsVertex * v3 = surfaceVertex(vcls, -1.0f, 0.0f);
+    GtsVertex * v4 = surfaceVertex(vcls, 0.0f, -1.0f);
+
+    GtsEdgeClass * ecls = projectedEdgeClass();
+    GtsEdge * e1 = gts_edge_new(ecls, v0, v1);
+    GtsEdge * e2 = gts_edge_new(ecls, v0, v2);
+    GtsEdge * e3 = gts_edge_new(ecls, v0, v3);
+    GtsEdge * e4 = gts_edge_new(ecls, v0, v4);
+    GtsEdge * e5 = gts_edge_new(ecls, v1, v2);
+    GtsEdge * e6 = gts_edge_new(ecls, v2, v3);
+    GtsEdge * e7 = gts_edge_new(ecls, v3, v4);
+    GtsEdge * e8 = gts_edge_new(ecls, v4, v1);
+
+    GtsFaceClass * fcls = surfaceFaceClass();
+    GtsFace * f1 = gts_face_new(fcls, e1, e2, e5);
+    GtsFace * f2 = gts_face_new(fcls, e2, e3, e6);
+    GtsFace * f3 = gts_face_new(fcls, e3, e4, e7);
+    GtsFace * f4 = gts_face_new(fcls, e4, e1, e8);
+
+    gts_surface_add_face(surface, f1);
+    gts_surface_add_face(surface, f2);
+    gts_surface_add_face(surface, f3);
+    gts_surface_add_face(surface, f4);
+
+    if (surface->arena)
+        gts_arena_pop(surface->arena);
+    return surface;
+}
+
+// Called concurrently by gts_surface_refine_parallel(), each edge being
+// evaluated by exactly one thread, and so is refineEdge() by
+// gts_surface_refine_independent()
+gdouble refineCost(gpointer item, gpointer data)
+{
+    GtsEdge * e = GTS_EDGE(item);
+    glm::vec3 v1 = VECTOR(e->segment.v1);
+    glm::vec3 v2 = VECTOR(e->segment.v2);
+    glm::dvec3 mv = (v1 + v2) / 2.0f;
+    glm::dvec3 nv = projectMidpoint(e,
+        *reinterpret_cast<ProjectionCache*>(data));
+    return -glm::length(mv - nv);
+}
+
+GtsVertex * refineEdge(GtsEdge * e, GtsVertexClass * vcls, gpointer data)
+{
+    glm::dvec3 nv = projectMidpoint(e,
+        *reinterpret_cast<ProjectionCache*>(data));
+    return surfaceVertex(vcls, nv.x, nv.y);
+}
+
+void refineCostEstimates(gpointer * items, gdouble * keys, guint n,
+                         gpointer data)
+{
+    const size_t block = 256;
+    double x[block], y[block], z[block], fz[block], fx[block], fy[block];
+
+    for (guint start = 0; start < n; start += block) {
+        const size_t count = MIN(block, n - start);
+        for (size_t i = 0; i < count; i ++) {
+            GtsSegment * s = GTS_SEGMENT(items[start + i]);
+            const glm::dvec2 uv = (vertexParameters(s->v1) +
+                vertexParameters(s->v2)) / 2.0;
+            x[i] = uv.x;
+            y[i] = uv.y;
+            z[i] = (s->v1->p.z + s->v2->p.z) / 2.0;
+        }
+        heightField->evaluateGradient(x, y, fz, fx, fy, count);
+        for (size_t i = 0; i < count; i ++)
+            keys[start + i] = -fabs(z[i] - fz[i]) /
+                sqrt(1.0 + fx[i] * fx[i] + fy[i] * fy[i]);
+    }
+}
+
+gdouble refineCostEstimate(gpointer item, gpointer data)
+{
+    gdouble key;
+    refineCostEstimates(&item, &key, 1, data);
+    return key;
+}
+
+void refineSurface(GtsSurface * surface, ProjectionCache & cache,
+                   GtsRefineTolerance & stop, guint nthreads)
+{
+    if (refineSlack > 0.0) {
+        const bool estimate = costModel == CostModel::Estimate;
+        gts_surface_refine_independent(surface,
+            estimate ? refineCostEstimates : nullptr,
+            estimate ? refineCostEstimate : refineCost, &cache,
+            refineEdge, &cache,
+            (GtsStopFunc) gts_refine_stop_tolerance, &stop,
+            refineSlack, nthreads);
+        return;
+    }
+
+    switch (costModel) {
+    case CostModel::Exact:
+        gts_surface_refine_parallel(surface,
+            refineCost, &cache,
+            refineEdge, &cache,
+            (GtsStopFunc) gts_refine_stop_tolerance, &stop,
+            nthreads);
+        break;
+    case CostModel::Estimate:
+        gts_surface_refine_batch(surface,
+            refineCostEstimates, refineCostEstimate, &cache,
+            refineEdge, &cache,
+            (GtsStopFunc) gts_refine_stop_tolerance, &stop,
+            nthreads);
+        break;
+    }
+}
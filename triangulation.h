@@ -0,0 +1,138 @@
+#ifndef TRIANGULATION_H
+#define TRIANGULATION_H
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <gts.h>
+#include <stdio.h>
+
+#define DEBUG(...) \
+    printf(__VA_ARGS__); \
+    printf("\n");
+
+#define ERROR(...) \
+    DEBUG(__VA_ARGS__); \
+    throw 0;
+
+#define VECTOR(vertex) \
+    glm::vec3(vertex->p.x, vertex->p.y, vertex->p.z)
+
+enum class ProjectionEngine
+{
+    Simplex,
+    Newton
+};
+
+// How the refinement orders the edges: by the exact distance between their
+// midpoint and the surface, or by a first order estimate of it, projecting
+// only the midpoints of the edges actually split
+enum class CostModel
+{
+    Exact,
+    Estimate
+};
+
+// Where the vertices, edges and faces are allocated from: individually with
+// g_malloc(), from slabs recycling the destroyed objects, or from an arena
+// released at once together with the surface. Only read when the classes
+// are first used.
+enum class ObjectAllocator
+{
+    Malloc,
+    Slab,
+    Arena
+};
+
+// Updated concurrently while the refinement heap is being seeded
+struct ProjectionStats
+{
+    std::atomic<size_t> calls;
+    std::atomic<size_t> iterations;
+};
+
+// Surface model from surfaces.h together with the projection solvers
+// instantiated for it, so that the model is only dispatched once per
+// projection
+struct HeightField
+{
+    const char * name;
+    double (* f)(double x, double y);
+    void (* evaluate)(const double * x, const double * y, double * z,
+                      size_t n);
+    void (* evaluateGradient)(const double * x, const double * y, double * z,
+                              double * fx, double * fy, size_t n);
+    glm::dvec3 (* nearestSimplex)(glm::vec3 p, glm::dvec2 start, double step);
+    glm::dvec3 (* nearestNewton)(glm::vec3 p, glm::dvec2 start);
+};
+
+// Vertex lying on the surface, together with its parameters (x, y) on the
+// height field in full precision
+struct ParametricVertex
+{
+    GtsVertex vertex;
+    glm::dvec2 uv;
+};
+
+// Edge that remembers the projection of its midpoint onto the surface. The
+// projection is computed once by the cost function and reused when the edge
+// gets split, and it goes away together with the edge when
+// midvertex_insertion() destroys it.
+struct ProjectedEdge
+{
+    GtsEdge edge;
+    bool projected;
+    glm::dvec3 projection;
+};
+
+struct ProjectionCache
+{
+    std::atomic<size_t> hits;
+    std::atomic<size_t> misses;
+};
+
+extern ProjectionEngine projectionEngine;
+extern CostModel costModel;
+extern ObjectAllocator objectAllocator;
+
+// How far from the order of their costs the edges may be refined, so that
+// independent edges are refined in parallel, or 0 to refine them one by one
+// with gts_surface_refine_parallel() or gts_surface_refine_batch()
+extern double refineSlack;
+extern ProjectionStats projectionStats;
+
+extern const HeightField heightFields[];
+extern const size_t heightFieldCount;
+extern const HeightField * heightField;
+
+// Returns nullptr if there is no height field with the given name
+const HeightField * findHeightField(const char * name);
+
+glm::dvec3 nearestPoint(glm::vec3 p, glm::dvec2 start, double step);
+
+GtsVertexClass * parametricVertexClass();
+GtsEdgeClass * projectedEdgeClass();
+GtsFaceClass * surfaceFaceClass();
+GtsVertex * surfaceVertex(GtsVertexClass * vcls, double x, double y);
+
+// Builds the initial coarse approximation of the height field over the
+// unit diamond, owning an arena with ObjectAllocator::Arena
+GtsSurface * buildSurface();
+
+// Callbacks for gts_surface_refine_parallel() and
+// gts_surface_refine_independent(), the data of both being a
+// ProjectionCache. The cost of an edge is minus the distance between its
+// midpoint and the surface, to be used with gts_refine_stop_tolerance().
+gdouble refineCost(gpointer item, gpointer data);
+GtsVertex * refineEdge(GtsEdge * e, GtsVertexClass * vcls, gpointer data);
+
+// Estimated costs, |z - f(x, y)| / |(fx, fy, -1)| at the midpoints of the
+// edges, sampled with the batch kernels of the surface model
+void refineCostEstimates(gpointer * items, gdouble * keys, guint n,
+                         gpointer data);
+gdouble refineCostEstimate(gpointer item, gpointer data);
+
+// Refines surface with the current cost model until stop is met
+void refineSurface(GtsSurface * surface, ProjectionCache & cache,
+                   GtsRefineTolerance & stop, guint nthreads);
+
+#endif // TRIANGULATION_H